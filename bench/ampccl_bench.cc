@@ -0,0 +1,298 @@
+// ampccl-bench: host-side hot-path microbenchmarks (no devices, no NCCL/HCCL).
+// Everything a hooked collective touches on the CPU: config lookups, comm -> domain
+// lookup under contention, param cache, planner, shm param store, stream pending
+// table and a full VirtualCollective::AllReduce launch on the core's stub backends.
+//
+//   ./build/ampccl-bench
+//   ./build/ampccl-bench --benchmark_filter=Shm --benchmark_format=json > shm.json
+//   ./build/ampccl-bench --benchmark_out=base.json   # console + JSON file
+
+#include "bench.h"
+#include "common/config.h"
+#include "common/op_key.h"
+#include "cache/param_cache.h"
+#include "core/domain_key.h"
+#include "core/domain_manager.h"
+#include "core/planner.h"
+#include "core/shm_store.h"
+#include "core/virtual_collective.h"
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+using namespace ampccl;
+
+constexpr int kFloat32 = 7;  // ncclFloat32
+
+OpKey MakeKey(CollectiveType op, size_t bytes) {
+    OpKey k;
+    k.op = op;
+    k.bytes = bytes;
+    k.datatype = kFloat32;
+    return k;
+}
+
+// Keys unique to this process so benchmark shm segments never meet a real job's.
+CommDomainKey MakeDomainKey(int nranks, int salt) {
+    CommDomainKey key;
+    key.world_size = nranks;
+    for (int r = 0; r < nranks; ++r) key.ranks.push_back(r);
+    key.comm_id.lo = static_cast<uint64_t>(salt);
+    key.job = "ampccl-bench-" + std::to_string(getpid());
+    return key;
+}
+
+// ---------------------------------------------------------------------------
+// Config: every getter is a getenv + parse on each call.
+
+void BM_ConfigIsAdaptiveEnabled(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::IsAdaptiveEnabled());
+}
+BENCHMARK(BM_ConfigIsAdaptiveEnabled);
+
+void BM_ConfigIsPCIeEnabled(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::IsPCIeEnabled());
+}
+BENCHMARK(BM_ConfigIsPCIeEnabled);
+
+void BM_ConfigGetMinMsgSize(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::GetMinMsgSize());
+}
+BENCHMARK(BM_ConfigGetMinMsgSize);
+
+void BM_ConfigGetAlgorithm(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::GetAlgorithm());
+}
+BENCHMARK(BM_ConfigGetAlgorithm);
+
+void BM_ConfigGetStatSyncMode(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::GetStatSyncMode(8));
+}
+BENCHMARK(BM_ConfigGetStatSyncMode);
+
+void BM_ConfigGetPCIeDeadlineSeconds(bench::State& state) {
+    for (auto _ : state) bench::DoNotOptimize(Config::GetPCIeDeadlineSeconds());
+}
+BENCHMARK(BM_ConfigGetPCIeDeadlineSeconds);
+
+// ---------------------------------------------------------------------------
+// DomainManager: raw comm -> domain under the manager mutex, 1-32 hook threads.
+
+constexpr int kRawComms = 64;
+
+void* RawComm(int i) {
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(0x10000 + 64 * i));
+}
+
+void BM_GetDomainByRawComm(bench::State& state) {
+    DomainManager& dm = DomainManager::GetInstance();
+    void* comm = RawComm(state.thread_index() % kRawComms);
+    for (auto _ : state) bench::DoNotOptimize(dm.GetDomainByRawComm(comm));
+}
+BENCHMARK(BM_GetDomainByRawComm)
+    ->ThreadRange(1, 32)
+    ->Setup([](const bench::State&) {
+        for (int i = 0; i < kRawComms; ++i) {
+            DomainManager::GetInstance().RegisterRawComm(RawComm(i), MakeDomainKey(8, i));
+        }
+    })
+    ->Teardown([](const bench::State&) {
+        for (int i = 0; i < kRawComms; ++i) DomainManager::GetInstance().UnregisterRawComm(RawComm(i));
+    });
+
+// Key digest (shm segment name, domain creation): paid once per communicator init.
+void BM_CommDomainKeyDigest(bench::State& state) {
+    CommDomainKey key = MakeDomainKey(static_cast<int>(state.range(0)), 0);
+    for (auto _ : state) bench::DoNotOptimize(key.Digest());
+}
+BENCHMARK(BM_CommDomainKeyDigest)->ArgName("ranks")->Arg(8)->Arg(128);
+
+// ---------------------------------------------------------------------------
+// ParamCache: arg = entries already in the table.
+
+void FillCache(ParamCache* cache, int entries) {
+    for (int i = 0; i < entries; ++i) {
+        cache->Update(MakeKey(static_cast<CollectiveType>(i % 4), static_cast<size_t>(4096) << (i / 4 % 20) | i),
+                      ParamValue(0.7, true, 40.0, 12.0));
+    }
+}
+
+void BM_ParamCacheLookupHit(bench::State& state) {
+    ParamCache cache;
+    FillCache(&cache, static_cast<int>(state.range(0)));
+    OpKey key = MakeKey(CollectiveType::AllReduce, 1 << 20);
+    cache.Update(key, ParamValue(0.6, true, 40.0, 12.0));
+    for (auto _ : state) bench::DoNotOptimize(cache.Lookup(key));
+}
+BENCHMARK(BM_ParamCacheLookupHit)->ArgName("entries")->Arg(16)->Arg(256);
+
+void BM_ParamCacheLookupMiss(bench::State& state) {
+    ParamCache cache;
+    FillCache(&cache, static_cast<int>(state.range(0)));
+    OpKey key = MakeKey(CollectiveType::Broadcast, 12345);
+    for (auto _ : state) bench::DoNotOptimize(cache.Lookup(key));
+}
+BENCHMARK(BM_ParamCacheLookupMiss)->ArgName("entries")->Arg(16)->Arg(256);
+
+void BM_ParamCacheUpdate(bench::State& state) {
+    ParamCache cache;
+    FillCache(&cache, static_cast<int>(state.range(0)));
+    OpKey key = MakeKey(CollectiveType::AllReduce, 1 << 20);
+    ParamValue v(0.6, true, 40.0, 12.0);
+    for (auto _ : state) {
+        v.alpha = 1.0 - v.alpha;
+        cache.Update(key, v);
+    }
+}
+BENCHMARK(BM_ParamCacheUpdate)->ArgName("entries")->Arg(16)->Arg(256);
+
+// ---------------------------------------------------------------------------
+// Planner
+
+void BM_CreatePlan(bench::State& state) {
+    size_t bytes = static_cast<size_t>(state.range(0));
+    double alpha = 0.7;
+    for (auto _ : state) {
+        bench::DoNotOptimize(alpha);
+        bench::DoNotOptimize(Planner::CreatePlan(bytes, alpha, true));
+    }
+}
+BENCHMARK(BM_CreatePlan)->ArgName("bytes")->Arg(4096)->Arg(1 << 20)->Arg(256 << 20);
+
+// ---------------------------------------------------------------------------
+// ShmParamStore at 8/64/128 ranks. One segment per run, attached as rank 0 with every
+// rank's stat slot and 64 param entries filled, unlinked afterwards.
+
+struct ShmFixture {
+    CommDomainKey key;
+    std::unique_ptr<ShmParamStore> store;
+    ParamCache cache;
+};
+ShmFixture* g_shm = nullptr;
+
+void ShmSetup(const bench::State& state) {
+    int nranks = static_cast<int>(state.range(0));
+    g_shm = new ShmFixture;
+    g_shm->key = MakeDomainKey(nranks, 0x5000 + nranks);
+    g_shm->store.reset(new ShmParamStore);
+    if (!g_shm->store->Attach(g_shm->key, 0, nranks)) {
+        std::fprintf(stderr, "ampccl-bench: shm attach failed (%d ranks)\n", nranks);
+        std::exit(1);
+    }
+    FillCache(&g_shm->cache, 64);
+    g_shm->store->WriteParams(g_shm->cache);
+    ExecStat stat;
+    stat.fast_time = 1e-3;
+    stat.pcie_time = 9e-4;
+    stat.fast_bytes = 700 << 10;
+    stat.pcie_bytes = 300 << 10;
+    for (int r = 0; r < nranks; ++r) {
+        g_shm->store->WriteMyStat(r, MakeKey(CollectiveType::AllReduce, 1 << 20), stat);
+    }
+}
+
+// The store is the segment's only attacher: deleting it unlinks the segment.
+void ShmTeardown(const bench::State&) {
+    delete g_shm;
+    g_shm = nullptr;
+}
+
+void BM_ShmReadParams(bench::State& state) {
+    ParamCache cache;
+    for (auto _ : state) g_shm->store->ReadParams(&cache);
+    bench::DoNotOptimize(cache.Size());
+}
+BENCHMARK(BM_ShmReadParams)->ArgName("ranks")->Arg(8)->Arg(64)->Arg(128)->Setup(ShmSetup)->Teardown(ShmTeardown);
+
+void BM_ShmWriteParams(bench::State& state) {
+    for (auto _ : state) g_shm->store->WriteParams(g_shm->cache);
+}
+BENCHMARK(BM_ShmWriteParams)->ArgName("ranks")->Arg(8)->Arg(64)->Arg(128)->Setup(ShmSetup)->Teardown(ShmTeardown);
+
+void BM_ShmReadAllStatsAndAggregate(bench::State& state) {
+    ExecStat stat;
+    OpKey key;
+    for (auto _ : state) {
+        bench::DoNotOptimize(g_shm->store->ReadAllStatsAndAggregate(&stat, &key));
+        bench::ClobberMemory();
+    }
+}
+BENCHMARK(BM_ShmReadAllStatsAndAggregate)
+    ->ArgName("ranks")->Arg(8)->Arg(64)->Arg(128)->Setup(ShmSetup)->Teardown(ShmTeardown);
+
+// ---------------------------------------------------------------------------
+// Stream pending table: register at launch + take at sync, one stream per thread.
+
+void BM_StreamPendingRoundTrip(bench::State& state) {
+    DomainManager& dm = DomainManager::GetInstance();
+    void* stream = reinterpret_cast<void*>(static_cast<uintptr_t>(0x900000 + 64 * state.thread_index()));
+    OpKey key = MakeKey(CollectiveType::AllReduce, 1 << 20);
+    Plan plan = Planner::CreatePlan(key.bytes, 0.7, true);
+    for (auto _ : state) {
+        dm.RegisterStreamPending(stream, nullptr, key, plan, true, true);
+        bench::DoNotOptimize(dm.TakeStreamPending(stream));
+    }
+}
+BENCHMARK(BM_StreamPendingRoundTrip)->ThreadRange(1, 8);
+
+// ---------------------------------------------------------------------------
+// Full VirtualCollective::AllReduce launch. Args: bytes, ranks. 4 KB stays below the
+// PCIe crossover (fast only); 64 MB splits onto a placeholder PCIe stream. ranks > 1
+// attaches the shm store as rank 0, which aggregates stats and republishes params on
+// every call. Stub backends return immediately, so this is AmpCCL's own cost.
+
+CommDomain* g_domain = nullptr;
+
+void CollectiveSetup(const bench::State& state) {
+    int nranks = static_cast<int>(state.range(1));
+    CommDomainKey key = MakeDomainKey(nranks, 0x7000 + nranks);
+    g_domain = DomainManager::GetInstance().GetOrCreateDomainByKey(key);
+    g_domain->set_comm_rank(0);
+    g_domain->set_pcie_rank(0);
+    g_domain->set_pcie_nranks(nranks);
+    g_domain->set_pcie_stream(reinterpret_cast<void*>(static_cast<uintptr_t>(0xa00000)));
+}
+
+void CollectiveTeardown(const bench::State& state) {
+    if (static_cast<int>(state.range(1)) > 1) {
+        shm_unlink(ShmParamStore::ShmNameForKey(g_domain->key).c_str());
+    }
+    g_domain = nullptr;
+}
+
+void BM_VirtualAllReduce(bench::State& state) {
+    size_t count = static_cast<size_t>(state.range(0)) / sizeof(float);
+    void* comm = reinterpret_cast<void*>(static_cast<uintptr_t>(0xb00000));
+    void* stream = reinterpret_cast<void*>(static_cast<uintptr_t>(0xc00000));
+    char sendbuf[64];
+    char recvbuf[64];
+    for (auto _ : state) {
+        bench::DoNotOptimize(VirtualCollective::AllReduce(g_domain, sendbuf, recvbuf, count, kFloat32,
+                                                          /*op=*/0, comm, stream));
+    }
+    bool split = g_domain->controller->UsePCIe(MakeKey(CollectiveType::AllReduce, count * sizeof(float)),
+                                               g_domain->param_cache);
+    state.SetLabel(split ? "split" : "fast-only");
+    DomainManager::GetInstance().TakeStreamPending(stream);
+}
+BENCHMARK(BM_VirtualAllReduce)
+    ->ArgNames({"bytes", "ranks"})
+    ->Args({4 << 10, 1})
+    ->Args({64 << 20, 1})
+    ->Args({64 << 20, 8})
+    ->Setup(CollectiveSetup)
+    ->Teardown(CollectiveTeardown);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    // The split path is what is being measured; respect an explicit AMPCCL_ENABLE_PCIE=0.
+    setenv("AMPCCL_ENABLE_PCIE", "1", 0);
+    return bench::Main(argc, argv);
+}
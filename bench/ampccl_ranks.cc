@@ -0,0 +1,593 @@
+// ampccl-ranks: multi-process harness for the shm parameter path (scheme A).
+// Forks N rank processes that attach to one ShmParamStore, like the ranks of a job on
+// one node, and drive the same scripted collective schedule through
+// VirtualCollective. The fast library and device events are stand-ins registered
+// through FastBackendOps / DeviceEventOps: each stream keeps a modelled clock that a
+// collective advances by latency + bytes / bandwidth, scaled by a fixed per-rank skew
+// and a per-collective jitter, so the controllers see realistic, rank-dependent times
+// without devices or real waiting. Ranks also sleep a random time before each call so
+// their hosts drift relative to rank 0, and meet at a barrier where the application
+// would synchronize the stream.
+//
+// The parent then checks that every rank used rank 0's split for every collective and
+// reports, per rank count: collectives until rank 0's alpha settled, the lag between a
+// stat being measured and its update applying, dropped updates, and the host time each
+// call spent in AmpCCL (including waits for rank 0).
+//
+//   ./build/ampccl-ranks                                  # 2, 8, 32, 128 ranks
+//   ./build/ampccl-ranks --ranks 8 --algo model --sizes 1M,64M --collectives 2000
+//   ./build/ampccl-ranks --shift 500,40,6 --json          # PCIe drops to 6 GB/s at #500
+
+#include "backend/fast_backend.h"
+#include "common/op_key.h"
+#include "core/domain.h"
+#include "core/domain_key.h"
+#include "core/domain_manager.h"
+#include "core/shm_store.h"
+#include "core/stream_sync.h"
+#include "core/virtual_collective.h"
+#include "telemetry/timer.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace ampccl;
+
+constexpr int kFloat32 = 7;  // ncclFloat32
+constexpr int kMaxRanks = 128;
+
+struct PathModel {
+    double lat_s;
+    double gbps;
+
+    double Time(double bytes) const { return bytes > 0 ? lat_s + bytes / (gbps * 1e9) : 0.0; }
+};
+
+struct Options {
+    std::vector<int> ranks{2, 8, 32, 128};
+    std::vector<size_t> sizes{1u << 20, 16u << 20, 64u << 20};
+    int collectives = 600;
+    bool allgather = false;
+    std::string algo;          // AMPCCL_ALGO for the ranks (empty: inherit, else tcp)
+    int lead = -1;             // AMPCCL_PARAM_LEAD (-1: inherit)
+    PathModel fast{10e-6, 40.0};
+    PathModel pcie{20e-6, 12.0};
+    int shift_at = -1;         // Collective from which shift_fast / shift_pcie apply
+    double shift_fast = 0.0;
+    double shift_pcie = 0.0;
+    double skew = 0.1;         // Per-rank time scale in [1 - skew, 1 + skew]
+    double jitter = 0.02;      // Per-collective relative stddev
+    double issue_skew_us = 50; // Host delay before each call, uniform [0, issue_skew_us]
+    int sync_every = 1;        // Stream sync (a cross-rank barrier) every N collectives, 0: never
+    double tol = 0.02;         // Alpha band for convergence
+    bool json = false;
+};
+
+void Usage() {
+    std::fprintf(stderr,
+        "usage: ampccl-ranks [--ranks 2,8,32,128] [--sizes 1M,16M,64M] [--collectives N]\n"
+        "                    [--op allreduce|allgather] [--algo NAME] [--lead N]\n"
+        "                    [--fast-gbps G] [--pcie-gbps G] [--shift AT,FAST_GBPS,PCIE_GBPS]\n"
+        "                    [--skew F] [--jitter F] [--issue-skew-us US] [--sync-every N]\n"
+        "                    [--tol F] [--json]\n");
+}
+
+bool ParseSize(const std::string& s, size_t* out) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (end == s.c_str() || v <= 0) return false;
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': v *= 1024; ++end; break;
+        case 'm': case 'M': v *= 1024 * 1024; ++end; break;
+        case 'g': case 'G': v *= 1024.0 * 1024 * 1024; ++end; break;
+        default: return false;
+    }
+    if (*end != '\0') return false;
+    *out = static_cast<size_t>(v);
+    return true;
+}
+
+std::vector<std::string> Split(const std::string& s) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == std::string::npos) comma = s.size();
+        out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+bool ParseArgs(int argc, char** argv, Options* opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") return false;
+        if (a == "--json") {
+            opt->json = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        std::string v = argv[++i];
+        if (a == "--ranks") {
+            opt->ranks.clear();
+            for (const std::string& r : Split(v)) opt->ranks.push_back(std::atoi(r.c_str()));
+        } else if (a == "--sizes") {
+            opt->sizes.clear();
+            for (const std::string& s : Split(v)) {
+                size_t n = 0;
+                if (!ParseSize(s, &n)) return false;
+                opt->sizes.push_back(n);
+            }
+        } else if (a == "--collectives") opt->collectives = std::atoi(v.c_str());
+        else if (a == "--op") {
+            if (v != "allreduce" && v != "allgather") return false;
+            opt->allgather = (v == "allgather");
+        } else if (a == "--algo") opt->algo = v;
+        else if (a == "--lead") opt->lead = std::atoi(v.c_str());
+        else if (a == "--fast-gbps") opt->fast.gbps = std::atof(v.c_str());
+        else if (a == "--pcie-gbps") opt->pcie.gbps = std::atof(v.c_str());
+        else if (a == "--shift") {
+            std::vector<std::string> f = Split(v);
+            if (f.size() != 3) return false;
+            opt->shift_at = std::atoi(f[0].c_str());
+            opt->shift_fast = std::atof(f[1].c_str());
+            opt->shift_pcie = std::atof(f[2].c_str());
+            if (opt->shift_fast <= 0 || opt->shift_pcie <= 0) return false;
+        } else if (a == "--skew") opt->skew = std::atof(v.c_str());
+        else if (a == "--jitter") opt->jitter = std::atof(v.c_str());
+        else if (a == "--issue-skew-us") opt->issue_skew_us = std::atof(v.c_str());
+        else if (a == "--sync-every") opt->sync_every = std::atoi(v.c_str());
+        else if (a == "--tol") opt->tol = std::atof(v.c_str());
+        else return false;
+    }
+    for (int r : opt->ranks) {
+        if (r < 2 || r > kMaxRanks) return false;
+    }
+    return !opt->ranks.empty() && !opt->sizes.empty() && opt->collectives > 0 && opt->fast.gbps > 0 &&
+           opt->pcie.gbps > 0 && opt->skew >= 0 && opt->skew < 1 && opt->jitter >= 0 && opt->sync_every >= 0 && opt->tol > 0;
+}
+
+// ---------------------------------------------------------------------------
+// Stand-in device: per-stream modelled clocks (seconds), advanced by the fast
+// library at launch and by the PCIe share between the PCIe timer's start and stop.
+
+void* const kUserStream = reinterpret_cast<void*>(static_cast<uintptr_t>(0x5100));
+void* const kPCIeStream = reinterpret_cast<void*>(static_cast<uintptr_t>(0x5200));
+void* const kComm = reinterpret_cast<void*>(static_cast<uintptr_t>(0x5300));
+
+struct Device {
+    PathModel fast;
+    PathModel pcie;
+    double rank_scale = 1.0;
+    std::mt19937_64 rng;
+    std::normal_distribution<double> noise{1.0, 0.0};
+
+    double fast_clock = 0.0;
+    double pcie_clock = 0.0;
+    bool pcie_started = false;  // The PCIe timer records start, then stop
+    size_t total_bytes = 0;     // Of the collective being launched
+    size_t fast_bytes = 0;      // Launched on the fast library so far
+
+    double Scale() { return rank_scale * std::min(2.0, std::max(0.5, noise(rng))); }
+};
+Device g_dev;
+
+struct FakeEvent {
+    double t = 0.0;
+};
+
+int EventCreate(void** event) {
+    *event = new FakeEvent;
+    return 0;
+}
+int EventDestroy(void* event) {
+    delete static_cast<FakeEvent*>(event);
+    return 0;
+}
+int EventRecord(void* event, void* stream) {
+    FakeEvent* e = static_cast<FakeEvent*>(event);
+    if (stream == kPCIeStream) {
+        e->t = g_dev.pcie_clock;
+        if (!g_dev.pcie_started) {
+            size_t bytes = g_dev.total_bytes - std::min(g_dev.total_bytes, g_dev.fast_bytes);
+            g_dev.pcie_clock += g_dev.pcie.Time(static_cast<double>(bytes)) * g_dev.Scale();
+        }
+        g_dev.pcie_started = !g_dev.pcie_started;
+    } else {
+        e->t = g_dev.fast_clock;
+    }
+    return 0;
+}
+int EventSynchronize(void*) { return 0; }
+int EventElapsedMs(float* ms, void* start, void* end) {
+    *ms = static_cast<float>((static_cast<FakeEvent*>(end)->t - static_cast<FakeEvent*>(start)->t) * 1e3);
+    return 0;
+}
+
+void LaunchFast(size_t bytes) {
+    g_dev.fast_bytes += bytes;
+    g_dev.fast_clock += g_dev.fast.Time(static_cast<double>(bytes)) * g_dev.Scale();
+}
+int FakeAllReduce(const void*, void*, size_t count, int, int, void*, void*) {
+    LaunchFast(count * sizeof(float));
+    return 0;
+}
+int FakeAllGather(const void*, void*, size_t sendcount, int, void*, void*) {
+    LaunchFast(sendcount * sizeof(float));
+    return 0;
+}
+// A split AllGather's fast part runs as one broadcast per root; together they move what
+// one AllGather of count does, charged once (at root 0).
+int FakeBroadcast(const void*, void*, size_t count, int, int root, void*, void*) {
+    if (root == 0) {
+        LaunchFast(count * sizeof(float));
+    }
+    return 0;
+}
+size_t FakeDataTypeSize(int) { return sizeof(float); }
+
+// ---------------------------------------------------------------------------
+// Results, in an anonymous shared mapping set up before fork.
+
+struct Call {
+    uint64_t fast_bytes;  // Sent on the fast library (the rest went to PCIe)
+    uint32_t host_ns;     // Time spent in VirtualCollective
+};
+
+// A device collective completes only once every rank has launched it, so a stream
+// sync couples the ranks' hosts; the harness stands that in with a shared barrier.
+struct Barrier {
+    std::atomic<uint32_t> arrived;
+    std::atomic<uint32_t> generation;
+
+    void Wait(int nranks) {
+        uint32_t gen = generation.load(std::memory_order_acquire);
+        if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<uint32_t>(nranks)) {
+            arrived.store(0, std::memory_order_relaxed);
+            generation.store(gen + 1, std::memory_order_release);
+            return;
+        }
+        for (int spins = 0; generation.load(std::memory_order_acquire) == gen; ++spins) {
+            if (spins < 64) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    }
+};
+
+struct RankSummary {
+    uint64_t applied;
+    uint64_t lag_sum;
+    uint64_t lag_max;
+    uint64_t dropped;
+    uint64_t wait_ns;
+    int done;
+};
+
+// Set by the parent before fork so every rank of a run derives the same segment name,
+// and concurrent harnesses do not share one.
+std::string g_job;
+
+CommDomainKey KeyFor(int nranks) {
+    CommDomainKey key;
+    key.world_size = nranks;
+    for (int r = 0; r < nranks; ++r) key.ranks.push_back(r);
+    key.comm_id.lo = static_cast<uint64_t>(nranks);
+    key.job = g_job;
+    return key;
+}
+
+size_t SizeAt(const Options& opt, int i) { return opt.sizes[static_cast<size_t>(i) % opt.sizes.size()]; }
+
+int RunRank(const Options& opt, int nranks, int rank, Call* calls, RankSummary* summary, Barrier* barrier) {
+    FastBackendOps ops;
+    ops.all_reduce = &FakeAllReduce;
+    ops.all_gather = &FakeAllGather;
+    ops.broadcast = &FakeBroadcast;
+    ops.datatype_size = &FakeDataTypeSize;
+    FastBackendImpl::SetOps(ops);
+    DeviceEventOps events;
+    events.create = &EventCreate;
+    events.destroy = &EventDestroy;
+    events.record = &EventRecord;
+    events.synchronize = &EventSynchronize;
+    events.elapsed_ms = &EventElapsedMs;
+    SetRuntimeEventOps(events);
+
+    g_dev.fast = opt.fast;
+    g_dev.pcie = opt.pcie;
+    g_dev.rng.seed(0x9e3779b97f4a7c15ull * static_cast<uint64_t>(rank + 1));
+    g_dev.noise = std::normal_distribution<double>(1.0, opt.jitter);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    g_dev.rank_scale = 1.0 + opt.skew * unit(g_dev.rng);
+    std::uniform_real_distribution<double> issue(0.0, opt.issue_skew_us);
+
+    CommDomain* domain = DomainManager::GetInstance().GetOrCreateDomainByKey(KeyFor(nranks));
+    domain->set_comm_rank(rank);
+    domain->set_pcie_rank(rank);
+    domain->set_pcie_nranks(nranks);
+    domain->set_pcie_stream(kPCIeStream);
+
+    char buf[64];  // Never touched by the stand-ins
+    for (int i = 0; i < opt.collectives; ++i) {
+        if (i == opt.shift_at) {
+            g_dev.fast.gbps = opt.shift_fast;
+            g_dev.pcie.gbps = opt.shift_pcie;
+        }
+        if (opt.issue_skew_us > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(issue(g_dev.rng)));
+        }
+        size_t count = SizeAt(opt, i) / sizeof(float);
+        g_dev.total_bytes = count * sizeof(float);
+        g_dev.fast_bytes = 0;
+        g_dev.pcie_started = false;
+        auto t0 = std::chrono::steady_clock::now();
+        BackendResult r = opt.allgather
+            ? VirtualCollective::AllGather(domain, buf, buf, count, kFloat32, kComm, kUserStream)
+            : VirtualCollective::AllReduce(domain, buf, buf, count, kFloat32, /*op=*/0, kComm,
+                                           kUserStream);
+        auto t1 = std::chrono::steady_clock::now();
+        if (r != BackendResult::Success) {
+            std::fprintf(stderr, "ampccl-ranks: rank %d: collective %d failed\n", rank, i);
+            return 1;
+        }
+        if (opt.sync_every > 0 && (i + 1) % opt.sync_every == 0) barrier->Wait(nranks);
+        OnStreamSynchronized(kUserStream);
+        // Both streams are idle once synchronized.
+        g_dev.fast_clock = g_dev.pcie_clock = std::max(g_dev.fast_clock, g_dev.pcie_clock);
+        calls[i].fast_bytes = g_dev.fast_bytes;
+        calls[i].host_ns = static_cast<uint32_t>(
+            std::min<int64_t>(UINT32_MAX, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+    }
+
+    const ShmParamStore::LogStats& ls = domain->shm_store()->log_stats();
+    summary->applied = ls.applied;
+    summary->lag_sum = ls.lag_sum;
+    summary->lag_max = ls.lag_max;
+    summary->dropped = ls.dropped;
+    summary->wait_ns = ls.wait_ns;
+    summary->done = domain->shm_store()->IsAttached() ? 1 : 0;
+    return summary->done ? 0 : 1;
+}
+
+// ---------------------------------------------------------------------------
+// Analysis
+
+double Percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(std::ceil(p * v.size()));
+    return v[std::min(i > 0 ? i - 1 : 0, v.size() - 1)];
+}
+
+// Split that balances the two modelled paths: lf + a*b/Bf = lp + (1-a)*b/Bp.
+double OptimalAlpha(const PathModel& fast, const PathModel& pcie, double bytes) {
+    double sf = 1.0 / (fast.gbps * 1e9);
+    double sp = 1.0 / (pcie.gbps * 1e9);
+    double a = (pcie.lat_s - fast.lat_s + bytes * sp) / (bytes * (sf + sp));
+    return std::min(1.0, std::max(0.0, a));
+}
+
+struct RunResult {
+    int nranks = 0;
+    bool ok = false;
+    int mismatches = 0;          // Collectives where some rank's split differs from rank 0's
+    int first_mismatch = -1;
+    int converged_at = -1;       // Collectives after the (last) shift until alpha stayed in band
+    double final_alpha = 0.0;    // Rank 0, largest size, settled value
+    double optimal_alpha = 0.0;  // Model optimum for it
+    uint64_t updates = 0;        // Rank 0
+    double lag_mean = 0.0;
+    uint64_t lag_max = 0;
+    uint64_t dropped = 0;
+    double host_p50_us = 0.0;
+    double host_p99_us = 0.0;
+    double wait_pct = 0.0;       // Share of host time spent waiting for rank 0
+};
+
+RunResult Analyze(const Options& opt, int nranks, const Call* calls, const RankSummary* sums) {
+    RunResult res;
+    res.nranks = nranks;
+    res.ok = true;
+    int n = opt.collectives;
+    for (int r = 0; r < nranks; ++r) res.ok = res.ok && sums[r].done;
+
+    for (int i = 0; i < n; ++i) {
+        for (int r = 1; r < nranks; ++r) {
+            if (calls[static_cast<size_t>(r) * n + i].fast_bytes != calls[i].fast_bytes) {
+                if (res.first_mismatch < 0) res.first_mismatch = i;
+                ++res.mismatches;
+                break;
+            }
+        }
+    }
+
+    // Convergence of rank 0's alpha per size: settled value = mean over the last tenth
+    // of that size's calls; converged at the first call after which every later call
+    // of that size stays within tol of it. The run's value is the slowest size.
+    int begin = opt.shift_at > 0 && opt.shift_at < n ? opt.shift_at : 0;
+    size_t largest = *std::max_element(opt.sizes.begin(), opt.sizes.end());
+    res.converged_at = 0;
+    for (size_t s : opt.sizes) {
+        std::vector<std::pair<int, double>> seq;
+        for (int i = begin; i < n; ++i) {
+            if (SizeAt(opt, i) == s) seq.emplace_back(i, static_cast<double>(calls[i].fast_bytes) / s);
+        }
+        if (seq.empty()) continue;
+        size_t tail = std::max<size_t>(1, seq.size() / 10);
+        double settled = 0.0;
+        for (size_t k = seq.size() - tail; k < seq.size(); ++k) settled += seq[k].second;
+        settled /= tail;
+        int at = begin;
+        for (const auto& p : seq) {
+            if (std::fabs(p.second - settled) > opt.tol) at = p.first + 1;
+        }
+        if (at > n - (n - begin) / 10) at = -1;  // Still moving in the last tenth
+        if (at < 0 || res.converged_at < 0) res.converged_at = -1;
+        else res.converged_at = std::max(res.converged_at, at - begin);
+        if (s == largest) {
+            res.final_alpha = settled;
+            const PathModel fast = opt.shift_at > 0 && opt.shift_at < n ? PathModel{opt.fast.lat_s, opt.shift_fast}
+                                                                        : opt.fast;
+            const PathModel pcie = opt.shift_at > 0 && opt.shift_at < n ? PathModel{opt.pcie.lat_s, opt.shift_pcie}
+                                                                        : opt.pcie;
+            res.optimal_alpha = OptimalAlpha(fast, pcie, static_cast<double>(s));
+        }
+    }
+
+    res.updates = sums[0].applied;
+    res.dropped = sums[0].dropped;
+    uint64_t applied = 0, lag_sum = 0;
+    double wait_s = 0.0, host_s = 0.0;
+    std::vector<double> host;
+    host.reserve(static_cast<size_t>(nranks) * n);
+    for (int r = 0; r < nranks; ++r) {
+        applied += sums[r].applied;
+        lag_sum += sums[r].lag_sum;
+        res.lag_max = std::max(res.lag_max, sums[r].lag_max);
+        wait_s += sums[r].wait_ns * 1e-9;
+        for (int i = 0; i < n; ++i) {
+            double us = calls[static_cast<size_t>(r) * n + i].host_ns * 1e-3;
+            host.push_back(us);
+            host_s += us * 1e-6;
+        }
+    }
+    res.lag_mean = applied ? static_cast<double>(lag_sum) / applied : 0.0;
+    res.host_p50_us = Percentile(host, 0.5);
+    res.host_p99_us = Percentile(host, 0.99);
+    res.wait_pct = host_s > 0 ? 100.0 * wait_s / host_s : 0.0;
+    return res;
+}
+
+bool RunRanks(const Options& opt, int nranks, RunResult* out) {
+    size_t ncalls = static_cast<size_t>(nranks) * opt.collectives;
+    size_t map_size = ncalls * sizeof(Call) + nranks * sizeof(RankSummary) + sizeof(Barrier);
+    void* mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::perror("ampccl-ranks: mmap");
+        return false;
+    }
+    Call* calls = static_cast<Call*>(mem);
+    RankSummary* sums = reinterpret_cast<RankSummary*>(calls + ncalls);
+    Barrier* barrier = new (sums + nranks) Barrier{{0}, {0}};
+
+    std::fflush(stdout);
+    std::vector<pid_t> pids;
+    for (int r = 0; r < nranks; ++r) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::perror("ampccl-ranks: fork");
+            for (pid_t p : pids) kill(p, SIGKILL);
+            munmap(mem, map_size);
+            return false;
+        }
+        if (pid == 0) {
+            _exit(RunRank(opt, nranks, r, calls + static_cast<size_t>(r) * opt.collectives, sums + r, barrier));
+        }
+        pids.push_back(pid);
+    }
+    // Ranks wait on rank 0 at collective entry: if one fails, stop the others.
+    int failed = 0;
+    for (size_t left = pids.size(); left > 0; --left) {
+        int st = 0;
+        pid_t pid = wait(&st);
+        if (pid < 0) break;
+        if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+            if (failed++ == 0) {
+                for (pid_t p : pids) {
+                    if (p != pid) kill(p, SIGKILL);
+                }
+            }
+        }
+    }
+    shm_unlink(ShmParamStore::ShmNameForKey(KeyFor(nranks)).c_str());
+    *out = Analyze(opt, nranks, calls, sums);
+    out->ok = out->ok && failed == 0;
+    munmap(mem, map_size);
+    return failed == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+    // Ranks inherit these; explicit settings in the environment win except where a flag is given.
+    setenv("AMPCCL_ENABLE_PCIE", "1", 0);
+    setenv("AMPCCL_STAT_SYNC", "shm", 1);
+    setenv("AMPCCL_STATS_PAGE", "0", 0);
+    setenv("AMPCCL_PCIE_DEADLINE_MS", "0", 0);  // Stub PCIe syncs inline, no watchdog thread
+    if (!opt.algo.empty()) setenv("AMPCCL_ALGO", opt.algo.c_str(), 1);
+    else setenv("AMPCCL_ALGO", "tcp", 0);
+    g_job = "ampccl-ranks-" + std::to_string(getpid());
+    if (opt.lead >= 0) setenv("AMPCCL_PARAM_LEAD", std::to_string(opt.lead).c_str(), 1);
+
+    std::string sizes;
+    for (size_t s : opt.sizes) sizes += (sizes.empty() ? "" : ",") + std::to_string(s);
+    const char* lead = std::getenv("AMPCCL_PARAM_LEAD");
+    if (opt.json) {
+        std::printf("{\"op\": \"%s\", \"algo\": \"%s\", \"lead\": %s, \"collectives\": %d, \"sizes\": [%s], "
+                    "\"results\": [",
+                    opt.allgather ? "allgather" : "allreduce", std::getenv("AMPCCL_ALGO"), lead ? lead : "8",
+                    opt.collectives, sizes.c_str());
+    } else {
+        std::printf("# %s, algo %s, lead %s, %d collectives over sizes %s, skew %.0f%%, jitter %.0f%%, "
+                    "issue skew %.0f us, sync every %d\n",
+                    opt.allgather ? "allgather" : "allreduce", std::getenv("AMPCCL_ALGO"), lead ? lead : "8",
+                    opt.collectives, sizes.c_str(), opt.skew * 100, opt.jitter * 100, opt.issue_skew_us, opt.sync_every);
+        std::printf("%6s %10s %10s %8s %8s %8s %9s %8s %8s %10s %10s %7s\n", "ranks", "mismatch", "converged",
+                    "alpha", "optimal", "updates", "lag_mean", "lag_max", "dropped", "host_p50us", "host_p99us",
+                    "wait%");
+    }
+    int status = 0;
+    for (size_t k = 0; k < opt.ranks.size(); ++k) {
+        RunResult r;
+        bool ran = RunRanks(opt, opt.ranks[k], &r);
+        if (!ran || !r.ok || r.mismatches > 0) status = 1;
+        if (opt.json) {
+            std::printf("%s{\"ranks\": %d, \"ok\": %s, \"mismatches\": %d, \"first_mismatch\": %d, "
+                        "\"converged_at\": %d, \"alpha\": %.4f, \"optimal_alpha\": %.4f, \"updates\": %llu, "
+                        "\"lag_mean\": %.2f, \"lag_max\": %llu, \"dropped\": %llu, \"host_p50_us\": %.2f, "
+                        "\"host_p99_us\": %.2f, \"wait_pct\": %.2f}",
+                        k ? ", " : "", r.nranks, r.ok ? "true" : "false", r.mismatches, r.first_mismatch,
+                        r.converged_at, r.final_alpha, r.optimal_alpha, static_cast<unsigned long long>(r.updates),
+                        r.lag_mean, static_cast<unsigned long long>(r.lag_max),
+                        static_cast<unsigned long long>(r.dropped), r.host_p50_us, r.host_p99_us, r.wait_pct);
+        } else {
+            char converged[16];
+            if (r.converged_at >= 0) std::snprintf(converged, sizeof(converged), "%d", r.converged_at);
+            else std::snprintf(converged, sizeof(converged), "no");
+            std::printf("%6d %10d %10s %8.3f %8.3f %8llu %9.2f %8llu %8llu %10.2f %10.2f %7.2f%s\n", r.nranks,
+                        r.mismatches, converged, r.final_alpha, r.optimal_alpha,
+                        static_cast<unsigned long long>(r.updates), r.lag_mean,
+                        static_cast<unsigned long long>(r.lag_max), static_cast<unsigned long long>(r.dropped),
+                        r.host_p50_us, r.host_p99_us, r.wait_pct, r.ok ? "" : "  (rank failure)");
+            if (r.first_mismatch >= 0) std::printf("       first mismatch at collective %d\n", r.first_mismatch);
+        }
+        std::fflush(stdout);
+    }
+    if (opt.json) std::printf("]}\n");
+    return status;
+}
@@ -0,0 +1,406 @@
+#ifndef AMPCCL_BENCH_BENCH_H_
+#define AMPCCL_BENCH_BENCH_H_
+
+// Minimal Google Benchmark-style harness (no external dependency): registration with
+// Args/Threads, automatic iteration count, console or JSON output in Google
+// Benchmark's schema so compare.py and dashboards can consume it.
+//
+//   static void BM_Foo(bench::State& state) {
+//       for (auto _ : state) bench::DoNotOptimize(Foo(state.range(0)));
+//   }
+//   BENCHMARK(BM_Foo)->Arg(8)->Arg(64)->ThreadRange(1, 32);
+//   BENCHMARK_MAIN();
+//
+// Threaded runs: every thread runs `iterations` loops; real_time is wall time per loop
+// (the latency each caller sees under contention), cpu_time the mean per-thread CPU
+// time per loop, items_per_second the aggregate rate.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace bench {
+
+template <typename T>
+inline void DoNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename T>
+inline void DoNotOptimize(T& value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+inline uint64_t WallNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline uint64_t ThreadCpuNs() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+class State {
+public:
+    State(int64_t iterations, const std::vector<int64_t>& args, int thread_index, int threads)
+        : iterations_(iterations), args_(args), thread_index_(thread_index), threads_(threads) {}
+
+    int64_t range(size_t i = 0) const { return i < args_.size() ? args_[i] : 0; }
+    int thread_index() const { return thread_index_; }
+    int threads() const { return threads_; }
+    int64_t iterations() const { return iterations_; }
+    void SetLabel(const std::string& label) { label_ = label; }
+    const std::string& label() const { return label_; }
+
+    // Exclude setup work inside the loop from cpu_time (wall time still includes it).
+    void PauseTiming() { cpu_ns_ += ThreadCpuNs() - cpu_start_; }
+    void ResumeTiming() { cpu_start_ = ThreadCpuNs(); }
+
+    // Loop value of `for (auto _ : state)`; the attribute keeps -Wunused-variable quiet
+    // about the unused binding, as in Google Benchmark.
+    struct __attribute__((unused)) Value {};
+
+    struct Iterator {
+        State* state;
+        int64_t left;
+        bool operator!=(const Iterator&) {
+            if (left-- > 0) {
+                return true;
+            }
+            state->Finish();
+            return false;
+        }
+        void operator++() {}
+        Value operator*() const { return Value(); }
+    };
+    Iterator begin() {
+        cpu_start_ = ThreadCpuNs();
+        return Iterator{this, iterations_};
+    }
+    Iterator end() { return Iterator{this, 0}; }
+
+    uint64_t cpu_ns() const { return cpu_ns_; }
+
+private:
+    void Finish() { cpu_ns_ += ThreadCpuNs() - cpu_start_; }
+
+    int64_t iterations_;
+    std::vector<int64_t> args_;
+    int thread_index_;
+    int threads_;
+    std::string label_;
+    uint64_t cpu_start_ = 0;
+    uint64_t cpu_ns_ = 0;
+};
+
+using Function = void (*)(State&);
+using Hook = std::function<void(const State&)>;
+
+class Benchmark {
+public:
+    Benchmark(const char* name, Function fn) : name_(name), fn_(fn) {}
+
+    Benchmark* Arg(int64_t a) { return Args({a}); }
+    Benchmark* Args(const std::vector<int64_t>& a) {
+        args_.push_back(a);
+        return this;
+    }
+    Benchmark* ArgName(const std::string& n) {
+        arg_names_ = {n};
+        return this;
+    }
+    Benchmark* ArgNames(const std::vector<std::string>& n) {
+        arg_names_ = n;
+        return this;
+    }
+    Benchmark* Threads(int t) {
+        threads_.push_back(t);
+        return this;
+    }
+    // lo, 2*lo, 4*lo, ... up to hi (inclusive).
+    Benchmark* ThreadRange(int lo, int hi) {
+        for (int t = lo; t <= hi; t *= 2) threads_.push_back(t);
+        return this;
+    }
+    // Run once per (args, threads) combination on the main thread, outside timing.
+    Benchmark* Setup(Hook fn) {
+        setup_ = std::move(fn);
+        return this;
+    }
+    Benchmark* Teardown(Hook fn) {
+        teardown_ = std::move(fn);
+        return this;
+    }
+
+    const std::string& name() const { return name_; }
+    Function fn() const { return fn_; }
+    const std::vector<std::vector<int64_t>>& args() const { return args_; }
+    const std::vector<std::string>& arg_names() const { return arg_names_; }
+    const std::vector<int>& threads() const { return threads_; }
+    const Hook& setup() const { return setup_; }
+    const Hook& teardown() const { return teardown_; }
+
+private:
+    std::string name_;
+    Function fn_;
+    std::vector<std::vector<int64_t>> args_;
+    std::vector<std::string> arg_names_;
+    std::vector<int> threads_;
+    Hook setup_;
+    Hook teardown_;
+};
+
+inline std::vector<Benchmark*>& Registry() {
+    static std::vector<Benchmark*> registry;
+    return registry;
+}
+
+inline Benchmark* Register(const char* name, Function fn) {
+    Registry().push_back(new Benchmark(name, fn));
+    return Registry().back();
+}
+
+struct Run {
+    std::string name;
+    std::string label;
+    int threads = 1;
+    int64_t iterations = 0;   // Per thread
+    double real_ns = 0.0;     // Per iteration
+    double cpu_ns = 0.0;      // Per iteration, mean over threads
+    double items_per_second = 0.0;
+};
+
+// Start all threads together, time from release to the last thread finishing.
+inline Run RunOnce(const Benchmark& b, const std::vector<int64_t>& args, int threads, int64_t iters) {
+    std::vector<State> states;
+    for (int t = 0; t < threads; ++t) states.emplace_back(iters, args, t, threads);
+    std::mutex mu;
+    std::condition_variable cv;
+    bool go = false;
+    int ready = 0;
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                ++ready;
+                cv.notify_all();
+                cv.wait(lock, [&] { return go; });
+            }
+            b.fn()(states[t]);
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return ready == threads - 1; });
+        go = true;
+    }
+    cv.notify_all();
+    uint64_t start = WallNs();
+    b.fn()(states[0]);
+    for (auto& w : workers) w.join();
+    uint64_t wall = WallNs() - start;
+
+    Run run;
+    run.threads = threads;
+    run.iterations = iters;
+    run.label = states[0].label();
+    run.real_ns = static_cast<double>(wall) / static_cast<double>(iters);
+    uint64_t cpu = 0;
+    for (const State& s : states) cpu += s.cpu_ns();
+    run.cpu_ns = static_cast<double>(cpu) / static_cast<double>(iters) / threads;
+    run.items_per_second = wall > 0 ? static_cast<double>(iters) * threads * 1e9 / static_cast<double>(wall) : 0.0;
+    return run;
+}
+
+// Grow the iteration count until one run takes at least min_time seconds.
+inline Run RunBenchmark(const Benchmark& b, const std::vector<int64_t>& args, int threads, double min_time) {
+    int64_t iters = 1;
+    const int64_t kMaxIters = 1000000000;
+    for (;;) {
+        Run run = RunOnce(b, args, threads, iters);
+        double secs = run.real_ns * static_cast<double>(iters) * 1e-9;
+        if (secs >= min_time || iters >= kMaxIters) {
+            return run;
+        }
+        double mult = secs > 0.0 ? min_time * 1.4 / secs : 10.0;
+        mult = std::min(10.0, std::max(2.0, mult));
+        iters = std::min(kMaxIters, static_cast<int64_t>(static_cast<double>(iters) * mult));
+    }
+}
+
+inline std::string RunName(const Benchmark& b, const std::vector<int64_t>& args, int threads, bool explicit_threads) {
+    std::string name = b.name();
+    for (size_t i = 0; i < args.size(); ++i) {
+        name += '/';
+        if (i < b.arg_names().size() && !b.arg_names()[i].empty()) {
+            name += b.arg_names()[i] + ':';
+        }
+        name += std::to_string(args[i]);
+    }
+    if (explicit_threads) {
+        name += "/threads:" + std::to_string(threads);
+    }
+    return name;
+}
+
+inline std::string JsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+inline void WriteJson(std::FILE* f, const char* executable, const std::vector<Run>& runs) {
+    char host[256] = "";
+    gethostname(host, sizeof(host) - 1);
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+    std::fprintf(f, "{\n  \"context\": {\n");
+    std::fprintf(f, "    \"date\": \"%s\",\n", date);
+    std::fprintf(f, "    \"host_name\": \"%s\",\n", JsonEscape(host).c_str());
+    std::fprintf(f, "    \"executable\": \"%s\",\n", JsonEscape(executable).c_str());
+    std::fprintf(f, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+    std::fprintf(f, "    \"library_build_type\": \"release\"\n");
+#else
+    std::fprintf(f, "    \"library_build_type\": \"debug\"\n");
+#endif
+    std::fprintf(f, "  },\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run& r = runs[i];
+        std::fprintf(f, "    {\n");
+        std::fprintf(f, "      \"name\": \"%s\",\n", JsonEscape(r.name).c_str());
+        std::fprintf(f, "      \"run_name\": \"%s\",\n", JsonEscape(r.name).c_str());
+        std::fprintf(f, "      \"run_type\": \"iteration\",\n");
+        std::fprintf(f, "      \"repetitions\": 1,\n      \"repetition_index\": 0,\n");
+        std::fprintf(f, "      \"threads\": %d,\n", r.threads);
+        std::fprintf(f, "      \"iterations\": %lld,\n", static_cast<long long>(r.iterations));
+        std::fprintf(f, "      \"real_time\": %.4f,\n", r.real_ns);
+        std::fprintf(f, "      \"cpu_time\": %.4f,\n", r.cpu_ns);
+        std::fprintf(f, "      \"time_unit\": \"ns\",\n");
+        if (!r.label.empty()) {
+            std::fprintf(f, "      \"label\": \"%s\",\n", JsonEscape(r.label).c_str());
+        }
+        std::fprintf(f, "      \"items_per_second\": %.4f\n", r.items_per_second);
+        std::fprintf(f, "    }%s\n", i + 1 < runs.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+inline void PrintConsoleHeader() {
+    std::printf("%-56s %14s %14s %12s %14s\n", "Benchmark", "Time(ns)", "CPU(ns)", "Iterations", "items/s");
+    std::printf("%s\n", std::string(114, '-').c_str());
+}
+
+inline void PrintConsole(const Run& r) {
+    std::printf("%-56s %14.1f %14.1f %12lld %14.4g %s\n", r.name.c_str(), r.real_ns, r.cpu_ns,
+                static_cast<long long>(r.iterations), r.items_per_second, r.label.c_str());
+    std::fflush(stdout);
+}
+
+// Flags: --benchmark_filter=REGEX --benchmark_min_time=SECONDS
+//        --benchmark_format=console|json --benchmark_out=FILE (JSON) --benchmark_list_tests
+inline int Main(int argc, char** argv) {
+    std::string filter = ".";
+    std::string format = "console";
+    std::string out_path;
+    double min_time = 0.2;
+    bool list = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto value = [&a](const char* flag) -> const char* {
+            size_t n = std::strlen(flag);
+            return a.compare(0, n, flag) == 0 ? a.c_str() + n : nullptr;
+        };
+        if (const char* v = value("--benchmark_filter=")) filter = v;
+        else if (const char* v = value("--benchmark_min_time=")) min_time = std::atof(v);
+        else if (const char* v = value("--benchmark_format=")) format = v;
+        else if (const char* v = value("--benchmark_out=")) out_path = v;
+        else if (a == "--benchmark_list_tests") list = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--benchmark_filter=REGEX] [--benchmark_min_time=S] "
+                         "[--benchmark_format=console|json] [--benchmark_out=FILE] [--benchmark_list_tests]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+    if (format != "console" && format != "json") {
+        std::fprintf(stderr, "%s: unknown --benchmark_format=%s\n", argv[0], format.c_str());
+        return 2;
+    }
+    std::regex re(filter);
+    bool console = (format == "console");
+    if (console && !list) PrintConsoleHeader();
+
+    std::vector<Run> runs;
+    for (Benchmark* b : Registry()) {
+        std::vector<std::vector<int64_t>> arg_sets = b->args();
+        if (arg_sets.empty()) arg_sets.push_back({});
+        std::vector<int> thread_counts = b->threads();
+        bool explicit_threads = !thread_counts.empty();
+        if (!explicit_threads) thread_counts.push_back(1);
+        for (const auto& args : arg_sets) {
+            for (int threads : thread_counts) {
+                std::string name = RunName(*b, args, threads, explicit_threads);
+                if (!std::regex_search(name, re)) continue;
+                if (list) {
+                    std::printf("%s\n", name.c_str());
+                    continue;
+                }
+                State setup_state(0, args, 0, threads);
+                if (b->setup()) b->setup()(setup_state);
+                Run run = RunBenchmark(*b, args, threads, min_time);
+                if (b->teardown()) b->teardown()(setup_state);
+                run.name = name;
+                if (console) PrintConsole(run);
+                runs.push_back(run);
+            }
+        }
+    }
+    if (list) return 0;
+    if (!console) WriteJson(stdout, argv[0], runs);
+    if (!out_path.empty()) {
+        std::FILE* f = std::fopen(out_path.c_str(), "w");
+        if (f == nullptr) {
+            std::fprintf(stderr, "%s: cannot write %s\n", argv[0], out_path.c_str());
+            return 1;
+        }
+        WriteJson(f, argv[0], runs);
+        std::fclose(f);
+    }
+    return 0;
+}
+
+}  // namespace bench
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+#define BENCHMARK(fn) \
+    static ::bench::Benchmark* BENCH_CONCAT(bench_reg_, __LINE__) __attribute__((unused)) = \
+        ::bench::Register(#fn, fn)
+#define BENCHMARK_MAIN() \
+    int main(int argc, char** argv) { return ::bench::Main(argc, argv); }
+
+#endif  // AMPCCL_BENCH_BENCH_H_
@@ -11,7 +11,8 @@ enum class BackendResult {
     Success = 0,
     InvalidArgument = 1,
     UnhandledError = 2,
-    InternalError = 3
+    InternalError = 3,
+    Timeout = 4        // Work did not complete within its deadline (PCIe watchdog)
 };
 
 // Base interface for all backends
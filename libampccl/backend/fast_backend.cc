@@ -1,10 +1,24 @@
 #include "fast_backend.h"
-#include <dlfcn.h>
 
 namespace ampccl {
 
-// Implementation of fast backend (NCCL/HCCL)
-// This will call the actual NCCL/HCCL APIs
+namespace {
+
+FastBackendOps g_ops;
+
+BackendResult ToBackendResult(int ret) {
+    return ret == 0 ? BackendResult::Success : BackendResult::UnhandledError;
+}
+
+}  // namespace
+
+void BackendBase<FastBackend>::SetOps(const FastBackendOps& ops) {
+    g_ops = ops;
+}
+
+size_t BackendBase<FastBackend>::DataTypeSize(int datatype) {
+    return g_ops.datatype_size ? g_ops.datatype_size(datatype) : 0;
+}
 
 BackendResult BackendBase<FastBackend>::AllReduce(
     const void* sendbuff,
@@ -15,14 +29,10 @@ BackendResult BackendBase<FastBackend>::AllReduce(
     void* comm,
     void* stream) {
 
-    // TODO: Call actual NCCL/HCCL AllReduce
-    // For now, this is a placeholder
-    // In real implementation:
-    // - Detect if NCCL or HCCL is being used
-    // - Call appropriate API (ncclAllReduce or HcclAllReduce)
-    // - Handle errors appropriately
-
-    return BackendResult::Success;
+    if (g_ops.all_reduce == nullptr) {
+        return BackendResult::Success;
+    }
+    return ToBackendResult(g_ops.all_reduce(sendbuff, recvbuff, count, datatype, op, comm, stream));
 }
 
 BackendResult BackendBase<FastBackend>::AllGather(
@@ -33,8 +43,10 @@ BackendResult BackendBase<FastBackend>::AllGather(
     void* comm,
     void* stream) {
 
-    // TODO: Call actual NCCL/HCCL AllGather
-    return BackendResult::Success;
+    if (g_ops.all_gather == nullptr) {
+        return BackendResult::Success;
+    }
+    return ToBackendResult(g_ops.all_gather(sendbuff, recvbuff, sendcount, datatype, comm, stream));
 }
 
 BackendResult BackendBase<FastBackend>::ReduceScatter(
@@ -46,8 +58,10 @@ BackendResult BackendBase<FastBackend>::ReduceScatter(
     void* comm,
     void* stream) {
 
-    // TODO: Call actual NCCL/HCCL ReduceScatter
-    return BackendResult::Success;
+    if (g_ops.reduce_scatter == nullptr) {
+        return BackendResult::Success;
+    }
+    return ToBackendResult(g_ops.reduce_scatter(sendbuff, recvbuff, recvcount, datatype, op, comm, stream));
 }
 
 BackendResult BackendBase<FastBackend>::Broadcast(
@@ -59,8 +73,10 @@ BackendResult BackendBase<FastBackend>::Broadcast(
     void* comm,
     void* stream) {
 
-    // TODO: Call actual NCCL/HCCL Broadcast
-    return BackendResult::Success;
+    if (g_ops.broadcast == nullptr) {
+        return BackendResult::Success;
+    }
+    return ToBackendResult(g_ops.broadcast(sendbuff, recvbuff, count, datatype, root, comm, stream));
 }
 
 }  // namespace ampccl
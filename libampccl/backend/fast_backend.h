@@ -8,11 +8,33 @@ namespace ampccl {
 // Fast backend tag (NCCL/HCCL)
 struct FastBackend {};
 
-// Specialization for fast backend (NCCL/HCCL)
-// This will be implemented to call actual NCCL/HCCL APIs
+// Original (unhooked) library entry points, registered by the NCCL or HCCL hook once it
+// has loaded them. datatype / op are the library's own enum values; comm and stream its
+// handles. Returns the library's result code (0 = success). With no ops registered
+// (core-only builds: tools, benchmarks) every call succeeds without doing anything.
+struct FastBackendOps {
+    int (*all_reduce)(const void* sendbuff, void* recvbuff, size_t count, int datatype, int op,
+                      void* comm, void* stream) = nullptr;
+    int (*all_gather)(const void* sendbuff, void* recvbuff, size_t sendcount, int datatype,
+                      void* comm, void* stream) = nullptr;
+    int (*reduce_scatter)(const void* sendbuff, void* recvbuff, size_t recvcount, int datatype, int op,
+                          void* comm, void* stream) = nullptr;
+    int (*broadcast)(const void* sendbuff, void* recvbuff, size_t count, int datatype, int root,
+                     void* comm, void* stream) = nullptr;
+    // Element size in bytes of a library datatype; 0 if unknown.
+    size_t (*datatype_size)(int datatype) = nullptr;
+};
+
+// Specialization for fast backend (NCCL/HCCL): calls through the registered FastBackendOps
 template<>
 class BackendBase<FastBackend> {
 public:
+    // Called by the hook after loading the original library, before any collective.
+    static void SetOps(const FastBackendOps& ops);
+
+    // Element size of datatype per the registered library; 0 if none is registered.
+    static size_t DataTypeSize(int datatype);
+
     static BackendResult AllReduce(
         const void* sendbuff,
         void* recvbuff,
@@ -1,4 +1,5 @@
 #include "pcie_backend.h"
+#include "fast_backend.h"
 #include "core/domain.h"
 
 #ifdef AMPCCL_ENABLE_PCIE
@@ -16,8 +17,34 @@ namespace {
 
 using namespace pccl;
 
+// Bytes per element for the program (PCCL builds without IRProgram::elem_size assume 4).
+void SetElemSize(IRProgram* program, int datatype) {
+#ifdef PCCL_IR_HAS_ELEM_SIZE
+    size_t size = FastBackendImpl::DataTypeSize(datatype);
+    program->elem_size = size ? size : 4;
+#else
+    (void)program;
+    (void)datatype;
+#endif
+}
+
+// NUMA node of each host chunk: chunk c is filled by PCCL rank c's D2H, so it is placed
+// next to that rank's device (CommDomain::pcie_numa, from the rank table) and the copies
+// into and out of it stay on one socket. Node 0 when the placement is unknown.
+int ChunkNuma(const CommDomain* domain, int chunk) {
+    const std::vector<int>& nodes = domain->pcie_numa();
+    int node = chunk < static_cast<int>(nodes.size()) ? nodes[static_cast<size_t>(chunk)] : -1;
+    return node > 0 ? node : 0;
+}
+
+void HostChunkNuma(const CommDomain* domain, int numa[2]) {
+    for (int c = 0; c < 2; ++c) {
+        numa[c] = ChunkNuma(domain, c);
+    }
+}
+
 // 2-rank AllReduce IR: Rank 0 root reduce, Rank 1 reduces into Rank 0's chunk.
-IRProgram BuildAllReduceIR(int rank) {
+IRProgram BuildAllReduceIR(int rank, const int numa[2]) {
     IRProgram program;
     program.input_chunk_count = 1;
     program.output_chunk_count = 1;
@@ -25,7 +52,7 @@ IRProgram BuildAllReduceIR(int rank) {
     if (rank == 0) {
         Instruction inst0;
         inst0.op = OpCode::D2H;
-        inst0.src_numa = 0;
+        inst0.src_numa = numa[0];
         inst0.src_chunk_idx = 0;
         inst0.dst_chunk_idx = 0;
         inst0.deps = {};
@@ -33,17 +60,17 @@ IRProgram BuildAllReduceIR(int rank) {
 
         Instruction inst1;
         inst1.op = OpCode::H2D;
-        inst1.src_numa = 0;
+        inst1.src_numa = numa[0];
         inst1.src_chunk_idx = 0;
         inst1.dst_chunk_idx = 0;
-        inst1.deps = {{0, 0, 2}};
+        inst1.deps = {{numa[0], 0, 2}};
         inst1.effects = {};
 
         program.instructions = {inst0, inst1};
     } else {
         Instruction inst0;
         inst0.op = OpCode::D2H;
-        inst0.src_numa = 0;
+        inst0.src_numa = numa[1];
         inst0.src_chunk_idx = 0;
         inst0.dst_chunk_idx = 1;
         inst0.deps = {};
@@ -51,18 +78,18 @@ IRProgram BuildAllReduceIR(int rank) {
 
         Instruction inst1;
         inst1.op = OpCode::H2H_REDUCE;
-        inst1.src_numa = 0;
+        inst1.src_numa = numa[1];
         inst1.src_chunk_idx = 1;
         inst1.dst_chunk_idx = 0;
-        inst1.deps = {{0, 0, 1}};
+        inst1.deps = {{numa[0], 0, 1}};
         inst1.effects = {{0}};
 
         Instruction inst2;
         inst2.op = OpCode::H2D;
-        inst2.src_numa = 0;
+        inst2.src_numa = numa[0];
         inst2.src_chunk_idx = 0;
         inst2.dst_chunk_idx = 0;
-        inst2.deps = {{0, 0, 2}};
+        inst2.deps = {{numa[0], 0, 2}};
         inst2.effects = {};
 
         program.instructions = {inst0, inst1, inst2};
@@ -70,64 +97,42 @@ IRProgram BuildAllReduceIR(int rank) {
     return program;
 }
 
-// 2-rank AllGather IR: each rank has 1 chunk input, 2 chunks output.
-IRProgram BuildAllGatherIR(int rank) {
+// Broadcast IR for any group size: the root stages its input in host chunk `root`
+// (next to its device) and copies it to its own output; every other rank copies the
+// host chunk out once the root has signalled it.
+IRProgram BuildBroadcastIR(int rank, int root, int root_numa) {
     IRProgram program;
     program.input_chunk_count = 1;
-    program.output_chunk_count = 2;
+    program.output_chunk_count = 1;
 
-    if (rank == 0) {
+    if (rank == root) {
         Instruction inst0;
         inst0.op = OpCode::D2H;
-        inst0.src_numa = 0;
+        inst0.src_numa = root_numa;
         inst0.src_chunk_idx = 0;
-        inst0.dst_chunk_idx = 0;
+        inst0.dst_chunk_idx = root;
         inst0.deps = {};
-        inst0.effects = {{0}};
+        inst0.effects = {{root}};
 
         Instruction inst1;
         inst1.op = OpCode::D2D;
-        inst1.src_numa = 0;
+        inst1.src_numa = root_numa;
         inst1.src_chunk_idx = 0;
         inst1.dst_chunk_idx = 0;
         inst1.deps = {};
         inst1.effects = {};
 
-        Instruction inst2;
-        inst2.op = OpCode::H2D;
-        inst2.src_numa = 0;
-        inst2.src_chunk_idx = 1;
-        inst2.dst_chunk_idx = 1;
-        inst2.deps = {{0, 1, 1}};
-        inst2.effects = {};
-
-        program.instructions = {inst0, inst1, inst2};
+        program.instructions = {inst0, inst1};
     } else {
         Instruction inst0;
-        inst0.op = OpCode::D2H;
-        inst0.src_numa = 0;
-        inst0.src_chunk_idx = 0;
-        inst0.dst_chunk_idx = 1;
-        inst0.deps = {};
-        inst0.effects = {{1}};
-
-        Instruction inst1;
-        inst1.op = OpCode::D2D;
-        inst1.src_numa = 0;
-        inst1.src_chunk_idx = 0;
-        inst1.dst_chunk_idx = 1;
-        inst1.deps = {};
-        inst1.effects = {};
-
-        Instruction inst2;
-        inst2.op = OpCode::H2D;
-        inst2.src_numa = 0;
-        inst2.src_chunk_idx = 0;
-        inst2.dst_chunk_idx = 0;
-        inst2.deps = {{0, 0, 1}};
-        inst2.effects = {};
+        inst0.op = OpCode::H2D;
+        inst0.src_numa = root_numa;
+        inst0.src_chunk_idx = root;
+        inst0.dst_chunk_idx = 0;
+        inst0.deps = {{root_numa, root, 1}};
+        inst0.effects = {};
 
-        program.instructions = {inst0, inst1, inst2};
+        program.instructions = {inst0};
     }
     return program;
 }
@@ -143,6 +148,9 @@ BackendResult BackendBase<PCIeBackend>::AllReduce(
     int datatype,
     int op,
     void* stream) {
+    if (domain && domain->pcie_quarantined()) {
+        return BackendResult::UnhandledError;  // Never submit to a quarantined communicator
+    }
 #ifdef AMPCCL_ENABLE_PCIE
     if (!domain || !domain->pcie_comm() || domain->pcie_nranks() != 2) {
         return BackendResult::Success;  // stub when no PCCL or not 2-rank
@@ -153,7 +161,10 @@ BackendResult BackendBase<PCIeBackend>::AllReduce(
         return BackendResult::UnhandledError;
     }
     int rank = domain->pcie_rank();
-    pccl::IRProgram program = BuildAllReduceIR(rank);
+    int numa[2];
+    HostChunkNuma(domain, numa);
+    pccl::IRProgram program = BuildAllReduceIR(rank, numa);
+    SetElemSize(&program, datatype);
     pcclResult_t ret = pcclSubmit(comm, program,
                                   const_cast<void*>(sendbuff), recvbuff,
                                   count, static_cast<pcclStream_t>(pcie_stream));
@@ -176,28 +187,33 @@ BackendResult BackendBase<PCIeBackend>::AllGather(
     void* recvbuff,
     size_t sendcount,
     int datatype,
+    size_t recv_pitch,
     void* stream) {
+    if (domain && domain->pcie_quarantined()) {
+        return BackendResult::UnhandledError;  // Never submit to a quarantined communicator
+    }
 #ifdef AMPCCL_ENABLE_PCIE
-    if (!domain || !domain->pcie_comm() || domain->pcie_nranks() != 2) {
+    if (!domain || !domain->pcie_comm() || domain->pcie_nranks() < 2) {
         return BackendResult::Success;
     }
-    pcclComm_t comm = static_cast<pcclComm_t>(domain->pcie_comm());
-    void* pcie_stream = domain->pcie_stream();
-    if (!pcie_stream) {
-        return BackendResult::UnhandledError;
+    // One broadcast per rank, each into that rank's block: the blocks may be strided
+    // (a split AllGather leaves room for the fast share in every block).
+    char* recv = static_cast<char*>(recvbuff);
+    for (int root = 0; root < domain->pcie_nranks(); ++root) {
+        BackendResult r = Broadcast(domain, sendbuff, recv + static_cast<size_t>(root) * recv_pitch,
+                                    sendcount, datatype, root, stream);
+        if (r != BackendResult::Success) {
+            return r;
+        }
     }
-    int rank = domain->pcie_rank();
-    pccl::IRProgram program = BuildAllGatherIR(rank);
-    pcclResult_t ret = pcclSubmit(comm, program,
-                                  const_cast<void*>(sendbuff), recvbuff,
-                                  sendcount, static_cast<pcclStream_t>(pcie_stream));
-    return (ret == pcclSuccess) ? BackendResult::Success : BackendResult::UnhandledError;
+    return BackendResult::Success;
 #else
     (void)domain;
     (void)sendbuff;
     (void)recvbuff;
     (void)sendcount;
     (void)datatype;
+    (void)recv_pitch;
     (void)stream;
     return BackendResult::Success;
 #endif
@@ -211,7 +227,9 @@ BackendResult BackendBase<PCIeBackend>::ReduceScatter(
     int datatype,
     int op,
     void* stream) {
-    (void)domain;
+    if (domain && domain->pcie_quarantined()) {
+        return BackendResult::UnhandledError;  // Never submit to a quarantined communicator
+    }
     (void)sendbuff;
     (void)recvbuff;
     (void)recvcount;
@@ -229,6 +247,25 @@ BackendResult BackendBase<PCIeBackend>::Broadcast(
     int datatype,
     int root,
     void* stream) {
+    if (domain && domain->pcie_quarantined()) {
+        return BackendResult::UnhandledError;  // Never submit to a quarantined communicator
+    }
+#ifdef AMPCCL_ENABLE_PCIE
+    if (!domain || !domain->pcie_comm() || domain->pcie_nranks() < 2) {
+        return BackendResult::Success;
+    }
+    pcclComm_t comm = static_cast<pcclComm_t>(domain->pcie_comm());
+    void* pcie_stream = domain->pcie_stream();
+    if (!pcie_stream || root < 0 || root >= domain->pcie_nranks()) {
+        return BackendResult::UnhandledError;
+    }
+    pccl::IRProgram program = BuildBroadcastIR(domain->pcie_rank(), root, ChunkNuma(domain, root));
+    SetElemSize(&program, datatype);
+    pcclResult_t ret = pcclSubmit(comm, program,
+                                  const_cast<void*>(sendbuff), recvbuff,
+                                  count, static_cast<pcclStream_t>(pcie_stream));
+    return (ret == pcclSuccess) ? BackendResult::Success : BackendResult::UnhandledError;
+#else
     (void)domain;
     (void)sendbuff;
     (void)recvbuff;
@@ -237,6 +274,22 @@ BackendResult BackendBase<PCIeBackend>::Broadcast(
     (void)root;
     (void)stream;
     return BackendResult::Success;
+#endif
+}
+
+BackendResult BackendBase<PCIeBackend>::Synchronize(CommDomain* domain) {
+#ifdef AMPCCL_ENABLE_PCIE
+    if (!domain || !domain->pcie_comm() || !domain->pcie_stream()) {
+        return BackendResult::Success;
+    }
+    pcclResult_t ret = pcclSynchronizeStream(
+        static_cast<pcclComm_t>(domain->pcie_comm()),
+        static_cast<pcclStream_t>(domain->pcie_stream()));
+    return (ret == pcclSuccess) ? BackendResult::Success : BackendResult::UnhandledError;
+#else
+    (void)domain;
+    return BackendResult::Success;
+#endif
 }
 
 }  // namespace ampccl
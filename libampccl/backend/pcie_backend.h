@@ -24,12 +24,15 @@ public:
         void* stream
     );
 
+    // recv_pitch: bytes between the starts of consecutive ranks' blocks in recvbuff
+    // (sendcount * element size when the blocks are contiguous).
     static BackendResult AllGather(
         CommDomain* domain,
         const void* sendbuff,
         void* recvbuff,
         size_t sendcount,
         int datatype,
+        size_t recv_pitch,
         void* stream
     );
 
@@ -52,6 +55,9 @@ public:
         int root,
         void* stream
     );
+
+    // Block until all work on the domain's PCIe stream has completed (host side).
+    static BackendResult Synchronize(CommDomain* domain);
 };
 
 using PCIeBackendImpl = BackendBase<PCIeBackend>;
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <mutex>
 #include <vector>
+#include <tuple>
 #include <utility>
 
 namespace ampccl {
@@ -32,6 +33,11 @@ public:
         if (it != table_.end()) {
             return it->second;
         }
+        // Fall back to a per-(op, size class) seed (e.g. loaded from a profile)
+        auto st = seeds_.find(OpBucketOf(key));
+        if (st != seeds_.end()) {
+            return st->second;
+        }
         // Return default: 50% split, PCIe enabled
         return ParamValue(0.5, true, 0.0, 0.0);
     }
@@ -42,7 +48,71 @@ public:
         table_[key] = value;
     }
 
-    // Clear all cached parameters
+    // Seed the value returned for any OpKey of this (op, size class) that has no
+    // exact entry yet. Used for warm starts; seeds survive Clear().
+    void Seed(CollectiveType op, int size_class, const ParamValue& value) {
+        OpKey key;
+        key.op = op;
+        key.bytes = size_class > 0 ? (static_cast<size_t>(1) << size_class) : 0;
+        key.datatype = 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        seeds_[OpBucketOf(key)] = value;
+    }
+
+    // Learned split/fast-only crossover per (op, datatype): PCIe is used for size
+    // classes >= the stored class. Returns -1 if nothing was learned yet.
+    int Crossover(CollectiveType op, int datatype) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = crossover_.find(CrossoverKey(op, datatype));
+        return it != crossover_.end() ? it->second : -1;
+    }
+
+    void SetCrossover(CollectiveType op, int datatype, int size_class) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        crossover_[CrossoverKey(op, datatype)] = size_class;
+    }
+
+    // Snapshot / restore of the crossover table for shared-memory sync:
+    // tuples of (op, datatype, size class).
+    void GetAllCrossovers(std::vector<std::tuple<CollectiveType, int, int>>* out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out->clear();
+        out->reserve(crossover_.size());
+        for (const auto& p : crossover_) {
+            out->emplace_back(static_cast<CollectiveType>(p.first >> 16), p.first & 0xffff, p.second);
+        }
+    }
+
+    // PCIe circuit breaker gate: false while the breaker is open (no split at any size).
+    bool PCIeAllowed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pcie_allowed_;
+    }
+
+    void SetPCIeAllowed(bool allowed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pcie_allowed_ = allowed;
+    }
+
+    // Snapshot / replacement of the seeds (OpBucketOf -> seed), so every rank of a
+    // domain can adopt rank 0's warm start.
+    void GetAllSeeds(std::vector<std::pair<int, ParamValue>>* out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out->assign(seeds_.begin(), seeds_.end());
+    }
+
+    void SetSeeds(const std::vector<std::pair<int, ParamValue>>& in) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        seeds_.clear();
+        seeds_.insert(in.begin(), in.end());
+    }
+
+    size_t NumSeeds() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return seeds_.size();
+    }
+
+    // Clear all cached parameters (learned entries; seeds are kept)
     void Clear() {
         std::lock_guard<std::mutex> lock(mutex_);
         table_.clear();
@@ -73,8 +143,15 @@ public:
     }
 
 private:
+    static int CrossoverKey(CollectiveType op, int datatype) {
+        return (static_cast<int>(op) << 16) | (datatype & 0xffff);
+    }
+
     mutable std::mutex mutex_;
     std::unordered_map<OpKey, ParamValue> table_;
+    std::unordered_map<int, ParamValue> seeds_;  // OpBucketOf -> seed
+    std::unordered_map<int, int> crossover_;     // CrossoverKey -> size class
+    bool pcie_allowed_ = true;
 };
 
 }  // namespace ampccl
@@ -4,13 +4,22 @@
 #include <string>
 #include <cstdlib>
 #include <cstring>
+#include <unistd.h>
 
 namespace ampccl {
 
 enum class AdaptiveAlgorithm {
     TCP,      // TCP-style AIMD
     DCQCN,    // DCQCN-style
-    STATIC    // Static fixed ratio
+    STATIC,   // Static fixed ratio
+    MODEL,    // Latency/bandwidth model fit, closed-form split
+    BANDIT,   // UCB over discretised alpha arms
+    TAIL      // Balance per-path windowed p99
+};
+
+enum class StatSyncMode {
+    SHM,        // Scheme A: per-rank slots in POSIX shm, rank 0 aggregates (single host)
+    ALLREDUCE   // Scheme B: periodic AllReduce(max) over the fast communicator (multi-node)
 };
 
 class Config {
@@ -32,7 +41,7 @@ public:
     }
 
     // Algorithm selection via environment variable
-    // AMPCCL_ALGO=tcp|dcqcn|static (default: tcp)
+    // AMPCCL_ALGO=tcp|dcqcn|static|model|bandit|tail (default: tcp)
     static AdaptiveAlgorithm GetAlgorithm() {
         const char* algo_str = std::getenv("AMPCCL_ALGO");
         if (algo_str == nullptr) {
@@ -45,6 +54,12 @@ public:
             return AdaptiveAlgorithm::DCQCN;
         } else if (std::strcmp(algo_str, "static") == 0 || std::strcmp(algo_str, "STATIC") == 0) {
             return AdaptiveAlgorithm::STATIC;
+        } else if (std::strcmp(algo_str, "model") == 0 || std::strcmp(algo_str, "MODEL") == 0) {
+            return AdaptiveAlgorithm::MODEL;
+        } else if (std::strcmp(algo_str, "bandit") == 0 || std::strcmp(algo_str, "BANDIT") == 0) {
+            return AdaptiveAlgorithm::BANDIT;
+        } else if (std::strcmp(algo_str, "tail") == 0 || std::strcmp(algo_str, "TAIL") == 0) {
+            return AdaptiveAlgorithm::TAIL;
         }
 
         return AdaptiveAlgorithm::TCP;  // default
@@ -70,6 +85,20 @@ public:
         return std::stoull(val);
     }
 
+    // Bandit exploration budget: max fraction of collectives per size class that may
+    // run on an arm other than the current best.
+    // AMPCCL_BANDIT_BUDGET (default: 0.1)
+    static double GetBanditExploreBudget() {
+        const char* val = std::getenv("AMPCCL_BANDIT_BUDGET");
+        if (val == nullptr) {
+            return 0.1;
+        }
+        double b = std::atof(val);
+        if (b < 0.0) b = 0.0;
+        if (b > 1.0) b = 1.0;
+        return b;
+    }
+
     // Enable/disable PCIe backend
     // AMPCCL_ENABLE_PCIE=1|0 (default: 1)
     static bool IsPCIeEnabled() {
@@ -80,6 +109,326 @@ public:
         return std::strcmp(val, "0") != 0;
     }
 
+    // When a communicator's PCCL group is set up. lazy: on a background thread once the
+    // domain first sees a collective at or above its PCIe crossover, running fast-only
+    // until every rank is ready; communicators that only carry small messages never pay
+    // for it. eager: synchronously inside the CommInit hook.
+    // AMPCCL_PCIE_INIT=lazy|eager (default: lazy)
+    static bool IsPCIeInitLazy() {
+        const char* val = std::getenv("AMPCCL_PCIE_INIT");
+        if (val == nullptr) {
+            return true;
+        }
+        return std::strcmp(val, "eager") != 0;
+    }
+
+    // Deadline for a PCIe share to complete at stream sync, in milliseconds. A share
+    // that misses it fails the collective and quarantines PCCL (CommDomain::QuarantinePCIe).
+    // AMPCCL_PCIE_DEADLINE_MS (default: 2000; 0 = wait forever)
+    static double GetPCIeDeadlineSeconds() {
+        const char* val = std::getenv("AMPCCL_PCIE_DEADLINE_MS");
+        if (val == nullptr) {
+            return 2.0;
+        }
+        double ms = std::atof(val);
+        return ms > 0.0 ? ms / 1000.0 : 0.0;
+    }
+
+    // Consecutive PCIe failures/latency outliers that open the PCIe circuit breaker
+    // AMPCCL_PCIE_BREAKER_FAILURES (default: 3)
+    static int GetPCIeBreakerFailures() {
+        const char* val = std::getenv("AMPCCL_PCIE_BREAKER_FAILURES");
+        if (val == nullptr) {
+            return 3;
+        }
+        int n = std::atoi(val);
+        return n > 0 ? n : 3;
+    }
+
+    // Collectives the breaker stays open before the first half-open re-probe; doubles
+    // after every failed probe, up to 64x.
+    // AMPCCL_PCIE_BACKOFF (default: 64)
+    static int GetPCIeBackoff() {
+        const char* val = std::getenv("AMPCCL_PCIE_BACKOFF");
+        if (val == nullptr) {
+            return 64;
+        }
+        int n = std::atoi(val);
+        return n > 0 ? n : 64;
+    }
+
+    // Per-collective binary trace file; "%p" is replaced by the process id.
+    // AMPCCL_TRACE=<path> (default: unset -> disabled)
+    static std::string GetTracePath() {
+        return ExpandPid(std::getenv("AMPCCL_TRACE"));
+    }
+
+    // Workload capture file for ampccl-replay; "%p" is replaced by the process id.
+    // AMPCCL_CAPTURE=<path> (default: unset -> disabled)
+    static std::string GetCapturePath() {
+        return ExpandPid(std::getenv("AMPCCL_CAPTURE"));
+    }
+
+    // Trace / capture records buffered per thread before the drainer writes them (power of two)
+    // AMPCCL_TRACE_RING (default: 4096)
+    static size_t GetTraceRingSize() {
+        const char* val = std::getenv("AMPCCL_TRACE_RING");
+        size_t n = val != nullptr ? static_cast<size_t>(std::atol(val)) : 0;
+        if (n < 64) {
+            n = 4096;
+        }
+        size_t p = 64;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Per-process latency histograms in shared memory (/ampccl_stats_<pid>, read by ampccl-top)
+    // AMPCCL_STATS_PAGE=1|0 (default: 1)
+    static bool IsStatsPageEnabled() {
+        const char* val = std::getenv("AMPCCL_STATS_PAGE");
+        if (val == nullptr) {
+            return true;
+        }
+        return std::strcmp(val, "0") != 0;
+    }
+
+    // Log records admitted per call site per second; repeats beyond that are counted
+    // and reported as one line. 0 disables the limit. ERROR is never limited.
+    // AMPCCL_LOG_RATE (default: 20)
+    static int GetLogRateLimit() {
+        const char* val = std::getenv("AMPCCL_LOG_RATE");
+        if (val == nullptr) {
+            return 20;
+        }
+        int n = std::atoi(val);
+        return n > 0 ? n : 0;
+    }
+
+    // Format and write log lines on the calling thread (e.g. when chasing a crash)
+    // AMPCCL_LOG_SYNC=1|0 (default: 0)
+    static bool IsLogSyncEnabled() {
+        const char* val = std::getenv("AMPCCL_LOG_SYNC");
+        if (val == nullptr) {
+            return false;
+        }
+        return std::strcmp(val, "0") != 0;
+    }
+
+    // Hooked calls per thread between two timed ones for overhead accounting; 0 disables.
+    // AMPCCL_OVERHEAD_SAMPLE (default: 32)
+    static int GetOverheadSamplePeriod() {
+        const char* val = std::getenv("AMPCCL_OVERHEAD_SAMPLE");
+        if (val == nullptr) {
+            return 32;
+        }
+        int n = std::atoi(val);
+        return n > 0 ? n : 0;
+    }
+
+    // Print the per-op / per-phase interposition overhead table to stderr at exit
+    // AMPCCL_OVERHEAD_REPORT=1|0 (default: 0)
+    static bool IsOverheadReportEnabled() {
+        const char* val = std::getenv("AMPCCL_OVERHEAD_REPORT");
+        if (val == nullptr) {
+            return false;
+        }
+        return std::strcmp(val, "0") != 0;
+    }
+
+    // Persistent parameter profile (warm start across job restarts)
+    // AMPCCL_PROFILE=<path> (default: unset -> disabled)
+    static const char* GetProfilePath() {
+        const char* val = std::getenv("AMPCCL_PROFILE");
+        if (val == nullptr || val[0] == '\0') {
+            return nullptr;
+        }
+        return val;
+    }
+
+    // Read-only site profile (e.g. from ampccl-tune) seeded before AMPCCL_PROFILE
+    // AMPCCL_PROFILE_PRELOAD=<path> (default: unset)
+    static const char* GetProfilePreloadPath() {
+        const char* val = std::getenv("AMPCCL_PROFILE_PRELOAD");
+        if (val == nullptr || val[0] == '\0') {
+            return nullptr;
+        }
+        return val;
+    }
+
+    // Seconds between periodic profile flushes by rank 0 (also flushed at exit)
+    // AMPCCL_PROFILE_FLUSH_SEC (default: 60)
+    static double GetProfileFlushInterval() {
+        const char* val = std::getenv("AMPCCL_PROFILE_FLUSH_SEC");
+        if (val == nullptr) {
+            return 60.0;
+        }
+        return std::atof(val);
+    }
+
+    // Ranks per node as reported by the launcher: AMPCCL_LOCAL_SIZE, LOCAL_WORLD_SIZE,
+    // OMPI_COMM_WORLD_LOCAL_SIZE or MPI_LOCALNRANKS (first set wins). 0 if unknown.
+    // Job-wide, so it only describes the world communicator (or a single-host job);
+    // other communicators are grouped by the CommInit host exchange.
+    static int GetLocalSize() {
+        const char* local_vars[] = {"AMPCCL_LOCAL_SIZE", "LOCAL_WORLD_SIZE",
+                                    "OMPI_COMM_WORLD_LOCAL_SIZE", "MPI_LOCALNRANKS"};
+        for (const char* name : local_vars) {
+            const char* val = std::getenv(name);
+            if (val != nullptr && val[0] != '\0') {
+                int n = std::atoi(val);
+                return n > 0 ? n : 0;
+            }
+        }
+        return 0;
+    }
+
+    // This process's job-wide rank as reported by the launcher: AMPCCL_GLOBAL_RANK, RANK,
+    // OMPI_COMM_WORLD_RANK, PMI_RANK, PMIX_RANK or SLURM_PROCID (first set wins). -1 if unknown.
+    static int GetGlobalRank() {
+        const char* rank_vars[] = {"AMPCCL_GLOBAL_RANK", "RANK", "OMPI_COMM_WORLD_RANK",
+                                   "PMI_RANK", "PMIX_RANK", "SLURM_PROCID"};
+        for (const char* name : rank_vars) {
+            const char* val = std::getenv(name);
+            if (val != nullptr && val[0] != '\0') {
+                int r = std::atoi(val);
+                return r >= 0 ? r : -1;
+            }
+        }
+        return -1;
+    }
+
+    // Number of ranks in the job as reported by the launcher: AMPCCL_WORLD_SIZE, WORLD_SIZE,
+    // OMPI_COMM_WORLD_SIZE, PMI_SIZE or SLURM_NTASKS (first set wins). 0 if unknown.
+    static int GetWorldSize() {
+        const char* size_vars[] = {"AMPCCL_WORLD_SIZE", "WORLD_SIZE", "OMPI_COMM_WORLD_SIZE", "PMI_SIZE",
+                                   "SLURM_NTASKS"};
+        for (const char* name : size_vars) {
+            const char* val = std::getenv(name);
+            if (val != nullptr && val[0] != '\0') {
+                int n = std::atoi(val);
+                return n > 0 ? n : 0;
+            }
+        }
+        return 0;
+    }
+
+    // Job identifier, part of every domain key and shm segment name so that jobs sharing
+    // a node never share a segment: AMPCCL_JOB_ID, SLURM_JOB_ID, PBS_JOBID, LSB_JOBID or
+    // TORCHELASTIC_RUN_ID (first set wins). Empty if none is set.
+    static std::string GetJobId() {
+        const char* job_vars[] = {"AMPCCL_JOB_ID", "SLURM_JOB_ID", "PBS_JOBID", "LSB_JOBID",
+                                  "TORCHELASTIC_RUN_ID"};
+        for (const char* name : job_vars) {
+            const char* val = std::getenv(name);
+            if (val != nullptr && val[0] != '\0') {
+                return val;
+            }
+        }
+        return std::string();
+    }
+
+    // This host's name for node grouping, exchanged between the ranks of a communicator
+    // at CommInit when the launcher does not describe it: AMPCCL_HOST_ID if set
+    // (containers on one host under different hostnames), else gethostname(). Empty if
+    // neither is available.
+    static std::string GetHostId() {
+        const char* val = std::getenv("AMPCCL_HOST_ID");
+        if (val != nullptr && val[0] != '\0') {
+            return val;
+        }
+        char name[256] = {0};
+        if (gethostname(name, sizeof(name) - 1) != 0) {
+            return std::string();
+        }
+        return name;
+    }
+
+    // Ascend rank table describing the job's devices: AMPCCL_RANK_TABLE or RANK_TABLE_FILE
+    // (first set wins). Read for HCCL communicators created without one
+    // (HcclCommInitRootInfo) when its size matches theirs. nullptr if neither is set.
+    static const char* GetRankTableFile() {
+        const char* table_vars[] = {"AMPCCL_RANK_TABLE", "RANK_TABLE_FILE"};
+        for (const char* name : table_vars) {
+            const char* val = std::getenv(name);
+            if (val != nullptr && val[0] != '\0') {
+                return val;
+            }
+        }
+        return nullptr;
+    }
+
+    // Cross-rank statistics aggregation for a communicator of nranks ranks.
+    // AMPCCL_STAT_SYNC=shm|allreduce|auto (default: auto). auto picks allreduce when
+    // local_size (ranks per node of the communicator's NodeTopology) is known and smaller
+    // than nranks, i.e. the communicator spans hosts.
+    static StatSyncMode GetStatSyncMode(int nranks, int local_size = GetLocalSize()) {
+        const char* val = std::getenv("AMPCCL_STAT_SYNC");
+        if (val != nullptr) {
+            if (std::strcmp(val, "allreduce") == 0 || std::strcmp(val, "ALLREDUCE") == 0) {
+                return StatSyncMode::ALLREDUCE;
+            } else if (std::strcmp(val, "shm") == 0 || std::strcmp(val, "SHM") == 0) {
+                return StatSyncMode::SHM;
+            }
+        }
+        return (local_size > 0 && local_size < nranks) ? StatSyncMode::ALLREDUCE : StatSyncMode::SHM;
+    }
+
+    // Collectives between two statistics AllReduce rounds (scheme B)
+    // AMPCCL_STAT_SYNC_INTERVAL (default: 64)
+    static int GetStatSyncInterval() {
+        const char* val = std::getenv("AMPCCL_STAT_SYNC_INTERVAL");
+        if (val == nullptr) {
+            return 64;
+        }
+        int n = std::atoi(val);
+        return n > 0 ? n : 64;
+    }
+
+    // Collectives between rank 0 aggregating a stat and every rank applying it (scheme A).
+    // Ranks only wait for rank 0 when their host runs more than this many collectives ahead.
+    // AMPCCL_PARAM_LEAD (default: 8)
+    static int GetParamLead() {
+        const char* val = std::getenv("AMPCCL_PARAM_LEAD");
+        if (val == nullptr) {
+            return 8;
+        }
+        int n = std::atoi(val);
+        return n >= 0 ? n : 8;
+    }
+
+    // How long a scheme A rank waits at a collective entry for a rank 0 that has not
+    // attached to the domain's shm segment (failed attach, or none on this host) before it
+    // detaches and updates its controller locally. A rank 0 that attached and exited is
+    // given up on at once. AMPCCL_PARAM_WRITER_WAIT_MS (default: 30000)
+    static int GetParamWriterWaitMs() {
+        const char* val = std::getenv("AMPCCL_PARAM_WRITER_WAIT_MS");
+        if (val == nullptr) {
+            return 30000;
+        }
+        int n = std::atoi(val);
+        return n >= 0 ? n : 30000;
+    }
+
+    // Hierarchical AllReduce for multi-node communicators (intra RS -> inter AR -> intra AG)
+    // AMPCCL_HIER=1|0 (default: 1; only takes effect when GetLocalSize() < nranks)
+    static bool IsHierEnabled() {
+        const char* val = std::getenv("AMPCCL_HIER");
+        if (val == nullptr) {
+            return true;
+        }
+        return std::strcmp(val, "0") != 0;
+    }
+
+    // Minimum AllReduce size for the hierarchical path (bytes)
+    // AMPCCL_HIER_MIN_BYTES (default: 4194304)
+    static size_t GetHierMinBytes() {
+        const char* val = std::getenv("AMPCCL_HIER_MIN_BYTES");
+        if (val == nullptr) {
+            return 4u << 20;
+        }
+        return std::stoull(val);
+    }
+
     // Debug logging
     // AMPCCL_DEBUG=1|0 (default: 0)
     static bool IsDebugEnabled() {
@@ -89,6 +438,20 @@ public:
         }
         return std::strcmp(val, "0") != 0;
     }
+
+private:
+    // Path from an env value with the first "%p" replaced by the pid; empty if unset.
+    static std::string ExpandPid(const char* val) {
+        if (val == nullptr || val[0] == '\0') {
+            return std::string();
+        }
+        std::string path(val);
+        size_t pos = path.find("%p");
+        if (pos != std::string::npos) {
+            path.replace(pos, 2, std::to_string(static_cast<long>(getpid())));
+        }
+        return path;
+    }
 };
 
 }  // namespace ampccl
@@ -0,0 +1,125 @@
+#ifndef AMPCCL_COMMON_HASH_H_
+#define AMPCCL_COMMON_HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace ampccl {
+
+// 128-bit digest; lo is also used where a 64-bit id suffices.
+struct Hash128 {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+
+    bool operator==(const Hash128& other) const { return lo == other.lo && hi == other.hi; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+
+    // 32 lowercase hex digits, hi first.
+    std::string Hex() const {
+        char buf[33];
+        std::snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(hi),
+                      static_cast<unsigned long long>(lo));
+        return buf;
+    }
+};
+
+// Incremental SipHash-2-4 with 128-bit output. Used for identities that must not collide
+// across jobs and communicators sharing a node (domain keys, shm segment names); the
+// default key separates AmpCCL's digests from any other use of SipHash.
+class SipHasher128 {
+public:
+    static constexpr uint64_t kDefaultK0 = 0x414d5043434c5f4bull;  // "AMPCCL_K"
+    static constexpr uint64_t kDefaultK1 = 0x45595f444f4d4149ull;  // "EY_DOMAI"
+
+    explicit SipHasher128(uint64_t k0 = kDefaultK0, uint64_t k1 = kDefaultK1)
+        : v0_(k0 ^ 0x736f6d6570736575ull),
+          v1_(k1 ^ 0x646f72616e646f6dull ^ 0xee),
+          v2_(k0 ^ 0x6c7967656e657261ull),
+          v3_(k1 ^ 0x7465646279746573ull) {}
+
+    SipHasher128& Update(const void* data, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        size_t i = 0;
+        for (; i < len && (total_ & 7) != 0; ++i) {
+            AddByte(p[i]);
+        }
+        for (; i + 8 <= len; i += 8) {
+            uint64_t m = 0;
+            for (int b = 0; b < 8; ++b) m |= static_cast<uint64_t>(p[i + b]) << (8 * b);
+            Compress(m);
+            total_ += 8;
+        }
+        for (; i < len; ++i) {
+            AddByte(p[i]);
+        }
+        return *this;
+    }
+
+    // Fixed-width integers, little-endian, so digests do not depend on the host.
+    SipHasher128& UpdateU64(uint64_t v) {
+        if ((total_ & 7) == 0) {
+            Compress(v);
+            total_ += 8;
+            return *this;
+        }
+        unsigned char b[8];
+        for (int i = 0; i < 8; ++i) b[i] = static_cast<unsigned char>(v >> (8 * i));
+        return Update(b, sizeof(b));
+    }
+
+    // Length-prefixed, so consecutive strings cannot run into each other.
+    SipHasher128& UpdateString(const std::string& s) {
+        UpdateU64(s.size());
+        return Update(s.data(), s.size());
+    }
+
+    Hash128 Finalize() const {
+        SipHasher128 h = *this;
+        uint64_t b = tail_ | (static_cast<uint64_t>(total_) << 56);
+        h.Compress(b);
+        h.v2_ ^= 0xee;
+        h.Rounds(4);
+        Hash128 out;
+        out.lo = h.v0_ ^ h.v1_ ^ h.v2_ ^ h.v3_;
+        h.v1_ ^= 0xdd;
+        h.Rounds(4);
+        out.hi = h.v0_ ^ h.v1_ ^ h.v2_ ^ h.v3_;
+        return out;
+    }
+
+private:
+    static uint64_t Rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+    void Rounds(int n) {
+        for (int i = 0; i < n; ++i) {
+            v0_ += v1_; v1_ = Rotl(v1_, 13); v1_ ^= v0_; v0_ = Rotl(v0_, 32);
+            v2_ += v3_; v3_ = Rotl(v3_, 16); v3_ ^= v2_;
+            v0_ += v3_; v3_ = Rotl(v3_, 21); v3_ ^= v0_;
+            v2_ += v1_; v1_ = Rotl(v1_, 17); v1_ ^= v2_; v2_ = Rotl(v2_, 32);
+        }
+    }
+
+    void AddByte(unsigned char c) {
+        tail_ |= static_cast<uint64_t>(c) << (8 * (total_ & 7));
+        if ((++total_ & 7) == 0) {
+            Compress(tail_);
+            tail_ = 0;
+        }
+    }
+
+    void Compress(uint64_t m) {
+        v3_ ^= m;
+        Rounds(2);
+        v0_ ^= m;
+    }
+
+    uint64_t v0_, v1_, v2_, v3_;
+    uint64_t tail_ = 0;   // Pending bytes of the current 8-byte word
+    uint64_t total_ = 0;  // Bytes hashed so far
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_COMMON_HASH_H_
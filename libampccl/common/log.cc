@@ -0,0 +1,434 @@
+#include "log.h"
+#include "config.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <pthread.h>
+
+namespace ampccl {
+
+namespace {
+
+constexpr size_t kLogRingSize = 256;  // Records per thread (64 KiB)
+
+// Set once the logger has been destroyed; later calls (other singletons' destructors)
+// are formatted and written on the calling thread.
+std::atomic<bool> g_log_shutdown{false};
+
+// Set in a child forked from a process that had started the logger: the drainer thread
+// did not survive the fork, so the child formats and writes on the calling thread.
+std::atomic<bool> g_log_forked{false};
+
+// Set when this thread's ring has been handed back (RingLease destroyed); logging from
+// thread_local destructors that run later is written on the calling thread.
+thread_local bool t_ring_released = false;
+
+uint64_t SteadyNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Single-producer / single-consumer ring; a full ring drops the new record (counted).
+class LogRing {
+public:
+    LogRing() : slots_(kLogRingSize) {}
+
+    void Push(const LogRecord& rec) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= kLogRingSize) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slots_[head & (kLogRingSize - 1)] = rec;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    void DrainInto(std::vector<LogRecord>* out) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            out->push_back(slots_[tail & (kLogRingSize - 1)]);
+        }
+        tail_.store(tail, std::memory_order_release);
+    }
+
+    uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+    // Drop queued records without writing them (the forked child's copies).
+    void Discard() { tail_.store(head_.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+
+    // The producer thread has exited: nothing is pushed after this, so once drained the
+    // ring can be handed to a new thread.
+    void Retire() { retired_.store(true, std::memory_order_release); }
+    bool retired() const { return retired_.load(std::memory_order_acquire); }
+    void Reuse() { retired_.store(false, std::memory_order_relaxed); }
+
+private:
+    std::vector<LogRecord> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> retired_{false};
+};
+
+// Append one conversion. spec holds "%" plus flags/width/precision; length modifiers
+// are dropped and replaced by the captured argument's own width.
+void AppendArg(std::string* out, std::string spec, char conv, const LogRecord& r, int idx) {
+    if (idx >= r.nargs) {
+        out->append("(missing)");
+        return;
+    }
+    LogArgType t = r.types[idx];
+    const auto& a = r.args[idx];
+    auto as_int = [&]() -> long long {
+        switch (t) {
+            case LogArgType::Int: return static_cast<long long>(a.i);
+            case LogArgType::UInt: return static_cast<long long>(a.u);
+            case LogArgType::Double: return static_cast<long long>(a.d);
+            case LogArgType::Pointer: return static_cast<long long>(reinterpret_cast<intptr_t>(a.p));
+            default: return 0;
+        }
+    };
+    auto as_double = [&]() -> double {
+        switch (t) {
+            case LogArgType::Int: return static_cast<double>(a.i);
+            case LogArgType::UInt: return static_cast<double>(a.u);
+            case LogArgType::Double: return a.d;
+            default: return 0.0;
+        }
+    };
+    char buf[128];
+    int n = 0;
+    switch (conv) {
+        case 'd': case 'i':
+            spec += "ll";
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(), as_int());
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            spec += "ll";
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(), static_cast<unsigned long long>(as_int()));
+            break;
+        case 'c':
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(), static_cast<int>(as_int()));
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(), as_double());
+            break;
+        case 's':
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(),
+                              t == LogArgType::String ? r.strings + a.u : "(?)");
+            break;
+        case 'p':
+            spec += conv;
+            n = std::snprintf(buf, sizeof(buf), spec.c_str(), t == LogArgType::Pointer ? a.p : nullptr);
+            break;
+        default:
+            out->append("(?)");
+            return;
+    }
+    if (n > 0) {
+        out->append(buf, std::min(static_cast<size_t>(n), sizeof(buf) - 1));
+    }
+}
+
+void FormatRecord(const LogRecord& r, std::string* out) {
+    out->append("[AMPCCL][");
+    out->append(LogLevelName(static_cast<LogLevel>(r.level)));
+    out->append("] ");
+    int arg = 0;
+    for (const char* p = r.fmt; *p != '\0'; ++p) {
+        if (*p != '%') {
+            out->push_back(*p);
+            continue;
+        }
+        if (p[1] == '%') {
+            out->push_back('%');
+            ++p;
+            continue;
+        }
+        std::string spec = "%";
+        ++p;
+        while (*p != '\0' && std::strchr("-+ #0", *p) != nullptr) spec += *p++;
+        while (*p >= '0' && *p <= '9') spec += *p++;
+        if (*p == '.') {
+            spec += *p++;
+            while (*p >= '0' && *p <= '9') spec += *p++;
+        }
+        while (*p != '\0' && std::strchr("hlLqjzt", *p) != nullptr) ++p;
+        if (*p == '\0') {
+            break;
+        }
+        AppendArg(out, spec, *p, r, arg++);
+    }
+    out->push_back('\n');
+}
+
+class LogCore {
+public:
+    static LogCore& GetInstance() {
+        static LogCore instance;
+        return instance;
+    }
+
+    // False when this thread no longer has a ring (see t_ring_released).
+    bool Push(const LogRecord& rec) {
+        LogRing* ring = ThreadRing();
+        if (ring == nullptr) {
+            return false;
+        }
+        ring->Push(rec);
+        return true;
+    }
+
+    // Drain every ring, merge by timestamp, rate-limit and write to stderr. Rings of
+    // exited threads move to the free list once drained.
+    void Flush() {
+        std::lock_guard<std::mutex> lock(rings_mu_);
+        pending_.clear();
+        uint64_t dropped = 0;
+        for (size_t i = 0; i < rings_.size();) {
+            LogRing* r = rings_[i].get();
+            bool retired = r->retired();  // Before draining: every push is visible then
+            r->DrainInto(&pending_);
+            dropped += r->TakeDropped();
+            if (retired) {
+                free_rings_.push_back(std::move(rings_[i]));
+                rings_[i] = std::move(rings_.back());
+                rings_.pop_back();
+                continue;
+            }
+            ++i;
+        }
+        if (pending_.empty() && dropped == 0) {
+            return;
+        }
+        std::stable_sort(pending_.begin(), pending_.end(),
+                         [](const LogRecord& a, const LogRecord& b) { return a.ns < b.ns; });
+        std::string out;
+        for (const LogRecord& r : pending_) {
+            if (Admit(r, &out)) {
+                FormatRecord(r, &out);
+            }
+        }
+        if (dropped > 0) {
+            AppendNote(&out, LogLevel::WARN, dropped, "log records dropped (ring full)");
+        }
+        std::fwrite(out.data(), 1, out.size(), stderr);
+        std::fflush(stderr);
+    }
+
+private:
+    // Per call site (format pointer) budget of rate_limit_ records per second.
+    struct SiteWindow {
+        uint64_t start_ns = 0;
+        uint32_t count = 0;
+        uint64_t suppressed = 0;
+        uint8_t level = 0;
+    };
+
+    LogCore() : rate_limit_(Config::GetLogRateLimit()) {
+        drainer_ = std::thread(&LogCore::DrainLoop, this);
+        pthread_atfork(&LogCore::PrepareFork, &LogCore::ParentAfterFork, &LogCore::ChildAfterFork);
+    }
+
+    // fork() with the locks held, so the child never inherits one the drainer (or a
+    // logging thread registering its ring) held mid-update.
+    static void PrepareFork() {
+        if (g_log_shutdown.load(std::memory_order_acquire)) {
+            return;
+        }
+        LogCore& core = GetInstance();
+        core.wake_mu_.lock();
+        core.rings_mu_.lock();
+    }
+
+    static void ParentAfterFork() {
+        if (g_log_shutdown.load(std::memory_order_acquire)) {
+            return;
+        }
+        LogCore& core = GetInstance();
+        core.rings_mu_.unlock();
+        core.wake_mu_.unlock();
+    }
+
+    // Only the forking thread exists in the child: no drainer, and the other threads'
+    // rings are orphaned. The parent writes the records queued before the fork, so the
+    // child drops its copies and writes synchronously from here on.
+    static void ChildAfterFork() {
+        if (g_log_shutdown.load(std::memory_order_acquire)) {
+            return;
+        }
+        LogCore& core = GetInstance();
+        for (const auto& r : core.rings_) {
+            r->Discard();
+            r->TakeDropped();
+        }
+        // The parent's drainer handle and the condition variable it waits on: abandoned,
+        // as joining or detaching another process's thread is undefined and a broadcast
+        // would wait for that waiter to wake.
+        new (&core.drainer_) std::thread();
+        new (&core.wake_) std::condition_variable();
+        g_log_forked.store(true, std::memory_order_release);
+        core.rings_mu_.unlock();
+        core.wake_mu_.unlock();
+    }
+
+    ~LogCore() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (drainer_.joinable()) {
+            drainer_.join();
+        }
+        Flush();
+        g_log_shutdown.store(true, std::memory_order_release);
+        std::string out;
+        for (const auto& kv : sites_) {
+            if (kv.second.suppressed > 0) {
+                AppendSuppressed(&out, kv.first, kv.second);
+            }
+        }
+        std::fwrite(out.data(), 1, out.size(), stderr);
+        std::fflush(stderr);
+    }
+
+    LogCore(const LogCore&) = delete;
+    LogCore& operator=(const LogCore&) = delete;
+
+    // Holds the calling thread's ring; retires it when the thread exits, so rings
+    // (64 KiB each) are bounded by the peak number of logging threads, not the total.
+    struct RingLease {
+        LogRing* ring = nullptr;
+        ~RingLease() {
+            t_ring_released = true;
+            if (ring != nullptr && !g_log_shutdown.load(std::memory_order_acquire)) {
+                ring->Retire();
+            }
+        }
+    };
+
+    LogRing* ThreadRing() {
+        if (t_ring_released) {
+            return nullptr;
+        }
+        thread_local RingLease lease;
+        if (lease.ring == nullptr) {
+            std::lock_guard<std::mutex> lock(rings_mu_);
+            if (free_rings_.empty()) {
+                rings_.push_back(std::unique_ptr<LogRing>(new LogRing()));
+            } else {
+                rings_.push_back(std::move(free_rings_.back()));
+                free_rings_.pop_back();
+                rings_.back()->Reuse();
+            }
+            lease.ring = rings_.back().get();
+        }
+        return lease.ring;
+    }
+
+    bool Admit(const LogRecord& r, std::string* out) {
+        if (rate_limit_ <= 0 || r.level <= static_cast<uint8_t>(LogLevel::ERROR)) {
+            return true;
+        }
+        SiteWindow& w = sites_[r.fmt];
+        if (r.ns - w.start_ns >= 1000000000ull) {
+            if (w.suppressed > 0) {
+                AppendSuppressed(out, r.fmt, w);
+            }
+            w.start_ns = r.ns;
+            w.count = 0;
+            w.suppressed = 0;
+        }
+        if (w.count >= static_cast<uint32_t>(rate_limit_)) {
+            ++w.suppressed;
+            w.level = r.level;
+            return false;
+        }
+        ++w.count;
+        return true;
+    }
+
+    static void AppendNote(std::string* out, LogLevel level, uint64_t n, const char* what) {
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "[AMPCCL][%s] %llu %s\n", LogLevelName(level),
+                      static_cast<unsigned long long>(n), what);
+        out->append(buf);
+    }
+
+    static void AppendSuppressed(std::string* out, const char* fmt, const SiteWindow& w) {
+        std::string what = "similar messages suppressed: ";
+        what += fmt;
+        AppendNote(out, static_cast<LogLevel>(w.level), w.suppressed, what.c_str());
+    }
+
+    void DrainLoop() {
+        std::unique_lock<std::mutex> lock(wake_mu_);
+        while (!stop_) {
+            wake_.wait_for(lock, std::chrono::milliseconds(10));
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    const int rate_limit_;
+    std::mutex rings_mu_;  // Ring registration and draining, never taken by Push
+    std::vector<std::unique_ptr<LogRing>> rings_;       // Rings in use or awaiting a last drain
+    std::vector<std::unique_ptr<LogRing>> free_rings_;  // Drained rings of exited threads
+    std::vector<LogRecord> pending_;                        // Drain scratch (under rings_mu_)
+    std::unordered_map<const char*, SiteWindow> sites_;     // Rate limiter (under rings_mu_)
+    std::mutex wake_mu_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread drainer_;
+};
+
+void WriteNow(const LogRecord& rec) {
+    std::string out;
+    FormatRecord(rec, &out);
+    std::fwrite(out.data(), 1, out.size(), stderr);
+    std::fflush(stderr);
+}
+
+}  // namespace
+
+void Logger::Submit(LogRecord* rec) {
+    static const bool sync = Config::IsLogSyncEnabled();
+    rec->ns = SteadyNs();
+    if (sync || g_log_shutdown.load(std::memory_order_acquire) || g_log_forked.load(std::memory_order_acquire)) {
+        WriteNow(*rec);
+        return;
+    }
+    LogCore& core = LogCore::GetInstance();
+    if (!core.Push(*rec)) {
+        WriteNow(*rec);
+        return;
+    }
+    if (rec->level <= static_cast<uint8_t>(LogLevel::ERROR)) {
+        core.Flush();  // Errors reach stderr before the caller continues (or aborts)
+    }
+}
+
+void Logger::Flush() {
+    if (!g_log_shutdown.load(std::memory_order_acquire)) {
+        LogCore::GetInstance().Flush();
+    }
+}
+
+}  // namespace ampccl
@@ -1,9 +1,11 @@
 #ifndef AMPCCL_COMMON_LOG_H_
 #define AMPCCL_COMMON_LOG_H_
 
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <type_traits>
 
 namespace ampccl {
 
@@ -17,6 +19,17 @@ enum class LogLevel : int {
     DEBUG = 4
 };
 
+// Compile-time ceiling: sites more verbose than this are compiled out, whatever the
+// runtime level. Release builds (NDEBUG) keep ERROR/WARN only; override with
+// -DAMPCCL_LOG_MIN_LEVEL=<0-4> (CMake cache variable of the same name).
+#ifndef AMPCCL_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define AMPCCL_LOG_MIN_LEVEL 2
+#else
+#define AMPCCL_LOG_MIN_LEVEL 4
+#endif
+#endif
+
 // Global log level. Can be set by env AMPCCL_LOG_LEVEL or by SetLogLevel() at runtime.
 inline int& GetLogLevelRef() {
     static int level = -1;
@@ -66,12 +79,117 @@ inline const char* LogLevelName(LogLevel l) {
     }
 }
 
+// One captured log call: the format string pointer (a literal, so it outlives the
+// record), a timestamp and the raw arguments. String arguments are copied into
+// `strings` (truncated when they do not fit). Formatting happens later on the
+// logger thread (common/log.cc).
+constexpr int kLogMaxArgs = 8;
+
+enum class LogArgType : uint8_t {
+    Int = 0,
+    UInt = 1,
+    Double = 2,
+    String = 3,   // Offset into LogRecord::strings
+    Pointer = 4
+};
+
+struct LogRecord {
+    const char* fmt;
+    uint64_t ns;             // steady_clock, used to order records across threads
+    uint8_t level;
+    uint8_t nargs;
+    uint16_t strings_used;
+    LogArgType types[kLogMaxArgs];
+    uint8_t pad[4];
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        const void* p;
+    } args[kLogMaxArgs];
+    char strings[160];
+};
+
+static_assert(sizeof(LogRecord) == 256, "LogRecord should stay 256 bytes");
+
+class Logger {
+public:
+    // Capture and enqueue on the calling thread's ring; never blocks on I/O except
+    // for ERROR, which drains everything queued so far before returning.
+    template <typename... Args>
+    static void Log(LogLevel level, const char* fmt, const Args&... args) {
+        static_assert(sizeof...(Args) <= kLogMaxArgs, "too many AMPCCL_LOG arguments");
+        LogRecord rec;
+        rec.fmt = fmt;
+        rec.level = static_cast<uint8_t>(level);
+        rec.nargs = 0;
+        rec.strings_used = 0;
+        (Capture(&rec, args), ...);
+        Submit(&rec);
+    }
+
+    // Drain all pending records to stderr now.
+    static void Flush();
+
+private:
+    static void Submit(LogRecord* rec);
+
+    template <typename T>
+    static void Capture(LogRecord* rec, const T& v) {
+        int i = rec->nargs++;
+        using D = typename std::decay<T>::type;
+        if constexpr (std::is_same<D, char*>::value || std::is_same<D, const char*>::value) {
+            CaptureString(rec, i, v);
+        } else if constexpr (std::is_floating_point<D>::value) {
+            rec->types[i] = LogArgType::Double;
+            rec->args[i].d = static_cast<double>(v);
+        } else if constexpr (std::is_enum<D>::value) {
+            rec->types[i] = LogArgType::Int;
+            rec->args[i].i = static_cast<int64_t>(v);
+        } else if constexpr (std::is_integral<D>::value) {
+            if constexpr (std::is_signed<D>::value) {
+                rec->types[i] = LogArgType::Int;
+                rec->args[i].i = static_cast<int64_t>(v);
+            } else {
+                rec->types[i] = LogArgType::UInt;
+                rec->args[i].u = static_cast<uint64_t>(v);
+            }
+        } else {
+            static_assert(std::is_pointer<D>::value, "unsupported AMPCCL_LOG argument type");
+            rec->types[i] = LogArgType::Pointer;
+            rec->args[i].p = static_cast<const void*>(v);
+        }
+    }
+
+    static void CaptureString(LogRecord* rec, int i, const char* s) {
+        rec->types[i] = LogArgType::String;
+        rec->args[i].u = rec->strings_used;
+        size_t room = sizeof(rec->strings) - rec->strings_used;
+        if (room == 0) {
+            rec->args[i].u = sizeof(rec->strings) - 1;  // Terminator of the previous string
+            return;
+        }
+        if (s == nullptr) s = "(null)";
+        size_t len = std::strlen(s);
+        if (len >= room) len = room - 1;
+        std::memcpy(rec->strings + rec->strings_used, s, len);
+        rec->strings[rec->strings_used + len] = '\0';
+        rec->strings_used = static_cast<uint16_t>(rec->strings_used + len + 1);
+    }
+};
+
+// Never called: lets the compiler check AMPCCL_LOG formats against their arguments.
+inline void LogFormatCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void LogFormatCheck(const char*, ...) {}
+
+// AMPCCL_LOG(LEVEL, fmt, args...): printf-style; %s arguments are copied at the call,
+// everything else is formatted on the logger thread. No '*' width/precision.
 #define AMPCCL_LOG(level, ...) do { \
-    if (static_cast<int>(ampccl::LogLevel::level) <= ampccl::GetLogLevelRef()) { \
-        std::fprintf(stderr, "[AMPCCL][%s] ", ampccl::LogLevelName(ampccl::LogLevel::level)); \
-        std::fprintf(stderr, __VA_ARGS__); \
-        std::fprintf(stderr, "\n"); \
-        std::fflush(stderr); \
+    if constexpr (static_cast<int>(ampccl::LogLevel::level) <= AMPCCL_LOG_MIN_LEVEL) { \
+        if (static_cast<int>(ampccl::LogLevel::level) <= ampccl::GetLogLevelRef()) { \
+            static_cast<void>(sizeof((ampccl::LogFormatCheck(__VA_ARGS__), 0))); \
+            ampccl::Logger::Log(ampccl::LogLevel::level, __VA_ARGS__); \
+        } \
     } \
 } while (0)
 
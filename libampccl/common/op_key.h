@@ -13,9 +13,25 @@ enum class CollectiveType {
     ReduceScatter,
     Broadcast,
     Reduce,
-    AllToAll
+    AllToAll,
+    HierIntra   // Intra-node phases (reduce-scatter + all-gather) of a hierarchical AllReduce
 };
 
+constexpr int kNumCollectiveTypes = 7;
+
+inline const char* CollectiveTypeName(CollectiveType op) {
+    switch (op) {
+        case CollectiveType::AllReduce: return "AllReduce";
+        case CollectiveType::AllGather: return "AllGather";
+        case CollectiveType::ReduceScatter: return "ReduceScatter";
+        case CollectiveType::Broadcast: return "Broadcast";
+        case CollectiveType::Reduce: return "Reduce";
+        case CollectiveType::AllToAll: return "AllToAll";
+        case CollectiveType::HierIntra: return "AllReduce(hier)";
+    }
+    return "?";
+}
+
 struct OpKey {
     CollectiveType op;
     size_t bytes;
@@ -26,6 +42,29 @@ struct OpKey {
     }
 };
 
+// Message size class: floor(log2(bytes)), so 1 MB and 1.5 MB share a class while
+// 1 MB and 256 MB do not. Controllers key their learned state by size class.
+constexpr int kNumSizeClasses = 64;
+
+inline int SizeClassOf(size_t bytes) {
+    int c = 0;
+    while (bytes > 1 && c < kNumSizeClasses - 1) {
+        bytes >>= 1;
+        ++c;
+    }
+    return c;
+}
+
+// Controller state bucket: (collective type, size class). Algorithms keep their
+// state as arrays indexed by this so each message class converges independently.
+constexpr int kNumOpBuckets = kNumCollectiveTypes * kNumSizeClasses;
+
+inline int OpBucketOf(const OpKey& key) {
+    int op = static_cast<int>(key.op);
+    if (op < 0 || op >= kNumCollectiveTypes) op = 0;
+    return op * kNumSizeClasses + SizeClassOf(key.bytes);
+}
+
 }  // namespace ampccl
 
 // Hash function for OpKey
@@ -0,0 +1,171 @@
+#ifndef AMPCCL_CONTROLLER_ALGO_BANDIT_H_
+#define AMPCCL_CONTROLLER_ALGO_BANDIT_H_
+
+#include "algo_base.h"
+#include "telemetry/stats.h"
+#include "cache/param_cache.h"
+#include "common/op_key.h"
+#include "common/config.h"
+#include "common/log.h"
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace ampccl {
+
+// Bandit-style algorithm for non-convex time(alpha) landscapes (e.g. NVLink/HCCS
+// and PCIe contending for host memory bandwidth). alpha is discretised into
+// kArms arms per bucket; UCB1 (minimising normalised GetTotalTime()) picks the
+// next arm. The next arm is chosen at Update time and written to the cache, so
+// all ranks play the same arm. At most explore_budget_ of a bucket's collectives
+// run on an arm other than the current best.
+class BanditAlgo : public AdaptiveAlgo {
+public:
+    static constexpr int kArms = 11;  // alpha = 0.0, 0.1, ..., 1.0
+
+    BanditAlgo()
+        : explore_budget_(Config::GetBanditExploreBudget()),
+          ucb_c_(0.5),         // Exploration weight on normalised time
+          min_weight_(0.05) {  // EWMA floor so arm means track drift
+        Reset();
+    }
+
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        return seeded_[b] ? ArmAlpha(next_arm_[b]) : current.alpha;
+    }
+
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        if (!seeded_[b]) {
+            next_arm_[b] = NearestArm(current.alpha);
+            seeded_[b] = 1;
+        }
+        size_t total_bytes = stat.fast_bytes + stat.pcie_bytes;
+        double t = stat.GetTotalTime();
+        if (total_bytes == 0 || t <= 0.0) {
+            return;
+        }
+        // Failed collectives are penalised with double their measured time.
+        if (!stat.fast_success || !stat.pcie_success) {
+            t *= 2.0;
+        }
+
+        int played = NearestArm(static_cast<double>(stat.fast_bytes) / total_bytes);
+        int best = BestArm(b);
+        if (best >= 0) {
+            double best_mean = mean_[Idx(b, best)];
+            regret_.pulls++;
+            if (played != best) {
+                regret_.explore_pulls++;
+            }
+            if (t > best_mean) {
+                regret_.regret_time += t - best_mean;
+            }
+        }
+
+        int i = Idx(b, played);
+        count_[i]++;
+        double w = 1.0 / count_[i];
+        if (w < min_weight_) w = min_weight_;
+        mean_[i] += w * (t - mean_[i]);
+        pulls_[b]++;
+
+        next_arm_[b] = ChooseArm(b);
+        if (next_arm_[b] != BestArm(b)) {
+            off_best_[b]++;
+        }
+
+        if ((regret_.pulls & 1023) == 0 && regret_.pulls > 0) {
+            AMPCCL_LOG(INFO, "Bandit: pulls=%llu explore=%.3f regret=%.6fs",
+                       static_cast<unsigned long long>(regret_.pulls),
+                       regret_.ExploreFraction(), regret_.regret_time);
+        }
+    }
+
+    void Reset() override {
+        count_.fill(0);
+        mean_.fill(0.0);
+        pulls_.fill(0);
+        off_best_.fill(0);
+        next_arm_.fill(0);
+        seeded_.fill(0);
+        regret_ = RegretStats();
+    }
+
+    const RegretStats* GetRegretStats() const override { return &regret_; }
+
+private:
+    static int Idx(int bucket, int arm) { return bucket * kArms + arm; }
+
+    static double ArmAlpha(int arm) {
+        return static_cast<double>(arm) / (kArms - 1);
+    }
+
+    static int NearestArm(double alpha) {
+        if (alpha < 0.0) alpha = 0.0;
+        if (alpha > 1.0) alpha = 1.0;
+        return static_cast<int>(alpha * (kArms - 1) + 0.5);
+    }
+
+    // Arm with the lowest mean time among those played; -1 if none.
+    int BestArm(int b) const {
+        int best = -1;
+        for (int a = 0; a < kArms; ++a) {
+            int i = Idx(b, a);
+            if (count_[i] > 0 && (best < 0 || mean_[i] < mean_[Idx(b, best)])) {
+                best = a;
+            }
+        }
+        return best;
+    }
+
+    int ChooseArm(int b) const {
+        int best = BestArm(b);
+        // Exploration budget: off-best plays may not exceed budget * pulls.
+        double allowed = explore_budget_ * static_cast<double>(pulls_[b] + 1);
+        if (static_cast<double>(off_best_[b] + 1) > allowed) {
+            return best;
+        }
+        // Unplayed arms first, nearest to the current best.
+        int pick = -1;
+        for (int d = 1; d < kArms && pick < 0; ++d) {
+            if (best - d >= 0 && count_[Idx(b, best - d)] == 0) pick = best - d;
+            else if (best + d < kArms && count_[Idx(b, best + d)] == 0) pick = best + d;
+        }
+        if (pick >= 0) {
+            return pick;
+        }
+        // UCB1 lower confidence bound on normalised time.
+        double best_mean = mean_[Idx(b, best)];
+        double log_n = std::log(static_cast<double>(pulls_[b]));
+        pick = best;
+        double best_score = 1.0 - ucb_c_ * std::sqrt(log_n / count_[Idx(b, best)]);
+        for (int a = 0; a < kArms; ++a) {
+            int i = Idx(b, a);
+            double score = mean_[i] / best_mean - ucb_c_ * std::sqrt(log_n / count_[i]);
+            if (score < best_score) {
+                best_score = score;
+                pick = a;
+            }
+        }
+        return pick;
+    }
+
+    // Per-bucket and per-(bucket, arm) state (structure of arrays)
+    std::array<uint32_t, kNumOpBuckets * kArms> count_;
+    std::array<double, kNumOpBuckets * kArms> mean_;
+    std::array<uint64_t, kNumOpBuckets> pulls_;
+    std::array<uint64_t, kNumOpBuckets> off_best_;
+    std::array<uint8_t, kNumOpBuckets> next_arm_;
+    std::array<uint8_t, kNumOpBuckets> seeded_;
+
+    RegretStats regret_;
+    double explore_budget_;
+    double ucb_c_;
+    double min_weight_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_ALGO_BANDIT_H_
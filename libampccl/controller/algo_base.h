@@ -3,23 +3,31 @@
 
 #include "cache/param_cache.h"
 #include "telemetry/stats.h"
+#include "common/op_key.h"
 
 namespace ampccl {
 
-// Base class for adaptive algorithms
+// Base class for adaptive algorithms.
+// State is per OpBucketOf(op_key) (collective type x size class), so updates for
+// one message class never disturb another and call order does not matter.
 class AdaptiveAlgo {
 public:
     virtual ~AdaptiveAlgo() = default;
 
-    // Suggest alpha (fast backend ratio) based on current parameters
+    // Suggest alpha (fast backend ratio) for op_key. current is the cached value
+    // (possibly written by another rank); used until this bucket has been updated.
     // Returns alpha in [0.0, 1.0]
-    virtual double Suggest(const ParamValue& current) = 0;
+    virtual double Suggest(const OpKey& op_key, const ParamValue& current) = 0;
 
-    // Update algorithm state based on execution statistics
-    virtual void Update(const ExecStat& stat) = 0;
+    // Update the bucket of op_key from execution statistics. current seeds the
+    // bucket's state on its first update.
+    virtual void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) = 0;
 
     // Reset algorithm state
     virtual void Reset() = 0;
+
+    // Exploration cost, for algorithms that explore (nullptr otherwise).
+    virtual const RegretStats* GetRegretStats() const { return nullptr; }
 };
 
 }  // namespace ampccl
@@ -4,8 +4,9 @@
 #include "algo_base.h"
 #include "telemetry/stats.h"
 #include "cache/param_cache.h"
-#include <deque>
-#include <algorithm>
+#include "common/op_key.h"
+#include <array>
+#include <cstdint>
 
 namespace ampccl {
 
@@ -14,25 +15,30 @@ namespace ampccl {
 class DCQCNAlgo : public AdaptiveAlgo {
 public:
     DCQCNAlgo()
-        : alpha_(0.5),
-          target_ratio_(1.0),  // Target ratio of PCIe to fast bandwidth
+        : target_ratio_(1.0),  // Target ratio of PCIe to fast bandwidth
           kp_(0.1),            // Proportional gain
           ki_(0.01),           // Integral gain
-          kd_(0.001),          // Derivative gain
-          integral_error_(0.0),
-          last_error_(0.0),
-          window_size_(10) {}
-
-    double Suggest(const ParamValue& current) override {
-        alpha_ = current.alpha;
-        return alpha_;
+          kd_(0.001) {         // Derivative gain
+        Reset();
     }
 
-    void Update(const ExecStat& stat) override {
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        return seeded_[b] ? alpha_[b] : current.alpha;
+    }
+
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        if (!seeded_[b]) {
+            alpha_[b] = current.alpha;
+            seeded_[b] = 1;
+        }
+        double& alpha = alpha_[b];
+
         if (!stat.fast_success || !stat.pcie_success) {
             // If either backend failed, decrease alpha
-            alpha_ *= 0.8;
-            if (alpha_ < 0.1) alpha_ = 0.1;
+            alpha *= 0.8;
+            if (alpha < 0.1) alpha = 0.1;
             return;
         }
 
@@ -50,38 +56,42 @@ public:
         double error = target_ratio_ - current_ratio;
 
         // PID controller
-        integral_error_ += error;
+        double& integral_error = integral_error_[b];
+        integral_error += error;
         // Clamp integral to prevent windup
-        if (integral_error_ > 1.0) integral_error_ = 1.0;
-        if (integral_error_ < -1.0) integral_error_ = -1.0;
+        if (integral_error > 1.0) integral_error = 1.0;
+        if (integral_error < -1.0) integral_error = -1.0;
 
-        double derivative_error = error - last_error_;
-        last_error_ = error;
+        double derivative_error = error - last_error_[b];
+        last_error_[b] = error;
 
         // PID output
-        double pid_output = kp_ * error + ki_ * integral_error_ + kd_ * derivative_error;
+        double pid_output = kp_ * error + ki_ * integral_error + kd_ * derivative_error;
 
         // Update alpha
-        alpha_ += pid_output;
+        alpha += pid_output;
 
         // Clamp alpha to valid range
-        if (alpha_ < 0.1) alpha_ = 0.1;
-        if (alpha_ > 0.9) alpha_ = 0.9;
+        if (alpha < 0.1) alpha = 0.1;
+        if (alpha > 0.9) alpha = 0.9;
     }
 
     void Reset() override {
-        alpha_ = 0.5;
-        integral_error_ = 0.0;
-        last_error_ = 0.0;
+        alpha_.fill(0.5);
+        integral_error_.fill(0.0);
+        last_error_.fill(0.0);
+        seeded_.fill(0);
     }
 
 private:
-    double alpha_;
+    // Per-bucket PID state (structure of arrays, indexed by OpBucketOf)
+    std::array<double, kNumOpBuckets> alpha_;
+    std::array<double, kNumOpBuckets> integral_error_;
+    std::array<double, kNumOpBuckets> last_error_;
+    std::array<uint8_t, kNumOpBuckets> seeded_;
+
     double target_ratio_;
     double kp_, ki_, kd_;
-    double integral_error_;
-    double last_error_;
-    size_t window_size_;
 };
 
 }  // namespace ampccl
@@ -4,18 +4,47 @@
 #include "algo_base.h"
 #include "algo_tcp.h"
 #include "algo_dcqcn.h"
+#include "algo_model.h"
+#include "algo_bandit.h"
+#include "algo_tail.h"
 #include "common/config.h"
-#include "core/domain.h"
 #include <memory>
+#include <string>
 
 namespace ampccl {
 
+class CommDomain;
+
+// Static fixed-ratio algorithm
+class StaticAlgo : public AdaptiveAlgo {
+public:
+    explicit StaticAlgo(double alpha = 0.5) : alpha_(alpha), initial_alpha_(alpha) {}
+
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        return alpha_;  // Fixed ratio
+    }
+
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        // Static algorithm doesn't adapt
+    }
+
+    void Reset() override {
+        alpha_ = initial_alpha_;
+    }
+
+private:
+    double alpha_;
+    double initial_alpha_;
+};
+
 class AlgoFactory {
 public:
     // Create adaptive algorithm based on environment variable and domain
     static std::unique_ptr<AdaptiveAlgo> Create(const CommDomain& domain) {
-        AdaptiveAlgorithm algo_type = Config::GetAlgorithm();
+        return Create(Config::GetAlgorithm());
+    }
 
+    static std::unique_ptr<AdaptiveAlgo> Create(AdaptiveAlgorithm algo_type) {
         switch (algo_type) {
             case AdaptiveAlgorithm::TCP:
                 return std::make_unique<TCPAlgo>();
@@ -26,31 +55,47 @@ public:
             case AdaptiveAlgorithm::STATIC:
                 return std::make_unique<StaticAlgo>();
 
+            case AdaptiveAlgorithm::MODEL:
+                return std::make_unique<ModelAlgo>();
+
+            case AdaptiveAlgorithm::BANDIT:
+                return std::make_unique<BanditAlgo>();
+
+            case AdaptiveAlgorithm::TAIL:
+                return std::make_unique<TailAlgo>();
+
             default:
                 return std::make_unique<TCPAlgo>();  // Default to TCP
         }
     }
-};
 
-// Forward declaration - will be defined in algo_static.h or here
-class StaticAlgo : public AdaptiveAlgo {
-public:
-    StaticAlgo() : alpha_(0.5) {}
-
-    double Suggest(const ParamValue& current) override {
-        return alpha_;  // Fixed ratio
-    }
-
-    void Update(const ExecStat& stat) override {
-        // Static algorithm doesn't adapt
+    // AMPCCL_ALGO spelling of each algorithm (tools list and parse them by name).
+    static const char* Name(AdaptiveAlgorithm algo_type) {
+        switch (algo_type) {
+            case AdaptiveAlgorithm::TCP: return "tcp";
+            case AdaptiveAlgorithm::DCQCN: return "dcqcn";
+            case AdaptiveAlgorithm::STATIC: return "static";
+            case AdaptiveAlgorithm::MODEL: return "model";
+            case AdaptiveAlgorithm::BANDIT: return "bandit";
+            case AdaptiveAlgorithm::TAIL: return "tail";
+            default: return "?";
+        }
     }
 
-    void Reset() override {
-        alpha_ = 0.5;
+    static bool Parse(const std::string& name, AdaptiveAlgorithm* out) {
+        for (AdaptiveAlgorithm a : kAll) {
+            if (name == Name(a)) {
+                *out = a;
+                return true;
+            }
+        }
+        return false;
     }
 
-private:
-    double alpha_;
+    static constexpr AdaptiveAlgorithm kAll[] = {
+        AdaptiveAlgorithm::TCP, AdaptiveAlgorithm::DCQCN, AdaptiveAlgorithm::STATIC,
+        AdaptiveAlgorithm::MODEL, AdaptiveAlgorithm::BANDIT, AdaptiveAlgorithm::TAIL,
+    };
 };
 
 }  // namespace ampccl
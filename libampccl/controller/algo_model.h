@@ -0,0 +1,84 @@
+#ifndef AMPCCL_CONTROLLER_ALGO_MODEL_H_
+#define AMPCCL_CONTROLLER_ALGO_MODEL_H_
+
+#include "algo_base.h"
+#include "path_model.h"
+#include "telemetry/stats.h"
+#include "cache/param_cache.h"
+#include "common/op_key.h"
+#include <array>
+
+namespace ampccl {
+
+// Model-based algorithm: fits latency/bandwidth for each path and op bucket, then
+// solves for the alpha at which fast and PCIe finish together:
+//   Lf + a*N*sf = Lp + (1-a)*N*sp  =>  a = (Lp - Lf + N*sp) / (N*(sf + sp))
+// If the split does not beat fast-only by margin_ (PCIe latency dominates), returns 1.0.
+class ModelAlgo : public AdaptiveAlgo {
+public:
+    ModelAlgo()
+        : forget_(0.98),      // Exponential forgetting for the LS sums
+          margin_(0.05),      // Split must be at least 5% faster than fast-only
+          min_alpha_(0.0),
+          max_alpha_(1.0) {}
+
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        const BucketModel& m = models_[OpBucketOf(op_key)];
+        if (!m.fast.Ready() || !m.pcie.Ready()) {
+            return current.alpha;  // Keep splitting until both paths have samples
+        }
+        double lf, sf, lp, sp;
+        m.fast.Fit(&lf, &sf);
+        m.pcie.Fit(&lp, &sp);
+        double total = static_cast<double>(op_key.bytes);
+        if (total <= 0.0 || sf + sp <= 0.0) {
+            return current.alpha;
+        }
+        double alpha = (lp - lf + total * sp) / (total * (sf + sp));
+        if (alpha < min_alpha_) alpha = min_alpha_;
+        if (alpha > max_alpha_) alpha = max_alpha_;
+
+        double fast_only = lf + total * sf;
+        double split = lf + alpha * total * sf;
+        double pcie_side = lp + (1.0 - alpha) * total * sp;
+        if (pcie_side > split) split = pcie_side;
+        if (split >= fast_only * (1.0 - margin_)) {
+            return 1.0;
+        }
+        return alpha;
+    }
+
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        (void)current;
+        BucketModel& m = models_[OpBucketOf(op_key)];
+        if (stat.fast_success && stat.fast_bytes > 0 && stat.fast_time > 0.0) {
+            m.fast.AddSample(static_cast<double>(stat.fast_bytes), stat.fast_time, forget_);
+        }
+        if (stat.pcie_success && stat.pcie_bytes > 0 && stat.pcie_time > 0.0) {
+            m.pcie.AddSample(static_cast<double>(stat.pcie_bytes), stat.pcie_time, forget_);
+        }
+    }
+
+    void Reset() override {
+        for (auto& m : models_) {
+            m.fast.Reset();
+            m.pcie.Reset();
+        }
+    }
+
+private:
+    struct BucketModel {
+        LinearPathModel fast;
+        LinearPathModel pcie;
+    };
+
+    std::array<BucketModel, kNumOpBuckets> models_;
+    double forget_;
+    double margin_;
+    double min_alpha_;
+    double max_alpha_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_ALGO_MODEL_H_
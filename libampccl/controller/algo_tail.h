@@ -0,0 +1,106 @@
+#ifndef AMPCCL_CONTROLLER_ALGO_TAIL_H_
+#define AMPCCL_CONTROLLER_ALGO_TAIL_H_
+
+#include "algo_base.h"
+#include "telemetry/stats.h"
+#include "telemetry/quantile_window.h"
+#include "cache/param_cache.h"
+#include "common/op_key.h"
+#include "common/log.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ampccl {
+
+// Tail-latency-aware algorithm: minimises p99 of GetTotalTime() rather than the mean.
+// Each path keeps a sliding window of seconds-per-byte per bucket. The collective
+// finishes at max(fast, pcie), so its p99 is minimised when both paths' p99
+// finish times match: alpha* = q99_pcie / (q99_fast + q99_pcie) (per byte).
+// Since q99 = q50 * (p99/p50 spread), a path whose spread grows loses share even
+// when its median bandwidth is unchanged.
+class TailAlgo : public AdaptiveAlgo {
+public:
+    static constexpr int kWindow = 64;
+
+    TailAlgo()
+        : quantile_(0.99),
+          gain_(0.5),         // Move halfway to the target per update (damping)
+          min_samples_(16),
+          min_alpha_(0.05),
+          max_alpha_(0.95),
+          fast_(kNumOpBuckets),
+          pcie_(kNumOpBuckets) {
+        alpha_.fill(0.5);
+        seeded_.fill(0);
+    }
+
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        return seeded_[b] ? alpha_[b] : current.alpha;
+    }
+
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        if (!seeded_[b]) {
+            alpha_[b] = Clamp(current.alpha);
+            seeded_[b] = 1;
+        }
+        if (!stat.fast_success || !stat.pcie_success) {
+            // Failed PCIe share behaves like an unbounded tail: back off quickly.
+            if (!stat.pcie_success) {
+                alpha_[b] = Clamp(alpha_[b] + (1.0 - alpha_[b]) * 0.5);
+            }
+            return;
+        }
+        if (stat.fast_bytes > 0 && stat.fast_time > 0.0) {
+            fast_[b].Add(stat.fast_time / static_cast<double>(stat.fast_bytes));
+        }
+        if (stat.pcie_bytes > 0 && stat.pcie_time > 0.0) {
+            pcie_[b].Add(stat.pcie_time / static_cast<double>(stat.pcie_bytes));
+        }
+        if (fast_[b].Count() < min_samples_ || pcie_[b].Count() < min_samples_) {
+            return;
+        }
+        double qf = fast_[b].Quantile(quantile_);
+        double qp = pcie_[b].Quantile(quantile_);
+        if (qf <= 0.0 || qp <= 0.0) {
+            return;
+        }
+        double target = qp / (qf + qp);
+        alpha_[b] = Clamp(alpha_[b] + gain_ * (target - alpha_[b]));
+
+        AMPCCL_LOG(DEBUG, "Tail: bucket=%d fast p50=%.3g p99=%.3g pcie p50=%.3g p99=%.3g s/B alpha=%.3f",
+                   b, fast_[b].Quantile(0.5), qf, pcie_[b].Quantile(0.5), qp, alpha_[b]);
+    }
+
+    void Reset() override {
+        alpha_.fill(0.5);
+        seeded_.fill(0);
+        for (auto& w : fast_) w.Clear();
+        for (auto& w : pcie_) w.Clear();
+    }
+
+private:
+    double Clamp(double a) const {
+        if (a < min_alpha_) return min_alpha_;
+        if (a > max_alpha_) return max_alpha_;
+        return a;
+    }
+
+    double quantile_;
+    double gain_;
+    int min_samples_;
+    double min_alpha_;
+    double max_alpha_;
+
+    // Per-bucket state (structure of arrays, indexed by OpBucketOf)
+    std::array<double, kNumOpBuckets> alpha_;
+    std::array<uint8_t, kNumOpBuckets> seeded_;
+    std::vector<QuantileWindow<kWindow>> fast_;
+    std::vector<QuantileWindow<kWindow>> pcie_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_ALGO_TAIL_H_
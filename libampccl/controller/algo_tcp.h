@@ -4,6 +4,9 @@
 #include "algo_base.h"
 #include "telemetry/stats.h"
 #include "cache/param_cache.h"
+#include "common/op_key.h"
+#include <array>
+#include <cstdint>
 
 namespace ampccl {
 
@@ -11,54 +14,70 @@ namespace ampccl {
 class TCPAlgo : public AdaptiveAlgo {
 public:
     TCPAlgo()
-        : alpha_(0.5),
-          increase_factor_(0.01),  // Additive increase step
+        : increase_factor_(0.01),  // Additive increase step
           decrease_factor_(0.5),   // Multiplicative decrease factor
           min_alpha_(0.1),
-          max_alpha_(0.9) {}
+          max_alpha_(0.9) {
+        Reset();
+    }
 
-    double Suggest(const ParamValue& current) override {
-        // Use current alpha, clamped to valid range
-        alpha_ = current.alpha;
-        if (alpha_ < min_alpha_) alpha_ = min_alpha_;
-        if (alpha_ > max_alpha_) alpha_ = max_alpha_;
-        return alpha_;
+    double Suggest(const OpKey& op_key, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        return seeded_[b] ? alpha_[b] : Clamp(current.alpha);
     }
 
-    void Update(const ExecStat& stat) override {
+    void Update(const OpKey& op_key, const ExecStat& stat, const ParamValue& current) override {
+        int b = OpBucketOf(op_key);
+        if (!seeded_[b]) {
+            alpha_[b] = Clamp(current.alpha);
+            seeded_[b] = 1;
+        }
+        double& alpha = alpha_[b];
+
+        // alpha is the fast share (Planner: fast_bytes = alpha * total), so the PCIe share
+        // 1 - alpha is the AIMD window: it backs off multiplicatively and grows additively.
         if (!stat.fast_success || !stat.pcie_success) {
-            // If either backend failed, decrease alpha (use more fast backend)
-            alpha_ *= decrease_factor_;
-            if (alpha_ < min_alpha_) alpha_ = min_alpha_;
+            // If either backend failed, cut the PCIe share (use more fast backend)
+            alpha = 1.0 - (1.0 - alpha) * decrease_factor_;
+            if (alpha > max_alpha_) alpha = max_alpha_;
             return;
         }
 
         // Compare completion times
         double fast_time = stat.fast_time;
         double pcie_time = stat.pcie_time;
-        double total_time = stat.GetTotalTime();
 
-        // If PCIe is slower, decrease alpha (use more fast backend)
+        // If PCIe is slower, cut the PCIe share (use more fast backend)
         if (pcie_time > fast_time * 1.1) {  // 10% threshold
-            alpha_ *= decrease_factor_;
-            if (alpha_ < min_alpha_) alpha_ = min_alpha_;
+            alpha = 1.0 - (1.0 - alpha) * decrease_factor_;
+            if (alpha > max_alpha_) alpha = max_alpha_;
         } else if (pcie_time < fast_time * 0.9) {
-            // If PCIe is faster, increase alpha (use more PCIe)
-            alpha_ += increase_factor_;
-            if (alpha_ > max_alpha_) alpha_ = max_alpha_;
+            // If PCIe is faster, grow the PCIe share
+            alpha -= increase_factor_;
+            if (alpha < min_alpha_) alpha = min_alpha_;
         } else {
-            // Balanced, slight increase
-            alpha_ += increase_factor_ * 0.5;
-            if (alpha_ > max_alpha_) alpha_ = max_alpha_;
+            // Balanced, slight growth
+            alpha -= increase_factor_ * 0.5;
+            if (alpha < min_alpha_) alpha = min_alpha_;
         }
     }
 
     void Reset() override {
-        alpha_ = 0.5;
+        alpha_.fill(0.5);
+        seeded_.fill(0);
     }
 
 private:
-    double alpha_;
+    double Clamp(double a) const {
+        if (a < min_alpha_) return min_alpha_;
+        if (a > max_alpha_) return max_alpha_;
+        return a;
+    }
+
+    // Per-bucket state (structure of arrays, indexed by OpBucketOf)
+    std::array<double, kNumOpBuckets> alpha_;
+    std::array<uint8_t, kNumOpBuckets> seeded_;
+
     double increase_factor_;
     double decrease_factor_;
     double min_alpha_;
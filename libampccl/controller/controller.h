@@ -3,10 +3,15 @@
 
 #include "algo_base.h"
 #include "algo_factory.h"
+#include "crossover.h"
+#include "pcie_breaker.h"
 #include "cache/param_cache.h"
 #include "telemetry/stats.h"
 #include "common/op_key.h"
 #include "common/config.h"
+#include "common/log.h"
+#include <array>
+#include <cstdint>
 #include <memory>
 
 namespace ampccl {
@@ -15,34 +20,69 @@ namespace ampccl {
 class AdaptiveController {
 public:
     explicit AdaptiveController(std::unique_ptr<AdaptiveAlgo> algo)
-        : algo_(std::move(algo)) {}
+        : algo_(std::move(algo)),
+          crossover_(CeilSizeClass(Config::GetMinMsgSize())),
+          breaker_(Config::GetPCIeBreakerFailures(), Config::GetPCIeBackoff(),
+                   Config::GetPCIeDeadlineSeconds()),
+          probe_period_(64) {  // One split probe per 64 calls of a class below the boundary
+        probe_count_.fill(0);
+    }
+
+    // Whether this call may split across PCIe: at or above the learned crossover for its
+    // (op, datatype), or a periodic probe below it so a lower boundary can be found.
+    // Probe counters advance identically on every rank (same collective sequence).
+    // Never while the PCIe circuit breaker is open.
+    bool UsePCIe(const OpKey& op_key, const ParamCache& cache) {
+        if (!Config::IsPCIeEnabled() || !cache.PCIeAllowed()) {
+            return false;
+        }
+        if (AtOrAboveBoundary(op_key, cache)) {
+            return true;
+        }
+        return ++probe_count_[OpBucketOf(op_key)] % probe_period_ == 0;
+    }
+
+    // UsePCIe without probes (no counter advances): the threshold that starts lazy PCIe
+    // setup (Config::IsPCIeInitLazy).
+    bool AboveCrossover(const OpKey& op_key, const ParamCache& cache) const {
+        return Config::IsPCIeEnabled() && cache.PCIeAllowed() && AtOrAboveBoundary(op_key, cache);
+    }
 
     // Get suggested alpha for an operation
     double SuggestAlpha(const OpKey& op_key, const ParamCache& cache) {
         ParamValue current = cache.Lookup(op_key);
-        return algo_->Suggest(current);
+        return algo_->Suggest(op_key, current);
     }
 
     // Update controller state based on execution statistics
     void Update(const OpKey& op_key, const ExecStat& stat, ParamCache& cache) {
-        // Update algorithm
-        algo_->Update(stat);
-
-        // Get current parameters
+        // Get current parameters (seed the algorithm's bucket on first update)
         ParamValue current = cache.Lookup(op_key);
 
+        // Update algorithm
+        algo_->Update(op_key, stat, current);
+
         // Update parameters based on algorithm suggestion
-        double new_alpha = algo_->Suggest(current);
+        double new_alpha = algo_->Suggest(op_key, current);
 
         // Update bandwidth estimates
         double fast_bw = stat.GetFastBandwidth();
         double pcie_bw = stat.GetPCIeBandwidth();
 
-        // Decide whether to use PCIe
-        bool use_pcie = Config::IsPCIeEnabled() &&
-                       stat.pcie_success &&
-                       pcie_bw > 0.0 //&&
-                    //    (pcie_bw > fast_bw * 0.3);  // PCIe must be at least 30% of fast BW
+        // Decide whether to use PCIe: learned crossover for (op, datatype), with hysteresis
+        int boundary = crossover_.Observe(op_key, stat);
+        cache.SetCrossover(op_key.op, op_key.datatype, boundary);
+        bool use_pcie = Config::IsPCIeEnabled() && SizeClassOf(op_key.bytes) >= boundary;
+
+        // PCIe health: failures and latency outliers open the breaker
+        PCIeBreaker::State prev = breaker_.state();
+        PCIeBreaker::State state = breaker_.Observe(stat);
+        if (state != prev) {
+            AMPCCL_LOG(WARN, "PCIe breaker: %s -> %s (trips=%llu)", StateName(prev), StateName(state),
+                       static_cast<unsigned long long>(breaker_.trips()));
+        }
+        cache.SetPCIeAllowed(breaker_.AllowsPCIe());
+        use_pcie = use_pcie && breaker_.AllowsPCIe();
 
         // Create updated parameter value
         ParamValue updated(new_alpha, use_pcie, fast_bw, pcie_bw);
@@ -53,10 +93,40 @@ public:
 
     void Reset() {
         algo_->Reset();
+        crossover_.Reset();
+        breaker_.Reset();
+        probe_count_.fill(0);
+    }
+
+    const PCIeBreaker& breaker() const { return breaker_; }
+
+    const RegretStats* GetRegretStats() const {
+        return algo_->GetRegretStats();
     }
 
 private:
+    bool AtOrAboveBoundary(const OpKey& op_key, const ParamCache& cache) const {
+        int boundary = cache.Crossover(op_key.op, op_key.datatype);
+        if (boundary < 0) {
+            boundary = crossover_.seed_class();
+        }
+        return SizeClassOf(op_key.bytes) >= boundary;
+    }
+
+    static const char* StateName(PCIeBreaker::State s) {
+        switch (s) {
+            case PCIeBreaker::State::CLOSED: return "closed";
+            case PCIeBreaker::State::OPEN: return "open";
+            case PCIeBreaker::State::HALF_OPEN: return "half-open";
+        }
+        return "?";
+    }
+
     std::unique_ptr<AdaptiveAlgo> algo_;
+    CrossoverLearner crossover_;
+    PCIeBreaker breaker_;
+    std::array<uint32_t, kNumOpBuckets> probe_count_;
+    uint32_t probe_period_;
 };
 
 }  // namespace ampccl
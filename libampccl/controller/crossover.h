@@ -0,0 +1,159 @@
+#ifndef AMPCCL_CONTROLLER_CROSSOVER_H_
+#define AMPCCL_CONTROLLER_CROSSOVER_H_
+
+#include "path_model.h"
+#include "telemetry/stats.h"
+#include "common/op_key.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ampccl {
+
+// Smallest size class c with 2^c >= bytes (the class a size threshold starts at).
+inline int CeilSizeClass(size_t bytes) {
+    int c = SizeClassOf(bytes);
+    if (c < kNumSizeClasses - 1 && (static_cast<size_t>(1) << c) < bytes) {
+        ++c;
+    }
+    return c;
+}
+
+// Learns, per (op, datatype), the smallest size class at which splitting across fast
+// and PCIe beats fast-only. Each path's time is fitted as latency + bytes / bandwidth
+// per op bucket (LinearPathModel, fed by every execution), and each split execution is
+// scored at the split the fit predicts best, not at the one the algorithm happened to
+// run: gain = fast-only time / time at the balanced split, averaged per size class.
+// An early, unbalanced split (alpha still converging) thus does not condemn a class.
+// Samples are skipped until both fits tell latency from bandwidth; a failed PCIe share
+// always counts as a clear loss. Each class is a Schmitt trigger: it flips to LOSES
+// when the gain drops below 1 - margin and back to WINS only above 1 + margin, after
+// min_samples. A losing class only sees the controller's sparse probes, so those carry
+// a heavier weight. The boundary is one above the largest class that loses; classes
+// with no verdict yet default to the seed (AMPCCL_MIN_MSG_SIZE).
+class CrossoverLearner {
+public:
+    static constexpr int kNumDatatypeSlots = 16;
+
+    explicit CrossoverLearner(int seed_class)
+        : seed_class_(seed_class),
+          weight_(0.2),       // EWMA weight of a new gain sample
+          probe_weight_(0.5), // ... in a class that currently loses (probe samples only)
+          forget_(0.98),      // Exponential forgetting of the path fits
+          margin_(0.05),      // Hysteresis band around gain == 1
+          min_samples_(8) {
+        Reset();
+    }
+
+    int seed_class() const { return seed_class_; }
+
+    // Feed one execution; returns the (possibly moved) boundary for op_key's (op, datatype).
+    int Observe(const OpKey& op_key, const ExecStat& stat) {
+        int s = Slot(op_key);
+        PathModels& m = models_[OpBucketOf(op_key)];
+        if (stat.fast_success && stat.fast_bytes > 0 && stat.fast_time > 0.0) {
+            m.fast.AddSample(static_cast<double>(stat.fast_bytes), stat.fast_time, forget_);
+        }
+        if (stat.pcie_bytes > 0) {
+            double gain = 0.0;  // A failed PCIe share counts as a clear loss
+            if (stat.fast_success && stat.pcie_success) {
+                if (stat.pcie_time <= 0.0) {
+                    return boundary_[s];
+                }
+                m.pcie.AddSample(static_cast<double>(stat.pcie_bytes), stat.pcie_time, forget_);
+                if (!BestSplitGain(m, static_cast<double>(stat.fast_bytes + stat.pcie_bytes), &gain)) {
+                    return boundary_[s];
+                }
+            }
+            int i = Idx(s, SizeClassOf(op_key.bytes));
+            double w = verdict_[i] == kLoses ? probe_weight_ : weight_;
+            gain_[i] = samples_[i] == 0 ? gain : gain_[i] + w * (gain - gain_[i]);
+            if (samples_[i] < UINT32_MAX) samples_[i]++;
+            if (samples_[i] >= min_samples_) {
+                if (verdict_[i] != kLoses && gain_[i] < 1.0 - margin_) {
+                    verdict_[i] = kLoses;
+                } else if (verdict_[i] != kWins && gain_[i] > 1.0 + margin_) {
+                    verdict_[i] = kWins;
+                }
+            }
+            boundary_[s] = ComputeBoundary(s);
+        }
+        return boundary_[s];
+    }
+
+    void Reset() {
+        gain_.fill(0.0);
+        samples_.fill(0);
+        verdict_.fill(kUnknown);
+        boundary_.fill(seed_class_);
+        for (PathModels& m : models_) {
+            m.fast.Reset();
+            m.pcie.Reset();
+        }
+    }
+
+private:
+    enum Verdict : uint8_t { kUnknown = 0, kWins, kLoses };
+
+    static int Slot(const OpKey& key) {
+        int op = static_cast<int>(key.op);
+        if (op < 0 || op >= kNumCollectiveTypes) op = 0;
+        return op * kNumDatatypeSlots + (key.datatype & (kNumDatatypeSlots - 1));
+    }
+    static int Idx(int slot, int size_class) { return slot * kNumSizeClasses + size_class; }
+
+    struct PathModels {
+        LinearPathModel fast;
+        LinearPathModel pcie;
+    };
+
+    // Fast-only time over the time of the split that finishes both paths together
+    // (clamped to [0, 1] of total on fast). False while either fit is unidentified.
+    static bool BestSplitGain(const PathModels& m, double total, double* gain) {
+        double lf, sf, lp, sp;
+        if (!m.fast.Ready() || !m.pcie.Ready() || !m.fast.Fit(&lf, &sf) || !m.pcie.Fit(&lp, &sp) ||
+            total <= 0.0) {
+            return false;
+        }
+        double alpha = (lp - lf + total * sp) / (total * (sf + sp));
+        if (alpha < 0.0) alpha = 0.0;
+        if (alpha > 1.0) alpha = 1.0;
+        double fast_side = lf + alpha * total * sf;
+        double pcie_side = lp + (1.0 - alpha) * total * sp;
+        double split = fast_side > pcie_side ? fast_side : pcie_side;
+        if (split <= 0.0) {
+            return false;
+        }
+        *gain = (lf + total * sf) / split;
+        return true;
+    }
+
+    int ComputeBoundary(int s) const {
+        int boundary = 0;
+        for (int c = 0; c < kNumSizeClasses; ++c) {
+            uint8_t v = verdict_[Idx(s, c)];
+            if (v == kLoses || (v == kUnknown && c < seed_class_)) {
+                boundary = c + 1;
+            }
+        }
+        return boundary;
+    }
+
+    static constexpr int kNumSlots = kNumCollectiveTypes * kNumDatatypeSlots;
+
+    std::array<double, kNumSlots * kNumSizeClasses> gain_;
+    std::array<uint32_t, kNumSlots * kNumSizeClasses> samples_;
+    std::array<uint8_t, kNumSlots * kNumSizeClasses> verdict_;
+    std::array<int, kNumSlots> boundary_;
+    std::array<PathModels, kNumOpBuckets> models_;  // By OpBucketOf (datatypes share a fit)
+    int seed_class_;
+    double weight_;
+    double probe_weight_;
+    double forget_;
+    double margin_;
+    uint32_t min_samples_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_CROSSOVER_H_
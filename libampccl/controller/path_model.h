@@ -0,0 +1,50 @@
+#ifndef AMPCCL_CONTROLLER_PATH_MODEL_H_
+#define AMPCCL_CONTROLLER_PATH_MODEL_H_
+
+namespace ampccl {
+
+// Online least-squares fit of t = latency + bytes * inv_bw for one path.
+// Sums are exponentially decayed so the fit follows slow drift in link speed.
+struct LinearPathModel {
+    double n = 0.0;
+    double sx = 0.0;
+    double sy = 0.0;
+    double sxx = 0.0;
+    double sxy = 0.0;
+
+    void AddSample(double bytes, double seconds, double forget) {
+        n = n * forget + 1.0;
+        sx = sx * forget + bytes;
+        sy = sy * forget + seconds;
+        sxx = sxx * forget + bytes * bytes;
+        sxy = sxy * forget + bytes * seconds;
+    }
+
+    bool Ready() const { return n >= 2.0 && sx > 0.0; }
+
+    // Fit (latency, seconds per byte). When every sample has (nearly) the same size
+    // the slope is unidentifiable; attribute the whole time to bandwidth then. Returns
+    // whether latency and bandwidth were told apart.
+    bool Fit(double* latency, double* inv_bw) const {
+        double var = n * sxx - sx * sx;
+        double mean_x = sx / n;
+        if (var > 1e-6 * n * n * mean_x * mean_x) {
+            double slope = (n * sxy - sx * sy) / var;
+            double intercept = (sy - slope * sx) / n;
+            if (slope > 0.0 && intercept >= 0.0) {
+                *inv_bw = slope;
+                *latency = intercept;
+                return true;
+            }
+        }
+        *inv_bw = sy / sx;
+        *latency = 0.0;
+        return false;
+    }
+
+    void Reset() { n = sx = sy = sxx = sxy = 0.0; }
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_PATH_MODEL_H_
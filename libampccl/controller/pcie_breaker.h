@@ -0,0 +1,130 @@
+#ifndef AMPCCL_CONTROLLER_PCIE_BREAKER_H_
+#define AMPCCL_CONTROLLER_PCIE_BREAKER_H_
+
+#include "telemetry/stats.h"
+#include <cstdint>
+
+namespace ampccl {
+
+// Per-domain circuit breaker for the PCIe path. Fed with the same (cross-rank) stats as
+// the controller, so every rank sees the same transitions:
+//   CLOSED    - PCIe in use; a failed share or a latency outlier counts as a failure,
+//               failure_threshold consecutive failures trip the breaker.
+//   OPEN      - PCIe not used; after backoff updates it moves to HALF_OPEN.
+//   HALF_OPEN - PCIe allowed again for a probe; the next split execution closes the
+//               breaker on success or re-opens it with the backoff doubled (capped).
+// Time is counted in controller updates rather than wall clock, so ranks that run the
+// same collective sequence agree on when to re-probe.
+class PCIeBreaker {
+public:
+    enum class State { CLOSED = 0, OPEN, HALF_OPEN };
+
+    PCIeBreaker(int failure_threshold, int initial_backoff, double deadline_s)
+        : failure_threshold_(failure_threshold > 0 ? failure_threshold : 1),
+          initial_backoff_(initial_backoff > 0 ? initial_backoff : 1),
+          max_backoff_(static_cast<uint64_t>(initial_backoff_) * 64),
+          deadline_s_(deadline_s),
+          outlier_factor_(8.0),     // A share 8x slower than its expected time is an outlier
+          min_samples_(16),         // Samples before the expected time is trusted
+          weight_(0.05) {           // EWMA weight of a new seconds-per-byte sample
+        Reset();
+    }
+
+    State state() const { return state_; }
+    bool AllowsPCIe() const { return state_ != State::OPEN; }
+    uint64_t trips() const { return trips_; }
+
+    // Feed one execution; returns the state afterwards.
+    State Observe(const ExecStat& stat) {
+        if (state_ == State::OPEN) {
+            if (++updates_in_state_ >= backoff_) {
+                state_ = State::HALF_OPEN;
+                updates_in_state_ = 0;
+            }
+            return state_;
+        }
+        if (stat.pcie_bytes == 0) {
+            return state_;  // Fast-only run: says nothing about PCIe
+        }
+        if (IsFailure(stat)) {
+            OnFailure();
+        } else {
+            OnSuccess(stat);
+        }
+        return state_;
+    }
+
+    void Reset() {
+        state_ = State::CLOSED;
+        consecutive_failures_ = 0;
+        updates_in_state_ = 0;
+        backoff_ = static_cast<uint64_t>(initial_backoff_);
+        sec_per_byte_ = 0.0;
+        samples_ = 0;
+        trips_ = 0;
+    }
+
+private:
+    bool IsFailure(const ExecStat& stat) const {
+        if (!stat.pcie_success) {
+            return true;
+        }
+        if (deadline_s_ > 0.0 && stat.pcie_time > deadline_s_) {
+            return true;
+        }
+        if (samples_ >= min_samples_) {
+            double expected = sec_per_byte_ * static_cast<double>(stat.pcie_bytes);
+            return stat.pcie_time > outlier_factor_ * expected;
+        }
+        return false;
+    }
+
+    void OnSuccess(const ExecStat& stat) {
+        double spb = stat.pcie_time / static_cast<double>(stat.pcie_bytes);
+        sec_per_byte_ = samples_ == 0 ? spb : sec_per_byte_ + weight_ * (spb - sec_per_byte_);
+        if (samples_ < UINT32_MAX) samples_++;
+        consecutive_failures_ = 0;
+        if (state_ == State::HALF_OPEN) {
+            state_ = State::CLOSED;
+            backoff_ = static_cast<uint64_t>(initial_backoff_);
+        }
+    }
+
+    void OnFailure() {
+        if (state_ == State::HALF_OPEN) {
+            backoff_ = backoff_ * 2 < max_backoff_ ? backoff_ * 2 : max_backoff_;
+            Trip();
+            return;
+        }
+        if (++consecutive_failures_ >= failure_threshold_) {
+            Trip();
+        }
+    }
+
+    void Trip() {
+        state_ = State::OPEN;
+        consecutive_failures_ = 0;
+        updates_in_state_ = 0;
+        trips_++;
+    }
+
+    int failure_threshold_;
+    int initial_backoff_;
+    uint64_t max_backoff_;
+    double deadline_s_;
+    double outlier_factor_;
+    uint32_t min_samples_;
+    double weight_;
+
+    State state_;
+    int consecutive_failures_;
+    uint64_t updates_in_state_;
+    uint64_t backoff_;
+    double sec_per_byte_;
+    uint32_t samples_;
+    uint64_t trips_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CONTROLLER_PCIE_BREAKER_H_
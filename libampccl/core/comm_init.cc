@@ -1,4 +1,12 @@
 #include "comm_init.h"
+#include "common/log.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #ifdef AMPCCL_ENABLE_PCIE
 #include "comm.hpp"
@@ -6,27 +14,163 @@
 
 namespace ampccl {
 
+#ifdef AMPCCL_ENABLE_PCIE
+namespace {
+
+// pcclInit + pcclCreateStream; a communicator without a stream is still returned (the
+// collective path then keeps to the fast path, as before).
+bool CreatePCIeComm(int rank, int nranks, void** comm, void** stream) {
+    pcclComm_t pcie_comm = nullptr;
+    pcclResult_t ret = pcclInit(rank, nranks, &pcie_comm);
+    if (ret != pcclSuccess || !pcie_comm) {
+        return false;
+    }
+    *comm = pcie_comm;
+    pcclStream_t pcie_stream = nullptr;
+    if (pcclCreateStream(pcie_comm, &pcie_stream) == pcclSuccess && pcie_stream) {
+        *stream = pcie_stream;
+    }
+    return true;
+}
+
+}  // namespace
+#endif
+
 void InitPCIeForDomain(CommDomain* domain, int rank, int nranks) {
     if (!domain || nranks <= 0 || rank < 0 || rank >= nranks) {
         return;
     }
+    // PCIe only reaches GPUs/NPUs on this host: a multi-node communicator gets a
+    // node-local PCCL group (set_topology must run before this).
+    const NodeTopology& topo = domain->topology();
+    if (topo.IsMultiNode()) {
+        rank = topo.local_rank;
+        nranks = topo.local_size;
+    }
 #ifdef AMPCCL_ENABLE_PCIE
-    pcclComm_t pcie_comm = nullptr;
-    pcclResult_t ret = pcclInit(rank, nranks, &pcie_comm);
-    if (ret != pcclSuccess || !pcie_comm) {
+    if (Config::IsPCIeInitLazy()) {
+        // The group is known now: the shm store attaches by it from the first collective,
+        // so statistics flow the same way before and after PCCL is up.
+        domain->set_pcie_rank(rank);
+        domain->set_pcie_nranks(nranks);
+        int device = domain->device();
+        CommDomain::SetDeviceFn set_device = domain->set_device_fn();
+        domain->pcie_lazy_init().Defer(device, [rank, nranks, device, set_device](void** comm, void** stream) {
+            if (set_device != nullptr && device >= 0) {
+                set_device(device);
+            }
+            bool ok = CreatePCIeComm(rank, nranks, comm, stream);
+            if (!ok) {
+                AMPCCL_LOG(WARN, "PCIe: background pcclInit failed (rank %d of %d), staying on the fast path",
+                           rank, nranks);
+            }
+            return ok;
+        });
+        return;
+    }
+    void* pcie_comm = nullptr;
+    void* pcie_stream = nullptr;
+    if (!CreatePCIeComm(rank, nranks, &pcie_comm, &pcie_stream)) {
         return;
     }
     domain->set_pcie_comm(pcie_comm);
     domain->set_pcie_rank(rank);
     domain->set_pcie_nranks(nranks);
-    pcclStream_t pcie_stream = nullptr;
-    if (pcclCreateStream(pcie_comm, &pcie_stream) == pcclSuccess && pcie_stream) {
-        domain->set_pcie_stream(pcie_stream);
-    }
+    domain->set_pcie_stream(pcie_stream);
 #else
     (void)rank;
     (void)nranks;
 #endif
 }
 
+bool WarmStartFromParent(CommDomain* child, const CommDomain& parent) {
+    if (!child || child == &parent || child->param_cache.Size() > 0) {
+        return false;
+    }
+    const NodeTopology& ct = child->topology();
+    const NodeTopology& pt = parent.topology();
+    if (child->key.world_size != parent.key.world_size || ct.num_nodes != pt.num_nodes ||
+        ct.local_size != pt.local_size) {
+        return false;
+    }
+    std::vector<std::pair<OpKey, ParamValue>> entries;
+    std::vector<std::tuple<CollectiveType, int, int>> crossovers;
+    parent.param_cache.GetAll(&entries);
+    parent.param_cache.GetAllCrossovers(&crossovers);
+    if (entries.empty() && crossovers.empty()) {
+        return false;
+    }
+    child->param_cache.SetFrom(entries);
+    for (const auto& c : crossovers) {
+        child->param_cache.SetCrossover(std::get<0>(c), std::get<1>(c), std::get<2>(c));
+    }
+    AMPCCL_LOG(INFO, "Comm split: warm start from parent key=%s with %zu entries, %zu crossovers",
+               parent.key.Digest().Hex().c_str(), entries.size(), crossovers.size());
+    return true;
+}
+
+bool NeedsRankInfoExchange(int nranks, const NodeTopology* parent_topology) {
+    if (nranks <= 1) {
+        return false;
+    }
+    if (parent_topology) {
+        return parent_topology->IsMultiNode();
+    }
+    int world = Config::GetWorldSize();
+    int local = Config::GetLocalSize();
+    return world <= 0 || local <= 0 || (nranks != world && local < world);
+}
+
+bool ExchangeRankInfo(CommDomainKey* key, int rank, const StatReduceOps& ops, void* raw_comm, NodeTopology* topo) {
+    int n = key ? key->world_size : 0;
+    if (n <= 1 || rank < 0 || rank >= n || !ops.reduce_max) {
+        return false;
+    }
+    // [0, n) global ranks, [n, 2n) hosts; -1 where a rank knows nothing.
+    std::vector<double> info(2 * static_cast<size_t>(n), -1.0);
+    int global = Config::GetGlobalRank();
+    if (global >= 0) {
+        info[static_cast<size_t>(rank)] = static_cast<double>(global);
+    }
+    std::string host = Config::GetHostId();
+    if (!host.empty()) {
+        // 52 bits of the name's digest: exact as a double.
+        uint64_t h = SipHasher128().UpdateString(host).Finalize().lo & ((uint64_t(1) << 52) - 1);
+        info[static_cast<size_t>(n + rank)] = static_cast<double>(h);
+    }
+    void* scratch = nullptr;
+    bool ok = ops.reduce_max(info.data(), info.size(), raw_comm, &scratch);
+    if (ops.release) {
+        ops.release(scratch);
+    }
+    if (!ok) {
+        AMPCCL_LOG(WARN, "Comm init: rank info exchange failed, keeping communicator ranks and launcher topology");
+        return false;
+    }
+    auto all_known = [&](size_t first) {
+        return std::all_of(info.begin() + static_cast<std::ptrdiff_t>(first),
+                           info.begin() + static_cast<std::ptrdiff_t>(first + static_cast<size_t>(n)),
+                           [](double v) { return v >= 0; });
+    };
+    if (all_known(0)) {
+        for (int i = 0; i < n; ++i) {
+            key->ranks[static_cast<size_t>(i)] = static_cast<int>(info[static_cast<size_t>(i)]);
+        }
+        AMPCCL_LOG(DEBUG, "Comm key: global ranks %d..%d (rank %d is %d)", key->ranks.front(), key->ranks.back(),
+                   rank, global);
+    } else if (global >= 0) {
+        AMPCCL_LOG(WARN, "Comm key: some ranks reported no global rank, keeping communicator ranks");
+    }
+    if (topo && all_known(static_cast<size_t>(n))) {
+        std::vector<uint64_t> hosts(static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            hosts[static_cast<size_t>(i)] = static_cast<uint64_t>(info[static_cast<size_t>(n + i)]);
+        }
+        *topo = BuildNodeTopologyFromHosts(rank, hosts);
+        AMPCCL_LOG(DEBUG, "Comm init: rank %d is local rank %d of %d on node %d of %d", rank, topo->local_rank,
+                   topo->local_size, topo->node_id, topo->num_nodes);
+    }
+    return true;
+}
+
 }  // namespace ampccl
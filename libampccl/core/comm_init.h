@@ -2,32 +2,35 @@
 #define AMPCCL_CORE_COMM_INIT_H_
 
 #include "domain.h"
+#include "rank_table.h"
+#include "common/config.h"
+#include "common/hash.h"
 #include <cstddef>
 #include <vector>
 
 namespace ampccl {
 
 // Build our Comm identity (CommDomainKey) from NCCL init parameters.
-// Same (nranks, commId, rank set) across ranks yields the same key, so
-// dividing-param table is keyed by our Comm and can be shared/reused.
+// Same (nranks, commId, job) across ranks yields the same key, so the
+// dividing-param table is keyed by our Comm and can be shared/reused. The whole
+// unique id is hashed (NCCL's is random per communicator). ranks starts as
+// 0..n-1, which are the job-wide ranks for the world communicator; ExchangeRankInfo
+// replaces it with the job-wide ranks where it runs.
 inline CommDomainKey BuildKeyFromNcclInit(int nranks,
                                          const void* comm_id_bytes,
                                          size_t comm_id_len,
                                          int rank) {
+    (void)rank;
     CommDomainKey key;
     key.world_size = nranks;
     key.ranks.resize(static_cast<size_t>(nranks));
     for (int i = 0; i < nranks; ++i) {
         key.ranks[static_cast<size_t>(i)] = i;
     }
-    // Topology / clique identity from NCCL unique id
-    key.topology_hash = 0;
     if (comm_id_bytes && comm_id_len > 0) {
-        const unsigned char* p = static_cast<const unsigned char*>(comm_id_bytes);
-        for (size_t i = 0; i < comm_id_len; ++i) {
-            key.topology_hash = key.topology_hash * 131 + static_cast<uint64_t>(p[i]);
-        }
+        key.comm_id = SipHasher128().Update(comm_id_bytes, comm_id_len).Finalize();
     }
+    key.job = Config::GetJobId();
     return key;
 }
 
@@ -39,8 +42,76 @@ inline CommDomainKey BuildKeyFromHcclInit(int nranks,
     return BuildKeyFromNcclInit(nranks, comm_id_bytes, comm_id_len, rank);
 }
 
+// Our Comm identity for an HCCL communicator created from a rank table
+// (HcclCommInitClusterInfo), which has no root info: every rank reads the same table, so
+// its digest names the communicator, and seq (this process's count of communicators
+// created from that table) tells repeated creations apart.
+inline CommDomainKey BuildKeyFromRankTable(const RankTable& table, uint64_t seq) {
+    CommDomainKey key;
+    key.world_size = table.size();
+    key.ranks.resize(static_cast<size_t>(key.world_size));
+    for (int i = 0; i < key.world_size; ++i) {
+        key.ranks[static_cast<size_t>(i)] = i;
+    }
+    key.placement = table.Digest();
+    key.comm_id = SipHasher128()
+                      .UpdateString("ranktable")
+                      .UpdateU64(key.placement.lo)
+                      .UpdateU64(key.placement.hi)
+                      .UpdateU64(seq)
+                      .Finalize();
+    key.job = Config::GetJobId();
+    return key;
+}
+
+// Our Comm identity for a communicator split from parent (ncclCommSplit). Children of
+// one split differ by color and successive splits by seq (CommDomain::NextSplitSeq of the
+// parent), so every rank of a child derives the same key without exchanging anything.
+inline CommDomainKey BuildKeyFromSplit(const CommDomainKey& parent, uint64_t seq, int color, int nranks) {
+    CommDomainKey key;
+    key.world_size = nranks;
+    key.ranks.resize(static_cast<size_t>(nranks));
+    for (int i = 0; i < nranks; ++i) {
+        key.ranks[static_cast<size_t>(i)] = i;
+    }
+    Hash128 p = parent.Digest();
+    key.comm_id = SipHasher128()
+                      .UpdateString("split")
+                      .UpdateU64(p.lo)
+                      .UpdateU64(p.hi)
+                      .UpdateU64(seq)
+                      .UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(color)))
+                      .Finalize();
+    key.job = parent.job;
+    return key;
+}
+
+// One AllReduce(max) over raw_comm through ops.reduce_max (the scheme B reduction) in
+// which each rank contributes its job-wide rank (Config::GetGlobalRank) and its host
+// (Config::GetHostId). Fills key->ranks with the global rank of every communicator rank
+// when all ranks know theirs, and *topo with the node grouping of the hosts
+// (BuildNodeTopologyFromHosts) when all ranks know theirs. A blocking collective: every
+// rank of raw_comm calls it at CommInit, where NeedsRankInfoExchange holds. Returns false
+// (nothing changed) if the reduction fails.
+bool ExchangeRankInfo(CommDomainKey* key, int rank, const StatReduceOps& ops, void* raw_comm, NodeTopology* topo);
+
+// Whether a communicator of nranks ranks needs ExchangeRankInfo to learn its node
+// grouping, from values every rank shares so that all decide alike. parent_topology: the
+// parent's grouping for a split child (whose key the parent already names), else nullptr.
+// No for a child of a single-node parent, for the world communicator (nranks ==
+// Config::GetWorldSize(), grouped in the launcher's blocks of GetLocalSize() ranks) and
+// for any communicator of a single-host job (GetLocalSize() == GetWorldSize()).
+bool NeedsRankInfoExchange(int nranks, const NodeTopology* parent_topology);
+
+// Warm start of a split communicator: copy parent's learned params and crossovers into
+// child when both have the same shape (size and node topology) and child has learned
+// nothing yet. Every rank's parent holds the same params, so the children agree too.
+// Returns true if anything was copied.
+bool WarmStartFromParent(CommDomain* child, const CommDomain& parent);
+
 // PCIe (PCCL) communicator init for this domain. Called from CommInit hook
 // after raw comm is created and domain is registered. Implemented in comm_init.cc.
+// For a multi-node topology the PCCL group is the node (local_rank / local_size).
 void InitPCIeForDomain(CommDomain* domain, int rank, int nranks);
 
 }  // namespace ampccl
@@ -6,10 +6,18 @@
 #include "controller/controller.h"
 #include "telemetry/timer.h"
 #include "core/shm_store.h"
+#include "core/stat_reducer.h"
+#include "core/group_scope.h"
+#include "core/topology.h"
+#include "core/pcie_watchdog.h"
+#include "core/pcie_lazy_init.h"
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <cstdint>
 #include <memory>
 #include <functional>
+#include <utility>
 
 namespace ampccl {
 
@@ -19,6 +27,98 @@ public:
     std::unique_ptr<AdaptiveController> controller;
     ParamCache param_cache;
 
+    // 64-bit id of key (low half of its digest), for trace and capture records.
+    uint64_t key_id() const { return key_id_; }
+
+    // This process's rank in the communicator (set by the CommInit hook); -1 if unknown.
+    int comm_rank() const { return comm_rank_; }
+    void set_comm_rank(int r) { comm_rank_ = r; }
+
+    // Warm-start profile fingerprint (see ProfileStore::Fingerprint).
+    uint64_t profile_fingerprint() const { return profile_fingerprint_; }
+    void set_profile_fingerprint(uint64_t f) { profile_fingerprint_ = f; }
+
+    // Last write of this domain's params to the profile (DomainManager::MaybeFlushProfile,
+    // under its profile mutex); creation time until the first flush.
+    std::chrono::steady_clock::time_point profile_flushed_at() const { return profile_flushed_at_; }
+    void set_profile_flushed_at(std::chrono::steady_clock::time_point t) { profile_flushed_at_ = t; }
+
+    // Collective sequence number, advanced once per collective entry (identical on
+    // every rank of the communicator); used to line up traces across ranks.
+    uint64_t NextSeq() { return seq_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Split sequence number, advanced once per communicator split from this one (every
+    // rank splits in the same order); names the children (BuildKeyFromSplit).
+    uint64_t NextSplitSeq() { return split_seq_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Node-local grouping (set by the CommInit hook from the ranks' hosts); single node
+    // unless the communicator spans hosts.
+    const NodeTopology& topology() const { return topology_; }
+    void set_topology(const NodeTopology& t) { topology_ = t; }
+
+    // Sub-communicators for the hierarchical AllReduce; not ready on a single node.
+    const HierComms& hier_comms() const { return hier_comms_; }
+    void set_hier_comms(const HierComms& h) { hier_comms_ = h; }
+
+    // Creates hier_comms from the raw communicator (set by the CommInit hook of a
+    // multi-node communicator). A collective over comm, so it runs from the collective
+    // path: at the first AllReduce that would go hierarchical, the same call on every
+    // rank. One attempt, never inside an NCCL group (the split would only complete at
+    // its GroupEnd); returns whether the sub-communicators are ready.
+    using HierSplitFn = bool (*)(CommDomain* domain, void* comm);
+    void set_hier_split(HierSplitFn fn) { hier_split_ = fn; }
+    bool EnsureHierComms(void* comm) {
+        if (!hier_comms_.IsReady() && hier_split_ != nullptr && !InGroup()) {
+            HierSplitFn fn = hier_split_;
+            hier_split_ = nullptr;
+            fn(this, comm);
+        }
+        return hier_comms_.IsReady();
+    }
+
+    // Device-side ordering of the hierarchical AllReduce's PCIe part: intra-node
+    // reduce-scatter on the PCIe stream -> inter-node AllReduce on the fast stream ->
+    // intra-node all-gather on the PCIe stream.
+    StreamEvent& hier_rs_done() { return hier_rs_done_; }
+    StreamEvent& hier_ar_done() { return hier_ar_done_; }
+
+    // Device of this rank and the original set-device call, set by the CommInit hook;
+    // the background PCCL setup binds its thread to the device with them.
+    using SetDeviceFn = int (*)(int device);
+    int device() const { return device_; }
+    SetDeviceFn set_device_fn() const { return set_device_; }
+    void set_device(int device, SetDeviceFn fn) {
+        device_ = device;
+        set_device_ = fn;
+    }
+
+    // Deferred PCCL setup (Config::IsPCIeInitLazy); pcie_comm / pcie_stream stay null
+    // until the collective path publishes it.
+    PCIeLazyInit& pcie_lazy_init() { return pcie_lazy_init_; }
+
+    // Deadline-bounded sync of the PCIe stream (see Config::GetPCIeDeadlineSeconds).
+    PCIeWatchdog& pcie_watchdog() { return pcie_watchdog_; }
+
+    // A PCIe share that fails to launch or to complete by its deadline quarantines this
+    // rank's PCCL communicator: nothing is submitted to it again, since a wedged transfer
+    // may still write a user buffer and its peers may still be waiting on it. Splits are
+    // still planned (the fast shares must keep pairing up with the other ranks') until
+    // every rank has agreed to stop them (DisablePCIe); the PCIe shares fail meanwhile.
+    // With a single-rank PCIe group there is no one to agree with.
+    void QuarantinePCIe() {
+        if (pcie_quarantined_.exchange(true)) {
+            return;
+        }
+        if (pcie_nranks_ <= 1) {
+            DisablePCIe();
+        }
+        shm_store_.MarkPCIeLost();
+    }
+    bool pcie_quarantined() const { return pcie_quarantined_.load(std::memory_order_relaxed); }
+    // Called at the same collective on every rank (scheme B round flag, scheme A log stamp).
+    void DisablePCIe() { pcie_disabled_.store(true, std::memory_order_relaxed); }
+    bool pcie_disabled() const { return pcie_disabled_.load(std::memory_order_relaxed); }
+
     // PCIe (PCCL) communicator state - set in CommInit via InitPCIeForDomain
     void* pcie_comm() const { return pcie_comm_; }
     void set_pcie_comm(void* c) { pcie_comm_ = c; }
@@ -28,6 +128,10 @@ public:
     void set_pcie_nranks(int n) { pcie_nranks_ = n; }
     void* pcie_stream() const { return pcie_stream_; }
     void set_pcie_stream(void* s) { pcie_stream_ = s; }
+    // NUMA node of each PCCL rank's device, by PCCL rank (from the rank table); empty or
+    // -1 entries when unknown. Places the IR's host chunks.
+    const std::vector<int>& pcie_numa() const { return pcie_numa_; }
+    void set_pcie_numa(std::vector<int> nodes) { pcie_numa_ = std::move(nodes); }
 
     // Timers bound to this domain (fast stream + PCIe stream); used for deferred sync at SynchronizeStream.
     Timer& timer_fast() { return timer_fast_; }
@@ -39,23 +143,57 @@ public:
     ShmParamStore* shm_store() { return &shm_store_; }
     const ShmParamStore* shm_store() const { return &shm_store_; }
     void EnsureShmAttached() {
-        if (pcie_nranks_ > 1 && !shm_store_.IsAttached()) {
+        if (pcie_nranks_ > 1 && !stat_reducer_.IsEnabled() && !shm_store_.IsAttached()) {
             shm_store_.Attach(key, pcie_rank_, pcie_nranks_);
         }
     }
 
+    // Whether every rank of the PCIe group plans splits from the same controller state:
+    // one rank, scheme B once rank 0's seeds are adopted, or an attached scheme A store. Without it (a failed attach, or
+    // TakeUpdate gave up on rank 0) the domain stays fast-only, since ranks splitting
+    // differently would hang the collective. A disabled domain stays fast-only for good.
+    bool SplitsAgreed() const {
+        return !pcie_disabled() &&
+               (pcie_nranks_ <= 1 || (stat_reducer_.IsEnabled() && stat_reducer_.seeds_synced()) ||
+                shm_store_.IsAttached());
+    }
+
+    // Cross-rank statistics via AllReduce (scheme B); replaces the shm store when enabled.
+    StatReducer* stat_reducer() { return &stat_reducer_; }
+    const StatReducer* stat_reducer() const { return &stat_reducer_; }
+
     CommDomain(const CommDomainKey& k, std::unique_ptr<AdaptiveController> ctrl)
-        : key(k), controller(std::move(ctrl)),
+        : key(k), controller(std::move(ctrl)), key_id_(k.Digest().lo),
+          comm_rank_(-1), profile_fingerprint_(0),
           pcie_comm_(nullptr), pcie_rank_(-1), pcie_nranks_(0), pcie_stream_(nullptr) {}
 
 private:
+    uint64_t key_id_;
+    int comm_rank_;
+    uint64_t profile_fingerprint_;
+    std::chrono::steady_clock::time_point profile_flushed_at_ = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> seq_{0};
+    std::atomic<uint64_t> split_seq_{0};
+    NodeTopology topology_;
+    HierComms hier_comms_;
+    HierSplitFn hier_split_ = nullptr;
+    StreamEvent hier_rs_done_;
+    StreamEvent hier_ar_done_;
+    int device_ = -1;
+    SetDeviceFn set_device_ = nullptr;
     void* pcie_comm_;   // pcclComm_t (opaque)
     int pcie_rank_;
     int pcie_nranks_;
     void* pcie_stream_;  // pcclStream_t (opaque), created in InitPCIeForDomain
+    std::vector<int> pcie_numa_;
     Timer timer_fast_;
     Timer timer_pcie_;
     ShmParamStore shm_store_;
+    StatReducer stat_reducer_;
+    PCIeWatchdog pcie_watchdog_;
+    PCIeLazyInit pcie_lazy_init_;
+    std::atomic<bool> pcie_quarantined_{false};
+    std::atomic<bool> pcie_disabled_{false};
 };
 
 }  // namespace ampccl
@@ -1,29 +1,48 @@
 #ifndef AMPCCL_CORE_DOMAIN_KEY_H_
 #define AMPCCL_CORE_DOMAIN_KEY_H_
 
+#include "common/hash.h"
 #include <vector>
 #include <cstdint>
 #include <functional>
+#include <string>
 
 namespace ampccl {
 
+// Identity of one of our Comms. Every rank of a communicator builds the same key
+// (see BuildKeyFromNcclInit); two communicators, or two jobs on one node, must not.
 struct CommDomainKey {
-    int world_size;
+    int world_size = 0;
+    // Job-wide rank of each communicator rank, in communicator rank order; 0..n-1
+    // when the launcher does not expose global ranks.
     std::vector<int> ranks;
-    uint64_t topology_hash;
+    // Digest of the library's full unique id (ncclUniqueId / HcclRootInfo).
+    Hash128 comm_id;
+    // Job identifier (Config::GetJobId()); empty if the launcher sets none.
+    std::string job;
+    // Device placement (RankTable::Digest(): server and device of every rank); zero
+    // when no rank table describes the communicator.
+    Hash128 placement;
 
-    bool operator==(const CommDomainKey& other) const {
-        if (world_size != other.world_size ||
-            topology_hash != other.topology_hash ||
-            ranks.size() != other.ranks.size()) {
-            return false;
-        }
-        for (size_t i = 0; i < ranks.size(); ++i) {
-            if (ranks[i] != other.ranks[i]) {
-                return false;
-            }
+    // Keyed 128-bit digest over all fields: the shm segment name and the owner
+    // recorded in its header. Not cached; lookups on the collective path go through
+    // pointers (DomainManager) or CommDomain::key_id().
+    Hash128 Digest() const {
+        SipHasher128 h;
+        h.UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(world_size)));
+        h.UpdateU64(ranks.size());
+        for (int r : ranks) {
+            h.UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(r)));
         }
-        return true;
+        h.UpdateU64(comm_id.lo).UpdateU64(comm_id.hi);
+        h.UpdateString(job);
+        h.UpdateU64(placement.lo).UpdateU64(placement.hi);
+        return h.Finalize();
+    }
+
+    bool operator==(const CommDomainKey& other) const {
+        return world_size == other.world_size && comm_id == other.comm_id && ranks == other.ranks &&
+               job == other.job && placement == other.placement;
     }
 };
 
@@ -34,12 +53,7 @@ namespace std {
 template <>
 struct hash<ampccl::CommDomainKey> {
     size_t operator()(const ampccl::CommDomainKey& key) const {
-        size_t h = std::hash<int>{}(key.world_size);
-        h ^= std::hash<uint64_t>{}(key.topology_hash) << 1;
-        for (int rank : key.ranks) {
-            h ^= std::hash<int>{}(rank) << 1;
-        }
-        return h;
+        return static_cast<size_t>(key.Digest().lo);
     }
 };
 }  // namespace std
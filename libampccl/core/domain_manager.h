@@ -6,10 +6,14 @@
 #include "common/log.h"
 #include "common/op_key.h"
 #include "planner.h"
+#include "profile_store.h"
+#include "telemetry/trace.h"
 #include <unordered_map>
 #include <mutex>
 #include <memory>
 #include <optional>
+#include <string>
+#include <chrono>
 
 namespace ampccl {
 
@@ -20,17 +24,19 @@ struct PendingCollective {
     Plan plan;
     bool fast_success = true;
     bool pcie_success = true;
+    TraceStamp stamp;
 };
 
 // Manages the global "dividing param" table keyed by *our* Comm (CommDomainKey),
 // and the mapping from raw backend communicator to our Comm.
 //
-// - Table: our Comm (topology + ranks + size) -> CommDomain (controller + param cache).
-//   Shared across ranks; reused when a communicator is destroyed and re-created
-//   with the same topology/ranks/size.
-// - Raw mapping: raw comm pointer -> our Comm key. Used only to find which
-//   domain to use for a given collective call. Unregistering a raw comm does
-//   not remove the domain.
+// - Table: (our Comm, rank) -> CommDomain (controller + param cache). Reused when a
+//   communicator is destroyed and re-created with the same key. The rank only matters
+//   when one process drives several ranks of a communicator (ncclCommInitAll): each
+//   device then gets its own domain, controller and PCIe resources.
+// - Raw mapping: raw comm pointer -> our Comm. Used only to find which
+//   domain to use for a given collective call (no key hashing on that path).
+//   Unregistering a raw comm does not remove the domain.
 class DomainManager {
 public:
     static DomainManager& GetInstance() {
@@ -39,41 +45,35 @@ public:
     }
 
     // Get or create domain by *our* Comm key (used by CommInit after building key).
-    CommDomain* GetOrCreateDomainByKey(const CommDomainKey& key) {
+    // rank = -1: the process's only rank of the communicator (tools, benchmarks).
+    CommDomain* GetOrCreateDomainByKey(const CommDomainKey& key, int rank = -1) {
         std::lock_guard<std::mutex> lock(mutex_);
-        return GetOrCreateDomainByKeyLocked(key);
+        return GetOrCreateDomainByKeyLocked(key, rank);
     }
 
     // Register raw communicator to our Comm. Call after backend CommInit.
-    void RegisterRawComm(void* raw_comm, const CommDomainKey& key) {
+    void RegisterRawComm(void* raw_comm, const CommDomainKey& key, int rank = -1) {
         std::lock_guard<std::mutex> lock(mutex_);
-        (void)GetOrCreateDomainByKeyLocked(key);
-        raw_to_key_[raw_comm] = key;
+        raw_to_domain_[raw_comm] = GetOrCreateDomainByKeyLocked(key, rank);
     }
 
     // Get domain for a raw communicator (for collective hooks).
     CommDomain* GetDomainByRawComm(void* raw_comm) {
         std::lock_guard<std::mutex> lock(mutex_);
-        auto it = raw_to_key_.find(raw_comm);
-        if (it == raw_to_key_.end()) {
-            return nullptr;
-        }
-        auto jt = key_to_domain_.find(it->second);
-        if (jt == key_to_domain_.end()) {
-            return nullptr;
-        }
-        return jt->second.get();
+        auto it = raw_to_domain_.find(raw_comm);
+        return it == raw_to_domain_.end() ? nullptr : it->second;
     }
 
     // Unregister raw communicator on CommDestroy. Does not remove the domain.
     void UnregisterRawComm(void* raw_comm) {
         std::lock_guard<std::mutex> lock(mutex_);
-        raw_to_key_.erase(raw_comm);
+        raw_to_domain_.erase(raw_comm);
     }
 
     // Stream -> pending collective: register when launching a collective, take at SynchronizeStream.
     void RegisterStreamPending(void* stream, CommDomain* domain, const OpKey& op_key,
-                               const Plan& plan, bool fast_success, bool pcie_success) {
+                               const Plan& plan, bool fast_success, bool pcie_success,
+                               const TraceStamp& stamp = TraceStamp()) {
         std::lock_guard<std::mutex> lock(mutex_);
         PendingCollective pending;
         pending.domain = domain;
@@ -81,6 +81,7 @@ public:
         pending.plan = plan;
         pending.fast_success = fast_success;
         pending.pcie_success = pcie_success;
+        pending.stamp = stamp;
         stream_to_pending_[stream] = std::move(pending);
     }
 
@@ -96,41 +97,129 @@ public:
         return p;
     }
 
+    // Warm start once the domain's topology is set (CommInit): seed its param cache from
+    // the profiles under ProfileStore::Fingerprint(key, topology, backend, device). A
+    // domain reused by a re-created communicator keeps what it has learned since.
+    void LoadProfile(CommDomain* domain, const char* backend, const std::string& device) {
+        if (domain == nullptr || (!preload_.IsOpen() && !profile_.IsOpen())) {
+            return;
+        }
+        uint64_t fingerprint = ProfileStore::Fingerprint(domain->key, domain->topology(), backend, device);
+        if (domain->profile_fingerprint() == fingerprint) {
+            return;
+        }
+        domain->set_profile_fingerprint(fingerprint);
+        // Site profile first; the job's own profile overrides it per (op, size class).
+        // These are this rank's seeds only: the first collective replaces them with rank
+        // 0's (ShmParamStore::AdoptSeeds, StatReducer::SyncSeeds), as the files may differ.
+        if (preload_.IsOpen()) {
+            size_t n = preload_.Load(fingerprint, &domain->param_cache);
+            AMPCCL_LOG(INFO, "Profile: preloaded %zu tuned entries (%s, %s)", n, backend, device.c_str());
+        }
+        if (profile_.IsOpen()) {
+            size_t n = profile_.Load(fingerprint, &domain->param_cache);
+            AMPCCL_LOG(INFO, "Profile: warm start with %zu entries (%s, %s)", n, backend, device.c_str());
+        }
+    }
+
+    // Rank 0 of a domain: write its learned params to the profile if the flush
+    // interval has elapsed for that domain (each keeps its own timestamp, so a busy
+    // domain does not hold back the others). Called after each controller update at
+    // stream sync. Serialized on profile_mutex_, not mutex_: the store takes a file
+    // lock and writes, and every collective looks its domain up under mutex_.
+    void MaybeFlushProfile(CommDomain* domain) {
+        if (!profile_.IsOpen() || domain == nullptr || domain->comm_rank() != 0 ||
+            domain->profile_fingerprint() == 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(profile_mutex_);
+        double elapsed = std::chrono::duration<double>(now - domain->profile_flushed_at()).count();
+        if (elapsed < Config::GetProfileFlushInterval()) {
+            return;
+        }
+        domain->set_profile_flushed_at(now);
+        size_t n = profile_.Store(domain->profile_fingerprint(), domain->param_cache);
+        AMPCCL_LOG(DEBUG, "Profile: flushed %zu entries", n);
+    }
+
     void Clear() {
         std::lock_guard<std::mutex> lock(mutex_);
-        raw_to_key_.clear();
+        raw_to_domain_.clear();
         key_to_domain_.clear();
         stream_to_pending_.clear();
     }
 
 private:
-    DomainManager() = default;
-    ~DomainManager() = default;
+    DomainManager() {
+        if (Config::IsAdaptiveEnabled()) {
+            const char* preload = Config::GetProfilePreloadPath();
+            if (preload != nullptr) {
+                preload_.Open(preload, /*read_only=*/true);
+            }
+            const char* path = Config::GetProfilePath();
+            if (path != nullptr) {
+                profile_.Open(path);
+            }
+        }
+    }
+
+    // Final profile flush at exit (rank 0 of each domain; domains without a rank, from
+    // tools and benchmarks, never write).
+    ~DomainManager() {
+        if (!profile_.IsOpen()) {
+            return;
+        }
+        for (auto& kv : key_to_domain_) {
+            CommDomain* d = kv.second.get();
+            if (d->comm_rank() == 0 && d->profile_fingerprint() != 0) {
+                profile_.Store(d->profile_fingerprint(), d->param_cache);
+            }
+        }
+    }
+
     DomainManager(const DomainManager&) = delete;
     DomainManager& operator=(const DomainManager&) = delete;
 
-    CommDomain* GetOrCreateDomainByKeyLocked(const CommDomainKey& key) {
-        auto it = key_to_domain_.find(key);
+    struct DomainSlot {
+        CommDomainKey key;
+        int rank;
+
+        bool operator==(const DomainSlot& other) const { return rank == other.rank && key == other.key; }
+    };
+
+    struct DomainSlotHash {
+        size_t operator()(const DomainSlot& s) const {
+            return std::hash<CommDomainKey>()(s.key) ^ (static_cast<size_t>(s.rank + 1) * 0x9e3779b97f4a7c15ull);
+        }
+    };
+
+    CommDomain* GetOrCreateDomainByKeyLocked(const CommDomainKey& key, int rank) {
+        DomainSlot slot{key, rank};
+        auto it = key_to_domain_.find(slot);
         if (it != key_to_domain_.end()) {
-            AMPCCL_LOG(INFO, "Comm reused (existing): world_size=%d topology_hash=%llu",
-                       key.world_size, static_cast<unsigned long long>(key.topology_hash));
+            AMPCCL_LOG(INFO, "Comm reused (existing): world_size=%d rank=%d key=%s",
+                       key.world_size, rank, key.Digest().Hex().c_str());
             return it->second.get();
         }
-        AMPCCL_LOG(INFO, "Comm created (new): world_size=%d topology_hash=%llu",
-                   key.world_size, static_cast<unsigned long long>(key.topology_hash));
+        AMPCCL_LOG(INFO, "Comm created (new): world_size=%d rank=%d key=%s",
+                   key.world_size, rank, key.Digest().Hex().c_str());
         CommDomain temp_domain(key, nullptr);
         auto algo = AlgoFactory::Create(temp_domain);
         auto controller = std::make_unique<AdaptiveController>(std::move(algo));
         auto domain = std::make_unique<CommDomain>(key, std::move(controller));
         CommDomain* ptr = domain.get();
-        key_to_domain_[key] = std::move(domain);
+        key_to_domain_[std::move(slot)] = std::move(domain);
         return ptr;
     }
 
     mutable std::mutex mutex_;
-    std::unordered_map<CommDomainKey, std::unique_ptr<CommDomain>> key_to_domain_;
-    std::unordered_map<void*, CommDomainKey> raw_to_key_;
+    std::unordered_map<DomainSlot, std::unique_ptr<CommDomain>, DomainSlotHash> key_to_domain_;
+    std::unordered_map<void*, CommDomain*> raw_to_domain_;  // Into key_to_domain_ (never erased)
     std::unordered_map<void*, PendingCollective> stream_to_pending_;
+    ProfileStore preload_;
+    ProfileStore profile_;
+    std::mutex profile_mutex_;  // Flushes to profile_ and each domain's profile_flushed_at
 };
 
 }  // namespace ampccl
@@ -0,0 +1,44 @@
+#include "group_scope.h"
+#include "domain.h"
+#include <algorithm>
+#include <vector>
+
+namespace ampccl {
+
+namespace {
+
+thread_local int group_depth = 0;
+thread_local std::vector<CommDomain*> group_deferred;
+
+}  // namespace
+
+void EnterGroup() {
+    ++group_depth;
+}
+
+bool LeaveGroup() {
+    return group_depth > 0 && --group_depth == 0;
+}
+
+bool InGroup() {
+    return group_depth > 0;
+}
+
+void DeferToGroupEnd(CommDomain* domain) {
+    if (std::find(group_deferred.begin(), group_deferred.end(), domain) == group_deferred.end()) {
+        group_deferred.push_back(domain);
+    }
+}
+
+void RunGroupDeferred(bool ok) {
+    std::vector<CommDomain*> deferred;
+    deferred.swap(group_deferred);
+    if (!ok) {
+        return;
+    }
+    for (CommDomain* domain : deferred) {
+        domain->stat_reducer()->OnGroupEnd(domain);
+    }
+}
+
+}  // namespace ampccl
@@ -0,0 +1,28 @@
+#ifndef AMPCCL_CORE_GROUP_SCOPE_H_
+#define AMPCCL_CORE_GROUP_SCOPE_H_
+
+namespace ampccl {
+
+class CommDomain;
+
+// ncclGroupStart / ncclGroupEnd nesting of the calling thread, kept by the NCCL hook.
+// The library holds collectives issued inside a group until the outermost GroupEnd,
+// so work that reads a collective's result back on the host (statistics rounds and
+// the seed sync, StatReducer) or creates communicators (the hierarchical split) must
+// not run there. Every rank groups the same collectives, so work deferred to the end
+// of a group still runs at the same point of every rank's collective sequence.
+void EnterGroup();
+// True when the outermost group ends.
+bool LeaveGroup();
+bool InGroup();
+
+// A collective entry inside a group that left StatReducer work for the group's end.
+// Domains are kept in the order they asked, which every rank sees alike.
+void DeferToGroupEnd(CommDomain* domain);
+// Outermost GroupEnd: run the deferred work if the group launched (ok), else leave it
+// to each domain's next collective entry outside a group.
+void RunGroupDeferred(bool ok);
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_GROUP_SCOPE_H_
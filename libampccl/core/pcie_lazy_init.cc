@@ -0,0 +1,119 @@
+#include "pcie_lazy_init.h"
+#include <deque>
+#include <map>
+#include <thread>
+#include <utility>
+
+namespace ampccl {
+
+namespace {
+
+// One init thread per device, running tasks in submission order. Never torn down: at
+// exit a thread may still be blocked in pcclInit waiting for peers that are gone.
+class InitQueues {
+public:
+    static InitQueues& GetInstance() {
+        static InitQueues* instance = new InitQueues;
+        return *instance;
+    }
+
+    void Submit(int device, std::function<void()> job) {
+        std::lock_guard<std::mutex> lock(mu_);
+        Queue*& q = queues_[device];
+        if (q == nullptr) {
+            q = new Queue;
+            std::thread(&InitQueues::Loop, q).detach();
+        }
+        {
+            std::lock_guard<std::mutex> qlock(q->mu);
+            q->jobs.push_back(std::move(job));
+        }
+        q->cv.notify_one();
+    }
+
+private:
+    struct Queue {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    static void Loop(Queue* q) {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(q->mu);
+                q->cv.wait(lock, [q] { return !q->jobs.empty(); });
+                job = std::move(q->jobs.front());
+                q->jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mu_;
+    std::map<int, Queue*> queues_;
+};
+
+}  // namespace
+
+void PCIeLazyInit::Defer(int device, Task task) {
+    if (state_ != State::kNone || !task) {
+        return;
+    }
+    device_ = device;
+    task_ = std::move(task);
+    state_ = State::kDeferred;
+}
+
+void PCIeLazyInit::Start(uint64_t seq) {
+    if (state_ != State::kDeferred) {
+        return;
+    }
+    state_ = State::kRunning;
+    start_seq_ = seq;
+    std::shared_ptr<Shared> st = st_;
+    Task task = std::move(task_);
+    InitQueues::GetInstance().Submit(device_, [st, task] {
+        void* comm = nullptr;
+        void* stream = nullptr;
+        bool ok = task(&comm, &stream);
+        {
+            std::lock_guard<std::mutex> lock(st->mu);
+            st->done = true;
+            st->ok = ok;
+            st->comm = comm;
+            st->stream = stream;
+        }
+        st->cv.notify_all();
+    });
+}
+
+bool PCIeLazyInit::done() const {
+    std::lock_guard<std::mutex> lock(st_->mu);
+    return st_->done;
+}
+
+bool PCIeLazyInit::ok() const {
+    std::lock_guard<std::mutex> lock(st_->mu);
+    return st_->ok;
+}
+
+void PCIeLazyInit::Wait() {
+    std::unique_lock<std::mutex> lock(st_->mu);
+    st_->cv.wait(lock, [this] { return st_->done; });
+}
+
+bool PCIeLazyInit::Publish(void** comm, void** stream) {
+    if (state_ != State::kRunning) {
+        return false;
+    }
+    Wait();
+    state_ = State::kPublished;
+    std::lock_guard<std::mutex> lock(st_->mu);
+    *comm = st_->comm;
+    *stream = st_->stream;
+    return st_->ok;
+}
+
+}  // namespace ampccl
@@ -0,0 +1,80 @@
+#ifndef AMPCCL_CORE_PCIE_LAZY_INIT_H_
+#define AMPCCL_CORE_PCIE_LAZY_INIT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace ampccl {
+
+// Deferred PCCL setup of one domain (Config::IsPCIeInitLazy). The CommInit hook only
+// records the setup task; the first collective at or above the PCIe crossover queues it
+// on a background thread, and the collective path publishes the result (pcie_comm,
+// pcie_stream) at a collective all ranks agree on (VirtualCollective::PreparePCIe).
+//
+// pcclInit is collective and matches groups by call order on a device, so tasks run on
+// one thread per device, in the order this process started them: the same order on
+// every rank, as collectives are issued in the same order.
+class PCIeLazyInit {
+public:
+    enum class State { kNone, kDeferred, kRunning, kPublished };
+    // Creates the PCCL communicator and stream; false on failure. Runs on the init thread.
+    using Task = std::function<bool(void** comm, void** stream)>;
+
+    PCIeLazyInit() : st_(std::make_shared<Shared>()) {}
+
+    PCIeLazyInit(const PCIeLazyInit&) = delete;
+    PCIeLazyInit& operator=(const PCIeLazyInit&) = delete;
+
+    State state() const { return state_; }
+
+    // kNone -> kDeferred. device (-1 if unknown) picks the init thread.
+    void Defer(int device, Task task);
+
+    // kDeferred -> kRunning, at collective seq: queue the task.
+    void Start(uint64_t seq);
+    uint64_t start_seq() const { return start_seq_; }
+
+    // Whether the task has run, and its outcome (valid once done).
+    bool done() const;
+    bool ok() const;
+
+    // Block until the task has run.
+    void Wait();
+
+    // kRunning -> kPublished once the task has run (waits for it). Returns the outcome and,
+    // if it succeeded, the PCCL communicator and stream.
+    bool Publish(void** comm, void** stream);
+
+    // Agreement bookkeeping for the collective path: this rank's outcome was reported
+    // (scheme A), every rank reported ready (scheme B statistics round).
+    bool reported() const { return reported_; }
+    void set_reported() { reported_ = true; }
+    bool agreed() const { return agreed_; }
+    void set_agreed() { agreed_ = true; }
+
+private:
+    // Shared with the init thread, which may run the task after the domain is gone.
+    struct Shared {
+        std::mutex mu;
+        std::condition_variable cv;
+        bool done = false;
+        bool ok = false;
+        void* comm = nullptr;
+        void* stream = nullptr;
+    };
+
+    std::shared_ptr<Shared> st_;
+    Task task_;
+    int device_ = -1;
+    State state_ = State::kNone;  // Collective thread only
+    uint64_t start_seq_ = 0;
+    bool reported_ = false;
+    bool agreed_ = false;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_PCIE_LAZY_INIT_H_
@@ -0,0 +1,68 @@
+#include "pcie_watchdog.h"
+#include <chrono>
+
+namespace ampccl {
+
+PCIeWatchdog::~PCIeWatchdog() {
+    bool wedged;
+    {
+        std::lock_guard<std::mutex> lock(st_->mu);
+        st_->stop = true;
+        wedged = st_->busy;
+    }
+    st_->cv.notify_all();
+    if (thread_.joinable()) {
+        if (wedged) {
+            thread_.detach();  // Still blocked in PCCL; it exits once the sync returns
+        } else {
+            thread_.join();
+        }
+    }
+}
+
+bool PCIeWatchdog::wedged() const {
+    std::lock_guard<std::mutex> lock(st_->mu);
+    return st_->busy;
+}
+
+BackendResult PCIeWatchdog::Run(const std::function<bool()>& sync, double deadline_s) {
+    if (deadline_s <= 0.0) {
+        return sync() ? BackendResult::Success : BackendResult::UnhandledError;
+    }
+    std::unique_lock<std::mutex> lock(st_->mu);
+    if (st_->busy) {
+        return BackendResult::Timeout;
+    }
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&PCIeWatchdog::Loop, st_);
+    }
+    st_->job = sync;
+    st_->busy = true;
+    st_->cv.notify_all();
+    State* st = st_.get();
+    if (!st->cv.wait_for(lock, std::chrono::duration<double>(deadline_s),
+                         [st] { return !st->busy; })) {
+        return BackendResult::Timeout;
+    }
+    return st->ok ? BackendResult::Success : BackendResult::UnhandledError;
+}
+
+void PCIeWatchdog::Loop(std::shared_ptr<State> st) {
+    std::unique_lock<std::mutex> lock(st->mu);
+    while (true) {
+        st->cv.wait(lock, [&st] { return st->stop || (st->busy && st->job); });
+        if (st->stop) {
+            return;
+        }
+        std::function<bool()> job = std::move(st->job);
+        st->job = nullptr;
+        lock.unlock();
+        bool ok = job();
+        lock.lock();
+        st->ok = ok;
+        st->busy = false;
+        st->cv.notify_all();
+    }
+}
+
+}  // namespace ampccl
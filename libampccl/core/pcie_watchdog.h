@@ -0,0 +1,50 @@
+#ifndef AMPCCL_CORE_PCIE_WATCHDOG_H_
+#define AMPCCL_CORE_PCIE_WATCHDOG_H_
+
+#include "backend/backend_base.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ampccl {
+
+// Runs a blocking PCIe stream sync on a helper thread so the caller can give up after
+// a deadline. A sync that misses its deadline leaves the helper blocked in PCCL: the
+// path is "wedged" and later calls fail immediately until that sync finally returns.
+// One per domain; the helper thread is started on first use.
+class PCIeWatchdog {
+public:
+    PCIeWatchdog() : st_(std::make_shared<State>()) {}
+    ~PCIeWatchdog();
+
+    PCIeWatchdog(const PCIeWatchdog&) = delete;
+    PCIeWatchdog& operator=(const PCIeWatchdog&) = delete;
+
+    // Run sync (returns true on success) with a deadline in seconds; deadline <= 0 runs
+    // it inline. Returns Success, UnhandledError if sync failed, or Timeout.
+    BackendResult Run(const std::function<bool()>& sync, double deadline_s);
+
+    bool wedged() const;
+
+private:
+    // Shared with the helper thread, which may outlive the watchdog when wedged.
+    struct State {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::function<bool()> job;
+        bool busy = false;   // Job handed to the helper and not finished yet
+        bool ok = false;
+        bool stop = false;
+    };
+
+    static void Loop(std::shared_ptr<State> st);
+
+    std::shared_ptr<State> st_;
+    std::thread thread_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_PCIE_WATCHDOG_H_
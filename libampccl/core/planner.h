@@ -10,8 +10,9 @@ struct Plan {
     size_t fast_bytes;   // Bytes to send via fast backend
     size_t pcie_bytes;   // Bytes to send via PCIe backend
     bool use_pcie;       // Whether to use PCIe backend
+    double alpha;        // Fast ratio the split was built from (1.0 if fast-only)
 
-    Plan() : fast_bytes(0), pcie_bytes(0), use_pcie(false) {}
+    Plan() : fast_bytes(0), pcie_bytes(0), use_pcie(false), alpha(1.0) {}
 };
 
 class Planner {
@@ -20,12 +21,11 @@ public:
     static Plan CreatePlan(size_t total_bytes, double alpha, bool use_pcie_hint) {
         Plan plan;
 
-        // Check if PCIe should be disabled
-        size_t min_msg_size = Config::GetMinMsgSize();
+        // Check if PCIe should be disabled. The size crossover is learned by the
+        // controller (AMPCCL_MIN_MSG_SIZE only seeds it) and arrives as use_pcie_hint.
         size_t min_chunk_size = Config::GetMinChunkSize();
 
         if (!Config::IsPCIeEnabled() ||
-            total_bytes < min_msg_size ||
             !use_pcie_hint) {
             plan.fast_bytes = total_bytes;
             plan.pcie_bytes = 0;
@@ -36,6 +36,7 @@ public:
         // Clamp alpha to valid range
         if (alpha < 0.0) alpha = 0.0;
         if (alpha > 1.0) alpha = 1.0;
+        plan.alpha = alpha;
 
         // Calculate split
         plan.fast_bytes = static_cast<size_t>(total_bytes * alpha);
@@ -0,0 +1,302 @@
+#include "profile_store.h"
+#include "common/config.h"
+#include "common/hash.h"
+#include "common/log.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ampccl {
+
+namespace {
+
+std::string CpuModelName() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            return line;
+        }
+    }
+    return std::string();
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+// RAII flock on the profile fd.
+class FileLock {
+public:
+    FileLock(int fd, int op) : fd_(fd) { ok_ = (flock(fd_, op) == 0); }
+    ~FileLock() {
+        if (ok_) flock(fd_, LOCK_UN);
+    }
+    bool ok() const { return ok_; }
+
+private:
+    int fd_;
+    bool ok_;
+};
+#endif
+
+}  // namespace
+
+size_t ProfileStore::FileSize() {
+    return sizeof(Header) + static_cast<size_t>(kMaxEntries) * sizeof(Entry);
+}
+
+ProfileStore::Entry* ProfileStore::Entries() const {
+    return reinterpret_cast<Entry*>(static_cast<char*>(base_) + sizeof(Header));
+}
+
+uint64_t ProfileStore::Fingerprint(const CommDomainKey& key, const NodeTopology& topo, const char* backend,
+                                   const std::string& device) {
+    SipHasher128 h;
+    h.UpdateString(backend != nullptr ? backend : "");
+    h.UpdateString(device);
+    h.UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(key.world_size)));
+    // Shape only: node_id / local_rank differ per rank.
+    bool multi_node = topo.IsMultiNode();
+    h.UpdateU64(static_cast<uint64_t>(multi_node ? topo.num_nodes : 1));
+    int local_size = multi_node ? topo.local_size : key.world_size;
+    h.UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(local_size)));
+    bool pcie = false;
+#ifdef AMPCCL_ENABLE_PCIE
+    pcie = Config::IsPCIeEnabled() && local_size > 1;
+#endif
+    h.UpdateU64(pcie ? 1 : 0);
+    h.UpdateString(CpuModelName());
+#if defined(__linux__) || defined(__APPLE__)
+    h.UpdateU64(static_cast<uint64_t>(sysconf(_SC_NPROCESSORS_CONF)));
+#endif
+    const char* extra = std::getenv("AMPCCL_PROFILE_FINGERPRINT");
+    if (extra != nullptr) {
+        h.UpdateString(extra);
+    }
+    return h.Finalize().lo;
+}
+
+bool ProfileStore::Open(const std::string& path, bool read_only) {
+#if defined(__linux__) || defined(__APPLE__)
+    if (base_ != nullptr) {
+        return true;
+    }
+    read_only_ = read_only;
+    fd_ = read_only ? open(path.c_str(), O_RDONLY) : open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        AMPCCL_LOG(WARN, "ProfileStore: open %s failed", path.c_str());
+        return false;
+    }
+    size_ = FileSize();
+    {
+        FileLock lock(fd_, read_only ? LOCK_SH : LOCK_EX);
+        struct stat st;
+        if (!lock.ok() || fstat(fd_, &st) != 0) {
+            AMPCCL_LOG(WARN, "ProfileStore: lock/stat %s failed", path.c_str());
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        bool fresh = static_cast<size_t>(st.st_size) != size_;
+        if (fresh && read_only) {
+            AMPCCL_LOG(WARN, "ProfileStore: %s has unexpected size", path.c_str());
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        if (fresh && ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+            AMPCCL_LOG(WARN, "ProfileStore: ftruncate %s failed", path.c_str());
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        int prot = read_only ? PROT_READ : (PROT_READ | PROT_WRITE);
+        base_ = mmap(nullptr, size_, prot, MAP_SHARED, fd_, 0);
+        if (base_ == MAP_FAILED) {
+            base_ = nullptr;
+            close(fd_);
+            fd_ = -1;
+            AMPCCL_LOG(WARN, "ProfileStore: mmap %s failed", path.c_str());
+            return false;
+        }
+        Header* hdr = static_cast<Header*>(base_);
+        bool valid = !fresh && hdr->magic == kMagic && hdr->layout_version == kLayoutVersion &&
+                     hdr->capacity == kMaxEntries;
+        if (!valid && read_only) {
+            AMPCCL_LOG(WARN, "ProfileStore: %s is not a v%u profile", path.c_str(), kLayoutVersion);
+            munmap(base_, size_);
+            base_ = nullptr;
+            close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        if (!valid) {
+            std::memset(base_, 0, size_);
+            hdr->magic = kMagic;
+            hdr->layout_version = kLayoutVersion;
+            hdr->capacity = kMaxEntries;
+            hdr->num_entries = 0;
+            hdr->generation = 0;
+            AMPCCL_LOG(INFO, "ProfileStore: initialised %s", path.c_str());
+        }
+    }
+    return true;
+#else
+    (void)path;
+    (void)read_only;
+    return false;
+#endif
+}
+
+ProfileStore::~ProfileStore() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (base_ != nullptr) {
+        if (!read_only_) {
+            msync(base_, size_, MS_ASYNC);
+        }
+        munmap(base_, size_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+size_t ProfileStore::Load(uint64_t fingerprint, ParamCache* cache) const {
+    if (base_ == nullptr || cache == nullptr) {
+        return 0;
+    }
+    size_t loaded = 0;
+#if defined(__linux__) || defined(__APPLE__)
+    FileLock lock(fd_, LOCK_SH);
+    const Header* hdr = static_cast<const Header*>(base_);
+    uint32_t n = hdr->num_entries;
+    if (n > kMaxEntries) {
+        n = kMaxEntries;
+    }
+    const Entry* entries = Entries();
+    for (uint32_t i = 0; i < n; ++i) {
+        const Entry& e = entries[i];
+        if (e.valid == 0 || e.fingerprint != fingerprint ||
+            e.op < 0 || e.op >= kNumCollectiveTypes ||
+            e.size_class < 0 || e.size_class >= kNumSizeClasses) {
+            continue;
+        }
+        cache->Seed(static_cast<CollectiveType>(e.op), e.size_class,
+                    ParamValue(e.alpha, e.use_pcie != 0, e.fast_bw, e.pcie_bw));
+        ++loaded;
+    }
+#else
+    (void)fingerprint;
+#endif
+    return loaded;
+}
+
+ProfileStore::Entry* ProfileStore::FindOrInsertLocked(uint64_t fingerprint, int op, int size_class) {
+    Header* hdr = static_cast<Header*>(base_);
+    Entry* entries = Entries();
+    uint32_t n = hdr->num_entries;
+    if (n > kMaxEntries) {
+        n = kMaxEntries;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        Entry& e = entries[i];
+        if (e.valid != 0 && e.fingerprint == fingerprint && e.op == op && e.size_class == size_class) {
+            return &e;
+        }
+    }
+    if (n >= kMaxEntries) {
+        return nullptr;
+    }
+    Entry* e = &entries[n];
+    std::memset(e, 0, sizeof(Entry));
+    e->fingerprint = fingerprint;
+    e->op = op;
+    e->size_class = size_class;
+    hdr->num_entries = n + 1;
+    return e;
+}
+
+size_t ProfileStore::Store(uint64_t fingerprint, const ParamCache& cache) {
+    if (base_ == nullptr || read_only_) {
+        return 0;
+    }
+    std::vector<std::pair<OpKey, ParamValue>> snapshot;
+    cache.GetAll(&snapshot);
+    if (snapshot.empty()) {
+        return 0;
+    }
+    size_t written = 0;
+#if defined(__linux__) || defined(__APPLE__)
+    FileLock lock(fd_, LOCK_EX);
+    if (!lock.ok()) {
+        return 0;
+    }
+    Header* hdr = static_cast<Header*>(base_);
+    uint64_t gen = hdr->generation + 1;
+    for (const auto& kv : snapshot) {
+        Entry* e = FindOrInsertLocked(fingerprint, static_cast<int>(kv.first.op),
+                                      SizeClassOf(kv.first.bytes));
+        if (e == nullptr) {
+            AMPCCL_LOG(WARN, "ProfileStore: full (%u entries)", kMaxEntries);
+            break;
+        }
+        e->alpha = kv.second.alpha;
+        e->fast_bw = kv.second.fast_bw;
+        e->pcie_bw = kv.second.pcie_bw;
+        e->use_pcie = kv.second.use_pcie ? 1 : 0;
+        e->generation = gen;
+        e->valid = 1;
+        ++written;
+    }
+    hdr->generation = gen;
+    msync(base_, size_, MS_ASYNC);
+#else
+    (void)fingerprint;
+#endif
+    return written;
+}
+
+bool ProfileStore::Put(uint64_t fingerprint, CollectiveType op, int size_class, const ParamValue& value) {
+    if (base_ == nullptr || read_only_) {
+        return false;
+    }
+#if defined(__linux__) || defined(__APPLE__)
+    FileLock lock(fd_, LOCK_EX);
+    if (!lock.ok()) {
+        return false;
+    }
+    Header* hdr = static_cast<Header*>(base_);
+    Entry* e = FindOrInsertLocked(fingerprint, static_cast<int>(op), size_class);
+    if (e == nullptr) {
+        return false;
+    }
+    e->alpha = value.alpha;
+    e->fast_bw = value.fast_bw;
+    e->pcie_bw = value.pcie_bw;
+    e->use_pcie = value.use_pcie ? 1 : 0;
+    e->generation = ++hdr->generation;
+    e->valid = 1;
+    msync(base_, size_, MS_ASYNC);
+    return true;
+#else
+    (void)fingerprint;
+    (void)op;
+    (void)size_class;
+    (void)value;
+    return false;
+#endif
+}
+
+}  // namespace ampccl
@@ -0,0 +1,94 @@
+#ifndef AMPCCL_CORE_PROFILE_STORE_H_
+#define AMPCCL_CORE_PROFILE_STORE_H_
+
+#include "core/domain_key.h"
+#include "core/topology.h"
+#include "common/op_key.h"
+#include "cache/param_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ampccl {
+
+// Persistent, memory-mapped parameter profile for warm starts across job restarts.
+// Entries are keyed by (hardware/topology fingerprint, op, size class); unlike the
+// shm segment the key does not include the NCCL/HCCL unique id, so it survives
+// restarts. Readers take flock(LOCK_SH), writers flock(LOCK_EX), so several jobs on
+// one node can share a file. Only rank 0 of a domain calls Store().
+class ProfileStore {
+public:
+    ProfileStore() = default;
+    ~ProfileStore();
+
+    // Non-copyable
+    ProfileStore(const ProfileStore&) = delete;
+    ProfileStore& operator=(const ProfileStore&) = delete;
+
+    // Create or map the profile file. A file with another magic/layout version is
+    // reinitialised. read_only maps an existing file (e.g. a site profile written by
+    // ampccl-tune) without creating or reinitialising it. Returns true on success.
+    bool Open(const std::string& path, bool read_only = false);
+
+    bool IsOpen() const { return base_ != nullptr; }
+
+    // Fingerprint of hardware + communicator shape: backend ("nccl" / "hccl"), device
+    // model name, world size, node count and ranks per node (topo), whether a PCIe path
+    // is configured, CPU model, CPU count and optional AMPCCL_PROFILE_FINGERPRINT.
+    // Excludes the unique id and the rank on purpose: every rank of a job and every
+    // restart of it computes the same value.
+    static uint64_t Fingerprint(const CommDomainKey& key, const NodeTopology& topo, const char* backend,
+                                const std::string& device);
+
+    // Seed cache with every entry of this fingerprint. Returns entries loaded.
+    size_t Load(uint64_t fingerprint, ParamCache* cache) const;
+
+    // Write the cache's learned entries, one per (op, size class). Returns entries written.
+    size_t Store(uint64_t fingerprint, const ParamCache& cache);
+
+    // Insert or replace a single (op, size class) entry (used by ampccl-tune).
+    bool Put(uint64_t fingerprint, CollectiveType op, int size_class, const ParamValue& value);
+
+private:
+    static constexpr uint64_t kMagic = 0x414d5043434c5046u;  // "AMPCCLPF"
+    static constexpr uint32_t kLayoutVersion = 1;
+    static constexpr uint32_t kMaxEntries = 4096;
+
+#pragma pack(push, 1)
+    struct Entry {
+        uint64_t fingerprint;
+        int32_t op;
+        int32_t size_class;
+        double alpha;
+        double fast_bw;
+        double pcie_bw;
+        uint8_t use_pcie;
+        uint8_t valid;
+        uint8_t pad[6];
+        uint64_t generation;  // Header generation when last written
+    };
+    static_assert(sizeof(Entry) == 56, "Entry size");
+
+    struct Header {
+        uint64_t magic;
+        uint32_t layout_version;
+        uint32_t capacity;
+        uint32_t num_entries;
+        uint32_t pad;
+        uint64_t generation;  // Bumped on every Store/Put
+    };
+#pragma pack(pop)
+
+    static size_t FileSize();
+    Entry* Entries() const;
+    Entry* FindOrInsertLocked(uint64_t fingerprint, int op, int size_class);
+
+    void* base_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+    bool read_only_ = false;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_PROFILE_STORE_H_
@@ -0,0 +1,322 @@
+#include "rank_table.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ampccl {
+
+namespace {
+
+// Just enough JSON for rank tables: the whole document is parsed into a tree (the
+// files are a few KB), objects keep their member order.
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+    Type type = Null;
+    double number = 0.0;
+    std::string str;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* Find(const char* key) const {
+        for (const auto& m : members) {
+            if (m.first == key) {
+                return &m.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : s_(text) {}
+
+    bool ParseDocument(JsonValue* out, std::string* error) {
+        if (!ParseValue(out, 0)) {
+            *error = "JSON syntax error at offset " + std::to_string(pos_);
+            return false;
+        }
+        SkipSpace();
+        if (pos_ != s_.size()) {
+            *error = "trailing characters at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 32;
+
+    void SkipSpace() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\n' || s_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool Consume(char c) {
+        SkipSpace();
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool Literal(const char* word) {
+        size_t n = std::char_traits<char>::length(word);
+        if (s_.compare(pos_, n, word) != 0) {
+            return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    bool ParseValue(JsonValue* out, int depth) {
+        if (depth > kMaxDepth) {
+            return false;
+        }
+        SkipSpace();
+        if (pos_ >= s_.size()) {
+            return false;
+        }
+        char c = s_[pos_];
+        if (c == '{') {
+            ++pos_;
+            out->type = JsonValue::Object;
+            if (Consume('}')) {
+                return true;
+            }
+            do {
+                std::pair<std::string, JsonValue> member;
+                SkipSpace();
+                if (!ParseString(&member.first) || !Consume(':') || !ParseValue(&member.second, depth + 1)) {
+                    return false;
+                }
+                out->members.push_back(std::move(member));
+            } while (Consume(','));
+            return Consume('}');
+        }
+        if (c == '[') {
+            ++pos_;
+            out->type = JsonValue::Array;
+            if (Consume(']')) {
+                return true;
+            }
+            do {
+                out->items.emplace_back();
+                if (!ParseValue(&out->items.back(), depth + 1)) {
+                    return false;
+                }
+            } while (Consume(','));
+            return Consume(']');
+        }
+        if (c == '"') {
+            out->type = JsonValue::String;
+            return ParseString(&out->str);
+        }
+        if (c == 't' || c == 'f') {
+            out->type = JsonValue::Bool;
+            out->number = c == 't' ? 1.0 : 0.0;
+            return Literal(c == 't' ? "true" : "false");
+        }
+        if (c == 'n') {
+            out->type = JsonValue::Null;
+            return Literal("null");
+        }
+        const char* begin = s_.c_str() + pos_;
+        char* end = nullptr;
+        out->type = JsonValue::Number;
+        out->number = std::strtod(begin, &end);
+        if (end == begin) {
+            return false;
+        }
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    // Escapes are decoded; \u sequences outside ASCII become '?' (ids are ASCII).
+    bool ParseString(std::string* out) {
+        if (pos_ >= s_.size() || s_[pos_] != '"') {
+            return false;
+        }
+        ++pos_;
+        while (pos_ < s_.size()) {
+            char c = s_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (pos_ >= s_.size()) {
+                return false;
+            }
+            char e = s_[pos_++];
+            switch (e) {
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    if (pos_ + 4 > s_.size()) {
+                        return false;
+                    }
+                    unsigned long cp = std::strtoul(s_.substr(pos_, 4).c_str(), nullptr, 16);
+                    out->push_back(cp < 0x80 ? static_cast<char>(cp) : '?');
+                    pos_ += 4;
+                    break;
+                }
+                default: out->push_back(e); break;
+            }
+        }
+        return false;
+    }
+
+    const std::string& s_;
+    size_t pos_ = 0;
+};
+
+// Integer field written either as a number or as a decimal string ("device_id": "0").
+bool AsInt(const JsonValue* v, int* out) {
+    if (v == nullptr) {
+        return false;
+    }
+    if (v->type == JsonValue::Number) {
+        *out = static_cast<int>(v->number);
+        return true;
+    }
+    if (v->type != JsonValue::String || v->str.empty()) {
+        return false;
+    }
+    char* end = nullptr;
+    long n = std::strtol(v->str.c_str(), &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    *out = static_cast<int>(n);
+    return true;
+}
+
+}  // namespace
+
+bool RankTable::Load(const std::string& path, std::string* error) {
+    std::ifstream in(path);
+    if (!in) {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    return Parse(text.str(), error);
+}
+
+bool RankTable::Parse(const std::string& json, std::string* error) {
+    servers_.clear();
+    ranks_.clear();
+    JsonValue root;
+    if (!JsonParser(json).ParseDocument(&root, error)) {
+        return false;
+    }
+    const JsonValue* list = root.Find("server_list");
+    if (list == nullptr || list->type != JsonValue::Array) {
+        *error = "no server_list";
+        return false;
+    }
+    std::vector<RankPlacement> found;
+    for (const JsonValue& server : list->items) {
+        const JsonValue* id = server.Find("server_id");
+        const JsonValue* devices = server.Find("device");
+        if (id == nullptr || id->type != JsonValue::String || devices == nullptr ||
+            devices->type != JsonValue::Array) {
+            *error = "server without server_id or device list";
+            return false;
+        }
+        int index = static_cast<int>(servers_.size());
+        servers_.push_back(id->str);
+        for (const JsonValue& dev : devices->items) {
+            RankPlacement p;
+            p.server = index;
+            if (!AsInt(dev.Find("rank_id"), &p.rank) || !AsInt(dev.Find("device_id"), &p.device_id)) {
+                *error = "device without rank_id or device_id on server " + id->str;
+                return false;
+            }
+            if (!AsInt(dev.Find("numa_id"), &p.numa_node)) {
+                AsInt(dev.Find("numa_node"), &p.numa_node);
+            }
+            found.push_back(p);
+        }
+    }
+    // rank_id must cover 0..n-1 exactly once.
+    ranks_.assign(found.size(), RankPlacement());
+    for (const RankPlacement& p : found) {
+        if (p.rank < 0 || p.rank >= static_cast<int>(found.size()) || ranks_[static_cast<size_t>(p.rank)].rank >= 0) {
+            *error = "rank_id " + std::to_string(p.rank) + " is out of range or repeated";
+            ranks_.clear();
+            servers_.clear();
+            return false;
+        }
+        ranks_[static_cast<size_t>(p.rank)] = p;
+    }
+    if (ranks_.empty()) {
+        *error = "no devices";
+        servers_.clear();
+        return false;
+    }
+    return true;
+}
+
+NodeTopology RankTable::Topology(int r) const {
+    NodeTopology t;
+    int n = size();
+    std::vector<int> per_server(servers_.size(), 0);
+    int local_rank = 0;
+    for (const RankPlacement& p : ranks_) {
+        if (p.server == placement(r).server && p.rank < r) {
+            ++local_rank;
+        }
+        ++per_server[static_cast<size_t>(p.server)];
+    }
+    bool uniform = true;
+    for (int c : per_server) {
+        uniform = uniform && c == per_server[0];
+    }
+    if (servers_.size() < 2 || !uniform) {
+        t.local_rank = r;
+        t.local_size = n;
+        return t;
+    }
+    t.node_id = placement(r).server;
+    t.num_nodes = static_cast<int>(servers_.size());
+    t.local_rank = local_rank;
+    t.local_size = per_server[0];
+    return t;
+}
+
+std::vector<int> RankTable::GroupNuma(int r) const {
+    bool multi_node = Topology(r).IsMultiNode();
+    std::vector<int> nodes;
+    for (const RankPlacement& p : ranks_) {
+        if (!multi_node || p.server == placement(r).server) {
+            nodes.push_back(p.numa_node);
+        }
+    }
+    return nodes;
+}
+
+Hash128 RankTable::Digest() const {
+    SipHasher128 h;
+    h.UpdateString("ranktable");
+    h.UpdateU64(ranks_.size());
+    for (const RankPlacement& p : ranks_) {
+        h.UpdateString(servers_[static_cast<size_t>(p.server)]);
+        h.UpdateU64(static_cast<uint64_t>(static_cast<int64_t>(p.device_id)));
+    }
+    return h.Finalize();
+}
+
+}  // namespace ampccl
@@ -0,0 +1,54 @@
+#ifndef AMPCCL_CORE_RANK_TABLE_H_
+#define AMPCCL_CORE_RANK_TABLE_H_
+
+#include "core/topology.h"
+#include "common/hash.h"
+#include <string>
+#include <vector>
+
+namespace ampccl {
+
+// Placement of one communicator rank, from the rank table.
+struct RankPlacement {
+    int rank = -1;       // rank_id
+    int device_id = -1;  // NPU index on its server
+    int server = -1;     // Index into RankTable::servers()
+    int numa_node = -1;  // NUMA node of the device's PCIe root; -1 if the table has none
+};
+
+// Ascend rank table (the JSON file passed to HcclCommInitClusterInfo, usually also in
+// RANK_TABLE_FILE): versions 1.0 ("server_list") and 1.2 (adds "super_pod_list", which
+// is ignored). Numbers may be JSON strings, as HCCL writes them. The standard format
+// has no NUMA field; a per-device "numa_id" (or "numa_node") is read when a scheduler
+// adds one, otherwise numa_node stays -1.
+class RankTable {
+public:
+    // Parse a rank table file. On failure returns false and sets *error.
+    bool Load(const std::string& path, std::string* error);
+    bool Parse(const std::string& json, std::string* error);
+
+    int size() const { return static_cast<int>(ranks_.size()); }
+    const std::vector<std::string>& servers() const { return servers_; }
+    // Placement of rank r (ranks are dense 0..size()-1 after a successful parse).
+    const RankPlacement& placement(int r) const { return ranks_[static_cast<size_t>(r)]; }
+
+    // Node grouping of rank r: one node per server. Servers with different device
+    // counts have no common local_size, so the table is reported as a single node.
+    NodeTopology Topology(int r) const;
+
+    // NUMA node of every rank in r's node group (Topology(r)), in local-rank order: the
+    // placement of the PCCL ranks of r's domain (CommDomain::set_pcie_numa).
+    std::vector<int> GroupNuma(int r) const;
+
+    // Keyed digest of every rank's (server id, device id): identical for all ranks that
+    // read the same table, distinct for another device layout or server set.
+    Hash128 Digest() const;
+
+private:
+    std::vector<std::string> servers_;
+    std::vector<RankPlacement> ranks_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_RANK_TABLE_H_
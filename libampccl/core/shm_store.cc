@@ -1,15 +1,27 @@
 #include "shm_store.h"
+#include "common/config.h"
 #include "common/log.h"
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include <functional>
 #include <algorithm>
 
 #if defined(__linux__) || defined(__APPLE__)
+#include <dirent.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <cerrno>
 #endif
 
 namespace ampccl {
@@ -22,25 +34,112 @@ constexpr bool kShmAvailable = true;
 constexpr bool kShmAvailable = false;
 #endif
 
+#if defined(__linux__) || defined(__APPLE__)
+// Start time of pid in clock ticks since boot (field 22 of /proc/<pid>/stat), so a
+// recycled PID is not mistaken for the process that attached. 0 where /proc is missing.
+uint64_t ProcessStartTime(int pid) {
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(in, line)) {
+        return 0;
+    }
+    // comm (field 2) may contain spaces and parentheses: fields resume after the last ')'.
+    size_t paren = line.rfind(')');
+    if (paren == std::string::npos) {
+        return 0;
+    }
+    std::istringstream fields(line.substr(paren + 1));
+    std::string field;
+    for (int i = 3; i <= 22 && (fields >> field); ++i) {
+        if (i == 22) {
+            return std::strtoull(field.c_str(), nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+bool ProcessAlive(int pid, uint64_t start) {
+    if (pid <= 0 || (kill(pid, 0) != 0 && errno != EPERM)) {
+        return false;
+    }
+    return start == 0 || ProcessStartTime(pid) == start;
+}
+
+// Whether name still names the object open on fd (it may have been unlinked, and
+// possibly re-created, since fd was opened).
+bool NameRefersTo(const std::string& name, int fd) {
+    int cur = shm_open(name.c_str(), O_RDONLY, 0);
+    if (cur < 0) {
+        return false;
+    }
+    struct stat a;
+    struct stat b;
+    bool same = fstat(fd, &a) == 0 && fstat(cur, &b) == 0 && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+    close(cur);
+    return same;
+}
+
+// flock is advisory and released by the kernel when the holder dies. Where the shm
+// filesystem does not support it the protocol runs unlocked.
+void LockSegment(int fd) {
+    while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {
+    }
+}
+
+bool TryLockSegment(int fd) {
+    return flock(fd, LOCK_EX | LOCK_NB) == 0 || (errno != EWOULDBLOCK && errno != EINTR);
+}
+
+void UnlockSegment(int fd) {
+    flock(fd, LOCK_UN);
+}
+#else
+uint64_t ProcessStartTime(int) { return 0; }
+bool ProcessAlive(int, uint64_t) { return false; }
+#endif
+
 }  // namespace
 
 std::string ShmParamStore::ShmNameForKey(const CommDomainKey& key) {
-    size_t h = std::hash<CommDomainKey>{}(key);
     std::ostringstream os;
-    os << "/ampccl_" << std::hex << h;
+    os << kShmPrefix << 'u';
+#if defined(__linux__) || defined(__APPLE__)
+    os << static_cast<unsigned long>(getuid());
+#endif
+    if (!key.job.empty()) {
+        // Readable, bounded and free of '/' and the '_' separator; the digest covers the full id.
+        std::string job = key.job.substr(0, kMaxJobChars);
+        for (char& c : job) {
+            bool keep = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '.' ||
+                        c == '-';
+            if (!keep) {
+                c = '-';
+            }
+        }
+        os << '_' << job;
+    }
+    os << '_' << key.Digest().Hex();
     return os.str();
 }
 
-size_t ShmParamStore::ShmSize() const {
+size_t ShmParamStore::LogOffset() {
     size_t header = sizeof(Header);
     size_t stat_slots = static_cast<size_t>(kMaxRanks) * sizeof(StatSlot);
     size_t param_header = sizeof(uint64_t) + sizeof(uint32_t);  // version + num_entries
     size_t param_entries = static_cast<size_t>(kMaxParamEntries) * sizeof(ParamEntry);
-    return header + stat_slots + param_header + param_entries;
+    return (header + stat_slots + param_header + param_entries + 63) & ~static_cast<size_t>(63);
+}
+
+size_t ShmParamStore::ShmSize() {
+    return LogOffset() + sizeof(UpdateLog);
+}
+
+ShmParamStore::UpdateLog* ShmParamStore::Log() const {
+    return reinterpret_cast<UpdateLog*>(static_cast<char*>(base_) + LogOffset());
 }
 
 bool ShmParamStore::Attach(const CommDomainKey& key, int my_rank, int nranks) {
-    if (!kShmAvailable || nranks <= 0 || my_rank < 0 || my_rank >= nranks) {
+    if (!kShmAvailable || attach_failed_ || nranks <= 0 || my_rank < 0 || my_rank >= nranks) {
         return false;
     }
     if (nranks > kMaxRanks) {
@@ -53,33 +152,63 @@ bool ShmParamStore::Attach(const CommDomainKey& key, int my_rank, int nranks) {
     nranks_ = nranks;
 
 #if defined(__linux__) || defined(__APPLE__)
-    int flags = O_RDWR;
-    mode_t mode = 0666;
-    shm_fd_ = shm_open(name.c_str(), O_CREAT | O_RDWR, mode);
-    if (shm_fd_ < 0) {
-        AMPCCL_LOG(WARN, "ShmStore: shm_open %s failed", name.c_str());
-        return false;
+    static std::once_flag reclaim_once;
+    std::call_once(reclaim_once, [] { ReclaimStaleSegments(); });
+
+    // Same user only: the name carries the uid, and other users have no business here.
+    for (int attempt = 0;; ++attempt) {
+        shm_fd_ = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+        if (shm_fd_ < 0) {
+            AMPCCL_LOG(WARN, "ShmStore: shm_open %s failed", name.c_str());
+            return false;
+        }
+        LockSegment(shm_fd_);
+        if (NameRefersTo(name, shm_fd_)) {
+            break;
+        }
+        // Unlinked by its last user or a reclaimer between our open and lock: open the new one.
+        close(shm_fd_);
+        shm_fd_ = -1;
+        if (attempt == kAttachRetries) {
+            AMPCCL_LOG(WARN, "ShmStore: %s keeps being unlinked, shm disabled", name.c_str());
+            return false;
+        }
     }
+    // Closing the fd on a failure path below also releases the lock.
+    Hash128 owner = key.Digest();
+    bool foreign = false;  // Left in another layout by exited processes: rebuilt below
     struct stat st;
-    if (fstat(shm_fd_, &st) != 0) {
+    if (fstat(shm_fd_, &st) != 0 || st.st_size == 0) {
         if (ftruncate(shm_fd_, static_cast<off_t>(shm_size_)) != 0) {
             AMPCCL_LOG(WARN, "ShmStore: ftruncate failed");
             close(shm_fd_);
             shm_fd_ = -1;
             return false;
         }
-    } else if (st.st_size == 0) {
-        if (ftruncate(shm_fd_, static_cast<off_t>(shm_size_)) != 0) {
-            AMPCCL_LOG(WARN, "ShmStore: ftruncate failed");
+    } else if (static_cast<size_t>(st.st_size) != shm_size_) {
+        // Another AmpCCL version's layout (e.g. a job restarted after an upgrade).
+        Hash128 other;
+        int live = LiveAttachersOfOtherLayout(shm_fd_, static_cast<size_t>(st.st_size), &other);
+        foreign = live == 0 && ftruncate(shm_fd_, static_cast<off_t>(shm_size_)) == 0;
+        if (!foreign) {
+            if (live > 0) {
+                AMPCCL_LOG(ERROR, "ShmStore: %s has another layout (%zu bytes, expected %zu) and %d running "
+                           "user(s), owner %016llx%016llx%s; shm disabled for this domain", name.c_str(),
+                           static_cast<size_t>(st.st_size), shm_size_, live,
+                           static_cast<unsigned long long>(other.hi), static_cast<unsigned long long>(other.lo),
+                           other == owner ? " (this communicator)" : "");
+            } else {
+                AMPCCL_LOG(ERROR, "ShmStore: %s has another layout (%zu bytes, expected %zu) and cannot be "
+                           "reclaimed; shm disabled for this domain", name.c_str(),
+                           static_cast<size_t>(st.st_size), shm_size_);
+            }
             close(shm_fd_);
             shm_fd_ = -1;
+            attach_failed_ = true;
             return false;
         }
-    } else if (static_cast<size_t>(st.st_size) != shm_size_) {
-        AMPCCL_LOG(WARN, "ShmStore: size mismatch");
-        close(shm_fd_);
-        shm_fd_ = -1;
-        return false;
+        AMPCCL_LOG(INFO, "ShmStore: %s: reclaiming a segment of another layout (%zu bytes) left by exited "
+                   "processes", name.c_str(), static_cast<size_t>(st.st_size));
     }
     base_ = mmap(nullptr, shm_size_, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
     if (base_ == MAP_FAILED) {
@@ -90,12 +219,49 @@ bool ShmParamStore::Attach(const CommDomainKey& key, int my_rank, int nranks) {
         return false;
     }
     Header* hdr = static_cast<Header*>(base_);
-    if (hdr->magic != kMagic) {
-        hdr->magic = kMagic;
-        hdr->nranks = nranks;
-        hdr->param_version = 0;
-        hdr->pad = 0;
+    int pid = static_cast<int>(getpid());
+    if (foreign) {
+        InitSegment(owner, nranks, hdr->magic == kMagic ? hdr->generation + 1 : 1);
+    } else if (hdr->magic != kMagic) {
+        InitSegment(owner, nranks, 1);
+    } else {
+        bool collision = hdr->owner_lo != owner.lo || hdr->owner_hi != owner.hi || hdr->nranks != nranks;
+        const AttachRecord& mine = hdr->attached[my_rank];
+        if (!collision && PruneDeadAttachers(hdr) == 0) {
+            // Every earlier user has exited (clean exits unlink): whatever it holds was
+            // learned by another job, or left half-written by a crash.
+            AMPCCL_LOG(INFO, "ShmStore: %s: reclaiming stale generation %llu (creator pid %d exited)", name.c_str(),
+                       static_cast<unsigned long long>(hdr->generation), hdr->creator_pid);
+            InitSegment(owner, nranks, hdr->generation + 1);
+        } else if (collision || mine.pid != 0) {
+            if (collision) {
+                AMPCCL_LOG(ERROR, "ShmStore: %s belongs to another communicator (owner %016llx%016llx, nranks %d), "
+                           "shm disabled for this domain", name.c_str(), static_cast<unsigned long long>(hdr->owner_hi),
+                           static_cast<unsigned long long>(hdr->owner_lo), hdr->nranks);
+            } else {
+                AMPCCL_LOG(ERROR, "ShmStore: %s: rank %d is already attached by running pid %d, "
+                           "shm disabled for this domain", name.c_str(), my_rank, mine.pid);
+                if (my_rank == 0) {
+                    // The ranks that did attach would otherwise wait on the other pid's log.
+                    hdr->writer_refused.store(1, std::memory_order_release);
+                }
+            }
+            munmap(base_, shm_size_);
+            base_ = nullptr;
+            close(shm_fd_);
+            shm_fd_ = -1;
+            attach_failed_ = true;
+            return false;
+        }
     }
+    AttachRecord& rec = hdr->attached[my_rank];
+    rec.pid = pid;
+    rec.pad = 0;
+    rec.start = ProcessStartTime(pid);
+    hdr->refcount.fetch_add(1, std::memory_order_acq_rel);
+    generation_ = hdr->generation;
+    name_ = name;
+    UnlockSegment(shm_fd_);
     return true;
 #else
     (void)key;
@@ -103,9 +269,176 @@ bool ShmParamStore::Attach(const CommDomainKey& key, int my_rank, int nranks) {
 #endif
 }
 
+void ShmParamStore::InitSegment(const Hash128& owner, int nranks, uint64_t generation) {
+#if defined(__linux__) || defined(__APPLE__)
+    Header* hdr = static_cast<Header*>(base_);
+    // Readers (ampccl-top) skip the segment while magic is clear.
+    hdr->magic = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memset(static_cast<char*>(base_) + sizeof(hdr->magic), 0, shm_size_ - sizeof(hdr->magic));
+    hdr->nranks = nranks;
+    hdr->owner_lo = owner.lo;
+    hdr->owner_hi = owner.hi;
+    hdr->generation = generation;
+    hdr->creator_pid = static_cast<int32_t>(getpid());
+    hdr->creator_start = ProcessStartTime(hdr->creator_pid);
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = kMagic;
+#else
+    (void)owner;
+    (void)nranks;
+    (void)generation;
+#endif
+}
+
+int ShmParamStore::PruneDeadAttachers(Header* hdr) {
+    int live = 0;
+    for (AttachRecord& rec : hdr->attached) {
+        if (rec.pid == 0) {
+            continue;
+        }
+        if (ProcessAlive(rec.pid, rec.start)) {
+            ++live;
+        } else {
+            rec.pid = 0;
+            rec.start = 0;
+        }
+    }
+    hdr->refcount.store(static_cast<uint32_t>(live), std::memory_order_release);
+    return live;
+}
+
+int ShmParamStore::LiveAttachersOfOtherLayout(int fd, size_t size, Hash128* owner) {
+#if defined(__linux__) || defined(__APPLE__)
+    if (size < sizeof(Header)) {
+        return -1;
+    }
+    void* p = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        return -1;
+    }
+    const Header* hdr = static_cast<const Header*>(p);
+    int live = -1;
+    if (hdr->magic == 0) {
+        live = 0;  // Creator died before publishing the header (we hold its lock)
+    } else if (hdr->magic == kMagic && hdr->nranks > 0 && hdr->nranks <= kMaxRanks) {
+        owner->lo = hdr->owner_lo;
+        owner->hi = hdr->owner_hi;
+        live = CountLiveAttachers(hdr);
+    }
+    munmap(p, sizeof(Header));
+    return live;
+#else
+    (void)fd;
+    (void)size;
+    (void)owner;
+    return -1;
+#endif
+}
+
+int ShmParamStore::CountLiveAttachers(const Header* hdr) {
+    int live = 0;
+    for (const AttachRecord& rec : hdr->attached) {
+        live += rec.pid != 0 && ProcessAlive(rec.pid, rec.start) ? 1 : 0;
+    }
+    return live;
+}
+
+bool ShmParamStore::ReclaimIfStale(const std::string& name) {
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    // Held by someone attaching or detaching right now: not stale.
+    if (!TryLockSegment(fd)) {
+        close(fd);
+        return false;
+    }
+    size_t size = ShmSize();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0 || !NameRefersTo(name, fd)) {
+        close(fd);
+        return false;
+    }
+    if (static_cast<size_t>(st.st_size) != size) {
+        // Another AmpCCL layout: unlinked once its users are gone, as Attach would not use it.
+        Hash128 other;
+        bool stale = LiveAttachersOfOtherLayout(fd, static_cast<size_t>(st.st_size), &other) == 0;
+        if (stale) {
+            shm_unlink(name.c_str());
+        }
+        close(fd);
+        return stale;
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    Header* hdr = static_cast<Header*>(p);
+    // magic 0 under our lock: the creator died before publishing the header.
+    bool stale = hdr->magic == 0 || (hdr->magic == kMagic && CountLiveAttachers(hdr) == 0);
+    if (stale) {
+        hdr->magic = 0;
+        shm_unlink(name.c_str());
+    }
+    munmap(p, size);
+    close(fd);
+    return stale;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+int ShmParamStore::ReclaimStaleSegments() {
+    int reclaimed = 0;
+#if defined(__linux__)
+    std::string prefix = std::string(kShmPrefix + 1) + "u" + std::to_string(static_cast<unsigned long>(getuid())) + "_";
+    DIR* dir = opendir("/dev/shm");
+    if (dir == nullptr) {
+        return 0;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* e = readdir(dir)) {
+        if (std::strncmp(e->d_name, prefix.c_str(), prefix.size()) == 0) {
+            names.push_back(std::string("/") + e->d_name);
+        }
+    }
+    closedir(dir);
+    for (const std::string& name : names) {
+        if (ReclaimIfStale(name)) {
+            AMPCCL_LOG(DEBUG, "ShmStore: unlinked stale segment %s", name.c_str());
+            ++reclaimed;
+        }
+    }
+    if (reclaimed > 0) {
+        AMPCCL_LOG(INFO, "ShmStore: reclaimed %d stale segment(s) of exited processes", reclaimed);
+    }
+#endif
+    return reclaimed;
+}
+
 ShmParamStore::~ShmParamStore() {
+    Detach();
+}
+
+void ShmParamStore::Detach() {
 #if defined(__linux__) || defined(__APPLE__)
     if (base_ != nullptr && base_ != MAP_FAILED) {
+        LockSegment(shm_fd_);
+        Header* hdr = static_cast<Header*>(base_);
+        AttachRecord& rec = hdr->attached[my_rank_];
+        // A forked child inherits the mapping but not the attachment.
+        if (hdr->magic == kMagic && hdr->generation == generation_ && rec.pid == static_cast<int32_t>(getpid())) {
+            rec.pid = 0;
+            rec.start = 0;
+            if (hdr->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                hdr->magic = 0;
+                shm_unlink(name_.c_str());
+            }
+        }
         munmap(base_, shm_size_);
         base_ = nullptr;
     }
@@ -116,7 +449,7 @@ ShmParamStore::~ShmParamStore() {
 #endif
 }
 
-void ShmParamStore::WriteMyStat(int my_rank, const OpKey& op_key, const ExecStat& stat) {
+void ShmParamStore::WriteMyStat(int my_rank, const OpKey& op_key, const ExecStat& stat, uint64_t seq) {
     if (base_ == nullptr || my_rank < 0 || my_rank >= nranks_) {
         return;
     }
@@ -132,10 +465,12 @@ void ShmParamStore::WriteMyStat(int my_rank, const OpKey& op_key, const ExecStat
     slot->pcie_bytes = stat.pcie_bytes;
     slot->fast_success = stat.fast_success ? 1 : 0;
     slot->pcie_success = stat.pcie_success ? 1 : 0;
+    slot->seq = seq;
     slot->valid = 1;
 }
 
-bool ShmParamStore::ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* out_op_key) const {
+bool ShmParamStore::ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* out_op_key,
+                                             uint64_t* out_seq) const {
     if (base_ == nullptr || out_global_stat == nullptr || out_op_key == nullptr) {
         return false;
     }
@@ -143,6 +478,20 @@ bool ShmParamStore::ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* o
     p += sizeof(Header);
     StatSlot* slots = reinterpret_cast<StatSlot*>(p);
 
+    // Each slot holds its rank's latest stat, and ranks run at different points of the
+    // sequence: only slots of one collective are combined, the caller's own when it has
+    // one (unstamped slots, seq 0, combine with each other).
+    uint64_t ref_seq = 0;
+    if (my_rank_ >= 0 && my_rank_ < nranks_ && slots[my_rank_].valid != 0) {
+        ref_seq = slots[my_rank_].seq;
+    } else {
+        for (int r = 0; r < nranks_; ++r) {
+            if (slots[r].valid != 0 && slots[r].seq > ref_seq) {
+                ref_seq = slots[r].seq;
+            }
+        }
+    }
+
     double max_fast_time = 0.0;
     double max_pcie_time = 0.0;
     uint64_t fast_bytes = 0;
@@ -154,7 +503,7 @@ bool ShmParamStore::ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* o
 
     for (int r = 0; r < nranks_; ++r) {
         const StatSlot* s = &slots[r];
-        if (s->valid == 0) {
+        if (s->valid == 0 || s->seq != ref_seq) {
             continue;
         }
         any_valid = true;
@@ -188,9 +537,242 @@ bool ShmParamStore::ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* o
     out_global_stat->pcie_bytes = static_cast<size_t>(pcie_bytes);
     out_global_stat->fast_success = (fast_ok != 0);
     out_global_stat->pcie_success = (pcie_ok != 0);
+    if (out_seq != nullptr) {
+        *out_seq = ref_seq;
+    }
+    return true;
+}
+
+bool ShmParamStore::PublishUpdate(uint64_t seq, uint64_t lead, const OpKey& op_key, const ExecStat& stat,
+                                  uint64_t source_seq) {
+    if (base_ == nullptr || my_rank_ != 0 || source_seq + 1 <= published_source_) {
+        return false;
+    }
+    UpdateLog* log = Log();
+    uint64_t head = log->head.load(std::memory_order_relaxed);
+    uint64_t slowest = head;
+    for (int r = 0; r < nranks_; ++r) {
+        slowest = std::min(slowest, log->applied[r].load(std::memory_order_acquire));
+    }
+    if (head - slowest >= kUpdateRing) {
+        ++log_stats_.dropped;
+        return false;
+    }
+    UpdateRecord& rec = log->ring[head % kUpdateRing];
+    rec.apply_seq = seq + lead;
+    rec.stat.op = static_cast<int>(op_key.op);
+    rec.stat.bytes = static_cast<uint64_t>(op_key.bytes);
+    rec.stat.datatype = op_key.datatype;
+    rec.stat.fast_time = stat.fast_time;
+    rec.stat.pcie_time = stat.pcie_time;
+    rec.stat.fast_bytes = stat.fast_bytes;
+    rec.stat.pcie_bytes = stat.pcie_bytes;
+    rec.stat.fast_success = stat.fast_success ? 1 : 0;
+    rec.stat.pcie_success = stat.pcie_success ? 1 : 0;
+    rec.stat.valid = 1;
+    rec.stat.seq = source_seq;
+    log->head.store(head + 1, std::memory_order_release);
+    published_source_ = source_seq + 1;
+    return true;
+}
+
+void ShmParamStore::CloseThrough(uint64_t seq, uint64_t lead) {
+    if (base_ == nullptr || my_rank_ != 0) {
+        return;
+    }
+    // Later updates are stamped at least seq + 1 + lead, so collectives up to seq + lead are final.
+    std::atomic<uint64_t>& closed = Log()->closed;
+    if (closed.load(std::memory_order_relaxed) < seq + lead + 1) {
+        closed.store(seq + lead + 1, std::memory_order_release);
+    }
+}
+
+bool ShmParamStore::TakeUpdate(uint64_t seq, OpKey* op_key, ExecStat* stat) {
+    if (base_ == nullptr || op_key == nullptr || stat == nullptr) {
+        return false;
+    }
+    UpdateLog* log = Log();
+    if (log->closed.load(std::memory_order_acquire) <= seq) {
+        // Rank 0's host is more than lead collectives behind: wait for it to reach seq - lead.
+        auto start = std::chrono::steady_clock::now();
+        bool warned = false;
+        const char* writer_lost = nullptr;
+        for (int spins = 0; log->closed.load(std::memory_order_acquire) <= seq; ++spins) {
+            if (spins < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            if (spins % kWriterCheckSpins != 0) {
+                continue;
+            }
+            auto waited = std::chrono::steady_clock::now() - start;
+            writer_lost = WriterLost(std::chrono::duration_cast<std::chrono::milliseconds>(waited).count());
+            if (writer_lost != nullptr) {
+                break;
+            }
+            if (!warned && waited > std::chrono::seconds(10)) {
+                AMPCCL_LOG(WARN, "ShmStore: rank %d waiting >10s at collective %llu for rank 0 (closed %llu)",
+                           my_rank_, static_cast<unsigned long long>(seq),
+                           static_cast<unsigned long long>(log->closed.load(std::memory_order_relaxed)));
+                warned = true;
+            }
+        }
+        log_stats_.wait_ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now() - start).count());
+        if (writer_lost != nullptr) {
+            // Nothing will close seq: drop the scheme for this domain, so EnsureShmAttached
+            // does not re-attach and stats go to the local controller from now on.
+            AMPCCL_LOG(WARN, "ShmStore: %s: rank 0 %s, rank %d falls back to local parameter updates "
+                       "at collective %llu", name_.c_str(), writer_lost, my_rank_,
+                       static_cast<unsigned long long>(seq));
+            Detach();
+            attach_failed_ = true;
+            return false;
+        }
+    }
+    uint64_t taken = log_stats_.applied;
+    if (taken >= log->head.load(std::memory_order_acquire)) {
+        return false;
+    }
+    const UpdateRecord& rec = log->ring[taken % kUpdateRing];
+    if (rec.apply_seq > seq) {
+        return false;
+    }
+    op_key->op = static_cast<CollectiveType>(rec.stat.op);
+    op_key->bytes = static_cast<size_t>(rec.stat.bytes);
+    op_key->datatype = rec.stat.datatype;
+    stat->fast_time = rec.stat.fast_time;
+    stat->pcie_time = rec.stat.pcie_time;
+    stat->fast_bytes = static_cast<size_t>(rec.stat.fast_bytes);
+    stat->pcie_bytes = static_cast<size_t>(rec.stat.pcie_bytes);
+    stat->fast_success = rec.stat.fast_success != 0;
+    stat->pcie_success = rec.stat.pcie_success != 0;
+    uint64_t lag = rec.apply_seq > rec.stat.seq ? rec.apply_seq - rec.stat.seq : 0;
+    log_stats_.lag_sum += lag;
+    log_stats_.lag_max = std::max(log_stats_.lag_max, lag);
+    log->applied[my_rank_].store(++log_stats_.applied, std::memory_order_release);
     return true;
 }
 
+const char* ShmParamStore::WriterLost(int64_t waited_ms) const {
+    const Header* hdr = static_cast<const Header*>(base_);
+    if (hdr->writer_refused.load(std::memory_order_acquire) != 0) {
+        return "was refused the segment";
+    }
+    const AttachRecord& writer = hdr->attached[0];
+    int32_t pid = writer.pid;
+    if (pid == 0) {
+        // Rank 0 may still be on its way to its first collective.
+        static const int64_t grace_ms = Config::GetParamWriterWaitMs();
+        return waited_ms >= grace_ms ? "never attached" : nullptr;
+    }
+    return ProcessAlive(pid, writer.start) ? nullptr : "exited";
+}
+
+void ShmParamStore::MarkPCIeReady(bool ok) {
+    if (base_ == nullptr) {
+        return;
+    }
+    Log()->pcie_ready[my_rank_].store(ok ? kPCIeReady : kPCIeFailed, std::memory_order_release);
+}
+
+void ShmParamStore::AnnouncePCIe(uint64_t seq, uint64_t lead) {
+    if (base_ == nullptr || my_rank_ != 0) {
+        return;
+    }
+    UpdateLog* log = Log();
+    if (log->pcie_enable.load(std::memory_order_relaxed) != 0) {
+        return;
+    }
+    for (int r = 0; r < nranks_; ++r) {
+        if (log->pcie_ready[r].load(std::memory_order_acquire) != kPCIeReady) {
+            return;
+        }
+    }
+    // Published before CloseThrough(seq, lead) releases collective seq + lead.
+    log->pcie_enable.store(seq + lead + 1, std::memory_order_relaxed);
+}
+
+bool ShmParamStore::PCIeEnabledAt(uint64_t seq) const {
+    if (base_ == nullptr) {
+        return false;
+    }
+    uint64_t enable = Log()->pcie_enable.load(std::memory_order_acquire);
+    return enable != 0 && seq + 1 >= enable;
+}
+
+void ShmParamStore::MarkPCIeLost() {
+    if (base_ == nullptr) {
+        return;
+    }
+    Log()->pcie_lost.store(1, std::memory_order_release);
+}
+
+void ShmParamStore::AnnouncePCIeLoss(uint64_t seq, uint64_t lead) {
+    if (base_ == nullptr || my_rank_ != 0) {
+        return;
+    }
+    UpdateLog* log = Log();
+    if (log->pcie_disable.load(std::memory_order_relaxed) != 0 ||
+        log->pcie_lost.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    // Published before CloseThrough(seq, lead) releases collective seq + lead.
+    log->pcie_disable.store(seq + lead + 1, std::memory_order_relaxed);
+}
+
+bool ShmParamStore::PCIeDisabledAt(uint64_t seq) const {
+    if (base_ == nullptr) {
+        return false;
+    }
+    uint64_t disable = Log()->pcie_disable.load(std::memory_order_acquire);
+    return disable != 0 && seq + 1 >= disable;
+}
+
+void ShmParamStore::PublishSeeds(const ParamCache& cache) {
+    if (base_ == nullptr || my_rank_ != 0 || seeds_synced_) {
+        return;
+    }
+    std::vector<std::pair<int, ParamValue>> seeds;
+    cache.GetAllSeeds(&seeds);
+    UpdateLog* log = Log();
+    size_t n = std::min(seeds.size(), static_cast<size_t>(kNumOpBuckets));
+    for (size_t i = 0; i < n; ++i) {
+        SeedRow& row = log->seeds[i];
+        std::memset(&row, 0, sizeof(row));
+        row.bucket = seeds[i].first;
+        row.use_pcie = seeds[i].second.use_pcie ? 1 : 0;
+        row.alpha = seeds[i].second.alpha;
+        row.fast_bw = seeds[i].second.fast_bw;
+        row.pcie_bw = seeds[i].second.pcie_bw;
+    }
+    // Released to the other ranks by CloseThrough's store of closed.
+    log->num_seeds = static_cast<uint32_t>(n);
+    seeds_synced_ = true;
+}
+
+void ShmParamStore::AdoptSeeds(ParamCache* cache) {
+    if (base_ == nullptr || my_rank_ == 0 || seeds_synced_ || cache == nullptr) {
+        return;
+    }
+    const UpdateLog* log = Log();
+    uint32_t n = std::min(log->num_seeds, static_cast<uint32_t>(kNumOpBuckets));
+    std::vector<std::pair<int, ParamValue>> seeds;
+    seeds.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const SeedRow& row = log->seeds[i];
+        seeds.emplace_back(row.bucket, ParamValue(row.alpha, row.use_pcie != 0, row.fast_bw, row.pcie_bw));
+    }
+    size_t own = cache->NumSeeds();
+    cache->SetSeeds(seeds);
+    if (own != seeds.size()) {
+        AMPCCL_LOG(INFO, "ShmStore: rank %d replaced its %zu profile seeds with rank 0's %zu", my_rank_, own,
+                   seeds.size());
+    }
+    seeds_synced_ = true;
+}
+
 void ShmParamStore::ReadParams(ParamCache* cache) const {
     if (base_ == nullptr || cache == nullptr) {
         return;
@@ -209,6 +791,15 @@ void ShmParamStore::ReadParams(ParamCache* cache) const {
     snapshot.reserve(n);
     for (uint32_t i = 0; i < n; ++i) {
         const ParamEntry& e = entries[i];
+        if (e.op == kPCIeGateRowOp) {
+            cache->SetPCIeAllowed(e.bytes != 0);
+            continue;
+        }
+        if (e.op >= kCrossoverRowOp) {
+            cache->SetCrossover(static_cast<CollectiveType>(e.op - kCrossoverRowOp), e.datatype,
+                                static_cast<int>(e.bytes));
+            continue;
+        }
         OpKey key;
         key.op = static_cast<CollectiveType>(e.op);
         key.bytes = static_cast<size_t>(e.bytes);
@@ -221,14 +812,96 @@ void ShmParamStore::ReadParams(ParamCache* cache) const {
     (void)pver;
 }
 
+bool ShmParamStore::Inspect(const std::string& name, SegmentView* out) {
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size = ShmSize();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != size) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    const Header* hdr = static_cast<const Header*>(p);
+    if (hdr->magic != kMagic || hdr->nranks <= 0 || hdr->nranks > kMaxRanks) {
+        munmap(p, size);
+        return false;
+    }
+    out->nranks = hdr->nranks;
+    out->owner.lo = hdr->owner_lo;
+    out->owner.hi = hdr->owner_hi;
+    out->generation = hdr->generation;
+    out->creator_pid = hdr->creator_pid;
+    out->attached = static_cast<int>(hdr->refcount.load(std::memory_order_acquire));
+    out->live = CountLiveAttachers(hdr);
+    const char* base = static_cast<const char*>(p);
+    const StatSlot* slots = reinterpret_cast<const StatSlot*>(base + sizeof(Header));
+    out->stats.clear();
+    for (int r = 0; r < hdr->nranks; ++r) {
+        const StatSlot& s = slots[r];
+        if (s.valid == 0) {
+            continue;
+        }
+        RankStatView v;
+        v.rank = r;
+        v.op_key.op = static_cast<CollectiveType>(s.op);
+        v.op_key.bytes = static_cast<size_t>(s.bytes);
+        v.op_key.datatype = s.datatype;
+        v.stat.fast_time = s.fast_time;
+        v.stat.pcie_time = s.pcie_time;
+        v.stat.fast_bytes = static_cast<size_t>(s.fast_bytes);
+        v.stat.pcie_bytes = static_cast<size_t>(s.pcie_bytes);
+        v.stat.fast_success = s.fast_success != 0;
+        v.stat.pcie_success = s.pcie_success != 0;
+        out->stats.push_back(v);
+    }
+    size_t off = sizeof(Header) + static_cast<size_t>(kMaxRanks) * sizeof(StatSlot);
+    out->param_version = *reinterpret_cast<const uint64_t*>(base + off);
+    const UpdateLog* log = reinterpret_cast<const UpdateLog*>(base + LogOffset());
+    out->updates = log->head.load(std::memory_order_acquire);
+    out->closed_seq = log->closed.load(std::memory_order_acquire);
+    out->pcie_enable = log->pcie_enable.load(std::memory_order_acquire);
+    out->pcie_disable = log->pcie_disable.load(std::memory_order_acquire);
+
+    // Decode the param table the same way the ranks do.
+    ParamCache cache;
+    ShmParamStore reader;
+    reader.base_ = p;
+    reader.ReadParams(&cache);
+    reader.base_ = nullptr;
+    munmap(p, size);
+    cache.GetAll(&out->params);
+    cache.GetAllCrossovers(&out->crossovers);
+    out->pcie_allowed = cache.PCIeAllowed();
+    return true;
+#else
+    (void)name;
+    (void)out;
+    return false;
+#endif
+}
+
 void ShmParamStore::WriteParams(const ParamCache& cache) {
     if (base_ == nullptr) {
         return;
     }
     std::vector<std::pair<OpKey, ParamValue>> snapshot;
     cache.GetAll(&snapshot);
-    if (snapshot.size() > static_cast<size_t>(kMaxParamEntries)) {
-        snapshot.resize(kMaxParamEntries);
+    std::vector<std::tuple<CollectiveType, int, int>> crossovers;
+    cache.GetAllCrossovers(&crossovers);
+    const size_t max_rows = static_cast<size_t>(kMaxParamEntries) - 1;  // Last row: PCIe gate
+    if (crossovers.size() > max_rows) {
+        crossovers.resize(max_rows);
+    }
+    if (snapshot.size() + crossovers.size() > max_rows) {
+        snapshot.resize(max_rows - crossovers.size());
     }
     char* p = static_cast<char*>(base_);
     size_t off = sizeof(Header) + static_cast<size_t>(kMaxRanks) * sizeof(StatSlot);
@@ -236,7 +909,6 @@ void ShmParamStore::WriteParams(const ParamCache& cache) {
     uint32_t* pnum = reinterpret_cast<uint32_t*>(p + off + sizeof(uint64_t));
     ParamEntry* entries = reinterpret_cast<ParamEntry*>(p + off + sizeof(uint64_t) + sizeof(uint32_t));
 
-    *pnum = static_cast<uint32_t>(snapshot.size());
     for (size_t i = 0; i < snapshot.size(); ++i) {
         const auto& kv = snapshot[i];
         ParamEntry& e = entries[i];
@@ -249,6 +921,20 @@ void ShmParamStore::WriteParams(const ParamCache& cache) {
         e.fast_bw = kv.second.fast_bw;
         e.pcie_bw = kv.second.pcie_bw;
     }
+    // Crossover rows: op = kCrossoverRowOp + op, bytes = boundary size class.
+    for (size_t i = 0; i < crossovers.size(); ++i) {
+        ParamEntry& e = entries[snapshot.size() + i];
+        std::memset(&e, 0, sizeof(e));
+        e.op = kCrossoverRowOp + static_cast<int>(std::get<0>(crossovers[i]));
+        e.datatype = std::get<1>(crossovers[i]);
+        e.bytes = static_cast<uint64_t>(std::get<2>(crossovers[i]));
+    }
+    // Gate row: bytes = 1 while PCIe may be used (breaker not open).
+    ParamEntry& gate = entries[snapshot.size() + crossovers.size()];
+    std::memset(&gate, 0, sizeof(gate));
+    gate.op = kPCIeGateRowOp;
+    gate.bytes = cache.PCIeAllowed() ? 1 : 0;
+    *pnum = static_cast<uint32_t>(snapshot.size() + crossovers.size() + 1);
     (*pver)++;
 }
 
@@ -5,18 +5,35 @@
 #include "common/op_key.h"
 #include "cache/param_cache.h"
 #include "telemetry/stats.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace ampccl {
 
-// Shared-memory store for multi-rank: per-rank stat slots + single param table.
-// Only rank 0 writes params; all ranks read params. Each rank writes its own stat at SyncStream;
-// rank 0 aggregates at next collective entry and writes params.
+// Shared-memory store for multi-rank: per-rank stat slots, an update log and a param table.
+// Each rank writes its own stat at SyncStream. Rank 0 aggregates them at the next collective
+// entry and appends the result to the update log, stamped with the collective sequence
+// number at which it takes effect (its own seq + Config::GetParamLead()). Every rank,
+// rank 0 included, feeds each update to its own controller when its seq reaches that
+// stamp, so all controllers see the same updates at the same collective and produce the
+// same splits (the determinism scheme B relies on). The param table is rank 0's view,
+// published for monitoring (ampccl-top).
+//
+// Lifecycle: attach, detach and reclamation hold flock() on the segment, which the kernel
+// drops if the holder dies. Each rank records its PID and process start time in the
+// header and bumps an attach refcount; the last detach unlinks the segment. A segment
+// whose attachers have all exited (a crashed or killed job) is never reused as is: the
+// first attach wipes it and bumps its generation, and each process's first attach also
+// unlinks this user's other dead segments (ReclaimStaleSegments).
 class ShmParamStore {
 public:
     ShmParamStore() = default;
+    // Detaches: the last rank attached unlinks the segment.
     ~ShmParamStore();
 
     // Non-copyable
@@ -24,15 +41,71 @@ public:
     ShmParamStore& operator=(const ShmParamStore&) = delete;
 
     // Create or attach to shared segment for this key. my_rank/nranks from domain (e.g. pcie_rank/pcie_nranks).
-    // Returns true on success.
+    // Returns true on success; false also if another live process holds my_rank of the segment.
     bool Attach(const CommDomainKey& key, int my_rank, int nranks);
 
-    // Write this rank's stat (called at SyncStream). Only this rank's slot is written.
-    void WriteMyStat(int my_rank, const OpKey& op_key, const ExecStat& stat);
+    // Unlink this user's param segments whose attachers have all exited, skipping any
+    // segment another process holds locked. Returns the number removed. Run once per
+    // process by the first Attach.
+    static int ReclaimStaleSegments();
 
-    // Rank 0 only: read all slots, aggregate (max fast_time, max pcie_time), fill out_global_stat and out_op_key.
-    // Returns true if at least one slot was valid.
-    bool ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* out_op_key) const;
+    // Write this rank's stat (called at SyncStream) of collective seq. Only this rank's slot is written.
+    void WriteMyStat(int my_rank, const OpKey& op_key, const ExecStat& stat, uint64_t seq = 0);
+
+    // Rank 0 only: read the slots of one collective (this rank's latest, else the newest), aggregate
+    // (max fast_time, max pcie_time), fill out_global_stat, out_op_key and out_seq (optional, the
+    // collective's seq). Ranks that have not reached it yet are left out. Returns true if any slot matched.
+    bool ReadAllStatsAndAggregate(ExecStat* out_global_stat, OpKey* out_op_key, uint64_t* out_seq = nullptr) const;
+
+    // Rank 0, at the entry of collective seq: append an aggregated stat that every rank applies
+    // at seq + lead. Skipped (false) if no slot is newer than the last published update, or if
+    // the slowest rank has not yet applied the update kUpdateRing entries back.
+    bool PublishUpdate(uint64_t seq, uint64_t lead, const OpKey& op_key, const ExecStat& stat, uint64_t source_seq);
+
+    // Rank 0, at the entry of collective seq (after PublishUpdate): every update that applies
+    // at or before seq + lead is in the log.
+    void CloseThrough(uint64_t seq, uint64_t lead);
+
+    // All ranks, at the entry of collective seq: the next update in force at seq, in
+    // publication order; false once none is left. Waits until rank 0 has closed seq, which
+    // couples this rank to rank 0's host only when it runs more than lead collectives ahead.
+    // If rank 0 has exited, or has not attached within Config::GetParamWriterWaitMs(), the
+    // store detaches for good (IsAttached() turns false) and returns false.
+    bool TakeUpdate(uint64_t seq, OpKey* op_key, ExecStat* stat);
+
+    // Lazy PCCL setup (Config::IsPCIeInitLazy). Each rank reports the outcome of its
+    // background pcclInit once; rank 0, at the entry of collective seq (before CloseThrough),
+    // stamps seq + lead as the first collective to use PCIe once every rank reported
+    // success, and never if any rank failed. PCIeEnabledAt is final for a seq once
+    // TakeUpdate(seq) has returned, so all ranks switch at the same collective.
+    void MarkPCIeReady(bool ok);
+    void AnnouncePCIe(uint64_t seq, uint64_t lead);
+    bool PCIeEnabledAt(uint64_t seq) const;
+
+    // PCIe loss (CommDomain::QuarantinePCIe): any rank flags it; rank 0, at the entry of
+    // collective seq (before CloseThrough), stamps seq + lead as the first collective
+    // without splits. PCIeDisabledAt is final for a seq once TakeUpdate(seq) has
+    // returned, so all ranks stop splitting at the same collective.
+    void MarkPCIeLost();
+    void AnnouncePCIeLoss(uint64_t seq, uint64_t lead);
+    bool PCIeDisabledAt(uint64_t seq) const;
+
+    // Profile warm start (ParamCache seeds): rank 0 writes its seeds into the log once,
+    // before its first CloseThrough; every other rank replaces its own with them once,
+    // after its first TakeUpdate. Ranks whose profile files or fingerprints differ thus
+    // still plan from the same seeds.
+    void PublishSeeds(const ParamCache& cache);
+    void AdoptSeeds(ParamCache* cache);
+
+    // Update log counters of this rank.
+    struct LogStats {
+        uint64_t applied = 0;   // Updates taken (fed to the controller)
+        uint64_t lag_sum = 0;   // Sum of (apply seq - newest source collective seq) over them
+        uint64_t lag_max = 0;
+        uint64_t dropped = 0;   // Rank 0: updates skipped because a rank lagged kUpdateRing behind
+        uint64_t wait_ns = 0;   // Time spent in TakeUpdate waiting for rank 0
+    };
+    const LogStats& log_stats() const { return log_stats_; }
 
     // Read param table from shm into cache (all ranks).
     void ReadParams(ParamCache* cache) const;
@@ -40,14 +113,56 @@ public:
     // Rank 0 only: write cache to shm.
     void WriteParams(const ParamCache& cache);
 
+    // Read-only copy of a segment for monitoring tools (ampccl-top).
+    struct RankStatView {
+        int rank;
+        OpKey op_key;
+        ExecStat stat;   // Last stat this rank wrote
+    };
+    struct SegmentView {
+        int nranks = 0;
+        Hash128 owner;             // Digest of the key that created the segment
+        uint64_t generation = 0;   // Times the segment was (re)initialized
+        int creator_pid = 0;       // Process that initialized the current generation
+        int attached = 0;          // Attach refcount
+        int live = 0;              // Attached ranks whose process is still running
+        uint64_t param_version = 0;
+        uint64_t updates = 0;      // Update log entries published by rank 0
+        uint64_t closed_seq = 0;   // Collectives whose updates are all published
+        uint64_t pcie_enable = 0;  // 1 + first collective on PCIe after lazy setup; 0 = not yet
+        uint64_t pcie_disable = 0; // 1 + first fast-only collective after a PCIe loss; 0 = none
+        std::vector<RankStatView> stats;  // Ranks with a valid slot
+        std::vector<std::pair<OpKey, ParamValue>> params;
+        std::vector<std::tuple<CollectiveType, int, int>> crossovers;
+        bool pcie_allowed = true;
+    };
+
+    // Map shm segment `name` (e.g. "/ampccl_u1000_1f2e...") read-only and copy it out.
+    // Returns false if it is missing or not an AmpCCL param segment.
+    static bool Inspect(const std::string& name, SegmentView* out);
+    static constexpr const char* kShmPrefix = "/ampccl_";
+
+    // Segment name for a communicator key: kShmPrefix + "u<uid>" + "_<job>" (if the key
+    // has one, sanitized) + "_" + the key's 128-bit digest, so users and jobs sharing a
+    // node never open each other's segments. The header records the digest as well.
+    static std::string ShmNameForKey(const CommDomainKey& key);
+
     bool IsAttached() const { return base_ != nullptr; }
     int Nranks() const { return nranks_; }
     bool IsRank0() const { return my_rank_ == 0; }
 
 private:
-    static constexpr uint64_t kMagic = 0x414d5043434c5f53u;  // "AMPCCL_S"
+    static constexpr uint64_t kMagic = 0x414d5043434c5f58u;  // "AMPCCL_X"
+    static constexpr int kAttachRetries = 8;       // Segment unlinked between shm_open and flock
+    static constexpr int kWriterCheckSpins = 1024; // TakeUpdate waits between rank 0 liveness checks
     static constexpr int kMaxRanks = 128;
+    static constexpr uint64_t kUpdateRing = 64;
+    static constexpr uint64_t kPCIeReady = 1;
+    static constexpr uint64_t kPCIeFailed = 2;
     static constexpr int kMaxParamEntries = 512;
+    static constexpr size_t kMaxJobChars = 48;     // Job id characters kept in the segment name
+    static constexpr int kCrossoverRowOp = 0x100;  // ParamEntry.op marker for crossover rows
+    static constexpr int kPCIeGateRowOp = 0x200;   // ParamEntry.op marker for the breaker gate row
 
 #pragma pack(push, 1)
     struct StatSlot {
@@ -62,8 +177,9 @@ private:
         uint8_t pcie_success;
         uint8_t valid;    // 1 = written
         uint8_t padding[5];
+        uint64_t seq;     // Collective sequence number the stat belongs to
     };
-    static_assert(sizeof(StatSlot) == 56, "StatSlot size");
+    static_assert(sizeof(StatSlot) == 64, "StatSlot size");
 
     struct ParamEntry {
         int op;
@@ -77,22 +193,93 @@ private:
     };
     static_assert(sizeof(ParamEntry) >= 44 && sizeof(ParamEntry) <= 56, "ParamEntry size");
 
+    struct UpdateRecord {
+        uint64_t apply_seq;   // First collective seq the update is in force for
+        StatSlot stat;        // Aggregated stat and its op key (seq = newest source collective)
+    };
+
+    struct SeedRow {
+        int32_t bucket;       // OpBucketOf
+        uint8_t use_pcie;
+        uint8_t pad[3];
+        double alpha;
+        double fast_bw;
+        double pcie_bw;
+    };
+#pragma pack(pop)
+
+    // One attached rank. pid 0 = slot free; start tells a reused PID from the original.
+    struct AttachRecord {
+        int32_t pid;
+        uint32_t pad;
+        uint64_t start;       // Process start time (clock ticks since boot), 0 if unknown
+    };
+
+    // Written under the segment lock, except magic, which lock-free readers check last.
     struct Header {
         uint64_t magic;
         int nranks;
-        uint32_t param_version;
+        std::atomic<uint32_t> writer_refused;  // A rank 0 was refused (slot held): stop waiting for it
+        uint64_t owner_lo;    // CommDomainKey::Digest() of the creator; Attach refuses
+        uint64_t owner_hi;    // a segment whose owner is another key
+        uint64_t generation;  // Bumped when a stale segment is wiped for reuse
+        int32_t creator_pid;
+        uint32_t pad2;
+        uint64_t creator_start;
+        std::atomic<uint32_t> refcount;  // Non-free entries of attached
+        uint32_t pad3;
+        AttachRecord attached[kMaxRanks];  // Indexed by rank
+    };
+
+    // Update log, after the param table (8-byte aligned). head and closed only grow;
+    // applied[r] is the number of log entries rank r has fed to its controller.
+    struct UpdateLog {
+        std::atomic<uint64_t> closed;   // Collectives [0, closed) have all their updates in ring
+        std::atomic<uint64_t> head;     // Entries published
+        std::atomic<uint64_t> applied[kMaxRanks];
+        std::atomic<uint64_t> pcie_enable;            // 1 + enable seq; 0 = not (yet) enabled
+        std::atomic<uint64_t> pcie_ready[kMaxRanks];  // kPCIeReady / kPCIeFailed once reported
+        std::atomic<uint64_t> pcie_lost;              // 1 once any rank quarantined its PCCL
+        std::atomic<uint64_t> pcie_disable;           // 1 + first fast-only seq; 0 = none
+        UpdateRecord ring[kUpdateRing];
+        uint32_t num_seeds;                 // Rank 0's warm-start seeds, written before closed > 0
         uint32_t pad;
+        SeedRow seeds[kNumOpBuckets];
     };
-#pragma pack(pop)
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "process-shared counters need lock-free atomics");
 
-    static std::string ShmNameForKey(const CommDomainKey& key);
-    size_t ShmSize() const;
+    static size_t LogOffset();
+    static size_t ShmSize();
+    UpdateLog* Log() const;
+    // Zero the whole segment and publish a fresh header (segment lock held).
+    void InitSegment(const Hash128& owner, int nranks, uint64_t generation);
+    // Clear the records of exited processes and reset refcount; returns the live count.
+    static int PruneDeadAttachers(Header* hdr);
+    static int CountLiveAttachers(const Header* hdr);
+    static bool ReclaimIfStale(const std::string& name);
+    // A segment of size bytes other than ShmSize() (another AmpCCL layout; the Header is
+    // common to all of them), segment lock held: its live attachers, 0 if its creator
+    // died before publishing the header, or -1 if the header cannot be read. *owner gets
+    // the header's owner when it is published.
+    static int LiveAttachersOfOtherLayout(int fd, size_t size, Hash128* owner);
+    // Drop this rank's attachment and unmap; the last rank attached unlinks the segment.
+    void Detach();
+    // TakeUpdate, waiting waited_ms for rank 0: why it will never close the log (its
+    // process exited, its attach was refused, or it did not attach within
+    // Config::GetParamWriterWaitMs()), or nullptr while it still may.
+    const char* WriterLost(int64_t waited_ms) const;
 
     void* base_ = nullptr;
     size_t shm_size_ = 0;
     int my_rank_ = -1;
     int nranks_ = 0;
     int shm_fd_ = -1;
+    std::string name_;
+    uint64_t generation_ = 0;        // Header generation this store attached to
+    bool attach_failed_ = false;     // Collision or a live foreign layout: stop retrying at every collective
+    bool seeds_synced_ = false;      // PublishSeeds / AdoptSeeds done
+    uint64_t published_source_ = 0;  // Rank 0: 1 + newest source seq already published
+    LogStats log_stats_;
 };
 
 }  // namespace ampccl
@@ -0,0 +1,265 @@
+#include "stat_reducer.h"
+#include "domain.h"
+#include "group_scope.h"
+#include "common/log.h"
+#include <limits>
+#include <utility>
+
+namespace ampccl {
+
+StatReducer::~StatReducer() {
+    if (in_flight_) {
+        FinishRound(nullptr);
+    }
+    if (scratch_ != nullptr && ops_.release != nullptr) {
+        ops_.release(scratch_);
+    }
+    scratch_ = nullptr;
+}
+
+void StatReducer::Configure(const StatReduceOps& ops, void* raw_comm, int interval) {
+    std::lock_guard<std::mutex> lock(mu_);
+    ops_ = ops;
+    raw_comm_ = raw_comm;
+    interval_ = interval > 0 ? interval : 1;
+    calls_ = 0;
+    ClearWindow();
+}
+
+void StatReducer::DetachComm(void* raw_comm) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (raw_comm_ != raw_comm || !IsEnabled()) {
+        return;
+    }
+    // The round in flight runs on raw_comm: let it finish before the comm goes away.
+    if (in_flight_) {
+        FinishRound(nullptr);
+    }
+    if (scratch_ != nullptr && ops_.release != nullptr) {
+        ops_.release(scratch_);
+    }
+    scratch_ = nullptr;
+    ops_ = StatReduceOps();
+    raw_comm_ = nullptr;
+}
+
+void StatReducer::ClearWindow() {
+    sum_fast_time_.fill(0.0);
+    sum_pcie_time_.fill(0.0);
+    count_.fill(0);
+    failed_.fill(0);
+    pcie_failed_.fill(0);
+    last_fast_bytes_.fill(0);
+    last_pcie_bytes_.fill(0);
+    last_op_bytes_.fill(0);
+    last_datatype_.fill(0);
+}
+
+void StatReducer::Record(const OpKey& op_key, const ExecStat& stat) {
+    int b = OpBucketOf(op_key);
+    std::lock_guard<std::mutex> lock(mu_);
+    sum_fast_time_[b] += stat.fast_time;
+    sum_pcie_time_[b] += stat.pcie_time;
+    count_[b]++;
+    if (!stat.fast_success) {
+        failed_[b] = 1;
+    }
+    if (!stat.pcie_success) {
+        pcie_failed_[b] = 1;
+    }
+    last_fast_bytes_[b] = stat.fast_bytes;
+    last_pcie_bytes_[b] = stat.pcie_bytes;
+    last_op_bytes_[b] = op_key.bytes;
+    last_datatype_[b] = op_key.datatype;
+}
+
+void StatReducer::MarkInUseLocked(int bucket) {
+    if (!in_use_[bucket]) {
+        in_use_[bucket] = 1;
+        used_.push_back(bucket);
+    }
+}
+
+void StatReducer::MarkInUse(const OpKey& op_key) {
+    if (!IsEnabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    MarkInUseLocked(OpBucketOf(op_key));
+}
+
+void StatReducer::Pack(size_t n, double* out) const {
+    for (size_t i = 0; i < n; ++i) {
+        int b = used_[i];
+        double* f = out + i * kNumFields;
+        if (count_[b] == 0) {
+            for (int i = 0; i < kNumFields; ++i) f[i] = 0.0;
+            continue;
+        }
+        f[kFastTime] = sum_fast_time_[b] / count_[b];
+        f[kPCIeTime] = sum_pcie_time_[b] / count_[b];
+        f[kFastBytes] = static_cast<double>(last_fast_bytes_[b]);
+        f[kPCIeBytes] = static_cast<double>(last_pcie_bytes_[b]);
+        f[kOpBytes] = static_cast<double>(last_op_bytes_[b]);
+        f[kDatatype] = static_cast<double>(last_datatype_[b]);
+        f[kFailed] = failed_[b] ? 1.0 : 0.0;
+        f[kPCIeFailed] = pcie_failed_[b] ? 1.0 : 0.0;
+        f[kNegHasSample] = -1.0;
+    }
+}
+
+void StatReducer::Apply(const double* reduced, size_t n, CommDomain* domain) const {
+    for (size_t i = 0; i < n; ++i) {
+        int b = used_[i];
+        const double* f = reduced + i * kNumFields;
+        if (f[kNegHasSample] != -1.0) {
+            continue;  // Some rank has no sample for this bucket in the window
+        }
+        OpKey op_key;
+        op_key.op = static_cast<CollectiveType>(b / kNumSizeClasses);
+        op_key.bytes = static_cast<size_t>(f[kOpBytes]);
+        op_key.datatype = static_cast<int>(f[kDatatype]);
+        ExecStat stat;
+        stat.fast_time = f[kFastTime];
+        stat.pcie_time = f[kPCIeTime];
+        stat.fast_bytes = static_cast<size_t>(f[kFastBytes]);
+        stat.pcie_bytes = static_cast<size_t>(f[kPCIeBytes]);
+        stat.fast_success = f[kFailed] == 0.0;
+        stat.pcie_success = f[kPCIeFailed] == 0.0;
+        domain->controller->Update(op_key, stat, domain->param_cache);
+    }
+}
+
+void StatReducer::SyncSeeds(CommDomain* domain) {
+    seeds_synced_ = true;
+    buf_.assign(static_cast<size_t>(kNumOpBuckets) * kNumSeedFields, std::numeric_limits<double>::lowest());
+    if (domain->comm_rank() == 0) {
+        std::vector<std::pair<int, ParamValue>> seeds;
+        domain->param_cache.GetAllSeeds(&seeds);
+        for (const auto& kv : seeds) {
+            if (kv.first < 0 || kv.first >= kNumOpBuckets) {
+                continue;
+            }
+            double* f = buf_.data() + static_cast<size_t>(kv.first) * kNumSeedFields;
+            f[kSeedPresent] = 1.0;
+            f[kSeedAlpha] = kv.second.alpha;
+            f[kSeedUsePCIe] = kv.second.use_pcie ? 1.0 : 0.0;
+            f[kSeedFastBw] = kv.second.fast_bw;
+            f[kSeedPCIeBw] = kv.second.pcie_bw;
+        }
+    }
+    std::vector<std::pair<int, ParamValue>> adopted;
+    if (ops_.reduce_max(buf_.data(), buf_.size(), raw_comm_, &scratch_)) {
+        for (int b = 0; b < kNumOpBuckets; ++b) {
+            const double* f = buf_.data() + static_cast<size_t>(b) * kNumSeedFields;
+            if (f[kSeedPresent] == 1.0) {
+                adopted.emplace_back(b, ParamValue(f[kSeedAlpha], f[kSeedUsePCIe] != 0.0, f[kSeedFastBw],
+                                                   f[kSeedPCIeBw]));
+            }
+        }
+    } else {
+        AMPCCL_LOG(WARN, "StatReducer: seed AllReduce failed, starting without profile seeds");
+    }
+    size_t own = domain->param_cache.NumSeeds();
+    domain->param_cache.SetSeeds(adopted);
+    if (own != adopted.size()) {
+        AMPCCL_LOG(INFO, "StatReducer: rank %d replaced its %zu profile seeds with rank 0's %zu",
+                   domain->comm_rank(), own, adopted.size());
+    }
+}
+
+void StatReducer::FinishRound(CommDomain* domain) {
+    in_flight_ = false;
+    buf_.resize(1 + in_flight_buckets_ * kNumFields);
+    if (!ops_.wait_reduce(buf_.data(), buf_.size(), scratch_)) {
+        AMPCCL_LOG(WARN, "StatReducer: statistics AllReduce failed, skipping round %llu",
+                   static_cast<unsigned long long>(rounds_));
+        return;
+    }
+    if (!domain) {
+        return;
+    }
+    Apply(buf_.data() + 1, in_flight_buckets_, domain);
+    // A 0 means every rank's PCCL was up when the round was issued; it stays up. A 2
+    // means some rank quarantined its PCCL: every rank stops splitting from here on.
+    PCIeLazyInit& lazy = domain->pcie_lazy_init();
+    if (buf_[0] == 0.0 && lazy.state() == PCIeLazyInit::State::kRunning) {
+        lazy.set_agreed();
+    }
+    if (buf_[0] >= 2.0 && !domain->pcie_disabled()) {
+        domain->DisablePCIe();
+        AMPCCL_LOG(WARN, "StatReducer: a rank quarantined PCIe, domain is fast-only from round %llu",
+                   static_cast<unsigned long long>(rounds_));
+    }
+    ++rounds_;
+    AMPCCL_LOG(DEBUG, "StatReducer: applied round %llu", static_cast<unsigned long long>(rounds_));
+}
+
+void StatReducer::OnCollectiveEntry(CommDomain* domain, const OpKey& op_key) {
+    if (!IsEnabled() || !domain || !domain->controller) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        MarkInUseLocked(OpBucketOf(op_key));
+        if (++calls_ % static_cast<uint64_t>(interval_) == 0) {
+            round_due_ = true;
+        }
+    }
+    // A reduction issued now would be held with the group's collectives while its
+    // result is read back at once, i.e. before any rank has contributed.
+    if (InGroup()) {
+        if (!seeds_synced_ || round_due_) {
+            DeferToGroupEnd(domain);
+        }
+        return;
+    }
+    RunDue(domain);
+}
+
+void StatReducer::OnGroupEnd(CommDomain* domain) {
+    if (!IsEnabled() || !domain || !domain->controller) {
+        return;
+    }
+    RunDue(domain);
+}
+
+void StatReducer::RunDue(CommDomain* domain) {
+    if (!seeds_synced_) {
+        SyncSeeds(domain);
+    }
+    if (!round_due_) {
+        return;
+    }
+    round_due_ = false;
+    // The previous round has had interval_ collectives to complete, so this rarely waits.
+    if (in_flight_) {
+        FinishRound(domain);
+    }
+    size_t n;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        n = used_.size();
+        buf_.resize(1 + n * kNumFields);
+        Pack(n, buf_.data() + 1);
+        ClearWindow();
+    }
+    // Lazy PCCL setup: 1 while this rank's communicator is not (successfully) up, so a
+    // reduced 0 means every rank can switch to the split path from the collective
+    // that collects the round on. 2 once this rank has quarantined its PCCL.
+    PCIeLazyInit& lazy = domain->pcie_lazy_init();
+    bool pending = lazy.state() == PCIeLazyInit::State::kDeferred ||
+                   (lazy.state() == PCIeLazyInit::State::kRunning && !(lazy.done() && lazy.ok()));
+    buf_[0] = domain->pcie_quarantined() ? 2.0 : (pending ? 1.0 : 0.0);
+    // Every rank reaches this point at the same call index, so the reduction is
+    // ordered consistently with the user's collectives on the same communicator.
+    if (!ops_.reduce_max_async(buf_.data(), buf_.size(), raw_comm_, &scratch_)) {
+        AMPCCL_LOG(WARN, "StatReducer: statistics AllReduce failed to launch, skipping round %llu",
+                   static_cast<unsigned long long>(rounds_));
+        return;
+    }
+    in_flight_ = true;
+    in_flight_buckets_ = n;
+}
+
+}  // namespace ampccl
@@ -0,0 +1,148 @@
+#ifndef AMPCCL_CORE_STAT_REDUCER_H_
+#define AMPCCL_CORE_STAT_REDUCER_H_
+
+#include "common/op_key.h"
+#include "telemetry/stats.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ampccl {
+
+class CommDomain;
+
+// Backend hooks for the statistics AllReduce, provided by the NCCL/HCCL hook at CommInit.
+// reduce_max: in-place AllReduce(max) of count doubles through the original library on
+// raw_comm, using a private device buffer and stream; blocks until the result is back on
+// the host. reduce_max_async issues the same reduction (values are copied out before it
+// returns) and wait_reduce blocks for its result; at most one reduction is in flight per
+// scratch. *scratch is an opaque per-domain slot the hook may use to cache its buffers
+// and stream (nullptr on first call), grown when a later count is larger. release frees
+// it at domain teardown.
+struct StatReduceOps {
+    bool (*reduce_max)(double* values, size_t count, void* raw_comm, void** scratch) = nullptr;
+    bool (*reduce_max_async)(const double* values, size_t count, void* raw_comm, void** scratch) = nullptr;
+    bool (*wait_reduce)(double* values, size_t count, void* scratch) = nullptr;
+    void (*release)(void* scratch) = nullptr;
+};
+
+// Scheme B of docs/multi_rank_design.md: cross-rank statistics without shared memory.
+// Each rank records its ExecStats per op bucket at SyncStream. Every interval-th
+// collective entry (the same call on every rank, since collectives are issued in the
+// same order), all ranks pack their per-bucket means into a vector and issue an
+// AllReduce(max) of it without waiting; the next round collects the identical result
+// and feeds it to the controller in bucket order. Controllers are deterministic, so
+// param caches stay identical without a rank 0. Only buckets some collective has
+// entered are packed, in first-entry order, which every rank sees alike. A leading
+// element carries the lazy PCCL setup agreement (PCIeLazyInit): max over ranks of
+// "not ready yet". The first collective entry runs
+// one extra round that hands rank 0's profile seeds (ParamCache) to every rank, the
+// other ranks contributing the lowest double, so all controllers start from the same
+// warm start whatever profile each rank found.
+class StatReducer {
+public:
+    StatReducer() { ClearWindow(); }
+    ~StatReducer();
+
+    StatReducer(const StatReducer&) = delete;
+    StatReducer& operator=(const StatReducer&) = delete;
+
+    void Configure(const StatReduceOps& ops, void* raw_comm, int interval);
+    bool IsEnabled() const { return ops_.reduce_max && ops_.reduce_max_async && ops_.wait_reduce; }
+
+    // CommDestroy: stop using raw_comm (if it is the one reductions run on).
+    void DetachComm(void* raw_comm);
+
+    // SyncStream: accumulate this rank's stat for the op's bucket.
+    void Record(const OpKey& op_key, const ExecStat& stat);
+
+    // Collective entry (every rank, before the plan is built). Marks op_key's bucket in
+    // use and, every interval_ calls, applies the previous round's result to
+    // domain->controller / param_cache and issues the next round. Inside an NCCL group
+    // (InGroup) the seed sync and a due round wait for OnGroupEnd, or for the next
+    // entry outside a group; the call count still advances, so rounds stay aligned.
+    void OnCollectiveEntry(CommDomain* domain, const OpKey& op_key);
+
+    // Outermost ncclGroupEnd after an entry that deferred work (RunGroupDeferred).
+    void OnGroupEnd(CommDomain* domain);
+
+    // Rank 0's seeds have been adopted; until then ranks may plan from different ones.
+    bool seeds_synced() const { return seeds_synced_; }
+
+    // A collective path that records under another key than the entry's (HierIntra):
+    // called at the same point on every rank.
+    void MarkInUse(const OpKey& op_key);
+
+    uint64_t rounds() const { return rounds_; }
+
+private:
+    // Per-bucket packed fields. kNegHasSample turns the max into a min: a bucket is
+    // applied only if every rank has at least one sample in the window.
+    enum Field {
+        kFastTime = 0,
+        kPCIeTime,
+        kFastBytes,
+        kPCIeBytes,
+        kOpBytes,
+        kDatatype,
+        kFailed,
+        kPCIeFailed,
+        kNegHasSample,
+        kNumFields
+    };
+
+    // Seed round fields per bucket (a seed is present where kSeedPresent reduces to 1).
+    enum SeedField {
+        kSeedPresent = 0,
+        kSeedAlpha,
+        kSeedUsePCIe,
+        kSeedFastBw,
+        kSeedPCIeBw,
+        kNumSeedFields
+    };
+
+    void ClearWindow();
+    void MarkInUseLocked(int bucket);
+    // Fields of used_[0, n) from out[0].
+    void Pack(size_t n, double* out) const;
+    void Apply(const double* reduced, size_t n, CommDomain* domain) const;
+    // Collects the round in flight (buf_) and applies it; domain nullptr discards it.
+    void FinishRound(CommDomain* domain);
+    // First collective entry: replace this rank's seeds with rank 0's. Synchronous.
+    void SyncSeeds(CommDomain* domain);
+    // Seed sync if still pending, then the round if one is due.
+    void RunDue(CommDomain* domain);
+
+    StatReduceOps ops_;
+    void* raw_comm_ = nullptr;
+    void* scratch_ = nullptr;
+    int interval_ = 64;
+    uint64_t calls_ = 0;
+    uint64_t rounds_ = 0;
+    bool seeds_synced_ = false;
+    bool round_due_ = false;  // interval_ reached inside a group, round not yet issued
+    bool in_flight_ = false;
+    size_t in_flight_buckets_ = 0;  // used_ prefix packed into the round in flight
+
+    // Window accumulators since the last round (structure of arrays); guarded by mu_
+    // because SyncStream may run on another thread than the collective.
+    mutable std::mutex mu_;
+    std::array<double, kNumOpBuckets> sum_fast_time_;
+    std::array<double, kNumOpBuckets> sum_pcie_time_;
+    std::array<uint32_t, kNumOpBuckets> count_;
+    std::array<uint8_t, kNumOpBuckets> failed_;
+    std::array<uint8_t, kNumOpBuckets> pcie_failed_;
+    std::array<uint64_t, kNumOpBuckets> last_fast_bytes_;
+    std::array<uint64_t, kNumOpBuckets> last_pcie_bytes_;
+    std::array<uint64_t, kNumOpBuckets> last_op_bytes_;
+    std::array<int32_t, kNumOpBuckets> last_datatype_;
+    std::array<uint8_t, kNumOpBuckets> in_use_{};
+    std::vector<int> used_;  // buckets in first-entry order
+    std::vector<double> buf_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_STAT_REDUCER_H_
@@ -1,62 +1,159 @@
 #include "stream_sync.h"
 #include "domain_manager.h"
 #include "domain.h"
+#include "virtual_collective.h"
 #include "telemetry/stats.h"
+#include "telemetry/trace.h"
+#include "telemetry/capture.h"
+#include "telemetry/stats_page.h"
+#include "telemetry/overhead.h"
+#include "common/config.h"
 #include "common/log.h"
+#include <functional>
 #include <optional>
-
-#ifdef AMPCCL_ENABLE_PCIE
-#include "comm.hpp"
-#endif
+#include <thread>
 
 namespace ampccl {
 
-void OnStreamSynchronized(void* stream) {
+namespace {
+
+void RecordTrace(const PendingCollective& pending, const ExecStat& stat) {
+    TraceRecord rec = {};
+    rec.seq = pending.stamp.seq;
+    rec.domain = pending.domain->key_id();
+    rec.launch_ns = pending.stamp.launch_ns;
+    rec.launch_cost_ns = pending.stamp.launch_cost_ns;
+    rec.sync_ns = Tracer::NowNs();
+    rec.bytes = pending.op_key.bytes;
+    rec.fast_bytes = stat.fast_bytes;
+    rec.pcie_bytes = stat.pcie_bytes;
+    rec.alpha = pending.plan.alpha;
+    rec.fast_time = stat.fast_time;
+    rec.pcie_time = stat.pcie_time;
+    rec.datatype = pending.op_key.datatype;
+    rec.rank = pending.domain->comm_rank();
+    rec.tid = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    rec.op = static_cast<uint8_t>(pending.op_key.op);
+    rec.flags = (pending.plan.use_pcie ? kTraceUsePCIe : 0) |
+                (stat.fast_success ? kTraceFastOk : 0) |
+                (stat.pcie_success ? kTracePCIeOk : 0);
+    Tracer::GetInstance().Record(rec);
+}
+
+// This rank's view: per-path device times and the collective time (max of the two).
+void RecordHistograms(const PendingCollective& pending, const ExecStat& stat) {
+    StatsPage& page = StatsPage::GetInstance();
+    uint64_t domain = pending.domain->key_id();
+    int rank = pending.domain->comm_rank();
+    int op = static_cast<int>(pending.op_key.op);
+    int size_class = SizeClassOf(pending.op_key.bytes);
+    if (stat.fast_bytes > 0) {
+        page.Record(domain, rank, op, size_class, StatsPath::Fast, stat.fast_time);
+    }
+    if (stat.pcie_bytes > 0) {
+        page.Record(domain, rank, op, size_class, StatsPath::PCIe, stat.pcie_time);
+    }
+    page.Record(domain, rank, op, size_class, StatsPath::Total, stat.GetTotalTime());
+}
+
+}  // namespace
+
+bool CollectPendingStat(void* stream, PendingCollective* out_pending, ExecStat* out_stat) {
     std::optional<PendingCollective> pending =
         DomainManager::GetInstance().TakeStreamPending(stream);
     if (!pending) {
-        return;
+        return false;
     }
     CommDomain* domain = pending->domain;
     if (!domain || !domain->controller) {
-        return;
+        return false;
     }
 
-#ifdef AMPCCL_ENABLE_PCIE
-    if (domain->pcie_comm() && domain->pcie_stream() && pending->plan.use_pcie) {
-        pcclResult_t ret = pcclSynchronizeStream(
-            static_cast<pcclComm_t>(domain->pcie_comm()),
-            static_cast<pcclStream_t>(domain->pcie_stream()));
-        (void)ret;
+    // PCIe share still in flight: wait up to the deadline. A share that fails or misses
+    // it fails the collective and quarantines PCCL (reported to the controller's circuit
+    // breaker as well). It is not re-run on the fast path: the peers that made the
+    // deadline would not re-run it, and the late transfer may still land in recvbuff.
+    bool pcie_timed_out = false;
+    HookOverhead::Pause();  // Device waits below are library time, not AmpCCL overhead
+    if (pending->plan.use_pcie && pending->pcie_success && pending->plan.pcie_bytes > 0) {
+        BackendResult r = VirtualCollective::SynchronizePCIe(domain);
+        if (r != BackendResult::Success) {
+            pcie_timed_out = (r == BackendResult::Timeout);
+            pending->pcie_success = false;
+            domain->QuarantinePCIe();
+            AMPCCL_LOG(WARN, "StreamSync: PCIe share %s; collective %llu failed, PCIe quarantined",
+                       pcie_timed_out ? "missed its deadline" : "failed",
+                       static_cast<unsigned long long>(pending->stamp.seq));
+        }
     }
-#endif
 
     domain->timer_fast().Synchronize();
-    if (pending->plan.use_pcie) {
+    if (pending->plan.use_pcie && !pcie_timed_out) {
         domain->timer_pcie().Synchronize();
     }
+    HookOverhead::Resume();
 
-    ExecStat stat;
+    ExecStat& stat = *out_stat;
     stat.fast_time = domain->timer_fast().ElapsedSeconds();
-    stat.pcie_time = pending->plan.use_pcie ? domain->timer_pcie().ElapsedSeconds() : 0.0;
+    stat.pcie_time = 0.0;
+    if (pcie_timed_out) {
+        stat.pcie_time = Config::GetPCIeDeadlineSeconds();
+    } else if (pending->plan.use_pcie) {
+        stat.pcie_time = domain->timer_pcie().ElapsedSeconds();
+    }
     stat.fast_bytes = pending->plan.fast_bytes;
     stat.pcie_bytes = pending->plan.pcie_bytes;
     stat.fast_success = pending->fast_success;
     stat.pcie_success = pending->pcie_success;
+    *out_pending = std::move(*pending);
+    return true;
+}
+
+bool OnStreamSynchronized(void* stream) {
+    PendingCollective pending;
+    ExecStat stat;
+    if (!CollectPendingStat(stream, &pending, &stat)) {
+        return true;
+    }
+    CommDomain* domain = pending.domain;
+    if (Tracer::GetInstance().IsEnabled()) {
+        RecordTrace(pending, stat);
+    }
+    if (StatsPage::GetInstance().IsEnabled()) {
+        RecordHistograms(pending, stat);
+    }
+    WorkloadCapture& capture = WorkloadCapture::GetInstance();
+    if (capture.IsEnabled()) {
+        capture.RecordComplete(domain->key_id(),
+                               domain->comm_rank(), pending.stamp.seq, Tracer::NowNs(),
+                               pending.op_key, stat);
+    }
 
     domain->EnsureShmAttached();
     int nranks = domain->pcie_nranks();
     ShmParamStore* shm = domain->shm_store();
-    if (nranks > 1 && shm->IsAttached()) {
-        shm->WriteMyStat(domain->pcie_rank(), pending->op_key, stat);
+    if (domain->stat_reducer()->IsEnabled()) {
+        // Scheme B: controller is updated from the reduced stats at a later collective entry.
+        domain->stat_reducer()->Record(pending.op_key, stat);
+    } else if (nranks > 1 && shm->IsAttached()) {
+        shm->WriteMyStat(domain->pcie_rank(), pending.op_key, stat, pending.stamp.seq);
         AMPCCL_LOG(INFO, "StreamSync: wrote stat to shm (rank %d) op_key.bytes=%zu fast_time=%.6fs pcie_time=%.6fs",
-                   domain->pcie_rank(), pending->op_key.bytes, stat.fast_time, stat.pcie_time);
+                   domain->pcie_rank(), pending.op_key.bytes, stat.fast_time, stat.pcie_time);
     } else {
-        domain->controller->Update(pending->op_key, stat, domain->param_cache);
+        domain->controller->Update(pending.op_key, stat, domain->param_cache);
         AMPCCL_LOG(INFO, "StreamSync: op_key.bytes=%zu fast_time=%.6fs pcie_time=%.6fs fast_bytes=%zu pcie_bytes=%zu",
-                   pending->op_key.bytes, stat.fast_time, stat.pcie_time,
+                   pending.op_key.bytes, stat.fast_time, stat.pcie_time,
                    stat.fast_bytes, stat.pcie_bytes);
     }
+    if (StatsPage::GetInstance().IsEnabled()) {
+        // After this sync's update, or the one at the last collective entry (schemes A/B).
+        const RegretStats* regret = domain->controller->GetRegretStats();
+        if (regret != nullptr) {
+            StatsPage::GetInstance().PublishRegret(domain->key_id(), domain->comm_rank(), *regret);
+        }
+    }
+    DomainManager::GetInstance().MaybeFlushProfile(domain);
+    return stat.fast_success && stat.pcie_success;
 }
 
 }  // namespace ampccl
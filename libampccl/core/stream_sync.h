@@ -3,10 +3,21 @@
 
 namespace ampccl {
 
+struct PendingCollective;
+struct ExecStat;
+
+// Take the pending collective of this stream, wait for its PCIe stream and
+// timers, and build its ExecStat without updating any controller. Returns false
+// if the stream has no pending collective. Used by OnStreamSynchronized and by
+// tools that measure collectives directly.
+bool CollectPendingStat(void* stream, PendingCollective* out_pending, ExecStat* out_stat);
+
 // Called from hooked aclrtSynchronizeStream / cudaStreamSynchronize after the
 // original sync. If this stream had a pending collective, syncs PCIe stream
-// and domain timers, builds ExecStat, and updates the controller.
-void OnStreamSynchronized(void* stream);
+// and domain timers, builds ExecStat, and updates the controller. Returns false
+// if that collective failed on either path (a PCIe share that failed or missed its
+// deadline leaves its part of recvbuff undefined), so the hook can report it.
+bool OnStreamSynchronized(void* stream);
 
 }  // namespace ampccl
 
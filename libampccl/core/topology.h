@@ -0,0 +1,81 @@
+#ifndef AMPCCL_CORE_TOPOLOGY_H_
+#define AMPCCL_CORE_TOPOLOGY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ampccl {
+
+// Node-local grouping of a communicator, derived at CommInit from the host of every
+// rank (BuildNodeTopologyFromHosts) or, failing that, from the launcher's ranks per node.
+struct NodeTopology {
+    int node_id = 0;
+    int num_nodes = 1;
+    int local_rank = 0;
+    int local_size = 0;  // 0 = unknown (treated as single node)
+
+    bool IsMultiNode() const { return num_nodes > 1 && local_size > 0; }
+};
+
+// Fallback when the hosts are unknown: ranks placed in blocks of local_size per node
+// (torchrun / mpirun --map-by node default), node_id = rank / local_size. The launcher's
+// local size is job-wide, so this only holds for the world communicator.
+inline NodeTopology BuildNodeTopology(int rank, int nranks, int local_size) {
+    NodeTopology t;
+    if (local_size <= 0 || local_size >= nranks || nranks % local_size != 0) {
+        t.local_rank = rank;
+        t.local_size = nranks;
+        return t;
+    }
+    t.local_size = local_size;
+    t.num_nodes = nranks / local_size;
+    t.node_id = rank / local_size;
+    t.local_rank = rank % local_size;
+    return t;
+}
+
+// Grouping from hosts[r], the host of communicator rank r (any placement): nodes are
+// numbered in order of their lowest rank and local ranks follow communicator rank order,
+// as for a rank table. Hosts with different rank counts are treated as a single node.
+inline NodeTopology BuildNodeTopologyFromHosts(int rank, const std::vector<uint64_t>& hosts) {
+    NodeTopology t;
+    int n = static_cast<int>(hosts.size());
+    std::vector<uint64_t> nodes;
+    std::vector<int> per_node;
+    for (int r = 0; r < n; ++r) {
+        uint64_t h = hosts[static_cast<size_t>(r)];
+        size_t id = static_cast<size_t>(std::find(nodes.begin(), nodes.end(), h) - nodes.begin());
+        if (id == nodes.size()) {
+            nodes.push_back(h);
+            per_node.push_back(0);
+        }
+        if (r == rank) {
+            t.node_id = static_cast<int>(id);
+            t.local_rank = per_node[id];
+        }
+        ++per_node[id];
+    }
+    bool uniform = std::all_of(per_node.begin(), per_node.end(), [&](int c) { return c == per_node[0]; });
+    if (nodes.size() < 2 || !uniform) {
+        return BuildNodeTopology(rank, n, 0);
+    }
+    t.num_nodes = static_cast<int>(nodes.size());
+    t.local_size = per_node[0];
+    return t;
+}
+
+// Fast-library sub-communicators for the hierarchical AllReduce, created by the hook from
+// owner (the raw comm passed to CommInit): intra = ranks of this node, inter = ranks with
+// the same local_rank on every node.
+struct HierComms {
+    void* owner = nullptr;
+    void* intra = nullptr;
+    void* inter = nullptr;
+
+    bool IsReady() const { return intra != nullptr && inter != nullptr; }
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_CORE_TOPOLOGY_H_
@@ -3,11 +3,15 @@
 
 #include "domain.h"
 #include "domain_manager.h"
+#include "group_scope.h"
 #include "planner.h"
 #include "common/op_key.h"
 #include "backend/fast_backend.h"
 #include "backend/pcie_backend.h"
 #include "telemetry/stats.h"
+#include "telemetry/trace.h"
+#include "telemetry/capture.h"
+#include "telemetry/overhead.h"
 #include "common/config.h"
 #include "common/log.h"
 #include <cstddef>
@@ -35,32 +39,30 @@ public:
         op_key.bytes = count * GetDataTypeSize(datatype);
         op_key.datatype = datatype;
 
-        domain->EnsureShmAttached();
-        ShmParamStore* shm = domain->shm_store();
-        if (shm->IsAttached() && shm->IsRank0()) {
-            ExecStat global_stat;
-            OpKey agg_op_key;
-            if (shm->ReadAllStatsAndAggregate(&global_stat, &agg_op_key) && domain->controller) {
-                domain->controller->Update(agg_op_key, global_stat, domain->param_cache);
-                shm->WriteParams(domain->param_cache);
-            }
-        }
-        if (shm->IsAttached()) {
-            shm->ReadParams(&domain->param_cache);
+        TraceStamp stamp = BeginTrace(domain);
+        domain->stat_reducer()->OnCollectiveEntry(domain, op_key);
+        RefreshParams(domain, stamp.seq);
+        PreparePCIe(domain, stamp.seq, op_key);
+        HookOverhead::Enter(HookPhase::Plan);
+
+        // Multi-node, large: intra RS -> inter AR -> intra AG, only intra phases split.
+        if (UseHierarchical(domain, op_key.bytes, count, comm)) {
+            return HierarchicalAllReduce(domain, sendbuff, recvbuff, count, datatype, op, stream, &stamp);
         }
 
-        // 2. ParamCache lookup
-        ParamValue param = domain->param_cache.Lookup(op_key);
+        // 2. Split or fast-only: learned per-size crossover (or a probe below it)
+        bool use_pcie = domain->controller->UsePCIe(op_key, domain->param_cache) && domain->SplitsAgreed();
 
         // 3. Controller suggests alpha
         double alpha = domain->controller->SuggestAlpha(op_key, domain->param_cache);
 
         // 4. Planner builds split plan
-        Plan plan = Planner::CreatePlan(op_key.bytes, alpha, param.use_pcie);
+        Plan plan = Planner::CreatePlan(op_key.bytes, alpha, use_pcie);
 
         // 5. Launch fast + PCIe backend: record events only, no sync; pending consumed at SynchronizeStream.
         AMPCCL_LOG(INFO, "AllReduce before CCL: op=AllReduce bytes=%zu datatype=%d alpha=%.3f use_pcie=%d fast_bytes=%zu pcie_bytes=%zu",
                    op_key.bytes, datatype, alpha, plan.use_pcie ? 1 : 0, plan.fast_bytes, plan.pcie_bytes);
+        HookOverhead::Enter(HookPhase::Launch);
 
         bool fast_ok = true;
         bool pcie_ok = true;
@@ -75,37 +77,51 @@ public:
                 domain->timer_fast().Start(stream);
                 void* fast_send = const_cast<void*>(sendbuff);
                 void* fast_recv = recvbuff;
+                HookOverhead::Pause();
                 BackendResult fast_result = FastBackendImpl::AllReduce(
                     fast_send, fast_recv, plan.fast_bytes / elem_size,
                     datatype, op, comm, stream);
+                HookOverhead::Resume();
                 domain->timer_fast().Stop(stream);
                 fast_ok = (fast_result == BackendResult::Success);
             }
             if (plan.pcie_bytes > 0) {
+                void* pcie_send = const_cast<char*>(static_cast<const char*>(sendbuff) + pcie_offset);
+                void* pcie_recv = static_cast<char*>(recvbuff) + pcie_offset;
                 domain->timer_pcie().Start(pcie_stream);
-                const char* pcie_send = static_cast<const char*>(sendbuff) + pcie_offset;
-                char* pcie_recv = static_cast<char*>(recvbuff) + pcie_offset;
+                HookOverhead::Pause();
                 BackendResult pcie_result = PCIeBackendImpl::AllReduce(
                     domain, pcie_send, pcie_recv, plan.pcie_bytes / elem_size,
                     datatype, op, pcie_stream);
+                HookOverhead::Resume();
                 domain->timer_pcie().Stop(pcie_stream);
                 pcie_ok = (pcie_result == BackendResult::Success);
+                if (!pcie_ok) {
+                    domain->QuarantinePCIe();
+                }
             }
         } else {
             domain->timer_fast().Start(stream);
+            HookOverhead::Pause();
             BackendResult result = FastBackendImpl::AllReduce(
                 sendbuff, recvbuff, count, datatype, op, comm, stream);
+            HookOverhead::Resume();
             domain->timer_fast().Stop(stream);
             fast_ok = (result == BackendResult::Success);
         }
 
+        HookOverhead::Enter(HookPhase::Register);
+        EndTrace(domain, op_key, plan, stream, &stamp);
         DomainManager::GetInstance().RegisterStreamPending(
-            stream, domain, op_key, plan, fast_ok, pcie_ok);
+            stream, domain, op_key, plan, fast_ok, pcie_ok, stamp);
 
         return (fast_ok && pcie_ok) ? BackendResult::Success : BackendResult::UnhandledError;
     }
 
-    // Similar implementations for other collectives...
+    // AllGather: every rank's block of sendcount elements is split at the same offset,
+    // [0, F) on the fast library and [F, sendcount) on PCIe. Each path writes its part of
+    // every rank's block in recvbuff (blocks sendcount elements apart), so both run as
+    // strided gathers (FastStridedAllGather, PCIeBackendImpl::AllGather with a pitch).
     static BackendResult AllGather(
         CommDomain* domain,
         const void* sendbuff,
@@ -115,77 +131,112 @@ public:
         void* comm,
         void* stream
     ) {
-        // Similar to AllReduce but for AllGather
         OpKey op_key;
         op_key.op = CollectiveType::AllGather;
         op_key.bytes = sendcount * GetDataTypeSize(datatype);
         op_key.datatype = datatype;
 
-        domain->EnsureShmAttached();
-        ShmParamStore* shm = domain->shm_store();
-        if (shm->IsAttached() && shm->IsRank0()) {
-            ExecStat global_stat;
-            OpKey agg_op_key;
-            if (shm->ReadAllStatsAndAggregate(&global_stat, &agg_op_key) && domain->controller) {
-                domain->controller->Update(agg_op_key, global_stat, domain->param_cache);
-                shm->WriteParams(domain->param_cache);
-            }
-        }
-        if (shm->IsAttached()) {
-            shm->ReadParams(&domain->param_cache);
-        }
+        TraceStamp stamp = BeginTrace(domain);
+        domain->stat_reducer()->OnCollectiveEntry(domain, op_key);
+        RefreshParams(domain, stamp.seq);
+        PreparePCIe(domain, stamp.seq, op_key);
+        HookOverhead::Enter(HookPhase::Plan);
 
-        ParamValue param = domain->param_cache.Lookup(op_key);
+        // PCCL only reaches this host's ranks: a split needs the PCIe group to be the
+        // whole communicator.
+        int nranks = domain->key.world_size;
+        bool use_pcie = domain->controller->UsePCIe(op_key, domain->param_cache) &&
+                        domain->pcie_nranks() == nranks && domain->SplitsAgreed();
         double alpha = domain->controller->SuggestAlpha(op_key, domain->param_cache);
-        Plan plan = Planner::CreatePlan(op_key.bytes, alpha, param.use_pcie);
+        Plan plan = Planner::CreatePlan(op_key.bytes, alpha, use_pcie);
 
         AMPCCL_LOG(INFO, "AllGather before CCL: bytes=%zu datatype=%d alpha=%.3f use_pcie=%d fast_bytes=%zu pcie_bytes=%zu",
                    op_key.bytes, datatype, alpha, plan.use_pcie ? 1 : 0, plan.fast_bytes, plan.pcie_bytes);
+        HookOverhead::Enter(HookPhase::Launch);
 
         bool fast_ok = true;
         bool pcie_ok = true;
         void* pcie_stream = domain->pcie_stream();
 
         if (plan.use_pcie && plan.pcie_bytes > 0 && pcie_stream) {
-            size_t fast_offset = 0;
-            size_t pcie_offset = plan.fast_bytes;
             size_t elem_size = GetDataTypeSize(datatype);
+            size_t fast_count = plan.fast_bytes / elem_size;
+            size_t pcie_count = sendcount - fast_count;
+            size_t pitch = sendcount * elem_size;
 
-            if (plan.fast_bytes > 0) {
+            if (fast_count > 0) {
                 domain->timer_fast().Start(stream);
-                BackendResult fast_result = FastBackendImpl::AllGather(
-                    sendbuff, recvbuff, plan.fast_bytes / elem_size, datatype, comm, stream);
+                HookOverhead::Pause();
+                BackendResult fast_result = FastStridedAllGather(
+                    sendbuff, recvbuff, fast_count, datatype, pitch, nranks, comm, stream);
+                HookOverhead::Resume();
                 domain->timer_fast().Stop(stream);
                 fast_ok = (fast_result == BackendResult::Success);
             }
-            if (plan.pcie_bytes > 0) {
+            if (pcie_count > 0) {
                 domain->timer_pcie().Start(pcie_stream);
-                const char* pcie_send = static_cast<const char*>(sendbuff) + pcie_offset;
-                char* pcie_recv = static_cast<char*>(recvbuff) + pcie_offset;
-                size_t pcie_chunk_elems = plan.pcie_bytes / (2 * elem_size);
+                const char* pcie_send = static_cast<const char*>(sendbuff) + fast_count * elem_size;
+                char* pcie_recv = static_cast<char*>(recvbuff) + fast_count * elem_size;
+                HookOverhead::Pause();
                 BackendResult pcie_result = PCIeBackendImpl::AllGather(
-                    domain, pcie_send, pcie_recv, pcie_chunk_elems, datatype, pcie_stream);
+                    domain, pcie_send, pcie_recv, pcie_count, datatype, pitch, pcie_stream);
+                HookOverhead::Resume();
                 domain->timer_pcie().Stop(pcie_stream);
                 pcie_ok = (pcie_result == BackendResult::Success);
+                if (!pcie_ok) {
+                    domain->QuarantinePCIe();
+                }
             }
         } else {
             domain->timer_fast().Start(stream);
+            HookOverhead::Pause();
             BackendResult result = FastBackendImpl::AllGather(
                 sendbuff, recvbuff, sendcount, datatype, comm, stream);
+            HookOverhead::Resume();
             domain->timer_fast().Stop(stream);
             fast_ok = (result == BackendResult::Success);
         }
 
+        HookOverhead::Enter(HookPhase::Register);
+        EndTrace(domain, op_key, plan, stream, &stamp);
         DomainManager::GetInstance().RegisterStreamPending(
-            stream, domain, op_key, plan, fast_ok, pcie_ok);
+            stream, domain, op_key, plan, fast_ok, pcie_ok, stamp);
+
+        return (fast_ok && pcie_ok) ? BackendResult::Success : BackendResult::UnhandledError;
+    }
 
-        return fast_ok ? BackendResult::Success : BackendResult::UnhandledError;
+    // Block on the domain's PCIe stream for at most AMPCCL_PCIE_DEADLINE_MS.
+    static BackendResult SynchronizePCIe(CommDomain* domain) {
+        return domain->pcie_watchdog().Run(
+            [domain] { return PCIeBackendImpl::Synchronize(domain) == BackendResult::Success; },
+            Config::GetPCIeDeadlineSeconds());
+    }
+
+    // AllGather of count elements per rank into blocks pitch bytes apart in recvbuff (0:
+    // contiguous). The fast libraries only gather contiguously, so a strided gather runs
+    // as one broadcast per rank, rooted at that rank, into its block.
+    static BackendResult FastStridedAllGather(const void* sendbuff, void* recvbuff, size_t count, int datatype,
+                                              size_t pitch, int nranks, void* comm, void* stream) {
+        if (pitch == 0 || pitch == count * GetDataTypeSize(datatype)) {
+            return FastBackendImpl::AllGather(sendbuff, recvbuff, count, datatype, comm, stream);
+        }
+        char* recv = static_cast<char*>(recvbuff);
+        for (int root = 0; root < nranks; ++root) {
+            BackendResult r = FastBackendImpl::Broadcast(sendbuff, recv + static_cast<size_t>(root) * pitch,
+                                                         count, datatype, root, comm, stream);
+            if (r != BackendResult::Success) {
+                return r;
+            }
+        }
+        return BackendResult::Success;
     }
 
-private:
     static size_t GetDataTypeSize(int datatype) {
-        // Map NCCL/HCCL datatype to size
-        // This is a simplified version - actual implementation should handle all types
+        // The hooked library knows its own enum; the table below is only for core-only
+        // builds (tools, benchmarks) where no library is registered.
+        if (size_t size = FastBackendImpl::DataTypeSize(datatype)) {
+            return size;
+        }
         switch (datatype) {
             case 0: return 4;   // float32
             case 1: return 8;   // float64
@@ -195,6 +246,254 @@ private:
             default: return 4;
         }
     }
+
+private:
+    // Sequence number and launch time for the trace / capture records; the clock is
+    // read only when one of them is on.
+    static TraceStamp BeginTrace(CommDomain* domain) {
+        TraceStamp stamp;
+        stamp.seq = domain->NextSeq();
+        if (Tracer::GetInstance().IsEnabled() || WorkloadCapture::GetInstance().IsEnabled()) {
+            stamp.launch_ns = Tracer::NowNs();
+        }
+        return stamp;
+    }
+
+    // Scheme A (shm): rank 0 queues the stats aggregated since its last call, then every
+    // rank applies the updates stamped for this collective to its own controller, so all
+    // ranks plan collective seq from identical controller state.
+    static void RefreshParams(CommDomain* domain, uint64_t seq) {
+        domain->EnsureShmAttached();
+        ShmParamStore* shm = domain->shm_store();
+        if (!shm->IsAttached() || !domain->controller) {
+            return;
+        }
+        static const uint64_t lead = static_cast<uint64_t>(Config::GetParamLead());
+        if (shm->IsRank0()) {
+            ExecStat global_stat;
+            OpKey agg_op_key;
+            uint64_t source_seq = 0;
+            if (shm->ReadAllStatsAndAggregate(&global_stat, &agg_op_key, &source_seq)) {
+                shm->PublishUpdate(seq, lead, agg_op_key, global_stat, source_seq);
+            }
+            if (domain->pcie_lazy_init().state() == PCIeLazyInit::State::kRunning) {
+                shm->AnnouncePCIe(seq, lead);
+            }
+            shm->AnnouncePCIeLoss(seq, lead);
+            shm->PublishSeeds(domain->param_cache);
+            shm->CloseThrough(seq, lead);
+        }
+        OpKey op_key;
+        ExecStat stat;
+        bool updated = false;
+        while (shm->TakeUpdate(seq, &op_key, &stat)) {
+            domain->controller->Update(op_key, stat, domain->param_cache);
+            updated = true;
+        }
+        if (!domain->pcie_disabled() && shm->PCIeDisabledAt(seq)) {
+            domain->DisablePCIe();
+            AMPCCL_LOG(WARN, "PCIe: a rank quarantined PCIe, domain is fast-only from collective %llu",
+                       static_cast<unsigned long long>(seq));
+        }
+        // Warm start from rank 0's seeds, not this rank's own profile lookup.
+        shm->AdoptSeeds(&domain->param_cache);
+        if (updated && shm->IsRank0()) {
+            shm->WriteParams(domain->param_cache);
+        }
+    }
+
+    // Lazy PCCL setup (Config::IsPCIeInitLazy): the first collective at or above the
+    // crossover starts it in the background; pcie_comm / pcie_stream are published at a
+    // collective every rank agrees on, so ranks never disagree on whether a split runs.
+    // Until then the domain runs fast-only.
+    static void PreparePCIe(CommDomain* domain, uint64_t seq, const OpKey& op_key) {
+        PCIeLazyInit& lazy = domain->pcie_lazy_init();
+        PCIeLazyInit::State state = lazy.state();
+        if (state == PCIeLazyInit::State::kNone || state == PCIeLazyInit::State::kPublished ||
+            !domain->controller) {
+            return;
+        }
+        ShmParamStore* shm = domain->shm_store();
+        bool channel = domain->pcie_nranks() <= 1 || shm->IsAttached() || domain->stat_reducer()->IsEnabled();
+        if (state == PCIeLazyInit::State::kDeferred) {
+            // Without an agreement channel every rank starts at its first collective, so
+            // the start (and the blocking switch below) happens at the same seq everywhere.
+            if (channel && !domain->controller->AboveCrossover(op_key, domain->param_cache)) {
+                return;
+            }
+            lazy.Start(seq);
+            AMPCCL_LOG(INFO, "PCIe: starting background setup at collective %llu (rank %d of %d)",
+                       static_cast<unsigned long long>(seq), domain->pcie_rank(), domain->pcie_nranks());
+        }
+        bool enable = false;
+        if (domain->pcie_nranks() <= 1) {
+            enable = lazy.done();
+        } else if (shm->IsAttached()) {
+            if (!lazy.reported() && lazy.done()) {
+                shm->MarkPCIeReady(lazy.ok());
+                lazy.set_reported();
+            }
+            enable = shm->PCIeEnabledAt(seq);
+        } else if (domain->stat_reducer()->IsEnabled()) {
+            enable = lazy.agreed();
+        } else {
+            static const uint64_t lead = static_cast<uint64_t>(Config::GetParamLead());
+            enable = seq >= lazy.start_seq() + lead;
+        }
+        if (!enable) {
+            return;
+        }
+        void* comm = nullptr;
+        void* stream = nullptr;
+        if (!lazy.Publish(&comm, &stream)) {
+            AMPCCL_LOG(WARN, "PCIe: background setup failed, domain stays on the fast path");
+            return;
+        }
+        domain->set_pcie_comm(comm);
+        domain->set_pcie_stream(stream);
+        AMPCCL_LOG(INFO, "PCIe: setup published at collective %llu (rank %d of %d)",
+                   static_cast<unsigned long long>(seq), domain->pcie_rank(), domain->pcie_nranks());
+    }
+
+    static void EndTrace(CommDomain* domain, const OpKey& op_key, const Plan& plan, void* stream,
+                         TraceStamp* stamp) {
+        if (stamp->launch_ns == 0) {
+            return;
+        }
+        stamp->launch_cost_ns = Tracer::NowNs() - stamp->launch_ns;
+        WorkloadCapture& capture = WorkloadCapture::GetInstance();
+        if (capture.IsEnabled()) {
+            capture.RecordLaunch(domain->key_id(),
+                                 domain->comm_rank(), stamp->seq, stamp->launch_ns, op_key, stream,
+                                 plan.alpha, plan.use_pcie);
+        }
+    }
+
+    // The sub-communicators are split from comm here, on first use (every rank reaches
+    // the same first large AllReduce outside an NCCL group; grouped ones stay flat until
+    // then), so communicators that never carry one pay nothing.
+    static bool UseHierarchical(CommDomain* domain, size_t bytes, size_t count, void* comm) {
+        const NodeTopology& topo = domain->topology();
+        return topo.IsMultiNode() && bytes >= Config::GetHierMinBytes() &&
+               count % static_cast<size_t>(topo.local_size) == 0 && domain->EnsureHierComms(comm);
+    }
+
+    // Hierarchical AllReduce over the node-local (intra) and cross-node (inter) fast
+    // sub-communicators. The buffer is split into a fast part [0, F) and a PCIe part
+    // [F, count), both multiples of local_size elements; each part is reduce-scattered
+    // within the node, its local chunk all-reduced across nodes over the NIC, then
+    // all-gathered within the node. Only the intra phases run on PCIe, so alpha is
+    // learned under its own key (HierIntra) rather than the flat AllReduce one.
+    // The PCIe part's phases are chained across the two streams with device events
+    // (hier_rs_done / hier_ar_done), so the launch never blocks the host; without a
+    // runtime that can chain streams, or inside an NCCL group (where the inter-node
+    // AllReduce launches only at GroupEnd, after hier_ar_done would have been recorded),
+    // the whole buffer takes the fast part. A PCIe phase
+    // that fails to launch quarantines PCCL and fails the collective; the inter-node
+    // AllReduce of the PCIe chunk is still issued so the other nodes' calls pair up. A
+    // missed deadline is only caught for the final all-gather (at stream sync), as a
+    // stalled reduce-scatter holds the caller's stream behind its event.
+    static BackendResult HierarchicalAllReduce(
+        CommDomain* domain,
+        const void* sendbuff,
+        void* recvbuff,
+        size_t count,
+        int datatype,
+        int op,
+        void* stream,
+        TraceStamp* stamp
+    ) {
+        const NodeTopology& topo = domain->topology();
+        const HierComms& hc = domain->hier_comms();
+        size_t elem_size = GetDataTypeSize(datatype);
+        size_t local_size = static_cast<size_t>(topo.local_size);
+
+        OpKey op_key;
+        op_key.op = CollectiveType::HierIntra;
+        op_key.bytes = count * elem_size;
+        op_key.datatype = datatype;
+        domain->stat_reducer()->MarkInUse(op_key);
+
+        bool use_pcie = domain->controller->UsePCIe(op_key, domain->param_cache) && domain->SplitsAgreed();
+        double alpha = domain->controller->SuggestAlpha(op_key, domain->param_cache);
+        Plan plan = Planner::CreatePlan(op_key.bytes, alpha, use_pcie);
+
+        // Align the split to whole reduce-scatter rows (local_size elements).
+        void* pcie_stream = domain->pcie_stream();
+        size_t fast_elems = count;
+        if (plan.use_pcie && pcie_stream && domain->hier_rs_done().Available() &&
+            domain->hier_ar_done().Available() && !InGroup()) {
+            fast_elems = (plan.fast_bytes / elem_size) / local_size * local_size;
+        }
+        size_t pcie_elems = count - fast_elems;
+        plan.fast_bytes = fast_elems * elem_size;
+        plan.pcie_bytes = pcie_elems * elem_size;
+        plan.use_pcie = pcie_elems > 0;
+
+        AMPCCL_LOG(INFO, "AllReduce hierarchical: bytes=%zu nodes=%d local_size=%d alpha=%.3f fast_bytes=%zu pcie_bytes=%zu",
+                   op_key.bytes, topo.num_nodes, topo.local_size, alpha, plan.fast_bytes, plan.pcie_bytes);
+        // The phase launches of both parts are charged to the libraries rather than itemised.
+        HookOverhead::Enter(HookPhase::Launch);
+        HookOverhead::Pause();
+
+        const char* send = static_cast<const char*>(sendbuff);
+        char* recv = static_cast<char*>(recvbuff);
+        bool fast_ok = true;
+        bool pcie_ok = true;
+
+        // PCIe part, phase 1 on the PCIe stream.
+        size_t pcie_chunk = pcie_elems / local_size;
+        char* pcie_mine = recv + (fast_elems + topo.local_rank * pcie_chunk) * elem_size;
+        if (plan.use_pcie) {
+            domain->timer_pcie().Start(pcie_stream);
+            pcie_ok = PCIeBackendImpl::ReduceScatter(
+                          domain, send + fast_elems * elem_size, pcie_mine, pcie_chunk,
+                          datatype, op, pcie_stream) == BackendResult::Success &&
+                      domain->hier_rs_done().Record(pcie_stream);
+        }
+
+        // Fast part: all three phases in order on the caller's stream.
+        if (fast_elems > 0) {
+            size_t fast_chunk = fast_elems / local_size;
+            char* fast_mine = recv + topo.local_rank * fast_chunk * elem_size;
+            domain->timer_fast().Start(stream);
+            fast_ok = FastBackendImpl::ReduceScatter(
+                          send, fast_mine, fast_chunk, datatype, op, hc.intra, stream) == BackendResult::Success &&
+                      FastBackendImpl::AllReduce(
+                          fast_mine, fast_mine, fast_chunk, datatype, op, hc.inter, stream) == BackendResult::Success &&
+                      FastBackendImpl::AllGather(
+                          fast_mine, recv, fast_chunk, datatype, hc.intra, stream) == BackendResult::Success;
+            domain->timer_fast().Stop(stream);
+        }
+
+        // PCIe part, phases 2-3: inter-node AllReduce of the chunk on the NIC once the
+        // reduce-scatter is done, then all-gather within the node over PCIe once that is.
+        if (plan.use_pcie) {
+            bool waited = !pcie_ok || domain->hier_rs_done().WaitOn(stream);
+            bool inter_ok = FastBackendImpl::AllReduce(
+                                pcie_mine, pcie_mine, pcie_chunk, datatype, op, hc.inter, stream) ==
+                            BackendResult::Success;
+            fast_ok = fast_ok && waited && inter_ok;
+            if (pcie_ok) {
+                pcie_ok = domain->hier_ar_done().Record(stream) && domain->hier_ar_done().WaitOn(pcie_stream) &&
+                          PCIeBackendImpl::AllGather(
+                              domain, pcie_mine, recv + fast_elems * elem_size, pcie_chunk,
+                              datatype, pcie_chunk * elem_size, pcie_stream) == BackendResult::Success;
+            }
+            if (!pcie_ok) {
+                domain->QuarantinePCIe();
+            }
+            domain->timer_pcie().Stop(pcie_stream);
+        }
+
+        HookOverhead::Resume();
+        HookOverhead::Enter(HookPhase::Register);
+        EndTrace(domain, op_key, plan, stream, stamp);
+        DomainManager::GetInstance().RegisterStreamPending(
+            stream, domain, op_key, plan, fast_ok, pcie_ok, *stamp);
+
+        return (fast_ok && pcie_ok) ? BackendResult::Success : BackendResult::UnhandledError;
+    }
 };
 
 }  // namespace ampccl
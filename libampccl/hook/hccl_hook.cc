@@ -5,10 +5,15 @@
 #include "core/domain_manager.h"
 #include "core/comm_init.h"
 #include "core/stream_sync.h"
+#include "telemetry/overhead.h"
 #include "common/op_key.h"
 #include "common/config.h"
 #include <dlfcn.h>
+#include <cstdint>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
 
 // HCCL types (forward declarations if headers not available)
 #ifndef HCCL_H
@@ -23,6 +28,8 @@ typedef enum { HCCL_REDUCE_SUM = 0, HCCL_REDUCE_MAX, HCCL_REDUCE_MIN } HcclReduc
 typedef void* HcclComm;
 typedef void* aclrtStream;
 typedef struct { char internal[HCCL_UNIQUE_ID_BYTES]; } hcclUniqueId;
+#define HCCL_ROOT_INFO_BYTES 4108
+typedef struct { char internal[HCCL_ROOT_INFO_BYTES]; } HcclRootInfo;
 #else
 #define HCCL_UNIQUE_ID_BYTES sizeof(hcclUniqueId)
 #endif
@@ -31,6 +38,11 @@ typedef struct { char internal[HCCL_UNIQUE_ID_BYTES]; } hcclUniqueId;
 typedef hcclResult_t (*hcclGetUniqueId_t)(hcclUniqueId* uniqueId);
 typedef hcclResult_t (*hcclCommInitRank_t)(HcclComm* comm, unsigned int nranks, hcclUniqueId commId, unsigned int rank);
 typedef hcclResult_t (*hcclCommDestroy_t)(HcclComm comm);
+typedef hcclResult_t (*hcclGetRootInfo_t)(HcclRootInfo* rootInfo);
+typedef hcclResult_t (*hcclCommInitRootInfo_t)(uint32_t nRanks, const HcclRootInfo* rootInfo, uint32_t rank,
+                                               HcclComm* comm);
+typedef hcclResult_t (*hcclCommInitClusterInfo_t)(const char* clusterInfo, uint32_t rank, HcclComm* comm);
+typedef hcclResult_t (*hcclGetRankSize_t)(HcclComm comm, uint32_t* rankSize);
 
 typedef hcclResult_t (*hcclAllReduce_t)(
     const void* sendbuff, void* recvbuff, unsigned long count,
@@ -51,15 +63,86 @@ typedef hcclResult_t (*hcclBroadcast_t)(
 // ACL runtime (for stream sync)
 typedef int (*aclrtSynchronizeStream_t)(aclrtStream stream);
 
+// ACL runtime (statistics AllReduce buffer and private stream)
+typedef int (*aclrtMalloc_t)(void** ptr, size_t size, int policy);
+typedef int (*aclrtFree_t)(void* ptr);
+typedef int (*aclrtMallocHost_t)(void** ptr, size_t size);
+typedef int (*aclrtFreeHost_t)(void* ptr);
+typedef int (*aclrtMemcpyAsync_t)(void* dst, size_t dest_max, const void* src, size_t count,
+                                  int kind, aclrtStream stream);
+typedef int (*aclrtCreateStream_t)(aclrtStream* stream);
+typedef int (*aclrtDestroyStream_t)(aclrtStream stream);
+typedef int (*aclrtSetDevice_t)(int32_t device);
+typedef int (*aclrtGetDevice_t)(int32_t* device);
+// SoC name ("Ascend910B3") for the profile fingerprint.
+typedef const char* (*aclrtGetSocName_t)();
+
 // Function pointers to original HCCL functions
 static hcclGetUniqueId_t orig_hcclGetUniqueId = nullptr;
 static hcclCommInitRank_t orig_hcclCommInitRank = nullptr;
 static hcclCommDestroy_t orig_hcclCommDestroy = nullptr;
+static hcclGetRootInfo_t orig_hcclGetRootInfo = nullptr;
+static hcclCommInitRootInfo_t orig_hcclCommInitRootInfo = nullptr;
+static hcclCommInitClusterInfo_t orig_hcclCommInitClusterInfo = nullptr;
+static hcclGetRankSize_t orig_hcclGetRankSize = nullptr;
 static hcclAllReduce_t orig_hcclAllReduce = nullptr;
 static hcclAllGather_t orig_hcclAllGather = nullptr;
 static hcclReduceScatter_t orig_hcclReduceScatter = nullptr;
 static hcclBroadcast_t orig_hcclBroadcast = nullptr;
 static aclrtSynchronizeStream_t orig_aclrtSynchronizeStream = nullptr;
+static aclrtMalloc_t orig_aclrtMalloc = nullptr;
+static aclrtFree_t orig_aclrtFree = nullptr;
+static aclrtMallocHost_t orig_aclrtMallocHost = nullptr;
+static aclrtFreeHost_t orig_aclrtFreeHost = nullptr;
+static aclrtMemcpyAsync_t orig_aclrtMemcpyAsync = nullptr;
+static aclrtCreateStream_t orig_aclrtCreateStream = nullptr;
+static aclrtDestroyStream_t orig_aclrtDestroyStream = nullptr;
+static aclrtSetDevice_t orig_aclrtSetDevice = nullptr;
+static aclrtGetDevice_t orig_aclrtGetDevice = nullptr;
+static aclrtGetSocName_t orig_aclrtGetSocName = nullptr;
+
+// Fast-path dispatch for VirtualCollective (FastBackendOps): HCCL enums and handles
+// travel through the core as ints and void*.
+static int FastAllReduce(const void* sendbuff, void* recvbuff, size_t count, int datatype, int op,
+                         void* comm, void* stream) {
+    return orig_hcclAllReduce(sendbuff, recvbuff, count, static_cast<HcclDataType>(datatype),
+                              static_cast<HcclReduceOp>(op), static_cast<HcclComm>(comm),
+                              static_cast<aclrtStream>(stream));
+}
+
+static int FastAllGather(const void* sendbuff, void* recvbuff, size_t sendcount, int datatype,
+                         void* comm, void* stream) {
+    return orig_hcclAllGather(sendbuff, recvbuff, sendcount, static_cast<HcclDataType>(datatype),
+                              static_cast<HcclComm>(comm), static_cast<aclrtStream>(stream));
+}
+
+static int FastReduceScatter(const void* sendbuff, void* recvbuff, size_t recvcount, int datatype, int op,
+                             void* comm, void* stream) {
+    return orig_hcclReduceScatter(sendbuff, recvbuff, recvcount, static_cast<HcclDataType>(datatype),
+                                  static_cast<HcclReduceOp>(op), static_cast<HcclComm>(comm),
+                                  static_cast<aclrtStream>(stream));
+}
+
+static int FastBroadcast(const void* sendbuff, void* recvbuff, size_t count, int datatype, int root,
+                         void* comm, void* stream) {
+    return orig_hcclBroadcast(sendbuff, recvbuff, count, static_cast<HcclDataType>(datatype),
+                              static_cast<unsigned int>(root), static_cast<HcclComm>(comm),
+                              static_cast<aclrtStream>(stream));
+}
+
+// HCCL_DATA_TYPE_INT8 .. HCCL_DATA_TYPE_BFP16 (hccl_types.h values).
+static size_t HcclDataTypeSize(int datatype) {
+    static const size_t kSizes[] = {1, 2, 4, 2, 4, 8, 8, 1, 2, 4, 8, 2};
+    return (datatype >= 0 && datatype < 12) ? kSizes[datatype] : 0;
+}
+
+// ACL events carry the timeline flag so aclrtEventElapsedTime works.
+static int (*orig_aclrtCreateEventWithFlag)(void** event, uint32_t flag) = nullptr;
+
+static int CreateTimelineEvent(void** event) {
+    const uint32_t kAclEventTimeLine = 0x00000008u;
+    return orig_aclrtCreateEventWithFlag(event, kAclEventTimeLine);
+}
 
 // Load original HCCL functions
 static void LoadOriginalFunctions() {
@@ -75,10 +158,22 @@ static void LoadOriginalFunctions() {
         orig_hcclGetUniqueId = (hcclGetUniqueId_t)dlsym(handle, "HcclGetUniqueId");
         orig_hcclCommInitRank = (hcclCommInitRank_t)dlsym(handle, "HcclCommInitRank");
         orig_hcclCommDestroy = (hcclCommDestroy_t)dlsym(handle, "HcclCommDestroy");
+        orig_hcclGetRootInfo = (hcclGetRootInfo_t)dlsym(handle, "HcclGetRootInfo");
+        orig_hcclCommInitRootInfo = (hcclCommInitRootInfo_t)dlsym(handle, "HcclCommInitRootInfo");
+        orig_hcclCommInitClusterInfo = (hcclCommInitClusterInfo_t)dlsym(handle, "HcclCommInitClusterInfo");
+        orig_hcclGetRankSize = (hcclGetRankSize_t)dlsym(handle, "HcclGetRankSize");
         orig_hcclAllReduce = (hcclAllReduce_t)dlsym(handle, "HcclAllReduce");
         orig_hcclAllGather = (hcclAllGather_t)dlsym(handle, "HcclAllGather");
         orig_hcclReduceScatter = (hcclReduceScatter_t)dlsym(handle, "HcclReduceScatter");
         orig_hcclBroadcast = (hcclBroadcast_t)dlsym(handle, "HcclBroadcast");
+
+        ampccl::FastBackendOps ops;
+        ops.all_reduce = orig_hcclAllReduce ? &FastAllReduce : nullptr;
+        ops.all_gather = orig_hcclAllGather ? &FastAllGather : nullptr;
+        ops.reduce_scatter = orig_hcclReduceScatter ? &FastReduceScatter : nullptr;
+        ops.broadcast = orig_hcclBroadcast ? &FastBroadcast : nullptr;
+        ops.datatype_size = &HcclDataTypeSize;
+        ampccl::FastBackendImpl::SetOps(ops);
     }
 
     // ACL runtime for aclrtSynchronizeStream (may be in same lib or libascendcl/libacl)
@@ -89,25 +184,182 @@ static void LoadOriginalFunctions() {
         }
         if (acl_handle) {
             orig_aclrtSynchronizeStream = (aclrtSynchronizeStream_t)dlsym(acl_handle, "aclrtSynchronizeStream");
+            orig_aclrtMalloc = (aclrtMalloc_t)dlsym(acl_handle, "aclrtMalloc");
+            orig_aclrtFree = (aclrtFree_t)dlsym(acl_handle, "aclrtFree");
+            orig_aclrtMallocHost = (aclrtMallocHost_t)dlsym(acl_handle, "aclrtMallocHost");
+            orig_aclrtFreeHost = (aclrtFreeHost_t)dlsym(acl_handle, "aclrtFreeHost");
+            orig_aclrtMemcpyAsync = (aclrtMemcpyAsync_t)dlsym(acl_handle, "aclrtMemcpyAsync");
+            orig_aclrtCreateStream = (aclrtCreateStream_t)dlsym(acl_handle, "aclrtCreateStream");
+            orig_aclrtDestroyStream = (aclrtDestroyStream_t)dlsym(acl_handle, "aclrtDestroyStream");
+            orig_aclrtSetDevice = (aclrtSetDevice_t)dlsym(acl_handle, "aclrtSetDevice");
+            orig_aclrtGetDevice = (aclrtGetDevice_t)dlsym(acl_handle, "aclrtGetDevice");
+            orig_aclrtGetSocName = (aclrtGetSocName_t)dlsym(acl_handle, "aclrtGetSocName");
+            orig_aclrtCreateEventWithFlag =
+                (int (*)(void**, uint32_t))dlsym(acl_handle, "aclrtCreateEventWithFlag");
+
+            ampccl::DeviceEventOps ev;
+            ev.create = orig_aclrtCreateEventWithFlag ? &CreateTimelineEvent : nullptr;
+            ev.destroy = (int (*)(void*))dlsym(acl_handle, "aclrtDestroyEvent");
+            ev.record = (int (*)(void*, void*))dlsym(acl_handle, "aclrtRecordEvent");
+            ev.synchronize = (int (*)(void*))dlsym(acl_handle, "aclrtSynchronizeEvent");
+            ev.elapsed_ms = (int (*)(float*, void*, void*))dlsym(acl_handle, "aclrtEventElapsedTime");
+            ev.stream_wait = (int (*)(void*, void*))dlsym(acl_handle, "aclrtStreamWaitEvent");
+            ampccl::SetRuntimeEventOps(ev);
         }
     }
 
     loaded = true;
 }
 
-// Helper to convert HCCL result to BackendResult
-static ampccl::BackendResult ConvertHCCLResult(hcclResult_t hccl_result) {
-    if (hccl_result == HCCL_SUCCESS) {
-        return ampccl::BackendResult::Success;
-    }
-    return ampccl::BackendResult::UnhandledError;
-}
-
 // Look up domain by raw HCCL communicator (registered at CommInit).
 static ampccl::CommDomain* GetDomainByRawComm(HcclComm comm) {
     return ampccl::DomainManager::GetInstance().GetDomainByRawComm(comm);
 }
 
+// Statistics AllReduce (scheme B): device buffer, pinned host staging (so the copy back
+// does not block the launch) and private stream per domain.
+struct HcclStatScratch {
+    void* dev_buf = nullptr;
+    void* host_buf = nullptr;
+    size_t bytes = 0;
+    aclrtStream stream = nullptr;
+};
+
+static const int kAclMemcpyHostToDevice = 1;
+static const int kAclMemcpyDeviceToHost = 2;
+static const int kHcclDataTypeFp64 = 10;
+static const int kHcclReduceMax = 2;
+
+static void HcclStatFreeBuffers(HcclStatScratch* s) {
+    if (s->dev_buf && orig_aclrtFree) orig_aclrtFree(s->dev_buf);
+    if (s->host_buf && orig_aclrtFreeHost) orig_aclrtFreeHost(s->host_buf);
+    s->dev_buf = nullptr;
+    s->host_buf = nullptr;
+    s->bytes = 0;
+}
+
+static bool HcclStatReduceMaxAsync(const double* values, size_t count, void* raw_comm, void** scratch) {
+    if (!orig_hcclAllReduce || !orig_aclrtMalloc || !orig_aclrtMallocHost || !orig_aclrtMemcpyAsync ||
+        !orig_aclrtCreateStream || !orig_aclrtSynchronizeStream) {
+        return false;
+    }
+    size_t bytes = count * sizeof(double);
+    HcclStatScratch* s = static_cast<HcclStatScratch*>(*scratch);
+    if (s == nullptr) {
+        s = new HcclStatScratch();
+        if (orig_aclrtCreateStream(&s->stream) != 0) {
+            delete s;
+            return false;
+        }
+        *scratch = s;
+    }
+    if (s->bytes < bytes) {
+        // No reduction is in flight here; the sync only orders the frees after the last one.
+        orig_aclrtSynchronizeStream(s->stream);
+        HcclStatFreeBuffers(s);
+        if (orig_aclrtMalloc(&s->dev_buf, bytes, 0) != 0 || orig_aclrtMallocHost(&s->host_buf, bytes) != 0) {
+            HcclStatFreeBuffers(s);
+            return false;
+        }
+        s->bytes = bytes;
+    }
+    std::memcpy(s->host_buf, values, bytes);
+    if (orig_aclrtMemcpyAsync(s->dev_buf, s->bytes, s->host_buf, bytes, kAclMemcpyHostToDevice, s->stream) != 0) {
+        return false;
+    }
+    hcclResult_t ret = orig_hcclAllReduce(s->dev_buf, s->dev_buf, count,
+                                          static_cast<HcclDataType>(kHcclDataTypeFp64),
+                                          static_cast<HcclReduceOp>(kHcclReduceMax),
+                                          static_cast<HcclComm>(raw_comm), s->stream);
+    if (ret != HCCL_SUCCESS) {
+        return false;
+    }
+    return orig_aclrtMemcpyAsync(s->host_buf, s->bytes, s->dev_buf, bytes, kAclMemcpyDeviceToHost, s->stream) == 0;
+}
+
+static bool HcclStatWait(double* values, size_t count, void* scratch) {
+    HcclStatScratch* s = static_cast<HcclStatScratch*>(scratch);
+    size_t bytes = count * sizeof(double);
+    // Original sync: must not re-enter OnStreamSynchronized.
+    if (s == nullptr || s->bytes < bytes || orig_aclrtSynchronizeStream(s->stream) != 0) {
+        return false;
+    }
+    std::memcpy(values, s->host_buf, bytes);
+    return true;
+}
+
+static bool HcclStatReduceMax(double* values, size_t count, void* raw_comm, void** scratch) {
+    return HcclStatReduceMaxAsync(values, count, raw_comm, scratch) && HcclStatWait(values, count, *scratch);
+}
+
+static void HcclStatRelease(void* scratch) {
+    HcclStatScratch* s = static_cast<HcclStatScratch*>(scratch);
+    if (s == nullptr) return;
+    if (s->stream && orig_aclrtSynchronizeStream) orig_aclrtSynchronizeStream(s->stream);
+    HcclStatFreeBuffers(s);
+    if (s->stream && orig_aclrtDestroyStream) orig_aclrtDestroyStream(s->stream);
+    delete s;
+}
+
+// Domain setup after any communicator creation path. table: the rank table describing
+// comm, or nullptr; it gives the node grouping (one node per server), so no rank info
+// is exchanged, and places the PCCL ranks' host chunks on their devices' NUMA nodes.
+static ampccl::CommDomain* SetupDomain(HcclComm comm, ampccl::CommDomainKey key, int rank, int nranks,
+                                       const ampccl::RankTable* table) {
+    ampccl::StatReduceOps ops;
+    ops.reduce_max = &HcclStatReduceMax;
+    ops.reduce_max_async = &HcclStatReduceMaxAsync;
+    ops.wait_reduce = &HcclStatWait;
+    ops.release = &HcclStatRelease;
+    ampccl::NodeTopology topo = ampccl::BuildNodeTopology(rank, nranks, ampccl::Config::GetLocalSize());
+    if (!table && ampccl::NeedsRankInfoExchange(nranks, nullptr)) {
+        ampccl::ExchangeRankInfo(&key, rank, ops, comm, &topo);
+    }
+    ampccl::DomainManager::GetInstance().RegisterRawComm(comm, key, rank);
+    ampccl::CommDomain* domain = ampccl::DomainManager::GetInstance().GetDomainByRawComm(comm);
+    if (!domain) {
+        return nullptr;
+    }
+    domain->set_comm_rank(rank);
+    int32_t device = -1;
+    if (orig_aclrtGetDevice && orig_aclrtGetDevice(&device) == 0) {
+        domain->set_device(device, orig_aclrtSetDevice);
+    }
+    // Node grouping only: HCCL sub-communicators need HcclCreateSubCommConfig, so the
+    // hierarchical AllReduce path stays NCCL-only; PCCL is still grouped per node.
+    if (table) {
+        topo = table->Topology(rank);
+        domain->set_pcie_numa(table->GroupNuma(rank));
+        AMPCCL_LOG(INFO, "HCCL: rank %d from rank table: server %d of %zu, device %d, numa %d", rank,
+                   table->placement(rank).server, table->servers().size(), table->placement(rank).device_id,
+                   table->placement(rank).numa_node);
+    }
+    domain->set_topology(topo);
+    const char* soc = orig_aclrtGetSocName ? orig_aclrtGetSocName() : nullptr;
+    ampccl::DomainManager::GetInstance().LoadProfile(domain, "hccl", soc != nullptr ? soc : "");
+    if (nranks > 1 && ampccl::Config::GetStatSyncMode(nranks, topo.local_size) == ampccl::StatSyncMode::ALLREDUCE &&
+        !domain->stat_reducer()->IsEnabled()) {
+        domain->stat_reducer()->Configure(ops, comm, ampccl::Config::GetStatSyncInterval());
+    }
+    ampccl::InitPCIeForDomain(domain, rank, nranks);
+    return domain;
+}
+
+// The job's rank table (Config::GetRankTableFile) if it describes nranks ranks, for
+// communicators created without one; every rank reads the same file, so all decide alike.
+static const ampccl::RankTable* LoadJobRankTable(int nranks, ampccl::RankTable* table) {
+    const char* path = ampccl::Config::GetRankTableFile();
+    std::string error;
+    if (path == nullptr) {
+        return nullptr;
+    }
+    if (!table->Load(path, &error)) {
+        AMPCCL_LOG(WARN, "HCCL: ignoring rank table %s: %s", path, error.c_str());
+        return nullptr;
+    }
+    return table->size() == nranks ? table : nullptr;
+}
+
 // Hooked HCCL functions
 extern "C" {
 
@@ -125,25 +377,98 @@ hcclResult_t HcclCommInitRank(HcclComm* comm, unsigned int nranks, hcclUniqueId
         return HCCL_INVALID_PARAM;
     }
     hcclResult_t ret = orig_hcclCommInitRank(comm, nranks, commId, rank);
-    if (ret != HCCL_SUCCESS || comm == nullptr || *comm == nullptr) {
+    if (ret != HCCL_SUCCESS || comm == nullptr || *comm == nullptr || !ampccl::Config::IsAdaptiveEnabled()) {
+        return ret;
+    }
+    SetupDomain(*comm,
+                ampccl::BuildKeyFromHcclInit(static_cast<int>(nranks), &commId, HCCL_UNIQUE_ID_BYTES,
+                                             static_cast<int>(rank)),
+                static_cast<int>(rank), static_cast<int>(nranks), nullptr);
+    return ret;
+}
+
+hcclResult_t HcclGetRootInfo(HcclRootInfo* rootInfo) {
+    LoadOriginalFunctions();
+    if (orig_hcclGetRootInfo) {
+        return orig_hcclGetRootInfo(rootInfo);
+    }
+    return HCCL_INVALID_PARAM;
+}
+
+// Keyed by the root info like HcclCommInitRank; the job's rank table, when it covers the
+// communicator, adds the device placement to the key, topology and IR.
+hcclResult_t HcclCommInitRootInfo(uint32_t nRanks, const HcclRootInfo* rootInfo, uint32_t rank, HcclComm* comm) {
+    LoadOriginalFunctions();
+    if (!orig_hcclCommInitRootInfo) {
+        return HCCL_INVALID_PARAM;
+    }
+    hcclResult_t ret = orig_hcclCommInitRootInfo(nRanks, rootInfo, rank, comm);
+    if (ret != HCCL_SUCCESS || comm == nullptr || *comm == nullptr || rootInfo == nullptr ||
+        !ampccl::Config::IsAdaptiveEnabled()) {
+        return ret;
+    }
+    int n = static_cast<int>(nRanks);
+    ampccl::CommDomainKey key =
+        ampccl::BuildKeyFromHcclInit(n, rootInfo, HCCL_ROOT_INFO_BYTES, static_cast<int>(rank));
+    ampccl::RankTable table;
+    const ampccl::RankTable* placement = LoadJobRankTable(n, &table);
+    if (placement) {
+        key.placement = placement->Digest();
+    }
+    SetupDomain(*comm, key, static_cast<int>(rank), n, placement);
+    return ret;
+}
+
+// clusterInfo is the rank table path. It names the communicator (BuildKeyFromRankTable);
+// an unreadable table still registers the communicator, keyed by the path.
+hcclResult_t HcclCommInitClusterInfo(const char* clusterInfo, uint32_t rank, HcclComm* comm) {
+    LoadOriginalFunctions();
+    if (!orig_hcclCommInitClusterInfo) {
+        return HCCL_INVALID_PARAM;
+    }
+    hcclResult_t ret = orig_hcclCommInitClusterInfo(clusterInfo, rank, comm);
+    if (ret != HCCL_SUCCESS || comm == nullptr || *comm == nullptr || clusterInfo == nullptr ||
+        !ampccl::Config::IsAdaptiveEnabled()) {
         return ret;
     }
-    if (!ampccl::Config::IsAdaptiveEnabled()) {
+    // Communicators created from the same table, per process (same order on every rank).
+    static std::mutex seq_mu;
+    static std::map<uint64_t, uint64_t> seqs;
+    ampccl::RankTable table;
+    std::string error;
+    if (table.Load(clusterInfo, &error)) {
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(seq_mu);
+            seq = seqs[table.Digest().lo]++;
+        }
+        SetupDomain(*comm, ampccl::BuildKeyFromRankTable(table, seq), static_cast<int>(rank), table.size(),
+                    &table);
+        return ret;
+    }
+    uint32_t n = 0;
+    if (!orig_hcclGetRankSize || orig_hcclGetRankSize(*comm, &n) != HCCL_SUCCESS) {
+        AMPCCL_LOG(WARN, "HCCL: rank table %s: %s; communicator not managed", clusterInfo, error.c_str());
         return ret;
     }
-    ampccl::CommDomainKey key = ampccl::BuildKeyFromHcclInit(
-        static_cast<int>(nranks), &commId, HCCL_UNIQUE_ID_BYTES, static_cast<int>(rank));
-    ampccl::DomainManager::GetInstance().RegisterRawComm(*comm, key);
-    ampccl::CommDomain* domain = ampccl::DomainManager::GetInstance().GetDomainByRawComm(*comm);
-    if (domain) {
-        ampccl::InitPCIeForDomain(domain, static_cast<int>(rank), static_cast<int>(nranks));
+    AMPCCL_LOG(WARN, "HCCL: rank table %s: %s; keying by path", clusterInfo, error.c_str());
+    std::string id = clusterInfo;
+    {
+        std::lock_guard<std::mutex> lock(seq_mu);
+        id += "#" + std::to_string(seqs[ampccl::SipHasher128().UpdateString(id).Finalize().lo]++);
     }
+    SetupDomain(*comm, ampccl::BuildKeyFromHcclInit(static_cast<int>(n), id.data(), id.size(), static_cast<int>(rank)),
+                static_cast<int>(rank), static_cast<int>(n), nullptr);
     return ret;
 }
 
 hcclResult_t HcclCommDestroy(HcclComm comm) {
     LoadOriginalFunctions();
     if (ampccl::Config::IsAdaptiveEnabled()) {
+        ampccl::CommDomain* domain = GetDomainByRawComm(comm);
+        if (domain) {
+            domain->stat_reducer()->DetachComm(comm);
+        }
         ampccl::DomainManager::GetInstance().UnregisterRawComm(comm);
     }
     if (orig_hcclCommDestroy) {
@@ -156,22 +481,28 @@ hcclResult_t HcclAllReduce(
     const void* sendbuff, void* recvbuff, unsigned long count,
     HcclDataType datatype, HcclReduceOp op, HcclComm comm, aclrtStream stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::AllReduce);
     LoadOriginalFunctions();
     if (!ampccl::Config::IsAdaptiveEnabled() && orig_hcclAllReduce) {
+        ampccl::HookOverhead::Done();
         return orig_hcclAllReduce(sendbuff, recvbuff, count, datatype, op, comm, stream);
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Lookup);
     ampccl::CommDomain* domain = GetDomainByRawComm(comm);
     if (!domain) {
+        ampccl::HookOverhead::Done();
         if (orig_hcclAllReduce) {
             return orig_hcclAllReduce(sendbuff, recvbuff, count, datatype, op, comm, stream);
         }
         return HCCL_INVALID_PARAM;
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Refresh);
     ampccl::BackendResult result = ampccl::VirtualCollective::AllReduce(
         domain, sendbuff, recvbuff, count,
         static_cast<int>(datatype), static_cast<int>(op), comm, stream);
+    ampccl::HookOverhead::Done();
 
     return (result == ampccl::BackendResult::Success) ? HCCL_SUCCESS : HCCL_INVALID_PARAM;
 }
@@ -180,22 +511,28 @@ hcclResult_t HcclAllGather(
     const void* sendbuff, void* recvbuff, unsigned long sendcount,
     HcclDataType datatype, HcclComm comm, aclrtStream stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::AllGather);
     LoadOriginalFunctions();
     if (!ampccl::Config::IsAdaptiveEnabled() && orig_hcclAllGather) {
+        ampccl::HookOverhead::Done();
         return orig_hcclAllGather(sendbuff, recvbuff, sendcount, datatype, comm, stream);
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Lookup);
     ampccl::CommDomain* domain = GetDomainByRawComm(comm);
     if (!domain) {
+        ampccl::HookOverhead::Done();
         if (orig_hcclAllGather) {
             return orig_hcclAllGather(sendbuff, recvbuff, sendcount, datatype, comm, stream);
         }
         return HCCL_INVALID_PARAM;
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Refresh);
     ampccl::BackendResult result = ampccl::VirtualCollective::AllGather(
         domain, sendbuff, recvbuff, sendcount,
         static_cast<int>(datatype), comm, stream);
+    ampccl::HookOverhead::Done();
 
     return (result == ampccl::BackendResult::Success) ? HCCL_SUCCESS : HCCL_INVALID_PARAM;
 }
@@ -204,7 +541,9 @@ hcclResult_t HcclReduceScatter(
     const void* sendbuff, void* recvbuff, unsigned long recvcount,
     HcclDataType datatype, HcclReduceOp op, HcclComm comm, aclrtStream stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::ReduceScatter);
     LoadOriginalFunctions();
+    ampccl::HookOverhead::Done();
     if (orig_hcclReduceScatter) {
         return orig_hcclReduceScatter(sendbuff, recvbuff, recvcount, datatype, op, comm, stream);
     }
@@ -215,7 +554,9 @@ hcclResult_t HcclBroadcast(
     const void* sendbuff, void* recvbuff, unsigned long count,
     HcclDataType datatype, unsigned int root, HcclComm comm, aclrtStream stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::Broadcast);
     LoadOriginalFunctions();
+    ampccl::HookOverhead::Done();
     if (orig_hcclBroadcast) {
         return orig_hcclBroadcast(sendbuff, recvbuff, count, datatype, root, comm, stream);
     }
@@ -223,14 +564,22 @@ hcclResult_t HcclBroadcast(
 }
 
 int aclrtSynchronizeStream(aclrtStream stream) {
+    ampccl::HookOverhead::Begin(ampccl::HookOp::StreamSync);
     LoadOriginalFunctions();
     if (orig_aclrtSynchronizeStream) {
+        ampccl::HookOverhead::Pause();
         int ret = orig_aclrtSynchronizeStream(stream);
+        ampccl::HookOverhead::Resume();
         if (ret == 0 && ampccl::Config::IsAdaptiveEnabled()) {
-            ampccl::OnStreamSynchronized(stream);
+            ampccl::HookOverhead::Enter(ampccl::HookPhase::Complete);
+            if (!ampccl::OnStreamSynchronized(stream)) {
+                ret = 500000;  // ACL_ERROR_INTERNAL_ERROR: the collective pending on the stream failed
+            }
         }
+        ampccl::HookOverhead::Done();
         return ret;
     }
+    ampccl::HookOverhead::Done();
     return -1;
 }
 
@@ -4,11 +4,21 @@
 #include "core/virtual_collective.h"
 #include "core/domain_manager.h"
 #include "core/comm_init.h"
+#include "core/group_scope.h"
 #include "core/stream_sync.h"
+#include "telemetry/overhead.h"
 #include "common/op_key.h"
 #include "common/config.h"
 #include <dlfcn.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 // NCCL types (forward declarations if headers not available)
 #ifndef NCCL_H
@@ -18,6 +28,7 @@ typedef enum { ncclSum, ncclProd, ncclMax, ncclMin } ncclRedOp_t;
 typedef void* ncclComm_t;
 typedef void* cudaStream_t;
 typedef struct { char internal[NCCL_UNIQUE_ID_BYTES]; } ncclUniqueId;
+typedef struct ncclConfig_v21700 ncclConfig_t;  // Only passed through
 #else
 #define NCCL_UNIQUE_ID_BYTES sizeof(ncclUniqueId)
 #endif
@@ -25,7 +36,17 @@ typedef struct { char internal[NCCL_UNIQUE_ID_BYTES]; } ncclUniqueId;
 // Forward declarations for original NCCL functions
 typedef int (*ncclGetUniqueId_t)(ncclUniqueId* uniqueId);
 typedef int (*ncclCommInitRank_t)(ncclComm_t* comm, int nranks, ncclUniqueId commId, int myrank);
+typedef int (*ncclCommInitRankConfig_t)(ncclComm_t* comm, int nranks, ncclUniqueId commId, int myrank,
+                                        ncclConfig_t* config);
+typedef int (*ncclCommInitRankScalable_t)(ncclComm_t* newcomm, int nranks, int myrank, int nId,
+                                          ncclUniqueId* commIds, ncclConfig_t* config);
+typedef int (*ncclCommInitAll_t)(ncclComm_t* comms, int ndev, const int* devlist);
 typedef int (*ncclCommDestroy_t)(ncclComm_t comm);
+typedef int (*ncclCommSplit_t)(ncclComm_t comm, int color, int key, ncclComm_t* newcomm, ncclConfig_t* config);
+typedef int (*ncclCommCount_t)(ncclComm_t comm, int* count);
+typedef int (*ncclCommUserRank_t)(ncclComm_t comm, int* rank);
+typedef int (*ncclGroupStart_t)();
+typedef int (*ncclGroupEnd_t)();
 
 typedef int (*ncclAllReduce_t)(
     const void* sendbuff, void* recvbuff, size_t count,
@@ -46,15 +67,89 @@ typedef int (*ncclBroadcast_t)(
 // CUDA runtime (for stream sync)
 typedef int (*cudaStreamSynchronize_t)(cudaStream_t stream);  // cudaError_t
 
+// CUDA runtime (statistics AllReduce buffer and private stream)
+typedef int (*cudaMalloc_t)(void** ptr, size_t size);
+typedef int (*cudaFree_t)(void* ptr);
+typedef int (*cudaMallocHost_t)(void** ptr, size_t size);
+typedef int (*cudaFreeHost_t)(void* ptr);
+typedef int (*cudaMemcpyAsync_t)(void* dst, const void* src, size_t count, int kind, cudaStream_t stream);
+typedef int (*cudaStreamCreateWithFlags_t)(cudaStream_t* stream, unsigned int flags);
+typedef int (*cudaStreamDestroy_t)(cudaStream_t stream);
+
+// CUDA runtime (per-device PCIe init for ncclCommInitAll, lazy PCIe init thread)
+typedef int (*cudaSetDevice_t)(int device);
+typedef int (*cudaGetDevice_t)(int* device);
+// Device model name for the profile fingerprint; prop is a cudaDeviceProp.
+typedef int (*cudaGetDeviceProperties_t)(void* prop, int device);
+
 // Function pointers to original NCCL functions
 static ncclGetUniqueId_t orig_ncclGetUniqueId = nullptr;
 static ncclCommInitRank_t orig_ncclCommInitRank = nullptr;
+static ncclCommInitRankConfig_t orig_ncclCommInitRankConfig = nullptr;
+static ncclCommInitRankScalable_t orig_ncclCommInitRankScalable = nullptr;
+static ncclCommInitAll_t orig_ncclCommInitAll = nullptr;
 static ncclCommDestroy_t orig_ncclCommDestroy = nullptr;
+static ncclCommSplit_t orig_ncclCommSplit = nullptr;
+static ncclCommCount_t orig_ncclCommCount = nullptr;
+static ncclCommUserRank_t orig_ncclCommUserRank = nullptr;
+static ncclGroupStart_t orig_ncclGroupStart = nullptr;
+static ncclGroupEnd_t orig_ncclGroupEnd = nullptr;
 static ncclAllReduce_t orig_ncclAllReduce = nullptr;
 static ncclAllGather_t orig_ncclAllGather = nullptr;
 static ncclReduceScatter_t orig_ncclReduceScatter = nullptr;
 static ncclBroadcast_t orig_ncclBroadcast = nullptr;
 static cudaStreamSynchronize_t orig_cudaStreamSynchronize = nullptr;
+static cudaMalloc_t orig_cudaMalloc = nullptr;
+static cudaFree_t orig_cudaFree = nullptr;
+static cudaMallocHost_t orig_cudaMallocHost = nullptr;
+static cudaFreeHost_t orig_cudaFreeHost = nullptr;
+static cudaMemcpyAsync_t orig_cudaMemcpyAsync = nullptr;
+static cudaStreamCreateWithFlags_t orig_cudaStreamCreateWithFlags = nullptr;
+static cudaStreamDestroy_t orig_cudaStreamDestroy = nullptr;
+static cudaSetDevice_t orig_cudaSetDevice = nullptr;
+static cudaGetDevice_t orig_cudaGetDevice = nullptr;
+static cudaGetDeviceProperties_t orig_cudaGetDeviceProperties = nullptr;
+
+// Fast-path dispatch for VirtualCollective (FastBackendOps): NCCL enums and handles
+// travel through the core as ints and void*.
+static int FastAllReduce(const void* sendbuff, void* recvbuff, size_t count, int datatype, int op,
+                         void* comm, void* stream) {
+    return orig_ncclAllReduce(sendbuff, recvbuff, count, static_cast<ncclDataType_t>(datatype),
+                              static_cast<ncclRedOp_t>(op), static_cast<ncclComm_t>(comm),
+                              static_cast<cudaStream_t>(stream));
+}
+
+static int FastAllGather(const void* sendbuff, void* recvbuff, size_t sendcount, int datatype,
+                         void* comm, void* stream) {
+    return orig_ncclAllGather(sendbuff, recvbuff, sendcount, static_cast<ncclDataType_t>(datatype),
+                              static_cast<ncclComm_t>(comm), static_cast<cudaStream_t>(stream));
+}
+
+static int FastReduceScatter(const void* sendbuff, void* recvbuff, size_t recvcount, int datatype, int op,
+                             void* comm, void* stream) {
+    return orig_ncclReduceScatter(sendbuff, recvbuff, recvcount, static_cast<ncclDataType_t>(datatype),
+                                  static_cast<ncclRedOp_t>(op), static_cast<ncclComm_t>(comm),
+                                  static_cast<cudaStream_t>(stream));
+}
+
+static int FastBroadcast(const void* sendbuff, void* recvbuff, size_t count, int datatype, int root,
+                         void* comm, void* stream) {
+    return orig_ncclBroadcast(sendbuff, recvbuff, count, static_cast<ncclDataType_t>(datatype), root,
+                              static_cast<ncclComm_t>(comm), static_cast<cudaStream_t>(stream));
+}
+
+// ncclInt8 .. ncclBfloat16 (nccl.h values).
+static size_t NcclDataTypeSize(int datatype) {
+    static const size_t kSizes[] = {1, 1, 4, 4, 8, 8, 2, 4, 8, 2};
+    return (datatype >= 0 && datatype < 10) ? kSizes[datatype] : 0;
+}
+
+// cudaStreamWaitEvent with default flags, for DeviceEventOps::stream_wait.
+static int (*orig_cudaStreamWaitEvent)(void* stream, void* event, unsigned int flags) = nullptr;
+
+static int StreamWaitEvent(void* stream, void* event) {
+    return orig_cudaStreamWaitEvent(stream, event, 0);
+}
 
 // Load original NCCL functions
 static void LoadOriginalFunctions() {
@@ -69,11 +164,29 @@ static void LoadOriginalFunctions() {
     if (handle) {
         orig_ncclGetUniqueId = (ncclGetUniqueId_t)dlsym(handle, "ncclGetUniqueId");
         orig_ncclCommInitRank = (ncclCommInitRank_t)dlsym(handle, "ncclCommInitRank");
+        orig_ncclCommInitRankConfig =
+            (ncclCommInitRankConfig_t)dlsym(handle, "ncclCommInitRankConfig");  // NCCL >= 2.14
+        orig_ncclCommInitRankScalable =
+            (ncclCommInitRankScalable_t)dlsym(handle, "ncclCommInitRankScalable");  // NCCL >= 2.23
+        orig_ncclCommInitAll = (ncclCommInitAll_t)dlsym(handle, "ncclCommInitAll");
         orig_ncclCommDestroy = (ncclCommDestroy_t)dlsym(handle, "ncclCommDestroy");
+        orig_ncclCommSplit = (ncclCommSplit_t)dlsym(handle, "ncclCommSplit");  // NCCL >= 2.18
+        orig_ncclCommCount = (ncclCommCount_t)dlsym(handle, "ncclCommCount");
+        orig_ncclCommUserRank = (ncclCommUserRank_t)dlsym(handle, "ncclCommUserRank");
+        orig_ncclGroupStart = (ncclGroupStart_t)dlsym(handle, "ncclGroupStart");
+        orig_ncclGroupEnd = (ncclGroupEnd_t)dlsym(handle, "ncclGroupEnd");
         orig_ncclAllReduce = (ncclAllReduce_t)dlsym(handle, "ncclAllReduce");
         orig_ncclAllGather = (ncclAllGather_t)dlsym(handle, "ncclAllGather");
         orig_ncclReduceScatter = (ncclReduceScatter_t)dlsym(handle, "ncclReduceScatter");
         orig_ncclBroadcast = (ncclBroadcast_t)dlsym(handle, "ncclBroadcast");
+
+        ampccl::FastBackendOps ops;
+        ops.all_reduce = orig_ncclAllReduce ? &FastAllReduce : nullptr;
+        ops.all_gather = orig_ncclAllGather ? &FastAllGather : nullptr;
+        ops.reduce_scatter = orig_ncclReduceScatter ? &FastReduceScatter : nullptr;
+        ops.broadcast = orig_ncclBroadcast ? &FastBroadcast : nullptr;
+        ops.datatype_size = &NcclDataTypeSize;
+        ampccl::FastBackendImpl::SetOps(ops);
     }
 
     // CUDA runtime for cudaStreamSynchronize
@@ -81,28 +194,306 @@ static void LoadOriginalFunctions() {
         void* cuda_handle = dlopen("libcudart.so", RTLD_LAZY);
         if (cuda_handle) {
             orig_cudaStreamSynchronize = (cudaStreamSynchronize_t)dlsym(cuda_handle, "cudaStreamSynchronize");
+            orig_cudaMalloc = (cudaMalloc_t)dlsym(cuda_handle, "cudaMalloc");
+            orig_cudaFree = (cudaFree_t)dlsym(cuda_handle, "cudaFree");
+            orig_cudaMallocHost = (cudaMallocHost_t)dlsym(cuda_handle, "cudaMallocHost");
+            orig_cudaFreeHost = (cudaFreeHost_t)dlsym(cuda_handle, "cudaFreeHost");
+            orig_cudaMemcpyAsync = (cudaMemcpyAsync_t)dlsym(cuda_handle, "cudaMemcpyAsync");
+            orig_cudaStreamCreateWithFlags =
+                (cudaStreamCreateWithFlags_t)dlsym(cuda_handle, "cudaStreamCreateWithFlags");
+            orig_cudaStreamDestroy = (cudaStreamDestroy_t)dlsym(cuda_handle, "cudaStreamDestroy");
+            orig_cudaSetDevice = (cudaSetDevice_t)dlsym(cuda_handle, "cudaSetDevice");
+            orig_cudaGetDevice = (cudaGetDevice_t)dlsym(cuda_handle, "cudaGetDevice");
+            orig_cudaGetDeviceProperties =
+                (cudaGetDeviceProperties_t)dlsym(cuda_handle, "cudaGetDeviceProperties");
+
+            ampccl::DeviceEventOps ev;
+            ev.create = (int (*)(void**))dlsym(cuda_handle, "cudaEventCreate");
+            ev.destroy = (int (*)(void*))dlsym(cuda_handle, "cudaEventDestroy");
+            ev.record = (int (*)(void*, void*))dlsym(cuda_handle, "cudaEventRecord");
+            ev.synchronize = (int (*)(void*))dlsym(cuda_handle, "cudaEventSynchronize");
+            ev.elapsed_ms = (int (*)(float*, void*, void*))dlsym(cuda_handle, "cudaEventElapsedTime");
+            orig_cudaStreamWaitEvent =
+                (int (*)(void*, void*, unsigned int))dlsym(cuda_handle, "cudaStreamWaitEvent");
+            ev.stream_wait = orig_cudaStreamWaitEvent ? &StreamWaitEvent : nullptr;
+            ampccl::SetRuntimeEventOps(ev);
         }
     }
 
     loaded = true;
 }
 
-// Helper to convert NCCL result to BackendResult
-static ampccl::BackendResult ConvertNCCLResult(int nccl_result) {
-    if (nccl_result == 0) {
-        return ampccl::BackendResult::Success;
-    }
-    return ampccl::BackendResult::UnhandledError;
-}
-
 // Look up domain by raw NCCL communicator (registered at CommInit).
 static ampccl::CommDomain* GetDomainByRawComm(ncclComm_t comm) {
     return ampccl::DomainManager::GetInstance().GetDomainByRawComm(comm);
 }
 
+// Statistics AllReduce (scheme B): device buffer, pinned host staging (so the copy back
+// does not block the launch) and non-blocking private stream per domain.
+struct NcclStatScratch {
+    void* dev_buf = nullptr;
+    void* host_buf = nullptr;
+    size_t bytes = 0;
+    cudaStream_t stream = nullptr;
+};
+
+static const int kCudaMemcpyHostToDevice = 1;
+static const int kCudaMemcpyDeviceToHost = 2;
+static const unsigned int kCudaStreamNonBlocking = 1;
+static const int kNcclFloat64 = 8;
+static const int kNcclMax = 2;
+
+static void NcclStatFreeBuffers(NcclStatScratch* s) {
+    if (s->dev_buf && orig_cudaFree) orig_cudaFree(s->dev_buf);
+    if (s->host_buf && orig_cudaFreeHost) orig_cudaFreeHost(s->host_buf);
+    s->dev_buf = nullptr;
+    s->host_buf = nullptr;
+    s->bytes = 0;
+}
+
+static bool NcclStatReduceMaxAsync(const double* values, size_t count, void* raw_comm, void** scratch) {
+    if (!orig_ncclAllReduce || !orig_cudaMalloc || !orig_cudaMallocHost || !orig_cudaMemcpyAsync ||
+        !orig_cudaStreamCreateWithFlags || !orig_cudaStreamSynchronize) {
+        return false;
+    }
+    size_t bytes = count * sizeof(double);
+    NcclStatScratch* s = static_cast<NcclStatScratch*>(*scratch);
+    if (s == nullptr) {
+        s = new NcclStatScratch();
+        if (orig_cudaStreamCreateWithFlags(&s->stream, kCudaStreamNonBlocking) != 0) {
+            delete s;
+            return false;
+        }
+        *scratch = s;
+    }
+    if (s->bytes < bytes) {
+        // No reduction is in flight here; the sync only orders the frees after the last one.
+        orig_cudaStreamSynchronize(s->stream);
+        NcclStatFreeBuffers(s);
+        if (orig_cudaMalloc(&s->dev_buf, bytes) != 0 || orig_cudaMallocHost(&s->host_buf, bytes) != 0) {
+            NcclStatFreeBuffers(s);
+            return false;
+        }
+        s->bytes = bytes;
+    }
+    std::memcpy(s->host_buf, values, bytes);
+    if (orig_cudaMemcpyAsync(s->dev_buf, s->host_buf, bytes, kCudaMemcpyHostToDevice, s->stream) != 0) {
+        return false;
+    }
+    int ret = orig_ncclAllReduce(s->dev_buf, s->dev_buf, count,
+                                 static_cast<ncclDataType_t>(kNcclFloat64),
+                                 static_cast<ncclRedOp_t>(kNcclMax),
+                                 static_cast<ncclComm_t>(raw_comm), s->stream);
+    if (ret != 0) {
+        return false;
+    }
+    return orig_cudaMemcpyAsync(s->host_buf, s->dev_buf, bytes, kCudaMemcpyDeviceToHost, s->stream) == 0;
+}
+
+static bool NcclStatWait(double* values, size_t count, void* scratch) {
+    NcclStatScratch* s = static_cast<NcclStatScratch*>(scratch);
+    size_t bytes = count * sizeof(double);
+    // Original sync: must not re-enter OnStreamSynchronized.
+    if (s == nullptr || s->bytes < bytes || orig_cudaStreamSynchronize(s->stream) != 0) {
+        return false;
+    }
+    std::memcpy(values, s->host_buf, bytes);
+    return true;
+}
+
+static bool NcclStatReduceMax(double* values, size_t count, void* raw_comm, void** scratch) {
+    return NcclStatReduceMaxAsync(values, count, raw_comm, scratch) && NcclStatWait(values, count, *scratch);
+}
+
+static void NcclStatRelease(void* scratch) {
+    NcclStatScratch* s = static_cast<NcclStatScratch*>(scratch);
+    if (s == nullptr) return;
+    if (s->stream && orig_cudaStreamSynchronize) orig_cudaStreamSynchronize(s->stream);
+    NcclStatFreeBuffers(s);
+    if (s->stream && orig_cudaStreamDestroy) orig_cudaStreamDestroy(s->stream);
+    delete s;
+}
+
+// Hierarchical AllReduce (CommDomain::HierSplitFn): split intra-node (color = node) and
+// inter-node (color = local rank) sub-communicators from comm. Collective over comm, so
+// the collective path calls it at the same AllReduce on every rank.
+static bool SplitHierComms(ampccl::CommDomain* domain, void* comm) {
+    const ampccl::NodeTopology& topo = domain->topology();
+    ncclComm_t intra = nullptr;
+    ncclComm_t inter = nullptr;
+    if (orig_ncclCommSplit(static_cast<ncclComm_t>(comm), topo.node_id, topo.local_rank, &intra, nullptr) != 0 ||
+        orig_ncclCommSplit(static_cast<ncclComm_t>(comm), topo.local_rank, topo.node_id, &inter, nullptr) != 0) {
+        if (intra && orig_ncclCommDestroy) orig_ncclCommDestroy(intra);
+        AMPCCL_LOG(WARN, "Hierarchical AllReduce: ncclCommSplit failed, staying flat");
+        return false;
+    }
+    ampccl::HierComms hc;
+    hc.owner = comm;
+    hc.intra = intra;
+    hc.inter = inter;
+    domain->set_hier_comms(hc);
+    return true;
+}
+
+static void DestroyHierComms(ampccl::CommDomain* domain, ncclComm_t comm) {
+    const ampccl::HierComms& hc = domain->hier_comms();
+    if (hc.owner != comm) {
+        return;
+    }
+    if (orig_ncclCommDestroy) {
+        if (hc.intra) orig_ncclCommDestroy(hc.intra);
+        if (hc.inter) orig_ncclCommDestroy(hc.inter);
+    }
+    domain->set_hier_comms(ampccl::HierComms());
+}
+
+// Model name of device ("NVIDIA H100 80GB HBM3"), or empty. name[256] leads
+// cudaDeviceProp in every CUDA release; the rest of the struct grows between releases,
+// hence the oversized buffer.
+static std::string DeviceName(int device) {
+    if (!orig_cudaGetDeviceProperties || device < 0) {
+        return std::string();
+    }
+    alignas(8) static thread_local char prop[8192];
+    if (orig_cudaGetDeviceProperties(prop, device) != 0) {
+        return std::string();
+    }
+    return std::string(prop, strnlen(prop, 256));
+}
+
+// Domain setup after any communicator creation path: register comm under key and wire
+// the domain for rank of nranks. collective = false when the caller drives every rank
+// from one thread (ncclCommInitAll) and so cannot issue collectives on comm here: the
+// rank info exchange, hierarchical split, scheme B reducer and PCCL init are skipped
+// (the caller initializes PCIe per device itself). parent: the domain comm was split
+// from, if any.
+static ampccl::CommDomain* SetupDomain(ncclComm_t comm, ampccl::CommDomainKey key, int rank, int nranks,
+                                       bool collective, const ampccl::CommDomain* parent = nullptr) {
+    ampccl::StatReduceOps ops;
+    ops.reduce_max = &NcclStatReduceMax;
+    ops.reduce_max_async = &NcclStatReduceMaxAsync;
+    ops.wait_reduce = &NcclStatWait;
+    ops.release = &NcclStatRelease;
+    // One process drives every rank of a non-collective communicator, and a single-node
+    // parent splits into single-node children.
+    const ampccl::NodeTopology* parent_topo = parent ? &parent->topology() : nullptr;
+    bool single_node = !collective || (parent_topo && !parent_topo->IsMultiNode());
+    ampccl::NodeTopology topo =
+        ampccl::BuildNodeTopology(rank, nranks, single_node ? 0 : ampccl::Config::GetLocalSize());
+    if (collective && ampccl::NeedsRankInfoExchange(nranks, parent_topo)) {
+        ampccl::ExchangeRankInfo(&key, rank, ops, comm, &topo);
+    }
+    ampccl::DomainManager::GetInstance().RegisterRawComm(comm, key, rank);
+    ampccl::CommDomain* domain = ampccl::DomainManager::GetInstance().GetDomainByRawComm(comm);
+    if (!domain) {
+        return nullptr;
+    }
+    domain->set_comm_rank(rank);
+    domain->set_topology(topo);
+    if (!collective) {
+        return domain;
+    }
+    int device = -1;
+    if (orig_cudaGetDevice && orig_cudaGetDevice(&device) == 0) {
+        domain->set_device(device, orig_cudaSetDevice);
+    }
+    ampccl::DomainManager::GetInstance().LoadProfile(domain, "nccl", DeviceName(device));
+    if (topo.IsMultiNode() && ampccl::Config::IsHierEnabled() && orig_ncclCommSplit) {
+        domain->set_hier_split(&SplitHierComms);
+    }
+    if (nranks > 1 && ampccl::Config::GetStatSyncMode(nranks, topo.local_size) == ampccl::StatSyncMode::ALLREDUCE &&
+        !domain->stat_reducer()->IsEnabled()) {
+        domain->stat_reducer()->Configure(ops, comm, ampccl::Config::GetStatSyncInterval());
+    }
+    ampccl::InitPCIeForDomain(domain, rank, nranks);
+    return domain;
+}
+
+// Split child setup once the child is usable: its key, warm start and shape come from
+// parent_comm's domain, seq being the parent's split count taken at the split.
+static void SetupSplitChild(ncclComm_t child, ncclComm_t parent_comm, uint64_t seq, int color) {
+    ampccl::CommDomain* parent = GetDomainByRawComm(parent_comm);
+    int rank = -1;
+    int nranks = 0;
+    if (!parent || !orig_ncclCommUserRank || !orig_ncclCommCount || orig_ncclCommUserRank(child, &rank) != 0 ||
+        orig_ncclCommCount(child, &nranks) != 0) {
+        return;
+    }
+    ampccl::CommDomain* domain = SetupDomain(child, ampccl::BuildKeyFromSplit(parent->key, seq, color, nranks),
+                                             rank, nranks, /*collective=*/true, parent);
+    if (domain) {
+        ampccl::WarmStartFromParent(domain, *parent);
+    }
+}
+
+// A communicator created between ncclGroupStart and ncclGroupEnd is only usable after
+// the outermost ncclGroupEnd, so its SetupDomain (which may issue collectives on it) waits
+// until then. parent != nullptr marks a split child.
+struct PendingSetup {
+    ncclComm_t comm = nullptr;
+    ampccl::CommDomainKey key;
+    int rank = 0;
+    int nranks = 0;
+    ncclComm_t parent = nullptr;
+    uint64_t split_seq = 0;
+    int color = 0;
+};
+static thread_local std::vector<PendingSetup> pending_setups;
+
+static void SetupOrDefer(ncclComm_t comm, ampccl::CommDomainKey key, int rank, int nranks) {
+    if (ampccl::InGroup()) {
+        PendingSetup p;
+        p.comm = comm;
+        p.key = std::move(key);
+        p.rank = rank;
+        p.nranks = nranks;
+        pending_setups.push_back(std::move(p));
+        return;
+    }
+    SetupDomain(comm, std::move(key), rank, nranks, /*collective=*/true);
+}
+
 // Hooked NCCL functions
 extern "C" {
 
+int ncclGroupStart() {
+    LoadOriginalFunctions();
+    if (!orig_ncclGroupStart) {
+        return -1;
+    }
+    int ret = orig_ncclGroupStart();
+    if (ret == 0) {
+        ampccl::EnterGroup();
+    }
+    return ret;
+}
+
+int ncclGroupEnd() {
+    LoadOriginalFunctions();
+    if (!orig_ncclGroupEnd) {
+        return -1;
+    }
+    int ret = orig_ncclGroupEnd();
+    if (!ampccl::LeaveGroup()) {
+        return ret;
+    }
+    std::vector<PendingSetup> pending;
+    pending.swap(pending_setups);
+    if (ret == 0) {
+        for (PendingSetup& p : pending) {
+            if (p.parent) {
+                SetupSplitChild(p.comm, p.parent, p.split_seq, p.color);
+            } else {
+                SetupDomain(p.comm, std::move(p.key), p.rank, p.nranks, /*collective=*/true);
+            }
+        }
+    }
+    // Statistics rounds and seed syncs the group's collectives deferred (StatReducer);
+    // a failed group's communicators were not created and its collectives not launched.
+    ampccl::RunGroupDeferred(ret == 0);
+    return ret;
+}
+
 int ncclGetUniqueId(ncclUniqueId* uniqueId) {
     LoadOriginalFunctions();
     if (orig_ncclGetUniqueId) {
@@ -117,25 +508,139 @@ int ncclCommInitRank(ncclComm_t* comm, int nranks, ncclUniqueId commId, int myra
         return -1;
     }
     int ret = orig_ncclCommInitRank(comm, nranks, commId, myrank);
-    if (ret != 0 || comm == nullptr || *comm == nullptr) {
+    if (ret != 0 || comm == nullptr || *comm == nullptr || !ampccl::Config::IsAdaptiveEnabled()) {
         return ret;
     }
-    if (!ampccl::Config::IsAdaptiveEnabled()) {
+    SetupOrDefer(*comm, ampccl::BuildKeyFromNcclInit(nranks, &commId, NCCL_UNIQUE_ID_BYTES, myrank), myrank, nranks);
+    return ret;
+}
+
+// Recent PyTorch creates every process group communicator through this entry point.
+int ncclCommInitRankConfig(ncclComm_t* comm, int nranks, ncclUniqueId commId, int myrank, ncclConfig_t* config) {
+    LoadOriginalFunctions();
+    if (!orig_ncclCommInitRankConfig) {
+        return -1;
+    }
+    int ret = orig_ncclCommInitRankConfig(comm, nranks, commId, myrank, config);
+    if (ret != 0 || comm == nullptr || *comm == nullptr || !ampccl::Config::IsAdaptiveEnabled()) {
         return ret;
     }
-    ampccl::CommDomainKey key = ampccl::BuildKeyFromNcclInit(
-        nranks, &commId, NCCL_UNIQUE_ID_BYTES, myrank);
-    ampccl::DomainManager::GetInstance().RegisterRawComm(*comm, key);
-    ampccl::CommDomain* domain = ampccl::DomainManager::GetInstance().GetDomainByRawComm(*comm);
-    if (domain) {
-        ampccl::InitPCIeForDomain(domain, myrank, nranks);
+    SetupOrDefer(*comm, ampccl::BuildKeyFromNcclInit(nranks, &commId, NCCL_UNIQUE_ID_BYTES, myrank), myrank, nranks);
+    return ret;
+}
+
+// Every rank passes the same nId ids, so the key hashes all of them.
+int ncclCommInitRankScalable(ncclComm_t* newcomm, int nranks, int myrank, int nId, ncclUniqueId* commIds,
+                             ncclConfig_t* config) {
+    LoadOriginalFunctions();
+    if (!orig_ncclCommInitRankScalable) {
+        return -1;
+    }
+    int ret = orig_ncclCommInitRankScalable(newcomm, nranks, myrank, nId, commIds, config);
+    if (ret != 0 || newcomm == nullptr || *newcomm == nullptr || commIds == nullptr || nId < 1 ||
+        !ampccl::Config::IsAdaptiveEnabled()) {
+        return ret;
+    }
+    SetupOrDefer(*newcomm,
+                 ampccl::BuildKeyFromNcclInit(nranks, commIds, static_cast<size_t>(nId) * NCCL_UNIQUE_ID_BYTES,
+                                              myrank),
+                 myrank, nranks);
+    return ret;
+}
+
+// Single process, one rank per device. There is no unique id: the key hashes this
+// process, its InitAll count and the device list. Each device gets its own domain;
+// PCCL init is a collective over the ranks, so it runs from one thread per device.
+int ncclCommInitAll(ncclComm_t* comms, int ndev, const int* devlist) {
+    LoadOriginalFunctions();
+    if (!orig_ncclCommInitAll) {
+        return -1;
+    }
+    int ret = orig_ncclCommInitAll(comms, ndev, devlist);
+    if (ret != 0 || comms == nullptr || ndev <= 0 || !ampccl::Config::IsAdaptiveEnabled()) {
+        return ret;
+    }
+    static std::atomic<uint64_t> init_all_count{0};
+    std::vector<int64_t> id;
+    id.push_back(static_cast<int64_t>(getpid()));
+    id.push_back(static_cast<int64_t>(init_all_count.fetch_add(1)));
+    for (int i = 0; i < ndev; ++i) {
+        id.push_back(devlist ? devlist[i] : i);
+    }
+    ampccl::CommDomainKey key = ampccl::BuildKeyFromNcclInit(ndev, id.data(), id.size() * sizeof(int64_t), 0);
+    std::vector<ampccl::CommDomain*> domains(static_cast<size_t>(ndev), nullptr);
+    for (int i = 0; i < ndev; ++i) {
+        if (comms[i]) {
+            domains[static_cast<size_t>(i)] = SetupDomain(comms[i], key, i, ndev, /*collective=*/false);
+        }
+        if (domains[static_cast<size_t>(i)]) {
+            int device = devlist ? devlist[i] : i;
+            domains[static_cast<size_t>(i)]->set_device(device, orig_cudaSetDevice);
+            ampccl::DomainManager::GetInstance().LoadProfile(domains[static_cast<size_t>(i)], "nccl",
+                                                             DeviceName(device));
+        }
+    }
+    std::vector<std::thread> threads;
+    for (int i = 0; i < ndev; ++i) {
+        threads.emplace_back([&, i] {
+            if (orig_cudaSetDevice) {
+                orig_cudaSetDevice(devlist ? devlist[i] : i);
+            }
+            ampccl::InitPCIeForDomain(domains[static_cast<size_t>(i)], i, ndev);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
     }
     return ret;
 }
 
+// The child is keyed by the parent's key, the parent's split count and the color, and
+// starts from the parent's learned params when its shape matches (SetupSplitChild, run
+// at ncclGroupEnd for a split inside a group). SplitHierComms splits through
+// orig_ncclCommSplit, so its sub-communicators never come through here.
+int ncclCommSplit(ncclComm_t comm, int color, int key, ncclComm_t* newcomm, ncclConfig_t* config) {
+    LoadOriginalFunctions();
+    if (!orig_ncclCommSplit) {
+        return -1;
+    }
+    int ret = orig_ncclCommSplit(comm, color, key, newcomm, config);
+    if (ret != 0 || !ampccl::Config::IsAdaptiveEnabled()) {
+        return ret;
+    }
+    ampccl::CommDomain* parent = GetDomainByRawComm(comm);
+    if (!parent) {
+        return ret;
+    }
+    // Every parent rank counts the split, including those that get no child.
+    uint64_t seq = parent->NextSplitSeq();
+    if (newcomm == nullptr || *newcomm == nullptr) {
+        return ret;
+    }
+    if (ampccl::InGroup()) {
+        PendingSetup p;
+        p.comm = *newcomm;
+        p.parent = comm;
+        p.split_seq = seq;
+        p.color = color;
+        pending_setups.push_back(std::move(p));
+        return ret;
+    }
+    SetupSplitChild(*newcomm, comm, seq, color);
+    return ret;
+}
+
 int ncclCommDestroy(ncclComm_t comm) {
     LoadOriginalFunctions();
+    pending_setups.erase(std::remove_if(pending_setups.begin(), pending_setups.end(),
+                                        [comm](const PendingSetup& p) { return p.comm == comm; }),
+                         pending_setups.end());
     if (ampccl::Config::IsAdaptiveEnabled()) {
+        ampccl::CommDomain* domain = GetDomainByRawComm(comm);
+        if (domain) {
+            domain->stat_reducer()->DetachComm(comm);
+            DestroyHierComms(domain, comm);
+        }
         ampccl::DomainManager::GetInstance().UnregisterRawComm(comm);
     }
     if (orig_ncclCommDestroy) {
@@ -148,22 +653,28 @@ int ncclAllReduce(
     const void* sendbuff, void* recvbuff, size_t count,
     ncclDataType_t datatype, ncclRedOp_t op, ncclComm_t comm, cudaStream_t stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::AllReduce);
     LoadOriginalFunctions();
     if (!ampccl::Config::IsAdaptiveEnabled() && orig_ncclAllReduce) {
+        ampccl::HookOverhead::Done();
         return orig_ncclAllReduce(sendbuff, recvbuff, count, datatype, op, comm, stream);
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Lookup);
     ampccl::CommDomain* domain = GetDomainByRawComm(comm);
     if (!domain) {
+        ampccl::HookOverhead::Done();
         if (orig_ncclAllReduce) {
             return orig_ncclAllReduce(sendbuff, recvbuff, count, datatype, op, comm, stream);
         }
         return -1;
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Refresh);
     ampccl::BackendResult result = ampccl::VirtualCollective::AllReduce(
         domain, sendbuff, recvbuff, count,
         static_cast<int>(datatype), static_cast<int>(op), comm, stream);
+    ampccl::HookOverhead::Done();
 
     return (result == ampccl::BackendResult::Success) ? 0 : -1;
 }
@@ -172,22 +683,28 @@ int ncclAllGather(
     const void* sendbuff, void* recvbuff, size_t sendcount,
     ncclDataType_t datatype, ncclComm_t comm, cudaStream_t stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::AllGather);
     LoadOriginalFunctions();
     if (!ampccl::Config::IsAdaptiveEnabled() && orig_ncclAllGather) {
+        ampccl::HookOverhead::Done();
         return orig_ncclAllGather(sendbuff, recvbuff, sendcount, datatype, comm, stream);
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Lookup);
     ampccl::CommDomain* domain = GetDomainByRawComm(comm);
     if (!domain) {
+        ampccl::HookOverhead::Done();
         if (orig_ncclAllGather) {
             return orig_ncclAllGather(sendbuff, recvbuff, sendcount, datatype, comm, stream);
         }
         return -1;
     }
 
+    ampccl::HookOverhead::Enter(ampccl::HookPhase::Refresh);
     ampccl::BackendResult result = ampccl::VirtualCollective::AllGather(
         domain, sendbuff, recvbuff, sendcount,
         static_cast<int>(datatype), comm, stream);
+    ampccl::HookOverhead::Done();
 
     return (result == ampccl::BackendResult::Success) ? 0 : -1;
 }
@@ -196,7 +713,9 @@ int ncclReduceScatter(
     const void* sendbuff, void* recvbuff, size_t recvcount,
     ncclDataType_t datatype, ncclRedOp_t op, ncclComm_t comm, cudaStream_t stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::ReduceScatter);
     LoadOriginalFunctions();
+    ampccl::HookOverhead::Done();
     if (orig_ncclReduceScatter) {
         return orig_ncclReduceScatter(sendbuff, recvbuff, recvcount, datatype, op, comm, stream);
     }
@@ -207,7 +726,9 @@ int ncclBroadcast(
     const void* sendbuff, void* recvbuff, size_t count,
     ncclDataType_t datatype, int root, ncclComm_t comm, cudaStream_t stream) {
 
+    ampccl::HookOverhead::Begin(ampccl::HookOp::Broadcast);
     LoadOriginalFunctions();
+    ampccl::HookOverhead::Done();
     if (orig_ncclBroadcast) {
         return orig_ncclBroadcast(sendbuff, recvbuff, count, datatype, root, comm, stream);
     }
@@ -215,14 +736,22 @@ int ncclBroadcast(
 }
 
 int cudaStreamSynchronize(cudaStream_t stream) {
+    ampccl::HookOverhead::Begin(ampccl::HookOp::StreamSync);
     LoadOriginalFunctions();
     if (orig_cudaStreamSynchronize) {
+        ampccl::HookOverhead::Pause();
         int ret = orig_cudaStreamSynchronize(stream);
+        ampccl::HookOverhead::Resume();
         if (ret == 0 && ampccl::Config::IsAdaptiveEnabled()) {
-            ampccl::OnStreamSynchronized(stream);
+            ampccl::HookOverhead::Enter(ampccl::HookPhase::Complete);
+            if (!ampccl::OnStreamSynchronized(stream)) {
+                ret = 999;  // cudaErrorUnknown: the collective pending on the stream failed
+            }
         }
+        ampccl::HookOverhead::Done();
         return ret;
     }
+    ampccl::HookOverhead::Done();
     return -1;  // cudaErrorUnknown or similar
 }
 
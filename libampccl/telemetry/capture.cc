@@ -0,0 +1,72 @@
+#include "capture.h"
+#include "telemetry/trace.h"
+#include "common/config.h"
+#include "common/log.h"
+#include <unistd.h>
+
+namespace ampccl {
+
+WorkloadCapture::WorkloadCapture() {
+    std::string path = Config::GetCapturePath();
+    if (path.empty()) {
+        return;
+    }
+    CaptureFileHeader hdr = {};
+    hdr.magic = kCaptureMagic;
+    hdr.version = kCaptureVersion;
+    hdr.record_size = sizeof(CaptureRecord);
+    hdr.pid = static_cast<int32_t>(getpid());
+    hdr.start_ns = Tracer::NowNs();
+    if (!writer_.Open(path, &hdr, sizeof(hdr), Config::GetTraceRingSize())) {
+        AMPCCL_LOG(WARN, "Capture: cannot open %s", path.c_str());
+        return;
+    }
+    AMPCCL_LOG(INFO, "Capture: writing workload to %s", path.c_str());
+}
+
+WorkloadCapture::~WorkloadCapture() {
+    uint64_t dropped = writer_.Close();
+    if (dropped > 0) {
+        AMPCCL_LOG(WARN, "Capture: %llu records dropped (ring full); raise AMPCCL_TRACE_RING",
+                   static_cast<unsigned long long>(dropped));
+    }
+}
+
+void WorkloadCapture::RecordLaunch(uint64_t domain, int rank, uint64_t seq, uint64_t ns,
+                                   const OpKey& op_key, void* stream, double alpha, bool use_pcie) {
+    CaptureRecord rec = {};
+    rec.ns = ns;
+    rec.seq = seq;
+    rec.domain = domain;
+    rec.bytes = op_key.bytes;
+    rec.stream = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(stream));
+    rec.alpha = static_cast<float>(alpha);
+    rec.rank = static_cast<int16_t>(rank);
+    rec.kind = kCaptureLaunch;
+    rec.op = static_cast<uint8_t>(op_key.op);
+    rec.datatype = static_cast<uint8_t>(op_key.datatype);
+    rec.flags = use_pcie ? kCaptureUsePCIe : 0;
+    writer_.Push(rec);
+}
+
+void WorkloadCapture::RecordComplete(uint64_t domain, int rank, uint64_t seq, uint64_t ns,
+                                     const OpKey& op_key, const ExecStat& stat) {
+    CaptureRecord rec = {};
+    rec.ns = ns;
+    rec.seq = seq;
+    rec.domain = domain;
+    rec.bytes = stat.fast_bytes;
+    rec.pcie_bytes = stat.pcie_bytes;
+    rec.fast_time = static_cast<float>(stat.fast_time);
+    rec.pcie_time = static_cast<float>(stat.pcie_time);
+    rec.rank = static_cast<int16_t>(rank);
+    rec.kind = kCaptureComplete;
+    rec.op = static_cast<uint8_t>(op_key.op);
+    rec.datatype = static_cast<uint8_t>(op_key.datatype);
+    rec.flags = (stat.pcie_bytes > 0 ? kCaptureUsePCIe : 0) |
+                (stat.fast_success ? kCaptureFastOk : 0) |
+                (stat.pcie_success ? kCapturePCIeOk : 0);
+    writer_.Push(rec);
+}
+
+}  // namespace ampccl
@@ -0,0 +1,96 @@
+#ifndef AMPCCL_TELEMETRY_CAPTURE_H_
+#define AMPCCL_TELEMETRY_CAPTURE_H_
+
+#include "telemetry/record_writer.h"
+#include "telemetry/stats.h"
+#include "common/op_key.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace ampccl {
+
+// Workload capture (AMPCCL_CAPTURE=<path>): the exact sequence of intercepted
+// collectives, for offline replay through the planner and controllers
+// (tools/ampccl_replay.cc). Two 64-byte records per collective:
+//   Launch    at collective entry: op, bytes, datatype, stream, alpha used
+//   Complete  at stream sync: measured per-path bytes and device times
+// joined on (domain, seq). A collective whose stream is never synchronised before the
+// next one on that stream has no Complete record. Timestamps are wall clock, so
+// inter-arrival gaps are differences of consecutive Launch records.
+
+#pragma pack(push, 1)
+struct CaptureFileHeader {
+    uint64_t magic;        // kCaptureMagic
+    uint32_t version;      // kCaptureVersion
+    uint32_t record_size;  // sizeof(CaptureRecord)
+    int32_t pid;
+    int32_t reserved;
+    uint64_t start_ns;     // Wall clock when capture started
+};
+
+struct CaptureRecord {
+    uint64_t ns;            // Wall clock: collective entry (Launch) or stream sync (Complete)
+    uint64_t seq;           // Per-domain collective sequence number
+    uint64_t domain;        // CommDomain::key_id()
+    uint64_t bytes;         // Launch: OpKey bytes. Complete: fast-path bytes
+    union {
+        uint64_t stream;      // Launch: caller's stream handle
+        uint64_t pcie_bytes;  // Complete: PCIe-path bytes
+    };
+    float alpha;            // Launch: fast ratio of the plan
+    float fast_time;        // Complete: fast-path device seconds
+    float pcie_time;        // Complete: PCIe-path device seconds
+    int16_t rank;           // comm rank, -1 if unknown
+    uint8_t kind;           // CaptureKind
+    uint8_t op;             // CollectiveType
+    uint8_t datatype;
+    uint8_t flags;          // kCapture* bits
+    uint8_t reserved[6];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CaptureRecord) == 64, "CaptureRecord layout changed");
+
+constexpr uint64_t kCaptureMagic = 0x414d504343434150u;  // "AMPCCCAP"
+constexpr uint32_t kCaptureVersion = 1;
+
+enum CaptureKind : uint8_t {
+    kCaptureLaunch = 1,
+    kCaptureComplete = 2,
+};
+
+enum CaptureFlags : uint8_t {
+    kCaptureUsePCIe = 1u << 0,
+    kCaptureFastOk = 1u << 1,
+    kCapturePCIeOk = 1u << 2,
+};
+
+class WorkloadCapture {
+public:
+    static WorkloadCapture& GetInstance() {
+        static WorkloadCapture instance;
+        return instance;
+    }
+
+    bool IsEnabled() const { return writer_.IsOpen(); }
+
+    void RecordLaunch(uint64_t domain, int rank, uint64_t seq, uint64_t ns, const OpKey& op_key,
+                      void* stream, double alpha, bool use_pcie);
+    void RecordComplete(uint64_t domain, int rank, uint64_t seq, uint64_t ns, const OpKey& op_key,
+                        const ExecStat& stat);
+
+    void Flush() { writer_.Flush(); }
+
+private:
+    WorkloadCapture();
+    ~WorkloadCapture();
+
+    WorkloadCapture(const WorkloadCapture&) = delete;
+    WorkloadCapture& operator=(const WorkloadCapture&) = delete;
+
+    RecordWriter<CaptureRecord> writer_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_CAPTURE_H_
@@ -0,0 +1,70 @@
+#ifndef AMPCCL_TELEMETRY_HISTOGRAM_H_
+#define AMPCCL_TELEMETRY_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ampccl {
+
+// HDR-style log-linear latency histogram over nanoseconds: values below 2^kSubBucketBits
+// get one bucket each; every power of two above that is split into 2^kSubBucketBits
+// linear sub-buckets, so a bucket is at most 1/16 (6.25%) wide relative to its value.
+// Values >= 2^kHistMaxExp ns (~18 minutes) land in the last bucket.
+constexpr int kHistSubBucketBits = 4;
+constexpr int kHistSubBuckets = 1 << kHistSubBucketBits;
+constexpr int kHistMaxExp = 40;
+constexpr int kHistNumBuckets = (kHistMaxExp - kHistSubBucketBits + 1) * kHistSubBuckets;
+
+inline int HistogramBucketOf(uint64_t ns) {
+    if (ns < static_cast<uint64_t>(kHistSubBuckets)) {
+        return static_cast<int>(ns);
+    }
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp >= kHistMaxExp) {
+        return kHistNumBuckets - 1;
+    }
+    int sub = static_cast<int>((ns >> (exp - kHistSubBucketBits)) & (kHistSubBuckets - 1));
+    return (exp - kHistSubBucketBits + 1) * kHistSubBuckets + sub;
+}
+
+// Smallest value (ns) that maps to bucket idx.
+inline uint64_t HistogramBucketLow(int idx) {
+    if (idx < kHistSubBuckets) {
+        return static_cast<uint64_t>(idx);
+    }
+    int exp = idx / kHistSubBuckets + kHistSubBucketBits - 1;
+    uint64_t sub = static_cast<uint64_t>(idx % kHistSubBuckets);
+    return (static_cast<uint64_t>(kHistSubBuckets) | sub) << (exp - kHistSubBucketBits);
+}
+
+// Midpoint of bucket idx, used as the reported value of a quantile.
+inline uint64_t HistogramBucketMid(int idx) {
+    if (idx < kHistSubBuckets) {
+        return static_cast<uint64_t>(idx);
+    }
+    int exp = idx / kHistSubBuckets + kHistSubBucketBits - 1;
+    uint64_t width = static_cast<uint64_t>(1) << (exp - kHistSubBucketBits);
+    return HistogramBucketLow(idx) + width / 2;
+}
+
+// q in [0, 1] over a bucket array with `total` samples; returns 0 when empty.
+inline uint64_t HistogramQuantile(const uint64_t* counts, uint64_t total, double q) {
+    if (total == 0) {
+        return 0;
+    }
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kHistNumBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return HistogramBucketMid(i);
+        }
+    }
+    return HistogramBucketMid(kHistNumBuckets - 1);
+}
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_HISTOGRAM_H_
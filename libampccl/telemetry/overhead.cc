@@ -0,0 +1,139 @@
+#include "overhead.h"
+#include "stats_page.h"
+#include "common/config.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ampccl {
+
+namespace {
+
+class OverheadRegistry {
+public:
+    static OverheadRegistry& GetInstance() {
+        static OverheadRegistry instance;
+        return instance;
+    }
+
+    uint32_t period() const { return period_; }
+
+    HookCounters* AddThread() {
+        HookCounters* c = StatsPage::GetInstance().ClaimHookBlock();
+        std::lock_guard<std::mutex> lock(mu_);
+        if (c == nullptr) {
+            owned_.push_back(std::unique_ptr<HookCounters>(new HookCounters()));
+            c = owned_.back().get();
+            for (int op = 0; op < kNumHookOps; ++op) {
+                c->calls[op].store(0, std::memory_order_relaxed);
+                c->sampled[op].store(0, std::memory_order_relaxed);
+                for (int p = 0; p < kNumHookPhases; ++p) {
+                    c->ns[op][p].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+        threads_.push_back(c);
+        return c;
+    }
+
+    void Sum(uint64_t calls[kNumHookOps], uint64_t sampled[kNumHookOps],
+             uint64_t ns[kNumHookOps][kNumHookPhases]) {
+        for (int op = 0; op < kNumHookOps; ++op) {
+            calls[op] = 0;
+            sampled[op] = 0;
+            for (int p = 0; p < kNumHookPhases; ++p) ns[op][p] = 0;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        for (const HookCounters* c : threads_) {
+            for (int op = 0; op < kNumHookOps; ++op) {
+                calls[op] += c->calls[op].load(std::memory_order_relaxed);
+                sampled[op] += c->sampled[op].load(std::memory_order_relaxed);
+                for (int p = 0; p < kNumHookPhases; ++p) {
+                    ns[op][p] += c->ns[op][p].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+private:
+    // The stats page is constructed first so it outlives this registry (its blocks are
+    // read by the exit report).
+    OverheadRegistry() : period_(static_cast<uint32_t>(Config::GetOverheadSamplePeriod())) {
+        StatsPage::GetInstance();
+    }
+
+    ~OverheadRegistry() {
+        if (Config::IsOverheadReportEnabled()) {
+            Report();
+        }
+    }
+
+    void Report() {
+        uint64_t calls[kNumHookOps];
+        uint64_t sampled[kNumHookOps];
+        uint64_t ns[kNumHookOps][kNumHookPhases];
+        Sum(calls, sampled, ns);
+        std::fprintf(stderr, "[AMPCCL] interposition overhead (mean ns per call, 1/%u calls timed)\n", period_);
+        std::fprintf(stderr, "[AMPCCL]   %-14s %10s", "op", "calls");
+        for (int p = 0; p < kNumHookPhases; ++p) {
+            std::fprintf(stderr, " %8s", HookOverhead::PhaseName(p));
+        }
+        std::fprintf(stderr, " %8s\n", "total");
+        for (int op = 0; op < kNumHookOps; ++op) {
+            if (calls[op] == 0) {
+                continue;
+            }
+            std::fprintf(stderr, "[AMPCCL]   %-14s %10llu", HookOverhead::OpName(op),
+                         static_cast<unsigned long long>(calls[op]));
+            double total = 0.0;
+            for (int p = 0; p < kNumHookPhases; ++p) {
+                double mean = sampled[op] > 0 ? static_cast<double>(ns[op][p]) / sampled[op] : 0.0;
+                total += mean;
+                std::fprintf(stderr, " %8.1f", mean);
+            }
+            std::fprintf(stderr, " %8.1f\n", total);
+        }
+    }
+
+    OverheadRegistry(const OverheadRegistry&) = delete;
+    OverheadRegistry& operator=(const OverheadRegistry&) = delete;
+
+    const uint32_t period_;
+    std::mutex mu_;
+    std::vector<HookCounters*> threads_;
+    std::vector<std::unique_ptr<HookCounters>> owned_;  // When the stats page has no room
+};
+
+}  // namespace
+
+bool HookOverhead::RegisterThread(HookThreadState* s) {
+    s->init = true;
+    OverheadRegistry& reg = OverheadRegistry::GetInstance();
+    if (reg.period() == 0) {
+        return false;
+    }
+    s->period = reg.period();
+    s->countdown = 1;  // Time the thread's first call
+    s->counters = reg.AddThread();
+    return true;
+}
+
+void HookOverhead::Snapshot(uint64_t calls[kNumHookOps], uint64_t sampled[kNumHookOps],
+                            uint64_t ns[kNumHookOps][kNumHookPhases]) {
+    OverheadRegistry::GetInstance().Sum(calls, sampled, ns);
+}
+
+const char* HookOverhead::OpName(int op) {
+    static const char* kNames[kNumHookOps] = {"AllReduce", "AllGather", "ReduceScatter", "Broadcast",
+                                              "StreamSync"};
+    return op >= 0 && op < kNumHookOps ? kNames[op] : "?";
+}
+
+const char* HookOverhead::PhaseName(int phase) {
+    static const char* kNames[kNumHookPhases] = {"config", "lookup", "refresh", "plan", "launch",
+                                                 "register", "complete"};
+    return phase >= 0 && phase < kNumHookPhases ? kNames[phase] : "?";
+}
+
+}  // namespace ampccl
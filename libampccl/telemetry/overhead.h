@@ -0,0 +1,154 @@
+#ifndef AMPCCL_TELEMETRY_OVERHEAD_H_
+#define AMPCCL_TELEMETRY_OVERHEAD_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ampccl {
+
+// Host time spent inside AmpCCL per hooked entry point, excluding the wrapped library
+// calls (original NCCL/HCCL, PCCL launches, stream/event waits). Every call is counted;
+// one call in AMPCCL_OVERHEAD_SAMPLE per thread is timed phase by phase, so the
+// amortised cost stays at a few ns per call. Mean per-phase cost = ns / sampled.
+//
+// Counters are per thread and single-writer (relaxed load + store, no RMW). They live
+// in the stats page when it is enabled (so ampccl-top can sum them live), otherwise on
+// the heap; HookOverhead reports the sums at exit (AMPCCL_OVERHEAD_REPORT).
+
+enum class HookOp : uint8_t {
+    AllReduce = 0,
+    AllGather = 1,
+    ReduceScatter = 2,
+    Broadcast = 3,
+    StreamSync = 4,   // cudaStreamSynchronize / aclrtSynchronizeStream
+};
+constexpr int kNumHookOps = 5;
+
+enum class HookPhase : uint8_t {
+    Config = 0,     // Loading originals, AMPCCL_ENABLE check
+    Lookup = 1,     // Raw comm -> CommDomain
+    Refresh = 2,    // Stat reducer entry, shm attach, rank-0 aggregate/update, param read
+    Plan = 3,       // UsePCIe, SuggestAlpha, CreatePlan
+    Launch = 4,     // AmpCCL work between library launches (timers, shares)
+    Register = 5,   // Trace stamp, pending registration
+    Complete = 6,   // Stream sync: pending stat collection, controller/shm/trace update
+};
+constexpr int kNumHookPhases = 7;
+
+struct HookCounters {
+    std::atomic<uint64_t> calls[kNumHookOps];
+    std::atomic<uint64_t> sampled[kNumHookOps];
+    std::atomic<uint64_t> ns[kNumHookOps][kNumHookPhases];
+};
+
+// Per-thread accounting state; trivially constructible so the thread_local needs no
+// init guard. initial-exec: the library is loaded at startup (LD_PRELOAD), so its TLS
+// sits in the static block and access is a single %fs-relative load.
+struct HookThreadState {
+    HookCounters* counters;
+    uint64_t last_ns;      // Start of the running interval (sampled calls only)
+    uint32_t countdown;    // Calls left until the next sampled one
+    uint32_t period;
+    uint8_t op;
+    uint8_t phase;
+    bool active;           // This call is being timed
+    uint8_t pause_depth;   // Nested wrapped library calls in progress
+    bool init;             // Registration attempted (counters stays null if disabled)
+};
+
+inline thread_local HookThreadState g_hook_state __attribute__((tls_model("initial-exec"))) = {};
+
+class HookOverhead {
+public:
+    // Entry of a hooked call; the Config phase starts here.
+    static void Begin(HookOp op) {
+        HookThreadState& s = g_hook_state;
+        if (s.counters == nullptr && (s.init || !RegisterThread(&s))) {
+            return;
+        }
+        Bump(&s.counters->calls[static_cast<int>(op)], 1);
+        if (--s.countdown != 0) {
+            s.active = false;
+            return;
+        }
+        s.countdown = s.period;
+        Bump(&s.counters->sampled[static_cast<int>(op)], 1);
+        s.op = static_cast<uint8_t>(op);
+        s.phase = static_cast<uint8_t>(HookPhase::Config);
+        s.active = true;
+        s.pause_depth = 0;
+        s.last_ns = NowNs();
+    }
+
+    // Close the running phase and start `phase`.
+    static void Enter(HookPhase phase) {
+        HookThreadState& s = g_hook_state;
+        if (!s.active) {
+            return;
+        }
+        uint64_t now = NowNs();
+        if (s.pause_depth == 0) {
+            Charge(&s, now);
+        }
+        s.phase = static_cast<uint8_t>(phase);
+        s.last_ns = now;
+    }
+
+    // Bracket a wrapped library call: its time is charged to no phase. Nests.
+    static void Pause() {
+        HookThreadState& s = g_hook_state;
+        if (!s.active || s.pause_depth++ != 0) {
+            return;
+        }
+        Charge(&s, NowNs());
+    }
+
+    static void Resume() {
+        HookThreadState& s = g_hook_state;
+        if (!s.active || s.pause_depth == 0 || --s.pause_depth != 0) {
+            return;
+        }
+        s.last_ns = NowNs();
+    }
+
+    // Exit of a hooked call (or hand-off to the original function).
+    static void Done() {
+        HookThreadState& s = g_hook_state;
+        if (!s.active) {
+            return;
+        }
+        if (s.pause_depth == 0) {
+            Charge(&s, NowNs());
+        }
+        s.active = false;
+    }
+
+    // Sum over all threads registered so far.
+    static void Snapshot(uint64_t calls[kNumHookOps], uint64_t sampled[kNumHookOps],
+                         uint64_t ns[kNumHookOps][kNumHookPhases]);
+
+    static const char* OpName(int op);
+    static const char* PhaseName(int phase);
+
+private:
+    static bool RegisterThread(HookThreadState* s);
+
+    static uint64_t NowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static void Charge(HookThreadState* s, uint64_t now) {
+        Bump(&s->counters->ns[s->op][s->phase], now - s->last_ns);
+    }
+
+    // Single writer: a plain load/store pair, no locked instruction.
+    static void Bump(std::atomic<uint64_t>* c, uint64_t v) {
+        c->store(c->load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_OVERHEAD_H_
@@ -0,0 +1,53 @@
+#ifndef AMPCCL_TELEMETRY_QUANTILE_WINDOW_H_
+#define AMPCCL_TELEMETRY_QUANTILE_WINDOW_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ampccl {
+
+// Fixed-size sliding window of the last N samples with quantile queries.
+// Memory is constant (N floats); Quantile() copies the window and runs
+// nth_element, so it is meant for the controller update path, not the launch path.
+template <int N>
+class QuantileWindow {
+public:
+    static_assert(N > 0, "QuantileWindow size");
+
+    void Add(double v) {
+        samples_[head_] = static_cast<float>(v);
+        head_ = (head_ + 1) % N;
+        if (count_ < N) ++count_;
+    }
+
+    int Count() const { return count_; }
+
+    // q in [0, 1]; nearest-rank on the current window. Returns 0 when empty.
+    double Quantile(double q) const {
+        if (count_ == 0) {
+            return 0.0;
+        }
+        float tmp[N];
+        std::copy(samples_, samples_ + count_, tmp);
+        if (q < 0.0) q = 0.0;
+        if (q > 1.0) q = 1.0;
+        int k = static_cast<int>(q * (count_ - 1) + 0.5);
+        std::nth_element(tmp, tmp + k, tmp + count_);
+        return tmp[k];
+    }
+
+    void Clear() {
+        head_ = 0;
+        count_ = 0;
+    }
+
+private:
+    float samples_[N] = {};
+    int head_ = 0;
+    int count_ = 0;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_QUANTILE_WINDOW_H_
@@ -0,0 +1,167 @@
+#ifndef AMPCCL_TELEMETRY_RECORD_WRITER_H_
+#define AMPCCL_TELEMETRY_RECORD_WRITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ampccl {
+
+// Single-producer / single-consumer ring of fixed-size records. The owning thread
+// pushes; the drainer pops. A full ring drops the new record (counted) instead of
+// blocking.
+template <typename Record>
+class RecordRing {
+public:
+    explicit RecordRing(size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+    bool Push(const Record& rec) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= slots_.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots_[head & mask_] = rec;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Write all available records to f; returns the number written.
+    size_t Drain(std::FILE* f) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        size_t n = static_cast<size_t>(head - tail);
+        while (tail != head) {
+            // Contiguous run up to the end of the buffer.
+            size_t start = static_cast<size_t>(tail & mask_);
+            size_t run = slots_.size() - start;
+            if (run > head - tail) run = static_cast<size_t>(head - tail);
+            std::fwrite(&slots_[start], sizeof(Record), run, f);
+            tail += run;
+        }
+        tail_.store(tail, std::memory_order_release);
+        return n;
+    }
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<Record> slots_;
+    uint64_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};  // Next slot to write (producer)
+    alignas(64) std::atomic<uint64_t> tail_{0};  // Next slot to read (drainer)
+    std::atomic<uint64_t> dropped_{0};
+};
+
+// Binary record file fed through per-thread rings and appended by a background
+// drainer every 10 ms. Push is lock-free on the calling thread's ring (registered on
+// first use). The ring pointer is thread_local per Record type, so a process has at
+// most one open writer per record type (Tracer, WorkloadCapture).
+template <typename Record>
+class RecordWriter {
+public:
+    RecordWriter() = default;
+    ~RecordWriter() { Close(); }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    // Create path, write the file header, start the drainer. ring_capacity must be a
+    // power of two.
+    bool Open(const std::string& path, const void* header, size_t header_size, size_t ring_capacity) {
+        file_ = std::fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            return false;
+        }
+        std::fwrite(header, header_size, 1, file_);
+        ring_capacity_ = ring_capacity;
+        drainer_ = std::thread(&RecordWriter::DrainLoop, this);
+        return true;
+    }
+
+    bool IsOpen() const { return file_ != nullptr; }
+
+    void Push(const Record& rec) {
+        if (file_ == nullptr) {
+            return;
+        }
+        ThreadRing()->Push(rec);
+    }
+
+    // Drain every ring to the file now.
+    void Flush() {
+        if (file_ == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(rings_mu_);
+        size_t n = 0;
+        for (const auto& r : rings_) n += r->Drain(file_);
+        if (n > 0) {
+            std::fflush(file_);
+        }
+    }
+
+    // Stop the drainer, write what is left and close. Returns the records dropped
+    // because a ring was full.
+    uint64_t Close() {
+        if (file_ == nullptr) {
+            return 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mu_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (drainer_.joinable()) {
+            drainer_.join();
+        }
+        Flush();
+        uint64_t dropped = 0;
+        for (const auto& r : rings_) dropped += r->dropped();
+        std::fclose(file_);
+        file_ = nullptr;
+        return dropped;
+    }
+
+private:
+    RecordRing<Record>* ThreadRing() {
+        thread_local RecordRing<Record>* ring = nullptr;
+        if (ring == nullptr) {
+            std::lock_guard<std::mutex> lock(rings_mu_);
+            rings_.push_back(std::unique_ptr<RecordRing<Record>>(new RecordRing<Record>(ring_capacity_)));
+            ring = rings_.back().get();
+        }
+        return ring;
+    }
+
+    void DrainLoop() {
+        std::unique_lock<std::mutex> lock(wake_mu_);
+        while (!stop_) {
+            wake_.wait_for(lock, std::chrono::milliseconds(10));
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+
+    std::FILE* file_ = nullptr;
+    size_t ring_capacity_ = 0;
+    std::mutex rings_mu_;  // Ring registration and draining, never taken by Push
+    std::vector<std::unique_ptr<RecordRing<Record>>> rings_;
+    std::mutex wake_mu_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread drainer_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_RECORD_WRITER_H_
@@ -2,6 +2,7 @@
 #define AMPCCL_TELEMETRY_STATS_H_
 
 #include <cstddef>
+#include <cstdint>
 
 namespace ampccl {
 
@@ -37,6 +38,20 @@ struct ExecStat {
     }
 };
 
+// Exploration cost of a bandit-style controller. Regret is measured against the
+// best arm's mean time at the moment each collective completed.
+struct RegretStats {
+    uint64_t pulls;          // Collectives observed
+    uint64_t explore_pulls;  // Collectives run on an arm other than the current best
+    double regret_time;      // Sum of (observed time - best arm mean), seconds
+
+    RegretStats() : pulls(0), explore_pulls(0), regret_time(0.0) {}
+
+    double ExploreFraction() const {
+        return pulls > 0 ? static_cast<double>(explore_pulls) / pulls : 0.0;
+    }
+};
+
 }  // namespace ampccl
 
 #endif  // AMPCCL_TELEMETRY_STATS_H_
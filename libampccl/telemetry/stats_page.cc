@@ -0,0 +1,199 @@
+#include "stats_page.h"
+#include "common/config.h"
+#include "common/log.h"
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <sstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ampccl {
+
+std::string StatsPage::NameForPid(int pid) {
+    std::ostringstream os;
+    os << kShmPrefix << pid;
+    return os.str();
+}
+
+StatsPage::StatsPage() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (!Config::IsStatsPageEnabled()) {
+        return;
+    }
+    name_ = NameForPid(static_cast<int>(getpid()));
+    // Owner read-write, everyone else read-only.
+    int fd = shm_open(name_.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        AMPCCL_LOG(WARN, "StatsPage: shm_open %s failed", name_.c_str());
+        return;
+    }
+    size_t size = PageSize();
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        AMPCCL_LOG(WARN, "StatsPage: ftruncate failed");
+        close(fd);
+        shm_unlink(name_.c_str());
+        return;
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        AMPCCL_LOG(WARN, "StatsPage: mmap failed");
+        shm_unlink(name_.c_str());
+        return;
+    }
+    // Fresh zero-filled mapping: construct the header, then publish it via magic.
+    StatsPageHeader* hdr = new (p) StatsPageHeader();
+    hdr->version = kStatsPageVersion;
+    hdr->header_size = sizeof(StatsPageHeader);
+    hdr->slot_size = sizeof(HistogramSlot);
+    hdr->num_buckets = kHistNumBuckets;
+    hdr->sub_bucket_bits = kHistSubBucketBits;
+    hdr->max_slots = kStatsPageMaxSlots;
+    hdr->pid = static_cast<int32_t>(getpid());
+    hdr->start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    hdr->num_slots.store(0, std::memory_order_relaxed);
+    hdr->updates.store(0, std::memory_order_relaxed);
+    hdr->hook_offset = static_cast<uint32_t>(HookOffset());
+    hdr->hook_block_size = sizeof(HookCounters);
+    hdr->max_hook_blocks = kStatsPageMaxHookBlocks;
+    hdr->hook_sample_period = static_cast<uint32_t>(Config::GetOverheadSamplePeriod());
+    hdr->num_hook_blocks.store(0, std::memory_order_relaxed);
+    hdr->regret_offset = static_cast<uint32_t>(RegretOffset());
+    hdr->regret_slot_size = sizeof(RegretSlot);
+    hdr->max_regret_slots = kStatsPageMaxRegretSlots;
+    hdr->num_regret_slots.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = kStatsPageMagic;
+    base_ = p;
+    AMPCCL_LOG(INFO, "StatsPage: %s (%zu bytes)", name_.c_str(), size);
+#endif
+}
+
+StatsPage::~StatsPage() {
+#if defined(__linux__) || defined(__APPLE__)
+    if (base_ != nullptr) {
+        munmap(base_, PageSize());
+        shm_unlink(name_.c_str());
+        base_ = nullptr;
+    }
+#endif
+}
+
+HistogramSlot* StatsPage::FindOrCreateSlot(uint64_t domain, int rank, int op, int size_class,
+                                           StatsPath path) {
+    auto key = std::make_tuple(domain, rank, op, size_class, static_cast<int>(path));
+    std::lock_guard<std::mutex> lock(slots_mu_);
+    auto it = slot_index_.find(key);
+    if (it != slot_index_.end()) {
+        return it->second;
+    }
+    StatsPageHeader* hdr = static_cast<StatsPageHeader*>(base_);
+    uint32_t n = hdr->num_slots.load(std::memory_order_relaxed);
+    if (n >= static_cast<uint32_t>(kStatsPageMaxSlots)) {
+        return nullptr;
+    }
+    char* slots = static_cast<char*>(base_) + sizeof(StatsPageHeader);
+    HistogramSlot* slot = new (slots + static_cast<size_t>(n) * sizeof(HistogramSlot)) HistogramSlot();
+    slot->domain = domain;
+    slot->rank = rank;
+    slot->op = static_cast<uint8_t>(op);
+    slot->size_class = static_cast<uint8_t>(size_class);
+    slot->path = static_cast<uint8_t>(path);
+    slot->count.store(0, std::memory_order_relaxed);
+    slot->sum_ns.store(0, std::memory_order_relaxed);
+    slot->min_ns.store(UINT64_MAX, std::memory_order_relaxed);
+    slot->max_ns.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < kHistNumBuckets; ++i) {
+        slot->buckets[i].store(0, std::memory_order_relaxed);
+    }
+    hdr->num_slots.store(n + 1, std::memory_order_release);  // Publish
+    slot_index_.emplace(key, slot);
+    return slot;
+}
+
+HookCounters* StatsPage::ClaimHookBlock() {
+    if (base_ == nullptr) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(slots_mu_);
+    StatsPageHeader* hdr = static_cast<StatsPageHeader*>(base_);
+    uint32_t n = hdr->num_hook_blocks.load(std::memory_order_relaxed);
+    if (n >= static_cast<uint32_t>(kStatsPageMaxHookBlocks)) {
+        return nullptr;
+    }
+    char* blocks = static_cast<char*>(base_) + HookOffset();
+    HookCounters* c = new (blocks + static_cast<size_t>(n) * sizeof(HookCounters)) HookCounters();
+    for (int op = 0; op < kNumHookOps; ++op) {
+        c->calls[op].store(0, std::memory_order_relaxed);
+        c->sampled[op].store(0, std::memory_order_relaxed);
+        for (int p = 0; p < kNumHookPhases; ++p) {
+            c->ns[op][p].store(0, std::memory_order_relaxed);
+        }
+    }
+    hdr->num_hook_blocks.store(n + 1, std::memory_order_release);  // Publish
+    return c;
+}
+
+void StatsPage::PublishRegret(uint64_t domain, int rank, const RegretStats& regret) {
+    if (base_ == nullptr) {
+        return;
+    }
+    RegretSlot* slot = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(slots_mu_);
+        auto key = std::make_pair(domain, rank);
+        auto it = regret_index_.find(key);
+        if (it != regret_index_.end()) {
+            slot = it->second;
+        } else {
+            StatsPageHeader* hdr = static_cast<StatsPageHeader*>(base_);
+            uint32_t n = hdr->num_regret_slots.load(std::memory_order_relaxed);
+            if (n >= static_cast<uint32_t>(kStatsPageMaxRegretSlots)) {
+                return;
+            }
+            char* slots = static_cast<char*>(base_) + RegretOffset();
+            slot = new (slots + static_cast<size_t>(n) * sizeof(RegretSlot)) RegretSlot();
+            slot->domain = domain;
+            slot->rank = rank;
+            slot->pulls.store(0, std::memory_order_relaxed);
+            slot->explore_pulls.store(0, std::memory_order_relaxed);
+            slot->regret_ns.store(0, std::memory_order_relaxed);
+            hdr->num_regret_slots.store(n + 1, std::memory_order_release);  // Publish
+            regret_index_.emplace(key, slot);
+        }
+    }
+    slot->explore_pulls.store(regret.explore_pulls, std::memory_order_relaxed);
+    slot->regret_ns.store(static_cast<int64_t>(regret.regret_time * 1e9), std::memory_order_relaxed);
+    slot->pulls.store(regret.pulls, std::memory_order_release);
+}
+
+void StatsPage::Record(uint64_t domain, int rank, int op, int size_class, StatsPath path,
+                       double seconds) {
+    if (base_ == nullptr || seconds < 0.0) {
+        return;
+    }
+    HistogramSlot* slot = FindOrCreateSlot(domain, rank, op, size_class, path);
+    if (slot == nullptr) {
+        return;
+    }
+    uint64_t ns = static_cast<uint64_t>(seconds * 1e9);
+    slot->buckets[HistogramBucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    slot->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t cur = slot->min_ns.load(std::memory_order_relaxed);
+    while (ns < cur && !slot->min_ns.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {
+    }
+    cur = slot->max_ns.load(std::memory_order_relaxed);
+    while (ns > cur && !slot->max_ns.compare_exchange_weak(cur, ns, std::memory_order_relaxed)) {
+    }
+    slot->count.fetch_add(1, std::memory_order_release);
+    static_cast<StatsPageHeader*>(base_)->updates.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace ampccl
@@ -0,0 +1,151 @@
+#ifndef AMPCCL_TELEMETRY_STATS_PAGE_H_
+#define AMPCCL_TELEMETRY_STATS_PAGE_H_
+
+#include "telemetry/histogram.h"
+#include "telemetry/overhead.h"
+#include "telemetry/stats.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace ampccl {
+
+// Per-process statistics page in shared memory (/ampccl_stats_<pid>). The process is
+// the only writer; external tools (ampccl-top) map it read-only and poll it, so
+// reading costs the job nothing. Layout is versioned: a reader must check magic,
+// version and the sizes in the header before touching slots.
+//
+// One slot per (domain, op, size class, path) holds a log-linear latency histogram
+// (telemetry/histogram.h) plus count/sum/min/max. Slots are appended, never removed;
+// a slot is visible once num_slots covers it. Counters are relaxed atomics, so a
+// concurrent reader may see a histogram a few samples ahead of its count.
+//
+// After the slots, up to kStatsPageMaxHookBlocks per-thread HookCounters blocks
+// (telemetry/overhead.h) hold the interposition overhead; readers sum the first
+// num_hook_blocks of them.
+//
+// Then up to kStatsPageMaxRegretSlots RegretSlots, one per (domain, rank) whose
+// controller reports exploration cost (bandit); overwritten in place at each stream
+// sync, so they always hold the controller's running totals.
+
+constexpr uint64_t kStatsPageMagic = 0x414d505354415453u;  // "AMPSTATS"
+constexpr uint32_t kStatsPageVersion = 3;
+constexpr int kStatsPageMaxSlots = 512;
+constexpr int kStatsPageMaxHookBlocks = 64;
+constexpr int kStatsPageMaxRegretSlots = 64;
+
+enum class StatsPath : uint8_t {
+    Fast = 0,    // Fast-path device time
+    PCIe = 1,    // PCIe-path device time
+    Total = 2,   // Collective time: max of the two paths
+};
+constexpr int kNumStatsPaths = 3;
+
+struct StatsPageHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;      // sizeof(StatsPageHeader)
+    uint32_t slot_size;        // sizeof(HistogramSlot)
+    uint32_t num_buckets;      // kHistNumBuckets
+    uint32_t sub_bucket_bits;  // kHistSubBucketBits
+    uint32_t max_slots;
+    int32_t pid;
+    int32_t reserved;
+    uint64_t start_ns;         // Wall clock when the page was created
+    std::atomic<uint32_t> num_slots;
+    uint32_t pad;
+    std::atomic<uint64_t> updates;  // Total samples recorded (changes on every write)
+    uint32_t hook_offset;           // Byte offset of the first HookCounters block
+    uint32_t hook_block_size;       // sizeof(HookCounters)
+    uint32_t max_hook_blocks;
+    uint32_t hook_sample_period;    // AMPCCL_OVERHEAD_SAMPLE
+    std::atomic<uint32_t> num_hook_blocks;
+    uint32_t pad2;
+    uint32_t regret_offset;         // Byte offset of the first RegretSlot
+    uint32_t regret_slot_size;      // sizeof(RegretSlot)
+    uint32_t max_regret_slots;
+    std::atomic<uint32_t> num_regret_slots;
+};
+
+struct HistogramSlot {
+    uint64_t domain;       // CommDomain::key_id()
+    int32_t rank;          // comm rank, -1 if unknown
+    uint8_t op;            // CollectiveType
+    uint8_t size_class;    // floor(log2(bytes))
+    uint8_t path;          // StatsPath
+    uint8_t pad;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum_ns;
+    std::atomic<uint64_t> min_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> buckets[kHistNumBuckets];
+};
+
+// A domain controller's RegretStats (telemetry/stats.h), regret in nanoseconds.
+struct RegretSlot {
+    uint64_t domain;  // CommDomain::key_id()
+    int32_t rank;     // comm rank, -1 if unknown
+    int32_t pad;
+    std::atomic<uint64_t> pulls;
+    std::atomic<uint64_t> explore_pulls;
+    std::atomic<int64_t> regret_ns;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "stats page needs lock-free 64-bit atomics");
+
+class StatsPage {
+public:
+    static StatsPage& GetInstance() {
+        static StatsPage instance;
+        return instance;
+    }
+
+    bool IsEnabled() const { return base_ != nullptr; }
+
+    // Add one sample (seconds) to the slot for this key; creates the slot on first use.
+    // Drops the sample if the page is full.
+    void Record(uint64_t domain, int rank, int op, int size_class, StatsPath path, double seconds);
+
+    // Overwrite the slot for (domain, rank) with the controller's running totals;
+    // creates the slot on first use. Dropped if the page is full.
+    void PublishRegret(uint64_t domain, int rank, const RegretStats& regret);
+
+    // Zeroed overhead counters block for one thread; nullptr if disabled or full.
+    HookCounters* ClaimHookBlock();
+
+    static constexpr const char* kShmPrefix = "/ampccl_stats_";
+    static std::string NameForPid(int pid);
+    static size_t HookOffset() {
+        return sizeof(StatsPageHeader) + static_cast<size_t>(kStatsPageMaxSlots) * sizeof(HistogramSlot);
+    }
+    static size_t RegretOffset() {
+        return HookOffset() + static_cast<size_t>(kStatsPageMaxHookBlocks) * sizeof(HookCounters);
+    }
+    static size_t PageSize() {
+        return RegretOffset() + static_cast<size_t>(kStatsPageMaxRegretSlots) * sizeof(RegretSlot);
+    }
+
+private:
+    StatsPage();
+    ~StatsPage();
+
+    StatsPage(const StatsPage&) = delete;
+    StatsPage& operator=(const StatsPage&) = delete;
+
+    HistogramSlot* FindOrCreateSlot(uint64_t domain, int rank, int op, int size_class, StatsPath path);
+
+    void* base_ = nullptr;
+    std::string name_;
+    std::mutex slots_mu_;  // Slot lookup/creation and hook block claims (writers only)
+    std::map<std::tuple<uint64_t, int, int, int, int>, HistogramSlot*> slot_index_;
+    std::map<std::pair<uint64_t, int>, RegretSlot*> regret_index_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_STATS_PAGE_H_
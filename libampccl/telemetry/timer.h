@@ -7,6 +7,8 @@
 // Record start/end events on stream; Stop() only records (no sync). Call
 // Synchronize() after all timers have recorded so parallel ops (e.g. fast + PCIe)
 // are not serialized; then ElapsedSeconds() is valid.
+// Without a compile-time backend, device events resolved at runtime by the hook
+// (DeviceEventOps) are used when registered, else CPU chrono.
 
 #if defined(AMPCCL_USE_CUDA_TIMER)
 #include <cuda_runtime.h>
@@ -19,6 +21,70 @@
 
 namespace ampccl {
 
+// Runtime event entry points (cudaEvent* / aclrt*Event), dlsym'd by the NCCL or HCCL
+// hook from the runtime it loaded. Used by builds without CUDA/ACL headers, where a
+// CPU clock around an asynchronous launch would only time the launch.
+struct DeviceEventOps {
+    int (*create)(void** event) = nullptr;
+    int (*destroy)(void* event) = nullptr;
+    int (*record)(void* event, void* stream) = nullptr;
+    int (*synchronize)(void* event) = nullptr;
+    int (*elapsed_ms)(float* ms, void* start, void* end) = nullptr;
+    // Make stream wait (device-side) for event's latest record; optional, only
+    // StreamEvent uses it.
+    int (*stream_wait)(void* stream, void* event) = nullptr;
+
+    bool IsComplete() const {
+        return create && destroy && record && synchronize && elapsed_ms;
+    }
+};
+
+inline DeviceEventOps& RuntimeEventOps() {
+    static DeviceEventOps ops;
+    return ops;
+}
+
+// First complete registration wins (one device runtime per process).
+inline void SetRuntimeEventOps(const DeviceEventOps& ops) {
+    if (ops.IsComplete() && !RuntimeEventOps().IsComplete()) {
+        RuntimeEventOps() = ops;
+    }
+}
+
+// Device-side ordering across streams: Record on one stream, then WaitOn another; the
+// wait covers the record made before it, without blocking the host. The runtime event
+// is created on first use; every call returns false if the runtime cannot chain
+// streams (no registered DeviceEventOps::stream_wait).
+class StreamEvent {
+public:
+    StreamEvent() = default;
+    StreamEvent(const StreamEvent&) = delete;
+    StreamEvent& operator=(const StreamEvent&) = delete;
+    ~StreamEvent() {
+        if (event_ != nullptr) {
+            RuntimeEventOps().destroy(event_);
+        }
+    }
+
+    bool Available() {
+        if (event_ != nullptr) {
+            return true;
+        }
+        const DeviceEventOps& ops = RuntimeEventOps();
+        if (!ops.IsComplete() || ops.stream_wait == nullptr || ops.create(&event_) != 0) {
+            event_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    bool Record(void* stream) { return Available() && RuntimeEventOps().record(event_, stream) == 0; }
+    bool WaitOn(void* stream) { return Available() && RuntimeEventOps().stream_wait(stream, event_) == 0; }
+
+private:
+    void* event_ = nullptr;
+};
+
 class Timer {
 public:
     Timer() : use_device_events_(false) {
@@ -47,6 +113,10 @@ public:
             aclrtDestroyEvent(end_event_);
         }
 #endif
+        if (rt_start_ != nullptr) {
+            RuntimeEventOps().destroy(rt_start_);
+            RuntimeEventOps().destroy(rt_end_);
+        }
     }
 
     // Record start event on stream (NCCL: cudaStream_t, HCCL: aclrtStream).
@@ -63,6 +133,11 @@ public:
             return;
         }
 #endif
+        rt_active_ = !use_device_events_ && stream && EnsureRuntimeEvents();
+        if (rt_active_) {
+            RuntimeEventOps().record(rt_start_, stream);
+            return;
+        }
         start_time_ = std::chrono::high_resolution_clock::now();
     }
 
@@ -81,6 +156,10 @@ public:
             return;
         }
 #endif
+        if (rt_active_) {
+            RuntimeEventOps().record(rt_end_, stream);
+            return;
+        }
         end_time_ = std::chrono::high_resolution_clock::now();
     }
 
@@ -96,6 +175,9 @@ public:
             aclrtSynchronizeEvent(end_event_);
         }
 #endif
+        if (rt_active_) {
+            RuntimeEventOps().synchronize(rt_end_);
+        }
     }
 
     double ElapsedSeconds() const {
@@ -114,6 +196,13 @@ public:
             return 0.0;
         }
 #endif
+        if (rt_active_) {
+            float ms = 0.0f;
+            if (RuntimeEventOps().elapsed_ms(&ms, rt_start_, rt_end_) == 0) {
+                return ms / 1000.0;
+            }
+            return 0.0;
+        }
         auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
             end_time_ - start_time_);
         return duration.count() / 1000000.0;
@@ -124,7 +213,28 @@ public:
     }
 
 private:
+    // Create the runtime events on first use (ops are registered after CommInit starts).
+    bool EnsureRuntimeEvents() {
+        if (rt_start_ != nullptr) {
+            return true;
+        }
+        const DeviceEventOps& ops = RuntimeEventOps();
+        if (!ops.IsComplete() || ops.create(&rt_start_) != 0) {
+            rt_start_ = nullptr;
+            return false;
+        }
+        if (ops.create(&rt_end_) != 0) {
+            ops.destroy(rt_start_);
+            rt_start_ = nullptr;
+            return false;
+        }
+        return true;
+    }
+
     bool use_device_events_;
+    bool rt_active_ = false;   // Last Start() used the runtime events
+    void* rt_start_ = nullptr;
+    void* rt_end_ = nullptr;
 #if defined(AMPCCL_USE_CUDA_TIMER)
     cudaEvent_t start_event_;
     cudaEvent_t end_event_;
@@ -0,0 +1,40 @@
+#include "trace.h"
+#include "common/config.h"
+#include "common/log.h"
+#include <chrono>
+#include <unistd.h>
+
+namespace ampccl {
+
+uint64_t Tracer::NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Tracer::Tracer() {
+    std::string path = Config::GetTracePath();
+    if (path.empty()) {
+        return;
+    }
+    TraceFileHeader hdr = {};
+    hdr.magic = kTraceMagic;
+    hdr.version = kTraceVersion;
+    hdr.record_size = sizeof(TraceRecord);
+    hdr.pid = static_cast<int32_t>(getpid());
+    size_t ring_capacity = Config::GetTraceRingSize();
+    if (!writer_.Open(path, &hdr, sizeof(hdr), ring_capacity)) {
+        AMPCCL_LOG(WARN, "Trace: cannot open %s", path.c_str());
+        return;
+    }
+    AMPCCL_LOG(INFO, "Trace: writing to %s (%zu records per thread)", path.c_str(), ring_capacity);
+}
+
+Tracer::~Tracer() {
+    uint64_t dropped = writer_.Close();
+    if (dropped > 0) {
+        AMPCCL_LOG(WARN, "Trace: %llu records dropped (ring full); raise AMPCCL_TRACE_RING",
+                   static_cast<unsigned long long>(dropped));
+    }
+}
+
+}  // namespace ampccl
@@ -0,0 +1,93 @@
+#ifndef AMPCCL_TELEMETRY_TRACE_H_
+#define AMPCCL_TELEMETRY_TRACE_H_
+
+#include "telemetry/record_writer.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace ampccl {
+
+// Per-collective trace (AMPCCL_TRACE=<path>): one fixed-size binary record per
+// collective, written at stream sync into a lock-free per-thread ring and appended to
+// the trace file by a background drainer. tools/ampccl_trace2json.cc converts the
+// file to Chrome trace JSON (chrome://tracing, Perfetto).
+
+#pragma pack(push, 1)
+struct TraceFileHeader {
+    uint64_t magic;        // kTraceMagic
+    uint32_t version;      // kTraceVersion
+    uint32_t record_size;  // sizeof(TraceRecord)
+    int32_t pid;
+    int32_t reserved;
+};
+
+struct TraceRecord {
+    uint64_t seq;             // Per-domain collective sequence number (same on every rank)
+    uint64_t domain;          // CommDomain::key_id()
+    uint64_t launch_ns;       // Wall clock at collective entry (ns since epoch)
+    uint64_t launch_cost_ns;  // Host time spent in the collective call (plan + launches)
+    uint64_t sync_ns;         // Wall clock when the stream sync consumed the collective
+    uint64_t bytes;           // OpKey bytes
+    uint64_t fast_bytes;
+    uint64_t pcie_bytes;
+    double alpha;             // Fast ratio suggested by the controller
+    double fast_time;         // Device seconds on the fast path
+    double pcie_time;         // Device seconds on the PCIe path
+    int32_t datatype;
+    int32_t rank;             // comm rank, -1 if unknown
+    uint32_t tid;             // Thread that ran the stream sync
+    uint8_t op;               // CollectiveType
+    uint8_t flags;            // kTrace* bits
+    uint8_t reserved[26];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(TraceRecord) == 128, "TraceRecord layout changed");
+
+constexpr uint64_t kTraceMagic = 0x414d504343545243u;  // "AMPCCTRC"
+constexpr uint32_t kTraceVersion = 1;
+
+enum TraceFlags : uint8_t {
+    kTraceUsePCIe = 1u << 0,
+    kTraceFastOk = 1u << 1,
+    kTracePCIeOk = 1u << 2,
+};
+
+// Launch-side stamp carried in PendingCollective until the record is written.
+struct TraceStamp {
+    uint64_t seq = 0;
+    uint64_t launch_ns = 0;
+    uint64_t launch_cost_ns = 0;
+};
+
+class Tracer {
+public:
+    static Tracer& GetInstance() {
+        static Tracer instance;
+        return instance;
+    }
+
+    bool IsEnabled() const { return writer_.IsOpen(); }
+
+    // Wall clock in ns since epoch (comparable across ranks and with framework traces).
+    static uint64_t NowNs();
+
+    // Lock-free on the calling thread's ring (registered on first use).
+    void Record(const TraceRecord& rec) { writer_.Push(rec); }
+
+    // Drain every ring to the file now.
+    void Flush() { writer_.Flush(); }
+
+private:
+    Tracer();
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    RecordWriter<TraceRecord> writer_;
+};
+
+}  // namespace ampccl
+
+#endif  // AMPCCL_TELEMETRY_TRACE_H_
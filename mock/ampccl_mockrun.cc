@@ -0,0 +1,583 @@
+// ampccl-mockrun: multi-process collective driver for the mock device libraries.
+// Forks one process per rank, each of which initializes a communicator through the
+// public NCCL (or HCCL) API and times collective + stream synchronize per size, like
+// nccl-tests. Linked against the mock libnccl/libcudart/libhccl/libascendcl, so a
+// plain run is the library baseline and a run with LD_PRELOAD=libampccl.so measures
+// the same loop through AmpCCL.
+//
+//   ampccl-mockrun --ranks 4
+//   LD_PRELOAD=build/libampccl.so AMPCCL_ENABLE=1 ampccl-mockrun --ranks 4 --check
+//
+// --init picks the NCCL communicator creation path: rank (ncclCommInitRank), config,
+// scalable, split (a same-size ncclCommSplit of an InitRank communicator), group (split
+// with the InitRank and the split each inside ncclGroupStart / ncclGroupEnd) or all (one
+// process, ncclCommInitAll, one thread per rank). With --api hccl it is rank
+// (HcclCommInitRank), rootinfo (HcclGetRootInfo + HcclCommInitRootInfo) or cluster
+// (HcclCommInitClusterInfo on a rank table written to /tmp, eight devices per server,
+// devices 0-3 on NUMA node 0 and 4-7 on node 1; also exported as RANK_TABLE_FILE).
+// --group K (NCCL) issues the collective K times per iteration between one
+// ncclGroupStart / ncclGroupEnd, as PyTorch coalesces calls, before the stream sync.
+//
+// Reported time per iteration is the slowest rank's issue-to-synchronized time.
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Public entry points of the mock libraries (nccl.h / cuda_runtime.h / hccl.h / acl.h).
+extern "C" {
+typedef struct { char internal[128]; } ncclUniqueId;
+typedef struct { char internal[128]; } hcclUniqueId;
+typedef struct { char internal[4108]; } HcclRootInfo;
+int ncclGetUniqueId(ncclUniqueId* id);
+int ncclCommInitRank(void** comm, int nranks, ncclUniqueId id, int rank);
+int ncclCommInitRankConfig(void** comm, int nranks, ncclUniqueId id, int rank, void* config);
+int ncclCommInitRankScalable(void** comm, int nranks, int rank, int n_ids, ncclUniqueId* ids, void* config);
+int ncclCommInitAll(void** comms, int ndev, const int* devlist);
+int ncclCommSplit(void* comm, int color, int key, void** newcomm, void* config);
+int ncclCommDestroy(void* comm);
+int ncclGroupStart();
+int ncclGroupEnd();
+int ncclAllReduce(const void* send, void* recv, size_t count, int dt, int op, void* comm, void* stream);
+int ncclAllGather(const void* send, void* recv, size_t sendcount, int dt, void* comm, void* stream);
+int ncclReduceScatter(const void* send, void* recv, size_t recvcount, int dt, int op, void* comm, void* stream);
+int ncclBroadcast(const void* send, void* recv, size_t count, int dt, int root, void* comm, void* stream);
+int cudaSetDevice(int device);
+int cudaGetDeviceCount(int* count);
+int cudaMalloc(void** ptr, size_t size);
+int cudaFree(void* ptr);
+int cudaMemcpy(void* dst, const void* src, size_t count, int kind);
+int cudaStreamCreate(void** stream);
+int cudaStreamDestroy(void* stream);
+int cudaStreamSynchronize(void* stream);
+int HcclGetUniqueId(hcclUniqueId* id);
+int HcclCommInitRank(void** comm, unsigned int nranks, hcclUniqueId id, unsigned int rank);
+int HcclGetRootInfo(HcclRootInfo* root_info);
+int HcclCommInitRootInfo(uint32_t nranks, const HcclRootInfo* root_info, uint32_t rank, void** comm);
+int HcclCommInitClusterInfo(const char* cluster_info, uint32_t rank, void** comm);
+int HcclCommDestroy(void* comm);
+int HcclAllReduce(const void* send, void* recv, unsigned long count, int dt, int op, void* comm, void* stream);
+int HcclAllGather(const void* send, void* recv, unsigned long sendcount, int dt, void* comm, void* stream);
+int HcclReduceScatter(const void* send, void* recv, unsigned long recvcount, int dt, int op, void* comm,
+                      void* stream);
+int HcclBroadcast(const void* send, void* recv, unsigned long count, int dt, unsigned int root, void* comm,
+                  void* stream);
+int aclrtSetDevice(int32_t device);
+int aclrtMalloc(void** ptr, size_t size, int policy);
+int aclrtFree(void* ptr);
+int aclrtMemcpy(void* dst, size_t dest_max, const void* src, size_t count, int kind);
+int aclrtCreateStream(void** stream);
+int aclrtDestroyStream(void* stream);
+int aclrtSynchronizeStream(void* stream);
+}
+
+namespace {
+
+constexpr int kNcclFloat32 = 7;
+constexpr int kHcclFp32 = 4;
+constexpr int kSum = 0;  // ncclSum == HCCL_REDUCE_SUM
+
+enum class Op { AllReduce, AllGather, ReduceScatter, Broadcast };
+const char* const kOpNames[] = {"allreduce", "allgather", "reducescatter", "broadcast"};
+
+enum class Init { Rank, Config, Scalable, Split, Group, All, RootInfo, Cluster };
+const char* const kInitNames[] = {"rank", "config", "scalable", "split", "group", "all", "rootinfo", "cluster"};
+
+struct Options {
+    bool hccl = false;
+    int ranks = 2;
+    int iters = 20;
+    int warmup = 5;
+    Op op = Op::AllReduce;
+    Init init = Init::Rank;
+    std::vector<size_t> sizes{4u << 10, 64u << 10, 1u << 20, 16u << 20, 64u << 20};
+    double skew_us = 0.0;
+    bool check = false;
+    bool json = false;
+    int hosts = 1;           // AMPCCL_HOST_ID per rank: rank r on host r % hosts
+    int group = 0;           // Collectives per ncclGroupStart / ncclGroupEnd; 0 = ungrouped
+    std::string rank_table;  // Init::Cluster: written by main before the fork
+};
+
+void Usage() {
+    std::fprintf(stderr,
+        "usage: ampccl-mockrun [--api nccl|hccl] [--ranks N] [--iters N] [--warmup N]\n"
+        "                      [--op allreduce|allgather|reducescatter|broadcast]\n"
+        "                      [--init rank|config|scalable|split|group|all|rootinfo|cluster]\n"
+        "                      [--sizes 4K,1M,...] [--skew-us US] [--hosts H] [--group K]\n"
+        "                      [--check] [--json]\n");
+}
+
+bool ParseSize(const std::string& s, size_t* out) {
+    char* end = nullptr;
+    double v = std::strtod(s.c_str(), &end);
+    if (end == s.c_str() || v <= 0) return false;
+    switch (*end) {
+        case '\0': break;
+        case 'k': case 'K': v *= 1024; ++end; break;
+        case 'm': case 'M': v *= 1024 * 1024; ++end; break;
+        case 'g': case 'G': v *= 1024.0 * 1024 * 1024; ++end; break;
+        default: return false;
+    }
+    if (*end != '\0') return false;
+    *out = static_cast<size_t>(v);
+    return true;
+}
+
+bool ParseArgs(int argc, char** argv, Options* opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") return false;
+        if (a == "--check") {
+            opt->check = true;
+            continue;
+        }
+        if (a == "--json") {
+            opt->json = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        std::string v = argv[++i];
+        if (a == "--api") {
+            if (v != "nccl" && v != "hccl") return false;
+            opt->hccl = (v == "hccl");
+        } else if (a == "--ranks") opt->ranks = std::atoi(v.c_str());
+        else if (a == "--iters") opt->iters = std::atoi(v.c_str());
+        else if (a == "--warmup") opt->warmup = std::atoi(v.c_str());
+        else if (a == "--skew-us") opt->skew_us = std::atof(v.c_str());
+        else if (a == "--hosts") opt->hosts = std::atoi(v.c_str());
+        else if (a == "--group") opt->group = std::atoi(v.c_str());
+        else if (a == "--op") {
+            auto it = std::find_if(std::begin(kOpNames), std::end(kOpNames),
+                                   [&](const char* n) { return v == n; });
+            if (it == std::end(kOpNames)) return false;
+            opt->op = static_cast<Op>(it - std::begin(kOpNames));
+        } else if (a == "--init") {
+            auto it = std::find_if(std::begin(kInitNames), std::end(kInitNames),
+                                   [&](const char* n) { return v == n; });
+            if (it == std::end(kInitNames)) return false;
+            opt->init = static_cast<Init>(it - std::begin(kInitNames));
+        } else if (a == "--sizes") {
+            opt->sizes.clear();
+            size_t start = 0;
+            while (start <= v.size()) {
+                size_t end = v.find(',', start);
+                if (end == std::string::npos) end = v.size();
+                size_t bytes;
+                if (!ParseSize(v.substr(start, end - start), &bytes)) return false;
+                opt->sizes.push_back(bytes);
+                start = end + 1;
+            }
+        } else return false;
+    }
+    // Each API has its own creation paths (rank is common to both).
+    bool hccl_init = opt->init == Init::Rank || opt->init == Init::RootInfo || opt->init == Init::Cluster;
+    if (opt->hccl ? !hccl_init : opt->init == Init::RootInfo || opt->init == Init::Cluster) return false;
+    if (opt->hccl && opt->group > 0) return false;  // HCCL has no group calls here
+    return opt->ranks >= 1 && opt->ranks <= 1024 && opt->iters >= 1 && opt->warmup >= 0 && opt->hosts >= 1 &&
+           opt->group >= 0 && !opt->sizes.empty();
+}
+
+// Shared with the rank processes (anonymous MAP_SHARED, set up before fork).
+struct Shared {
+    std::atomic<int> id_ready;
+    char unique_id[sizeof(HcclRootInfo)];  // ncclUniqueId, hcclUniqueId or HcclRootInfo
+};
+
+// Per-rank results: times[size][iter] in seconds, check[size] (-1 skipped, 0 fail, 1 ok).
+struct RankResults {
+    double* times;
+    int* check;
+};
+
+// Element counts for a "size" in bytes, as nccl-tests counts them: the full buffer
+// (AllReduce/Broadcast send, AllGather recv, ReduceScatter send).
+struct Counts {
+    size_t send;
+    size_t recv;
+};
+
+Counts CountsFor(Op op, size_t bytes, int nranks) {
+    size_t n = std::max<size_t>(bytes / sizeof(float), nranks);
+    size_t per_rank = n / nranks;
+    switch (op) {
+        case Op::AllGather: return {per_rank, per_rank * nranks};
+        case Op::ReduceScatter: return {per_rank * nranks, per_rank};
+        default: return {n, n};
+    }
+}
+
+double BusFactor(Op op, int nranks) {
+    switch (op) {
+        case Op::AllReduce: return 2.0 * (nranks - 1) / nranks;
+        case Op::AllGather:
+        case Op::ReduceScatter: return static_cast<double>(nranks - 1) / nranks;
+        case Op::Broadcast: return 1.0;
+    }
+    return 1.0;
+}
+
+float SendValue(int rank, size_t i) { return static_cast<float>(rank + 1 + static_cast<int>(i % 7)); }
+
+float Expected(Op op, int rank, int nranks, size_t i, size_t recvcount) {
+    switch (op) {
+        case Op::AllReduce:
+            return static_cast<float>(nranks * (nranks + 1) / 2 + nranks * static_cast<int>(i % 7));
+        case Op::AllGather: {
+            size_t per_rank = recvcount / nranks;
+            return SendValue(static_cast<int>(i / per_rank), i % per_rank);
+        }
+        case Op::ReduceScatter: {
+            size_t j = static_cast<size_t>(rank) * recvcount + i;
+            return static_cast<float>(nranks * (nranks + 1) / 2 + nranks * static_cast<int>(j % 7));
+        }
+        case Op::Broadcast: return SendValue(0, i);
+    }
+    return 0.0f;
+}
+
+// The device API one rank drives; NCCL + CUDA or HCCL + ACL.
+struct Api {
+    bool hccl;
+
+    int SetDevice(int d) const { return hccl ? aclrtSetDevice(d) : cudaSetDevice(d); }
+    int Malloc(void** p, size_t n) const { return hccl ? aclrtMalloc(p, n, 0) : cudaMalloc(p, n); }
+    void Free(void* p) const { hccl ? aclrtFree(p) : cudaFree(p); }
+    int Memcpy(void* dst, const void* src, size_t n) const {
+        return hccl ? aclrtMemcpy(dst, n, src, n, 0) : cudaMemcpy(dst, src, n, 0);
+    }
+    int StreamCreate(void** s) const { return hccl ? aclrtCreateStream(s) : cudaStreamCreate(s); }
+    void StreamDestroy(void* s) const { hccl ? aclrtDestroyStream(s) : cudaStreamDestroy(s); }
+    int Sync(void* s) const { return hccl ? aclrtSynchronizeStream(s) : cudaStreamSynchronize(s); }
+
+    int GetUniqueId(Init init, char* out) const {
+        if (init == Init::RootInfo) return HcclGetRootInfo(reinterpret_cast<HcclRootInfo*>(out));
+        if (hccl) return HcclGetUniqueId(reinterpret_cast<hcclUniqueId*>(out));
+        return ncclGetUniqueId(reinterpret_cast<ncclUniqueId*>(out));
+    }
+    // Init::Split / Group leave the InitRank parent in *parent (destroyed after the child).
+    int CommInit(Init init, void** comm, void** parent, int nranks, const char* id, int rank,
+                 const std::string& rank_table) const {
+        if (init == Init::RootInfo)
+            return HcclCommInitRootInfo(nranks, reinterpret_cast<const HcclRootInfo*>(id), rank, comm);
+        if (init == Init::Cluster) return HcclCommInitClusterInfo(rank_table.c_str(), rank, comm);
+        if (hccl) {
+            hcclUniqueId h;
+            std::memcpy(&h, id, sizeof(h));
+            return HcclCommInitRank(comm, nranks, h, rank);
+        }
+        ncclUniqueId n;
+        std::memcpy(&n, id, sizeof(n));
+        switch (init) {
+            case Init::Config: return ncclCommInitRankConfig(comm, nranks, n, rank, nullptr);
+            case Init::Scalable: return ncclCommInitRankScalable(comm, nranks, rank, 1, &n, nullptr);
+            case Init::Split: {
+                int ret = ncclCommInitRank(parent, nranks, n, rank);
+                return ret != 0 ? ret : ncclCommSplit(*parent, 0, rank, comm, nullptr);
+            }
+            case Init::Group: {
+                ncclGroupStart();
+                int ret = ncclCommInitRank(parent, nranks, n, rank);
+                int end = ncclGroupEnd();
+                if (ret != 0 || end != 0) return ret != 0 ? ret : end;
+                ncclGroupStart();
+                ret = ncclCommSplit(*parent, 0, rank, comm, nullptr);
+                end = ncclGroupEnd();
+                return ret != 0 ? ret : end;
+            }
+            default: return ncclCommInitRank(comm, nranks, n, rank);
+        }
+    }
+    void CommDestroy(void* comm) const { hccl ? HcclCommDestroy(comm) : ncclCommDestroy(comm); }
+
+    int Collective(Op op, const void* send, void* recv, const Counts& c, void* comm, void* s) const {
+        int dt = hccl ? kHcclFp32 : kNcclFloat32;
+        switch (op) {
+            case Op::AllReduce:
+                return hccl ? HcclAllReduce(send, recv, c.send, dt, kSum, comm, s)
+                            : ncclAllReduce(send, recv, c.send, dt, kSum, comm, s);
+            case Op::AllGather:
+                return hccl ? HcclAllGather(send, recv, c.send, dt, comm, s)
+                            : ncclAllGather(send, recv, c.send, dt, comm, s);
+            case Op::ReduceScatter:
+                return hccl ? HcclReduceScatter(send, recv, c.recv, dt, kSum, comm, s)
+                            : ncclReduceScatter(send, recv, c.recv, dt, kSum, comm, s);
+            case Op::Broadcast:
+                return hccl ? HcclBroadcast(send, recv, c.send, dt, 0, comm, s)
+                            : ncclBroadcast(send, recv, c.send, dt, 0, comm, s);
+        }
+        return -1;
+    }
+};
+
+double Now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One iteration's collective, or opt.group of them inside one NCCL group.
+int IssueIteration(const Api& api, const Options& opt, const void* send, void* recv, const Counts& c, void* comm,
+                   void* stream) {
+    if (opt.group == 0) return api.Collective(opt.op, send, recv, c, comm, stream);
+    int ret = ncclGroupStart();
+    for (int g = 0; g < opt.group && ret == 0; ++g) ret = api.Collective(opt.op, send, recv, c, comm, stream);
+    int end = ncclGroupEnd();
+    return ret != 0 ? ret : end;
+}
+
+// comm: already created (Init::All), else nullptr and the rank creates its own.
+int RunRank(const Options& opt, int rank, Shared* shared, RankResults out, void* comm) {
+    Api api{opt.hccl};
+    if (api.SetDevice(rank % 8) != 0) {
+        std::fprintf(stderr, "ampccl-mockrun: rank %d: set device failed\n", rank);
+        return 1;
+    }
+    // Cluster init has no root: the rank table names the communicator.
+    if (opt.init == Init::Cluster) shared->id_ready.store(1, std::memory_order_release);
+    if (comm == nullptr && rank == 0 && opt.init != Init::Cluster) {
+        if (api.GetUniqueId(opt.init, shared->unique_id) != 0) {
+            std::fprintf(stderr, "ampccl-mockrun: get unique id failed\n");
+            shared->id_ready.store(-1);
+            return 1;
+        }
+        shared->id_ready.store(1, std::memory_order_release);
+    }
+    int ready = 1;
+    while (comm == nullptr && (ready = shared->id_ready.load(std::memory_order_acquire)) == 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    if (comm == nullptr && ready < 0) return 1;
+
+    void* parent = nullptr;
+    void* stream = nullptr;
+    if ((comm == nullptr && api.CommInit(opt.init, &comm, &parent, opt.ranks, shared->unique_id, rank, opt.rank_table) != 0) ||
+        api.StreamCreate(&stream) != 0) {
+        std::fprintf(stderr, "ampccl-mockrun: rank %d: communicator init failed\n", rank);
+        return 1;
+    }
+
+    size_t max_bytes = *std::max_element(opt.sizes.begin(), opt.sizes.end());
+    Counts max_counts = CountsFor(opt.op, max_bytes, opt.ranks);
+    size_t send_bytes = std::max(max_counts.send, max_counts.recv) * sizeof(float);
+    void* send = nullptr;
+    void* recv = nullptr;
+    if (api.Malloc(&send, send_bytes) != 0 || api.Malloc(&recv, send_bytes) != 0) {
+        std::fprintf(stderr, "ampccl-mockrun: rank %d: out of memory\n", rank);
+        return 1;
+    }
+    std::vector<float> host(send_bytes / sizeof(float));
+    for (size_t i = 0; i < host.size(); ++i) host[i] = SendValue(rank, i);
+    api.Memcpy(send, host.data(), send_bytes);
+
+    std::mt19937 rng(static_cast<unsigned>(rank) * 7919u + 1u);
+    std::uniform_real_distribution<double> skew(0.0, opt.skew_us);
+    int status = 0;
+    for (size_t si = 0; si < opt.sizes.size(); ++si) {
+        Counts c = CountsFor(opt.op, opt.sizes[si], opt.ranks);
+        for (int it = -opt.warmup; it < opt.iters; ++it) {
+            if (opt.skew_us > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(skew(rng)));
+            double t0 = Now();
+            if (IssueIteration(api, opt, send, recv, c, comm, stream) != 0 || api.Sync(stream) != 0) {
+                std::fprintf(stderr, "ampccl-mockrun: rank %d: %s failed\n", rank, kOpNames[static_cast<int>(opt.op)]);
+                return 1;
+            }
+            if (it >= 0) out.times[si * opt.iters + it] = Now() - t0;
+        }
+        out.check[si] = -1;
+        if (opt.check) {
+            std::vector<float> got(c.recv);
+            api.Memcpy(got.data(), recv, c.recv * sizeof(float));
+            out.check[si] = 1;
+            for (size_t i = 0; i < c.recv; ++i) {
+                if (got[i] != Expected(opt.op, rank, opt.ranks, i, c.recv)) {
+                    out.check[si] = 0;
+                    status = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    api.Free(send);
+    api.Free(recv);
+    api.StreamDestroy(stream);
+    api.CommDestroy(comm);
+    if (parent) api.CommDestroy(parent);
+    return status;
+}
+
+// Rank table for Init::Cluster, in the Ascend 1.0 format plus a per-device numa_id.
+bool WriteRankTable(int nranks, std::string* path) {
+    char name[] = "/tmp/ampccl_mockrun_ranktable_XXXXXX";
+    int fd = mkstemp(name);
+    if (fd < 0) return false;
+    close(fd);
+    std::ofstream out(name);
+    out << "{\"version\": \"1.0\", \"server_count\": \"" << (nranks + 7) / 8 << "\", \"server_list\": [";
+    for (int r = 0; r < nranks; ++r) {
+        int dev = r % 8;
+        if (dev == 0) out << (r > 0 ? "]}, " : "") << "{\"server_id\": \"10.0.0." << r / 8 + 1 << "\", \"device\": [";
+        out << (dev > 0 ? ", " : "") << "{\"device_id\": \"" << dev << "\", \"device_ip\": \"192.168." << r / 8
+            << "." << dev << "\", \"rank_id\": \"" << r << "\", \"numa_id\": \"" << dev / 4 << "\"}";
+    }
+    out << "]}], \"status\": \"completed\"}\n";
+    *path = name;
+    return static_cast<bool>(out);
+}
+
+double Percentile(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(std::ceil(p * v.size())) - 1;
+    return v[std::min(i, v.size() - 1)];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    if (opt.init == Init::Cluster) {
+        if (!WriteRankTable(opt.ranks, &opt.rank_table)) {
+            std::fprintf(stderr, "ampccl-mockrun: cannot write rank table\n");
+            return 1;
+        }
+        setenv("RANK_TABLE_FILE", opt.rank_table.c_str(), 1);
+    }
+
+    size_t nsizes = opt.sizes.size();
+    size_t times_len = static_cast<size_t>(opt.ranks) * nsizes * opt.iters;
+    size_t map_size = sizeof(Shared) + times_len * sizeof(double) + opt.ranks * nsizes * sizeof(int);
+    void* mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        std::perror("ampccl-mockrun: mmap");
+        return 1;
+    }
+    Shared* shared = new (mem) Shared();
+    double* times = reinterpret_cast<double*>(static_cast<char*>(mem) + sizeof(Shared));
+    int* checks = reinterpret_cast<int*>(times + times_len);
+
+    // One process driving every rank (ncclCommInitAll): a thread per rank instead of a
+    // process. A failed rank leaves the others to the simulator's rendezvous timeout.
+    int failed = 0;
+    if (opt.init == Init::All) {
+        std::vector<void*> comms(opt.ranks, nullptr);
+        if (ncclCommInitAll(comms.data(), opt.ranks, nullptr) != 0) {
+            std::fprintf(stderr, "ampccl-mockrun: ncclCommInitAll failed\n");
+            return 1;
+        }
+        std::vector<int> status(opt.ranks, 0);
+        std::vector<std::thread> threads;
+        for (int r = 0; r < opt.ranks; ++r) {
+            threads.emplace_back([&, r] {
+                RankResults out{times + static_cast<size_t>(r) * nsizes * opt.iters, checks + r * nsizes};
+                status[r] = RunRank(opt, r, shared, out, comms[r]);
+            });
+        }
+        for (auto& t : threads) t.join();
+        for (int st : status) failed += st != 0;
+    }
+
+    std::vector<pid_t> pids;
+    for (int r = 0; opt.init != Init::All && r < opt.ranks; ++r) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::perror("ampccl-mockrun: fork");
+            for (pid_t p : pids) kill(p, SIGKILL);
+            return 1;
+        }
+        if (pid == 0) {
+            RankResults out{times + static_cast<size_t>(r) * nsizes * opt.iters, checks + r * nsizes};
+            // As a launcher would: AmpCCL keys communicators by the job-wide rank list.
+            setenv("RANK", std::to_string(r).c_str(), 1);
+            setenv("WORLD_SIZE", std::to_string(opt.ranks).c_str(), 1);
+            if (opt.hosts > 1) {
+                // PCCL groups are per host too: one mock group per simulated host.
+                std::string host = "mock-host" + std::to_string(r % opt.hosts);
+                setenv("AMPCCL_HOST_ID", host.c_str(), 1);
+                setenv("AMPCCL_MOCK_PCCL_GROUP", (std::to_string(getppid()) + "-" + host).c_str(), 1);
+            }
+            std::fflush(nullptr);
+            // exit, not _exit: the rank's static destructors detach (and, for the last
+            // rank, unlink) its AmpCCL and simulator segments like a real job's exit.
+            std::exit(RunRank(opt, r, shared, out, nullptr));
+        }
+        pids.push_back(pid);
+    }
+    // A failed rank leaves the others parked in a rendezvous: stop them too.
+    for (size_t left = pids.size(); left > 0; --left) {
+        int st = 0;
+        pid_t pid = wait(&st);
+        if (pid < 0) break;
+        if (!WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+            if (failed++ == 0) {
+                for (pid_t p : pids) {
+                    if (p != pid) kill(p, SIGKILL);
+                }
+            }
+        }
+    }
+
+    if (!opt.rank_table.empty()) unlink(opt.rank_table.c_str());
+
+    const char* op_name = kOpNames[static_cast<int>(opt.op)];
+    if (opt.json) {
+        std::printf("{\"api\": \"%s\", \"op\": \"%s\", \"ranks\": %d, \"iters\": %d, \"results\": [",
+                    opt.hccl ? "hccl" : "nccl", op_name, opt.ranks, opt.iters);
+    } else {
+        std::printf("# %s %s, %d ranks, %d iters (+%d warmup), init %s", opt.hccl ? "hccl" : "nccl", op_name,
+                    opt.ranks, opt.iters, opt.warmup, kInitNames[static_cast<int>(opt.init)]);
+        if (opt.group > 0) std::printf(", %d per group", opt.group);
+        std::printf("\n");
+        std::printf("%12s %12s %12s %12s %12s %8s\n", "bytes", "mean_us", "p50_us", "algbw_GB/s", "busbw_GB/s",
+                    "check");
+    }
+    for (size_t si = 0; si < nsizes; ++si) {
+        // Iteration time: the slowest rank.
+        std::vector<double> iter(opt.iters, 0.0);
+        int check = 1;
+        for (int r = 0; r < opt.ranks; ++r) {
+            for (int it = 0; it < opt.iters; ++it)
+                iter[it] = std::max(iter[it], times[(static_cast<size_t>(r) * nsizes + si) * opt.iters + it]);
+            check = std::min(check, checks[r * nsizes + si]);
+        }
+        double mean = 0.0;
+        for (double t : iter) mean += t;
+        mean /= opt.iters;
+        double p50 = Percentile(iter, 0.5);
+        size_t bytes = CountsFor(opt.op, opt.sizes[si], opt.ranks).send * sizeof(float);
+        if (opt.op == Op::AllGather) bytes *= opt.ranks;
+        double algbw = mean > 0 ? bytes / mean / 1e9 : 0.0;
+        double busbw = algbw * BusFactor(opt.op, opt.ranks);
+        const char* check_str = failed ? "error" : check < 0 ? "-" : check ? "ok" : "FAIL";
+        if (opt.json) {
+            std::printf("%s{\"bytes\": %zu, \"mean_us\": %.2f, \"p50_us\": %.2f, \"algbw_gbps\": %.3f, "
+                        "\"busbw_gbps\": %.3f, \"check\": \"%s\"}",
+                        si ? ", " : "", bytes, mean * 1e6, p50 * 1e6, algbw, busbw, check_str);
+        } else {
+            std::printf("%12zu %12.2f %12.2f %12.3f %12.3f %8s\n", bytes, mean * 1e6, p50 * 1e6, algbw, busbw,
+                        check_str);
+        }
+    }
+    if (opt.json) std::printf("]}\n");
+    munmap(mem, map_size);
+    if (failed) std::fprintf(stderr, "ampccl-mockrun: %d of %d ranks failed\n", failed, opt.ranks);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// Mock Ascend runtime (libascendcl.so) on top of the host simulator: the aclrt*
+// calls the HCCL hook, the stat reducer, the device timer and ampccl-mockrun make.
+
+#include "sim.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using ampccl::sim::Event;
+using ampccl::sim::Stream;
+namespace sim = ampccl::sim;
+
+extern "C" {
+
+typedef int aclError;
+typedef void* aclrtStream;
+typedef void* aclrtEvent;
+#define ACL_SUCCESS 0
+#define ACL_ERROR_INVALID_PARAM 100000
+#define ACL_ERROR_BAD_ALLOC 200000
+#define ACL_ERROR_RT_EVENT_NOT_COMPLETE 207008
+
+aclError aclInit(const char* /*config_path*/) { return ACL_SUCCESS; }
+aclError aclFinalize() { return ACL_SUCCESS; }
+
+aclError aclrtGetDeviceCount(uint32_t* count) {
+    if (!count) return ACL_ERROR_INVALID_PARAM;
+    *count = static_cast<uint32_t>(sim::SimConfig::Get().devices);
+    return ACL_SUCCESS;
+}
+
+aclError aclrtSetDevice(int32_t device) {
+    if (device < 0 || device >= sim::SimConfig::Get().devices) return ACL_ERROR_INVALID_PARAM;
+    sim::SetDevice(device);
+    return ACL_SUCCESS;
+}
+
+aclError aclrtGetDevice(int32_t* device) {
+    if (!device) return ACL_ERROR_INVALID_PARAM;
+    *device = sim::GetDevice();
+    return ACL_SUCCESS;
+}
+
+aclError aclrtResetDevice(int32_t /*device*/) { return ACL_SUCCESS; }
+
+const char* aclrtGetSocName() { return "MockNPU"; }
+
+aclError aclrtMalloc(void** ptr, size_t size, int /*policy*/) {
+    if (!ptr || size == 0) return ACL_ERROR_INVALID_PARAM;
+    *ptr = sim::DeviceAlloc(size);
+    return *ptr ? ACL_SUCCESS : ACL_ERROR_BAD_ALLOC;
+}
+
+aclError aclrtFree(void* ptr) {
+    sim::DeviceFree(ptr);
+    return ACL_SUCCESS;
+}
+
+aclError aclrtMallocHost(void** ptr, size_t size) { return aclrtMalloc(ptr, size, 0); }
+aclError aclrtFreeHost(void* ptr) { return aclrtFree(ptr); }
+
+aclError aclrtMemcpy(void* dst, size_t dest_max, const void* src, size_t count, int /*kind*/) {
+    if (count > dest_max || (count && (!dst || !src))) return ACL_ERROR_INVALID_PARAM;
+    sim::ResolveStream(nullptr)->Synchronize();
+    std::memmove(dst, src, count);
+    return ACL_SUCCESS;
+}
+
+aclError aclrtMemcpyAsync(void* dst, size_t dest_max, const void* src, size_t count, int /*kind*/,
+                          aclrtStream stream) {
+    if (count > dest_max || (count && (!dst || !src))) return ACL_ERROR_INVALID_PARAM;
+    sim::ResolveStream(stream)->Enqueue([=] { std::memmove(dst, src, count); });
+    return ACL_SUCCESS;
+}
+
+aclError aclrtMemset(void* ptr, size_t max_count, int32_t value, size_t count) {
+    if (count > max_count || (count && !ptr)) return ACL_ERROR_INVALID_PARAM;
+    sim::ResolveStream(nullptr)->Synchronize();
+    std::memset(ptr, value, count);
+    return ACL_SUCCESS;
+}
+
+aclError aclrtCreateStream(aclrtStream* stream) {
+    if (!stream) return ACL_ERROR_INVALID_PARAM;
+    *stream = sim::CreateStream();
+    return ACL_SUCCESS;
+}
+
+aclError aclrtDestroyStream(aclrtStream stream) {
+    if (!stream) return ACL_ERROR_INVALID_PARAM;
+    sim::DestroyStream(static_cast<Stream*>(stream));
+    return ACL_SUCCESS;
+}
+
+aclError aclrtSynchronizeStream(aclrtStream stream) {
+    sim::ResolveStream(stream)->Synchronize();
+    return ACL_SUCCESS;
+}
+
+aclError aclrtCreateEventWithFlag(aclrtEvent* event, uint32_t /*flag*/) {
+    if (!event) return ACL_ERROR_INVALID_PARAM;
+    *event = sim::CreateEvent();
+    return ACL_SUCCESS;
+}
+
+aclError aclrtCreateEvent(aclrtEvent* event) { return aclrtCreateEventWithFlag(event, 0); }
+
+aclError aclrtDestroyEvent(aclrtEvent event) {
+    if (!event) return ACL_ERROR_INVALID_PARAM;
+    sim::DestroyEvent(static_cast<Event*>(event));
+    return ACL_SUCCESS;
+}
+
+aclError aclrtRecordEvent(aclrtEvent event, aclrtStream stream) {
+    if (!event) return ACL_ERROR_INVALID_PARAM;
+    sim::RecordEvent(static_cast<Event*>(event), sim::ResolveStream(stream));
+    return ACL_SUCCESS;
+}
+
+aclError aclrtStreamWaitEvent(aclrtStream stream, aclrtEvent event) {
+    if (!event) return ACL_ERROR_INVALID_PARAM;
+    sim::WaitEvent(sim::ResolveStream(stream), static_cast<Event*>(event));
+    return ACL_SUCCESS;
+}
+
+aclError aclrtSynchronizeEvent(aclrtEvent event) {
+    if (!event) return ACL_ERROR_INVALID_PARAM;
+    sim::SynchronizeEvent(static_cast<Event*>(event));
+    return ACL_SUCCESS;
+}
+
+aclError aclrtEventElapsedTime(float* ms, aclrtEvent start, aclrtEvent end) {
+    if (!ms || !start || !end) return ACL_ERROR_INVALID_PARAM;
+    return sim::ElapsedMs(static_cast<Event*>(start), static_cast<Event*>(end), ms)
+               ? ACL_SUCCESS
+               : ACL_ERROR_RT_EVENT_NOT_COMPLETE;
+}
+
+}  // extern "C"
@@ -0,0 +1,218 @@
+// Mock CUDA runtime (libcudart.so) on top of the host simulator: just the calls
+// the NCCL hook, the stat reducer, the device timer and ampccl-mockrun make.
+
+#include "sim.h"
+
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+
+using ampccl::sim::Event;
+using ampccl::sim::Stream;
+namespace sim = ampccl::sim;
+
+extern "C" {
+
+typedef enum {
+    cudaSuccess = 0,
+    cudaErrorInvalidValue = 1,
+    cudaErrorMemoryAllocation = 2,
+    cudaErrorInvalidDevice = 101,
+    cudaErrorInvalidResourceHandle = 400,
+    cudaErrorNotReady = 600,
+} cudaError_t;
+typedef void* cudaStream_t;
+typedef void* cudaEvent_t;
+
+}  // extern "C"
+
+namespace {
+
+thread_local cudaError_t g_last_error = cudaSuccess;
+
+cudaError_t Ret(cudaError_t e) {
+    if (e != cudaSuccess && e != cudaErrorNotReady) g_last_error = e;
+    return e;
+}
+
+// Live streams, for cudaDeviceSynchronize.
+std::mutex g_streams_mu;
+std::unordered_set<Stream*>& Streams() {
+    static auto* s = new std::unordered_set<Stream*>;
+    return *s;
+}
+
+}  // namespace
+
+extern "C" {
+
+cudaError_t cudaGetDeviceCount(int* count) {
+    if (!count) return Ret(cudaErrorInvalidValue);
+    *count = sim::SimConfig::Get().devices;
+    return cudaSuccess;
+}
+
+cudaError_t cudaSetDevice(int device) {
+    if (device < 0 || device >= sim::SimConfig::Get().devices) return Ret(cudaErrorInvalidDevice);
+    sim::SetDevice(device);
+    return cudaSuccess;
+}
+
+cudaError_t cudaGetDevice(int* device) {
+    if (!device) return Ret(cudaErrorInvalidValue);
+    *device = sim::GetDevice();
+    return cudaSuccess;
+}
+
+// Only the leading name[256] of cudaDeviceProp is filled in.
+cudaError_t cudaGetDeviceProperties(void* prop, int device) {
+    if (!prop) return Ret(cudaErrorInvalidValue);
+    if (device < 0 || device >= sim::SimConfig::Get().devices) return Ret(cudaErrorInvalidDevice);
+    std::snprintf(static_cast<char*>(prop), 256, "Mock GPU");
+    return cudaSuccess;
+}
+
+cudaError_t cudaMalloc(void** ptr, size_t size) {
+    if (!ptr) return Ret(cudaErrorInvalidValue);
+    *ptr = sim::DeviceAlloc(size);
+    return *ptr ? cudaSuccess : Ret(cudaErrorMemoryAllocation);
+}
+
+cudaError_t cudaFree(void* ptr) {
+    sim::DeviceFree(ptr);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMallocHost(void** ptr, size_t size) { return cudaMalloc(ptr, size); }
+cudaError_t cudaFreeHost(void* ptr) { return cudaFree(ptr); }
+
+cudaError_t cudaMemcpy(void* dst, const void* src, size_t count, int /*kind*/) {
+    if (count && (!dst || !src)) return Ret(cudaErrorInvalidValue);
+    sim::ResolveStream(nullptr)->Synchronize();
+    std::memmove(dst, src, count);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemcpyAsync(void* dst, const void* src, size_t count, int /*kind*/, cudaStream_t stream) {
+    if (count && (!dst || !src)) return Ret(cudaErrorInvalidValue);
+    sim::ResolveStream(stream)->Enqueue([=] { std::memmove(dst, src, count); });
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemset(void* ptr, int value, size_t count) {
+    if (count && !ptr) return Ret(cudaErrorInvalidValue);
+    sim::ResolveStream(nullptr)->Synchronize();
+    std::memset(ptr, value, count);
+    return cudaSuccess;
+}
+
+cudaError_t cudaMemsetAsync(void* ptr, int value, size_t count, cudaStream_t stream) {
+    if (count && !ptr) return Ret(cudaErrorInvalidValue);
+    sim::ResolveStream(stream)->Enqueue([=] { std::memset(ptr, value, count); });
+    return cudaSuccess;
+}
+
+cudaError_t cudaStreamCreateWithFlags(cudaStream_t* stream, unsigned int /*flags*/) {
+    if (!stream) return Ret(cudaErrorInvalidValue);
+    Stream* s = sim::CreateStream();
+    {
+        std::lock_guard<std::mutex> lock(g_streams_mu);
+        Streams().insert(s);
+    }
+    *stream = s;
+    return cudaSuccess;
+}
+
+cudaError_t cudaStreamCreate(cudaStream_t* stream) { return cudaStreamCreateWithFlags(stream, 0); }
+
+cudaError_t cudaStreamDestroy(cudaStream_t stream) {
+    Stream* s = static_cast<Stream*>(stream);
+    {
+        std::lock_guard<std::mutex> lock(g_streams_mu);
+        if (!Streams().erase(s)) return Ret(cudaErrorInvalidResourceHandle);
+    }
+    sim::DestroyStream(s);
+    return cudaSuccess;
+}
+
+cudaError_t cudaStreamSynchronize(cudaStream_t stream) {
+    sim::ResolveStream(stream)->Synchronize();
+    return cudaSuccess;
+}
+
+cudaError_t cudaStreamQuery(cudaStream_t stream) {
+    return sim::ResolveStream(stream)->Idle() ? cudaSuccess : cudaErrorNotReady;
+}
+
+cudaError_t cudaDeviceSynchronize() {
+    sim::ResolveStream(nullptr)->Synchronize();
+    std::lock_guard<std::mutex> lock(g_streams_mu);
+    for (Stream* s : Streams()) s->Synchronize();
+    return cudaSuccess;
+}
+
+cudaError_t cudaEventCreateWithFlags(cudaEvent_t* event, unsigned int /*flags*/) {
+    if (!event) return Ret(cudaErrorInvalidValue);
+    *event = sim::CreateEvent();
+    return cudaSuccess;
+}
+
+cudaError_t cudaEventCreate(cudaEvent_t* event) { return cudaEventCreateWithFlags(event, 0); }
+
+cudaError_t cudaEventDestroy(cudaEvent_t event) {
+    if (!event) return Ret(cudaErrorInvalidResourceHandle);
+    sim::DestroyEvent(static_cast<Event*>(event));
+    return cudaSuccess;
+}
+
+cudaError_t cudaEventRecord(cudaEvent_t event, cudaStream_t stream) {
+    if (!event) return Ret(cudaErrorInvalidResourceHandle);
+    sim::RecordEvent(static_cast<Event*>(event), sim::ResolveStream(stream));
+    return cudaSuccess;
+}
+
+cudaError_t cudaStreamWaitEvent(cudaStream_t stream, cudaEvent_t event, unsigned int /*flags*/) {
+    if (!event) return Ret(cudaErrorInvalidResourceHandle);
+    sim::WaitEvent(sim::ResolveStream(stream), static_cast<Event*>(event));
+    return cudaSuccess;
+}
+
+cudaError_t cudaEventSynchronize(cudaEvent_t event) {
+    if (!event) return Ret(cudaErrorInvalidResourceHandle);
+    sim::SynchronizeEvent(static_cast<Event*>(event));
+    return cudaSuccess;
+}
+
+cudaError_t cudaEventQuery(cudaEvent_t event) {
+    if (!event) return Ret(cudaErrorInvalidResourceHandle);
+    return sim::QueryEvent(static_cast<Event*>(event)) ? cudaSuccess : cudaErrorNotReady;
+}
+
+cudaError_t cudaEventElapsedTime(float* ms, cudaEvent_t start, cudaEvent_t end) {
+    if (!ms || !start || !end) return Ret(cudaErrorInvalidValue);
+    return sim::ElapsedMs(static_cast<Event*>(start), static_cast<Event*>(end), ms) ? cudaSuccess
+                                                                                     : cudaErrorNotReady;
+}
+
+cudaError_t cudaGetLastError() {
+    cudaError_t e = g_last_error;
+    g_last_error = cudaSuccess;
+    return e;
+}
+
+cudaError_t cudaPeekAtLastError() { return g_last_error; }
+
+const char* cudaGetErrorString(cudaError_t error) {
+    switch (error) {
+        case cudaSuccess: return "no error";
+        case cudaErrorInvalidValue: return "invalid argument";
+        case cudaErrorMemoryAllocation: return "out of memory";
+        case cudaErrorInvalidDevice: return "invalid device ordinal";
+        case cudaErrorInvalidResourceHandle: return "invalid resource handle";
+        case cudaErrorNotReady: return "device not ready";
+    }
+    return "unknown error";
+}
+
+}  // extern "C"
@@ -0,0 +1,194 @@
+// Mock HCCL (libhccl.so) on top of the host simulator: the entry points the HCCL
+// hook resolves, with the hook's signatures and the hccl_types.h enum values.
+
+#include "sim.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace sim = ampccl::sim;
+
+extern "C" {
+
+#define HCCL_UNIQUE_ID_BYTES 128
+typedef struct { char internal[HCCL_UNIQUE_ID_BYTES]; } hcclUniqueId;
+#define HCCL_ROOT_INFO_BYTES 4108
+typedef struct { char internal[HCCL_ROOT_INFO_BYTES]; } HcclRootInfo;
+typedef enum {
+    HCCL_SUCCESS = 0,
+    HCCL_E_PARA = 1,
+    HCCL_E_INTERNAL = 4,
+} HcclResult;
+typedef void* HcclComm;
+typedef void* aclrtStream;
+
+}  // extern "C"
+
+namespace {
+
+struct MockComm {
+    sim::Comm* comm;
+};
+
+sim::Comm* Unwrap(HcclComm comm) { return comm ? static_cast<MockComm*>(comm)->comm : nullptr; }
+
+// HCCL_DATA_TYPE_INT8 .. HCCL_DATA_TYPE_BFP16; INT16/UINT16 are not simulated.
+bool MapType(int dt, sim::DataType* out) {
+    switch (dt) {
+        case 0: *out = sim::DataType::Int8; return true;
+        case 2: *out = sim::DataType::Int32; return true;
+        case 3: *out = sim::DataType::Float16; return true;
+        case 4: *out = sim::DataType::Float32; return true;
+        case 5: *out = sim::DataType::Int64; return true;
+        case 6: *out = sim::DataType::Uint64; return true;
+        case 7: *out = sim::DataType::Uint8; return true;
+        case 9: *out = sim::DataType::Uint32; return true;
+        case 10: *out = sim::DataType::Float64; return true;
+        case 11: *out = sim::DataType::BFloat16; return true;
+    }
+    return false;
+}
+
+// HCCL_REDUCE_SUM, PROD, MAX, MIN.
+bool MapOp(int op, sim::ReduceOp* out) {
+    if (op < 0 || op > 3) return false;
+    *out = static_cast<sim::ReduceOp>(op);
+    return true;
+}
+
+}  // namespace
+
+extern "C" {
+
+HcclResult HcclGetUniqueId(hcclUniqueId* unique_id) {
+    if (!unique_id) return HCCL_E_PARA;
+    std::memset(unique_id, 0, sizeof(*unique_id));
+    sim::CommId id = sim::NewCommId();
+    std::memcpy(unique_id->internal, &id, sizeof(id));
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclCommInitRank(HcclComm* comm, unsigned int nranks, hcclUniqueId comm_id, unsigned int rank) {
+    if (!comm) return HCCL_E_PARA;
+    sim::CommId id;
+    std::memcpy(&id, comm_id.internal, sizeof(id));
+    sim::Comm* c = sim::Comm::Init(id, static_cast<int>(nranks), static_cast<int>(rank));
+    if (!c) return id.magic == sim::kCommIdMagic ? HCCL_E_INTERNAL : HCCL_E_PARA;
+    *comm = new MockComm{c};
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclGetRootInfo(HcclRootInfo* root_info) {
+    if (!root_info) return HCCL_E_PARA;
+    std::memset(root_info, 0, sizeof(*root_info));
+    sim::CommId id = sim::NewCommId();
+    std::memcpy(root_info->internal, &id, sizeof(id));
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclCommInitRootInfo(uint32_t nranks, const HcclRootInfo* root_info, uint32_t rank, HcclComm* comm) {
+    if (!comm || !root_info) return HCCL_E_PARA;
+    sim::CommId id;
+    std::memcpy(&id, root_info->internal, sizeof(id));
+    sim::Comm* c = sim::Comm::Init(id, static_cast<int>(nranks), static_cast<int>(rank));
+    if (!c) return id.magic == sim::kCommIdMagic ? HCCL_E_INTERNAL : HCCL_E_PARA;
+    *comm = new MockComm{c};
+    return HCCL_SUCCESS;
+}
+
+// cluster_info is a rank table path. There is no root: every rank reads the same file,
+// so its path and bytes (and how many communicators this process made from it) name the
+// communicator; the path keeps a rerun from meeting a killed run's rendezvous segment. The rank count is the number of "rank_id" entries; the table is not
+// otherwise checked.
+HcclResult HcclCommInitClusterInfo(const char* cluster_info, uint32_t rank, HcclComm* comm) {
+    if (!comm || !cluster_info) return HCCL_E_PARA;
+    std::ifstream in(cluster_info);
+    if (!in) return HCCL_E_PARA;
+    std::ostringstream text;
+    text << in.rdbuf();
+    std::string table = text.str();
+    int nranks = 0;
+    for (size_t pos = table.find("\"rank_id\""); pos != std::string::npos; pos = table.find("\"rank_id\"", pos + 1)) {
+        ++nranks;
+    }
+    static std::mutex mu;
+    static std::map<size_t, uint64_t> created;
+    size_t digest = std::hash<std::string>()(std::string(cluster_info) + '\n' + table);
+    uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        seq = created[digest]++;
+    }
+    sim::CommId id{sim::kCommIdMagic, static_cast<uint64_t>(digest) * 0x9e3779b97f4a7c15ull + seq};
+    sim::Comm* c = sim::Comm::Init(id, nranks, static_cast<int>(rank));
+    if (!c) return HCCL_E_PARA;
+    *comm = new MockComm{c};
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclCommDestroy(HcclComm comm) {
+    if (!comm) return HCCL_E_PARA;
+    MockComm* m = static_cast<MockComm*>(comm);
+    delete m->comm;
+    delete m;
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclGetRankSize(HcclComm comm, uint32_t* size) {
+    if (!comm || !size) return HCCL_E_PARA;
+    *size = static_cast<uint32_t>(Unwrap(comm)->nranks());
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclGetRankId(HcclComm comm, uint32_t* rank) {
+    if (!comm || !rank) return HCCL_E_PARA;
+    *rank = static_cast<uint32_t>(Unwrap(comm)->rank());
+    return HCCL_SUCCESS;
+}
+
+HcclResult HcclAllReduce(const void* sendbuff, void* recvbuff, unsigned long count, int datatype, int op,
+                         HcclComm comm, aclrtStream stream) {
+    sim::DataType dt;
+    sim::ReduceOp rop;
+    if (!comm || !MapType(datatype, &dt) || !MapOp(op, &rop)) return HCCL_E_PARA;
+    return Unwrap(comm)->AllReduce(sendbuff, recvbuff, count, dt, rop, sim::ResolveStream(stream))
+               ? HCCL_SUCCESS
+               : HCCL_E_PARA;
+}
+
+HcclResult HcclAllGather(const void* sendbuff, void* recvbuff, unsigned long sendcount, int datatype,
+                         HcclComm comm, aclrtStream stream) {
+    sim::DataType dt;
+    if (!comm || !MapType(datatype, &dt)) return HCCL_E_PARA;
+    return Unwrap(comm)->AllGather(sendbuff, recvbuff, sendcount, dt, sim::ResolveStream(stream))
+               ? HCCL_SUCCESS
+               : HCCL_E_PARA;
+}
+
+HcclResult HcclReduceScatter(const void* sendbuff, void* recvbuff, unsigned long recvcount, int datatype, int op,
+                             HcclComm comm, aclrtStream stream) {
+    sim::DataType dt;
+    sim::ReduceOp rop;
+    if (!comm || !MapType(datatype, &dt) || !MapOp(op, &rop)) return HCCL_E_PARA;
+    return Unwrap(comm)->ReduceScatter(sendbuff, recvbuff, recvcount, dt, rop, sim::ResolveStream(stream))
+               ? HCCL_SUCCESS
+               : HCCL_E_PARA;
+}
+
+HcclResult HcclBroadcast(const void* sendbuff, void* recvbuff, unsigned long count, int datatype,
+                         unsigned int root, HcclComm comm, aclrtStream stream) {
+    sim::DataType dt;
+    if (!comm || !MapType(datatype, &dt)) return HCCL_E_PARA;
+    return Unwrap(comm)->Broadcast(sendbuff, recvbuff, count, dt, static_cast<int>(root),
+                                   sim::ResolveStream(stream))
+               ? HCCL_SUCCESS
+               : HCCL_E_PARA;
+}
+
+}  // extern "C"
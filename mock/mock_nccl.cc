@@ -0,0 +1,252 @@
+// Mock NCCL (libnccl.so) on top of the host simulator. Enum values and the
+// ncclUniqueId layout match nccl.h, so real NCCL applications link against it.
+
+#include "sim.h"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sim = ampccl::sim;
+
+extern "C" {
+
+#define NCCL_UNIQUE_ID_BYTES 128
+typedef struct { char internal[NCCL_UNIQUE_ID_BYTES]; } ncclUniqueId;
+typedef enum {
+    ncclSuccess = 0,
+    ncclUnhandledCudaError = 1,
+    ncclSystemError = 2,
+    ncclInternalError = 3,
+    ncclInvalidArgument = 4,
+    ncclInvalidUsage = 5,
+} ncclResult_t;
+typedef void* ncclComm_t;
+typedef void* cudaStream_t;
+// Contents are not read: every config field keeps its blocking default.
+typedef struct ncclConfig_v21700 ncclConfig_t;
+#define NCCL_SPLIT_NOCOLOR -1
+
+}  // extern "C"
+
+namespace {
+
+struct MockComm {
+    sim::Comm* comm;
+};
+
+sim::Comm* Unwrap(ncclComm_t comm) { return comm ? static_cast<MockComm*>(comm)->comm : nullptr; }
+
+// ncclInt8 .. ncclBfloat16 in nccl.h order.
+bool MapType(int dt, sim::DataType* out) {
+    static const sim::DataType kTypes[] = {
+        sim::DataType::Int8,    sim::DataType::Uint8,   sim::DataType::Int32,   sim::DataType::Uint32,
+        sim::DataType::Int64,   sim::DataType::Uint64,  sim::DataType::Float16, sim::DataType::Float32,
+        sim::DataType::Float64, sim::DataType::BFloat16};
+    if (dt < 0 || dt >= static_cast<int>(sizeof(kTypes) / sizeof(kTypes[0]))) return false;
+    *out = kTypes[dt];
+    return true;
+}
+
+// ncclSum, ncclProd, ncclMax, ncclMin (ncclAvg is not simulated).
+bool MapOp(int op, sim::ReduceOp* out) {
+    if (op < 0 || op > 3) return false;
+    *out = static_cast<sim::ReduceOp>(op);
+    return true;
+}
+
+// Collectives issued between ncclGroupStart and ncclGroupEnd are held and launched at
+// the outermost ncclGroupEnd, in issue order, as NCCL does: until then their streams
+// carry nothing and their output buffers stay untouched (synchronizing such a stream
+// aborts, see sim::Stream::Hold). Communicator creation and ncclCommSplit still
+// complete inside the group.
+thread_local int group_depth = 0;
+thread_local std::vector<std::pair<sim::Stream*, std::function<bool()>>> group_ops;
+
+ncclResult_t Issue(sim::Stream* s, std::function<bool()> op) {
+    if (group_depth > 0) {
+        s->Hold();
+        group_ops.emplace_back(s, std::move(op));
+        return ncclSuccess;
+    }
+    return op() ? ncclSuccess : ncclInvalidArgument;
+}
+
+}  // namespace
+
+extern "C" {
+
+ncclResult_t ncclGetVersion(int* version) {
+    if (!version) return ncclInvalidArgument;
+    *version = 22105;  // Reported as 2.21.5
+    return ncclSuccess;
+}
+
+ncclResult_t ncclGetUniqueId(ncclUniqueId* unique_id) {
+    if (!unique_id) return ncclInvalidArgument;
+    std::memset(unique_id, 0, sizeof(*unique_id));
+    sim::CommId id = sim::NewCommId();
+    std::memcpy(unique_id->internal, &id, sizeof(id));
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommInitRank(ncclComm_t* comm, int nranks, ncclUniqueId comm_id, int rank) {
+    if (!comm) return ncclInvalidArgument;
+    sim::CommId id;
+    std::memcpy(&id, comm_id.internal, sizeof(id));
+    sim::Comm* c = sim::Comm::Init(id, nranks, rank);
+    if (!c) return id.magic == sim::kCommIdMagic ? ncclSystemError : ncclInvalidArgument;
+    *comm = new MockComm{c};
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommInitRankConfig(ncclComm_t* comm, int nranks, ncclUniqueId comm_id, int rank,
+                                    ncclConfig_t* /*config*/) {
+    return ncclCommInitRank(comm, nranks, comm_id, rank);
+}
+
+// Every rank passes the same ids; the first one names the communicator.
+ncclResult_t ncclCommInitRankScalable(ncclComm_t* comm, int nranks, int rank, int n_ids, ncclUniqueId* comm_ids,
+                                      ncclConfig_t* /*config*/) {
+    if (n_ids < 1 || !comm_ids) return ncclInvalidArgument;
+    return ncclCommInitRank(comm, nranks, comm_ids[0], rank);
+}
+
+// One rank per device in this process. Comm::Init blocks until every rank has
+// attached, so the ranks attach from one thread each, on their own device.
+ncclResult_t ncclCommInitAll(ncclComm_t* comms, int ndev, const int* devlist) {
+    if (!comms || ndev <= 0) return ncclInvalidArgument;
+    sim::CommId id = sim::NewCommId();
+    std::vector<sim::Comm*> created(static_cast<size_t>(ndev), nullptr);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < ndev; ++i) {
+        threads.emplace_back([&, i] {
+            sim::SetDevice(devlist ? devlist[i] : i);
+            created[static_cast<size_t>(i)] = sim::Comm::Init(id, ndev, i);
+        });
+    }
+    for (auto& t : threads) t.join();
+    bool ok = true;
+    for (sim::Comm* c : created) ok = ok && c;
+    for (int i = 0; i < ndev; ++i) {
+        sim::Comm* c = created[static_cast<size_t>(i)];
+        if (!ok) {
+            delete c;
+            comms[i] = nullptr;
+            continue;
+        }
+        comms[i] = new MockComm{c};
+    }
+    return ok ? ncclSuccess : ncclSystemError;
+}
+
+ncclResult_t ncclCommSplit(ncclComm_t comm, int color, int key, ncclComm_t* newcomm, ncclConfig_t* /*config*/) {
+    if (!comm || !newcomm || (color < 0 && color != NCCL_SPLIT_NOCOLOR)) return ncclInvalidArgument;
+    sim::Comm* child = nullptr;
+    if (!Unwrap(comm)->Split(color, key, &child)) return ncclSystemError;
+    *newcomm = child ? new MockComm{child} : nullptr;
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommDestroy(ncclComm_t comm) {
+    if (!comm) return ncclInvalidArgument;
+    MockComm* m = static_cast<MockComm*>(comm);
+    delete m->comm;
+    delete m;
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommAbort(ncclComm_t comm) { return ncclCommDestroy(comm); }
+
+ncclResult_t ncclCommCount(ncclComm_t comm, int* count) {
+    if (!comm || !count) return ncclInvalidArgument;
+    *count = Unwrap(comm)->nranks();
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommUserRank(ncclComm_t comm, int* rank) {
+    if (!comm || !rank) return ncclInvalidArgument;
+    *rank = Unwrap(comm)->rank();
+    return ncclSuccess;
+}
+
+ncclResult_t ncclCommCuDevice(ncclComm_t comm, int* device) {
+    if (!comm || !device) return ncclInvalidArgument;
+    *device = Unwrap(comm)->device();
+    return ncclSuccess;
+}
+
+ncclResult_t ncclAllReduce(const void* sendbuff, void* recvbuff, size_t count, int datatype, int op,
+                           ncclComm_t comm, cudaStream_t stream) {
+    sim::DataType dt;
+    sim::ReduceOp rop;
+    if (!comm || !MapType(datatype, &dt) || !MapOp(op, &rop)) return ncclInvalidArgument;
+    sim::Comm* c = Unwrap(comm);
+    sim::Stream* s = sim::ResolveStream(stream);
+    return Issue(s, [=] { return c->AllReduce(sendbuff, recvbuff, count, dt, rop, s); });
+}
+
+ncclResult_t ncclAllGather(const void* sendbuff, void* recvbuff, size_t sendcount, int datatype,
+                           ncclComm_t comm, cudaStream_t stream) {
+    sim::DataType dt;
+    if (!comm || !MapType(datatype, &dt)) return ncclInvalidArgument;
+    sim::Comm* c = Unwrap(comm);
+    sim::Stream* s = sim::ResolveStream(stream);
+    return Issue(s, [=] { return c->AllGather(sendbuff, recvbuff, sendcount, dt, s); });
+}
+
+ncclResult_t ncclReduceScatter(const void* sendbuff, void* recvbuff, size_t recvcount, int datatype, int op,
+                               ncclComm_t comm, cudaStream_t stream) {
+    sim::DataType dt;
+    sim::ReduceOp rop;
+    if (!comm || !MapType(datatype, &dt) || !MapOp(op, &rop)) return ncclInvalidArgument;
+    sim::Comm* c = Unwrap(comm);
+    sim::Stream* s = sim::ResolveStream(stream);
+    return Issue(s, [=] { return c->ReduceScatter(sendbuff, recvbuff, recvcount, dt, rop, s); });
+}
+
+ncclResult_t ncclBroadcast(const void* sendbuff, void* recvbuff, size_t count, int datatype, int root,
+                           ncclComm_t comm, cudaStream_t stream) {
+    sim::DataType dt;
+    if (!comm || !MapType(datatype, &dt)) return ncclInvalidArgument;
+    sim::Comm* c = Unwrap(comm);
+    sim::Stream* s = sim::ResolveStream(stream);
+    return Issue(s, [=] { return c->Broadcast(sendbuff, recvbuff, count, dt, root, s); });
+}
+
+ncclResult_t ncclGroupStart() {
+    ++group_depth;
+    return ncclSuccess;
+}
+
+ncclResult_t ncclGroupEnd() {
+    if (group_depth == 0) return ncclInvalidUsage;
+    if (--group_depth > 0) return ncclSuccess;
+    std::vector<std::pair<sim::Stream*, std::function<bool()>>> ops;
+    ops.swap(group_ops);
+    bool ok = true;
+    for (auto& op : ops) {
+        op.first->Release();
+        ok = op.second() && ok;
+    }
+    return ok ? ncclSuccess : ncclInvalidArgument;
+}
+
+const char* ncclGetErrorString(ncclResult_t result) {
+    switch (result) {
+        case ncclSuccess: return "no error";
+        case ncclUnhandledCudaError: return "unhandled cuda error";
+        case ncclSystemError: return "unhandled system error";
+        case ncclInternalError: return "internal error";
+        case ncclInvalidArgument: return "invalid argument";
+        case ncclInvalidUsage: return "invalid usage";
+    }
+    return "unknown result code";
+}
+
+const char* ncclGetLastError(ncclComm_t /*comm*/) { return ""; }
+
+}  // extern "C"
@@ -0,0 +1,33 @@
+#ifndef AMPCCL_MOCK_PCCL_COMM_HPP_
+#define AMPCCL_MOCK_PCCL_COMM_HPP_
+
+// PCCL communicator and stream API. Stand-in for the pcieccl header of the same name
+// (see mock/pccl/pccl.cc); signatures match what libampccl calls.
+
+#include "ir.hpp"
+
+#include <cstddef>
+
+typedef void* pcclComm_t;
+typedef void* pcclStream_t;
+
+typedef enum {
+    pcclSuccess = 0,
+    pcclInvalidArgument = 1,
+    pcclSystemError = 2,
+    pcclInternalError = 3,
+} pcclResult_t;
+
+// Join the node-local group of nranks processes (collective: blocks until all joined).
+pcclResult_t pcclInit(int rank, int nranks, pcclComm_t* comm);
+pcclResult_t pcclFinalize(pcclComm_t comm);
+
+pcclResult_t pcclCreateStream(pcclComm_t comm, pcclStream_t* stream);
+pcclResult_t pcclDestroyStream(pcclComm_t comm, pcclStream_t stream);
+
+// Enqueue program on stream. count is the element count of the whole input buffer.
+pcclResult_t pcclSubmit(pcclComm_t comm, const pccl::IRProgram& program, void* sendbuff, void* recvbuff,
+                        size_t count, pcclStream_t stream);
+pcclResult_t pcclSynchronizeStream(pcclComm_t comm, pcclStream_t stream);
+
+#endif  // AMPCCL_MOCK_PCCL_COMM_HPP_
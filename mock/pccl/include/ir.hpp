@@ -0,0 +1,57 @@
+#ifndef AMPCCL_MOCK_PCCL_IR_HPP_
+#define AMPCCL_MOCK_PCCL_IR_HPP_
+
+// PCCL intermediate representation, as consumed by pcclSubmit. Stand-in for the
+// pcieccl header of the same name (see mock/pccl/pccl.cc).
+//
+// Every rank submits its own program over the same element count. The count is split
+// into input_chunk_count equal chunks; output chunks have the same size. Host chunks are
+// pinned host buffers of the same size shared by all ranks of the communicator, each
+// with a completion counter.
+
+#include <cstddef>
+#include <vector>
+
+// IRProgram::elem_size exists (absent from upstream pcieccl, which assumes 4 bytes).
+#define PCCL_IR_HAS_ELEM_SIZE 1
+
+namespace pccl {
+
+enum class OpCode {
+    D2H,         // input chunk src_chunk_idx -> host chunk dst_chunk_idx
+    H2D,         // host chunk src_chunk_idx -> output chunk dst_chunk_idx
+    D2D,         // input chunk src_chunk_idx -> output chunk dst_chunk_idx
+    H2H_REDUCE,  // host chunk dst_chunk_idx += host chunk src_chunk_idx
+};
+
+// Wait until host chunk chunk_idx (on NUMA node numa) has been signalled `count` times.
+struct Dependency {
+    int numa;
+    int chunk_idx;
+    int count;
+};
+
+// Signal host chunk chunk_idx once the instruction has completed.
+struct Effect {
+    int chunk_idx;
+};
+
+struct Instruction {
+    OpCode op = OpCode::D2H;
+    int src_numa = 0;
+    int src_chunk_idx = 0;
+    int dst_chunk_idx = 0;
+    std::vector<Dependency> deps;
+    std::vector<Effect> effects;
+};
+
+struct IRProgram {
+    int input_chunk_count = 1;
+    int output_chunk_count = 1;
+    size_t elem_size = 4;  // Bytes per element of pcclSubmit's count
+    std::vector<Instruction> instructions;
+};
+
+}  // namespace pccl
+
+#endif  // AMPCCL_MOCK_PCCL_IR_HPP_
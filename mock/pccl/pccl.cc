@@ -0,0 +1,333 @@
+// Host stand-in for the PCCL (pcieccl) library: pcclInit / pcclCreateStream /
+// pcclSubmit / pcclSynchronizeStream interpret IRProgram instructions on host memory.
+//
+// - A communicator is a POSIX shm segment shared by the nranks processes of the group:
+//   a barrier counter, per-host-chunk completion counters and the host chunk slots.
+//   Groups are named after AMPCCL_MOCK_PCCL_GROUP (default: the parent pid, which
+//   launcher-spawned ranks share), nranks, and the pcclInit count of the calling device
+//   (sim::GetDevice()) in this process, so every rank must create its PCCL communicators
+//   in the same order, as with real PCCL. Counting per device lets one process drive
+//   several ranks (ncclCommInitAll), each initializing from a thread on its own device.
+// - A PCCL stream is a sim::Stream; with the mock CUDA / ACL runtime the device timer
+//   can record events on it. pcclSubmit enqueues the whole program as one stream task.
+// - Each communicator has one in-order engine per opcode (D2H, H2D, D2D, reduce), like
+//   copy engines, so instructions of different kinds overlap. An instruction starts once
+//   its explicit dependencies are met and every earlier instruction of the same rank
+//   that touches the same buffer has completed, moves the data, then holds its engine
+//   for latency + bytes / bandwidth of its path (SimConfig pcie / d2d / host).
+// - Chunks larger than a host slot (AMPCCL_MOCK_STAGING_KB) run the program in passes
+//   over slot-sized slices, with a group barrier between passes.
+// - H2H_REDUCE sums by element size (the IR carries no type): 8 -> double,
+//   4 -> float, 2 -> fp16, 1 -> int8.
+
+#include "comm.hpp"
+#include "sim.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sim = ampccl::sim;
+using pccl::Instruction;
+using pccl::IRProgram;
+using pccl::OpCode;
+
+namespace {
+
+constexpr int kMaxRanks = 128;
+constexpr int kSlotsPerRank = 4;
+constexpr int kMaxSlots = kSlotsPerRank * kMaxRanks;
+constexpr int kNumEngines = 4;  // One per OpCode
+
+// All fields start at zero, so whichever rank creates the file needs no setup.
+struct Segment {
+    std::atomic<uint64_t> arrivals;
+    std::atomic<int32_t> nranks;
+    std::atomic<int32_t> pad;
+    std::atomic<uint64_t> slot_bytes;
+    char pad2[64 - 24];
+    // Completion counters per host slot; passes alternate between the two sets so one
+    // can be cleared while the other is in use.
+    std::atomic<int64_t> signals[2][kMaxSlots];
+    // Host slots follow.
+};
+
+struct PcclComm {
+    std::string name;
+    Segment* seg = nullptr;
+    size_t seg_size = 0;
+    int rank = 0;
+    int nranks = 0;
+    int slots = 0;
+    size_t slot_bytes = 0;
+    uint64_t barriers = 0;
+    uint64_t passes = 0;
+    std::unique_ptr<sim::Stream> engines[kNumEngines];
+
+    char* Slot(int idx) const {
+        return reinterpret_cast<char*>(seg) + sizeof(Segment) + static_cast<size_t>(idx) * slot_bytes;
+    }
+
+    void Arrive() {
+        uint64_t target = ++barriers * static_cast<uint64_t>(nranks);
+        seg->arrivals.fetch_add(1, std::memory_order_acq_rel);
+        sim::SpinUntil([&] { return seg->arrivals.load(std::memory_order_acquire) >= target; },
+                       "a PCCL pass barrier");
+    }
+};
+
+// Completion state of one pass's instructions on this rank.
+struct PassState {
+    std::mutex mu;
+    std::condition_variable cv;
+    std::vector<bool> done;
+    size_t remaining = 0;
+};
+
+std::map<int, int> g_init_count;  // Device -> pcclInit calls
+std::mutex g_init_mu;
+
+std::string GroupName(int nranks) {
+    std::lock_guard<std::mutex> lock(g_init_mu);
+    const char* group = std::getenv("AMPCCL_MOCK_PCCL_GROUP");
+    std::string g = (group && *group) ? group : std::to_string(getppid());
+    return "/ampccl_pccl_" + g + "_" + std::to_string(nranks) + "_" + std::to_string(g_init_count[sim::GetDevice()]++);
+}
+
+// Buffer an instruction reads or writes, for same-rank ordering.
+struct Buffer {
+    enum Kind { Input, Output, Host } kind;
+    int idx;
+    bool operator==(const Buffer& o) const { return kind == o.kind && idx == o.idx; }
+};
+
+void Operands(const Instruction& in, Buffer* src, Buffer* dst) {
+    switch (in.op) {
+        case OpCode::D2H: *src = {Buffer::Input, in.src_chunk_idx}; *dst = {Buffer::Host, in.dst_chunk_idx}; break;
+        case OpCode::H2D: *src = {Buffer::Host, in.src_chunk_idx}; *dst = {Buffer::Output, in.dst_chunk_idx}; break;
+        case OpCode::D2D: *src = {Buffer::Input, in.src_chunk_idx}; *dst = {Buffer::Output, in.dst_chunk_idx}; break;
+        case OpCode::H2H_REDUCE: *src = {Buffer::Host, in.src_chunk_idx}; *dst = {Buffer::Host, in.dst_chunk_idx}; break;
+    }
+}
+
+// Earlier instructions of the same program that instruction i must wait for: they
+// write what i reads or writes, or read what i writes.
+std::vector<std::vector<int>> LocalOrder(const IRProgram& p) {
+    size_t n = p.instructions.size();
+    std::vector<Buffer> src(n), dst(n);
+    for (size_t i = 0; i < n; ++i) Operands(p.instructions[i], &src[i], &dst[i]);
+    std::vector<std::vector<int>> before(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (dst[j] == src[i] || dst[j] == dst[i] || src[j] == dst[i])
+                before[i].push_back(static_cast<int>(j));
+        }
+    }
+    return before;
+}
+
+bool Validate(const PcclComm& c, const IRProgram& p) {
+    if (p.input_chunk_count <= 0 || p.output_chunk_count <= 0 || p.elem_size == 0) return false;
+    for (const Instruction& in : p.instructions) {
+        Buffer src{}, dst{};
+        Operands(in, &src, &dst);
+        for (const Buffer& b : {src, dst}) {
+            int limit = b.kind == Buffer::Input ? p.input_chunk_count
+                        : b.kind == Buffer::Output ? p.output_chunk_count : c.slots;
+            if (b.idx < 0 || b.idx >= limit) return false;
+        }
+        for (const pccl::Dependency& d : in.deps)
+            if (d.chunk_idx < 0 || d.chunk_idx >= c.slots || d.count < 0) return false;
+        for (const pccl::Effect& e : in.effects)
+            if (e.chunk_idx < 0 || e.chunk_idx >= c.slots) return false;
+    }
+    return true;
+}
+
+void Reduce(void* dst, const void* src, size_t n, size_t elem_size) {
+    switch (elem_size) {
+        case 8: sim::ReduceInto(dst, src, n, sim::DataType::Float64, sim::ReduceOp::Sum); break;
+        case 4: sim::ReduceInto(dst, src, n, sim::DataType::Float32, sim::ReduceOp::Sum); break;
+        case 2: sim::ReduceInto(dst, src, n, sim::DataType::Float16, sim::ReduceOp::Sum); break;
+        default: sim::ReduceInto(dst, src, n * elem_size, sim::DataType::Int8, sim::ReduceOp::Sum); break;
+    }
+}
+
+// Run one pass: elements [off, off + n) of every chunk.
+void RunPass(PcclComm* c, const IRProgram& p, const std::vector<std::vector<int>>& order,
+             const char* send, char* recv, size_t chunk_elems, size_t off, size_t n) {
+    const sim::SimConfig& cfg = sim::SimConfig::Get();
+    const size_t es = p.elem_size;
+    const size_t bytes = n * es;
+    std::atomic<int64_t>* signals = c->seg->signals[c->passes % 2];
+    const uint64_t seed = (c->passes << 20) ^ (static_cast<uint64_t>(c->rank) << 8);
+
+    PassState st;
+    st.done.assign(p.instructions.size(), false);
+    st.remaining = p.instructions.size();
+
+    for (size_t i = 0; i < p.instructions.size(); ++i) {
+        const Instruction* in = &p.instructions[i];
+        const std::vector<int>* before = &order[i];
+        int engine = static_cast<int>(in->op);
+        c->engines[engine]->Enqueue([=, &st, &cfg] {
+            {
+                std::unique_lock<std::mutex> lock(st.mu);
+                st.cv.wait(lock, [&] {
+                    return std::all_of(before->begin(), before->end(), [&](int j) { return st.done[j]; });
+                });
+            }
+            for (const pccl::Dependency& d : in->deps) {
+                sim::SpinUntil([&] { return signals[d.chunk_idx].load(std::memory_order_acquire) >= d.count; },
+                               "a PCCL chunk dependency");
+            }
+            uint64_t start = sim::NowNs();
+            const sim::PathModel* model = &cfg.pcie;
+            const char* in_chunk = send + (static_cast<size_t>(in->src_chunk_idx) * chunk_elems + off) * es;
+            char* out_chunk = recv + (static_cast<size_t>(in->dst_chunk_idx) * chunk_elems + off) * es;
+            if (cfg.move_data) {
+                switch (in->op) {
+                    case OpCode::D2H: std::memcpy(c->Slot(in->dst_chunk_idx), in_chunk, bytes); break;
+                    case OpCode::H2D: std::memcpy(out_chunk, c->Slot(in->src_chunk_idx), bytes); break;
+                    case OpCode::D2D: std::memmove(out_chunk, in_chunk, bytes); break;
+                    case OpCode::H2H_REDUCE:
+                        Reduce(c->Slot(in->dst_chunk_idx), c->Slot(in->src_chunk_idx), n, es);
+                        break;
+                }
+            }
+            if (in->op == OpCode::D2D) model = &cfg.d2d;
+            if (in->op == OpCode::H2H_REDUCE) model = &cfg.host;
+            double t = model->Time(static_cast<double>(bytes)) * sim::JitterFactor(seed ^ i);
+            sim::WaitUntil(start + static_cast<uint64_t>(t * 1e9));
+            for (const pccl::Effect& e : in->effects) signals[e.chunk_idx].fetch_add(1, std::memory_order_acq_rel);
+            std::lock_guard<std::mutex> lock(st.mu);
+            st.done[i] = true;
+            --st.remaining;
+            st.cv.notify_all();
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(st.mu);
+        st.cv.wait(lock, [&] { return st.remaining == 0; });
+    }
+    // Nobody touches the other signal set until every rank passes the barrier below.
+    if (c->rank == 0) {
+        for (int s = 0; s < c->slots; ++s) c->seg->signals[(c->passes + 1) % 2][s].store(0);
+    }
+    ++c->passes;
+    c->Arrive();
+}
+
+}  // namespace
+
+pcclResult_t pcclInit(int rank, int nranks, pcclComm_t* comm) {
+    if (!comm || nranks <= 0 || nranks > kMaxRanks || rank < 0 || rank >= nranks) return pcclInvalidArgument;
+    const sim::SimConfig& cfg = sim::SimConfig::Get();
+    std::string name = GroupName(nranks);
+    int slots = kSlotsPerRank * nranks;
+    size_t size = sizeof(Segment) + static_cast<size_t>(slots) * cfg.staging_bytes;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return pcclSystemError;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return pcclSystemError;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return pcclSystemError;
+
+    Segment* seg = static_cast<Segment*>(base);
+    int32_t expect_n = 0;
+    uint64_t expect_s = 0;
+    if ((!seg->nranks.compare_exchange_strong(expect_n, nranks) && expect_n != nranks) ||
+        (!seg->slot_bytes.compare_exchange_strong(expect_s, cfg.staging_bytes) &&
+         expect_s != cfg.staging_bytes)) {
+        std::fprintf(stderr, "[ampccl-mock] %s: ranks disagree on nranks or AMPCCL_MOCK_STAGING_KB\n",
+                     name.c_str());
+        munmap(base, size);
+        return pcclInvalidArgument;
+    }
+
+    PcclComm* c = new PcclComm;
+    c->name = name;
+    c->seg = seg;
+    c->seg_size = size;
+    c->rank = rank;
+    c->nranks = nranks;
+    c->slots = slots;
+    c->slot_bytes = cfg.staging_bytes;
+    for (auto& e : c->engines) e.reset(sim::CreateStream());
+    c->Arrive();
+    // Everyone has the mapping; the name is free for the next group.
+    if (rank == 0) shm_unlink(name.c_str());
+    *comm = c;
+    return pcclSuccess;
+}
+
+pcclResult_t pcclFinalize(pcclComm_t comm) {
+    if (!comm) return pcclInvalidArgument;
+    PcclComm* c = static_cast<PcclComm*>(comm);
+    for (auto& e : c->engines) e->Synchronize();
+    munmap(c->seg, c->seg_size);
+    delete c;
+    return pcclSuccess;
+}
+
+pcclResult_t pcclCreateStream(pcclComm_t comm, pcclStream_t* stream) {
+    if (!comm || !stream) return pcclInvalidArgument;
+    *stream = sim::CreateStream();
+    return pcclSuccess;
+}
+
+pcclResult_t pcclDestroyStream(pcclComm_t comm, pcclStream_t stream) {
+    if (!comm || !stream) return pcclInvalidArgument;
+    sim::DestroyStream(static_cast<sim::Stream*>(stream));
+    return pcclSuccess;
+}
+
+pcclResult_t pcclSubmit(pcclComm_t comm, const IRProgram& program, void* sendbuff, void* recvbuff, size_t count,
+                        pcclStream_t stream) {
+    if (!comm || !stream) return pcclInvalidArgument;
+    PcclComm* c = static_cast<PcclComm*>(comm);
+    if (!Validate(*c, program) || count % program.input_chunk_count != 0) return pcclInvalidArgument;
+    size_t chunk_elems = count / program.input_chunk_count;
+    if (chunk_elems > 0 && (!sendbuff || !recvbuff)) return pcclInvalidArgument;
+
+    auto prog = std::make_shared<IRProgram>(program);
+    auto order = std::make_shared<std::vector<std::vector<int>>>(LocalOrder(program));
+    const char* send = static_cast<const char*>(sendbuff);
+    char* recv = static_cast<char*>(recvbuff);
+    static_cast<sim::Stream*>(stream)->Enqueue([=] {
+        size_t slice = std::max<size_t>(1, c->slot_bytes / prog->elem_size);
+        size_t off = 0;
+        do {
+            size_t n = std::min(slice, chunk_elems - off);
+            RunPass(c, *prog, *order, send, recv, chunk_elems, off, n);
+            off += n;
+        } while (off < chunk_elems);
+    });
+    return pcclSuccess;
+}
+
+pcclResult_t pcclSynchronizeStream(pcclComm_t comm, pcclStream_t stream) {
+    if (!comm || !stream) return pcclInvalidArgument;
+    static_cast<sim::Stream*>(stream)->Synchronize();
+    return pcclSuccess;
+}
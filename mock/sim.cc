@@ -0,0 +1,640 @@
+#include "sim.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace ampccl {
+namespace sim {
+
+namespace {
+
+double EnvDouble(const char* name, double def) {
+    const char* v = std::getenv(name);
+    if (!v || !*v) return def;
+    char* end = nullptr;
+    double d = std::strtod(v, &end);
+    return (end && *end == '\0' && d >= 0) ? d : def;
+}
+
+uint64_t SplitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+}  // namespace
+
+size_t DataTypeSize(DataType dt) {
+    switch (dt) {
+        case DataType::Int8:
+        case DataType::Uint8: return 1;
+        case DataType::Float16:
+        case DataType::BFloat16: return 2;
+        case DataType::Int32:
+        case DataType::Uint32:
+        case DataType::Float32: return 4;
+        case DataType::Int64:
+        case DataType::Uint64:
+        case DataType::Float64: return 8;
+    }
+    return 1;
+}
+
+const SimConfig& SimConfig::Get() {
+    static const SimConfig cfg = [] {
+        SimConfig c;
+        c.fast.gbps = EnvDouble("AMPCCL_MOCK_FAST_GBPS", c.fast.gbps);
+        c.fast.lat_s = EnvDouble("AMPCCL_MOCK_FAST_LAT_US", c.fast.lat_s * 1e6) * 1e-6;
+        c.pcie.gbps = EnvDouble("AMPCCL_MOCK_PCIE_GBPS", c.pcie.gbps);
+        c.pcie.lat_s = EnvDouble("AMPCCL_MOCK_PCIE_LAT_US", c.pcie.lat_s * 1e6) * 1e-6;
+        c.d2d.gbps = EnvDouble("AMPCCL_MOCK_D2D_GBPS", c.d2d.gbps);
+        c.host.gbps = EnvDouble("AMPCCL_MOCK_HOST_GBPS", c.host.gbps);
+        c.jitter = EnvDouble("AMPCCL_MOCK_JITTER", c.jitter);
+        c.move_data = EnvDouble("AMPCCL_MOCK_DATA", 1) != 0;
+        size_t kb = static_cast<size_t>(EnvDouble("AMPCCL_MOCK_STAGING_KB", 1024));
+        c.staging_bytes = std::max<size_t>(kb, 64) * 1024;
+        c.devices = std::max(1, static_cast<int>(EnvDouble("AMPCCL_MOCK_DEVICES", c.devices)));
+        c.timeout_s = EnvDouble("AMPCCL_MOCK_TIMEOUT_S", c.timeout_s);
+        if (c.fast.gbps <= 0) c.fast.gbps = 40.0;
+        if (c.pcie.gbps <= 0) c.pcie.gbps = 12.0;
+        if (c.d2d.gbps <= 0) c.d2d.gbps = 200.0;
+        if (c.host.gbps <= 0) c.host.gbps = 20.0;
+        if (c.timeout_s <= 0) c.timeout_s = 60.0;
+        return c;
+    }();
+    return cfg;
+}
+
+double JitterFactor(uint64_t seed) {
+    double sigma = SimConfig::Get().jitter;
+    if (sigma <= 0) return 1.0;
+    uint64_t a = SplitMix64(seed);
+    uint64_t b = SplitMix64(a);
+    double u1 = (static_cast<double>(a >> 11) + 1.0) / 9007199254740993.0;  // (0, 1]
+    double u2 = static_cast<double>(b >> 11) / 9007199254740992.0;
+    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2);
+    return std::min(2.0, std::max(0.5, 1.0 + sigma * z));
+}
+
+uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+void WaitUntil(uint64_t deadline_ns) {
+    constexpr uint64_t kSpinNs = 50000;
+    uint64_t now = NowNs();
+    if (now + kSpinNs < deadline_ns)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(deadline_ns - now - kSpinNs));
+    while (NowNs() < deadline_ns) std::this_thread::yield();
+}
+
+void RendezvousTimeout(const char* what) {
+    std::fprintf(stderr,
+                 "[ampccl-mock] pid %d: no progress for %.0f s waiting for %s; the ranks issued "
+                 "different work (e.g. different fast/PCIe splits of one collective)\n",
+                 static_cast<int>(getpid()), SimConfig::Get().timeout_s, what);
+    std::abort();
+}
+
+// ---------------------------------------------------------------------------
+// Streams
+
+Stream::Stream() : worker_(&Stream::Run, this) {}
+
+Stream::~Stream() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+void Stream::Enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        queue_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void Stream::Hold() { held_.fetch_add(1); }
+
+void Stream::Release() { held_.fetch_sub(1); }
+
+void Stream::Synchronize() {
+    if (held_.load() > 0) {
+        std::fprintf(stderr,
+                     "[ampccl-mock] pid %d: stream synchronized while an open ncclGroupStart holds %d "
+                     "collective(s) issued to it; their results would be read before they ran\n",
+                     static_cast<int>(getpid()), held_.load());
+        std::abort();
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return queue_.empty() && !busy_; });
+}
+
+bool Stream::Idle() {
+    std::lock_guard<std::mutex> lock(mu_);
+    return queue_.empty() && !busy_;
+}
+
+void Stream::Run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;  // stop_ with nothing left to run
+        std::function<void()> task = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+        task();
+        lock.lock();
+        busy_ = false;
+        if (queue_.empty()) idle_cv_.notify_all();
+    }
+}
+
+Stream* ResolveStream(void* handle) {
+    if (handle) return static_cast<Stream*>(handle);
+    // Never destroyed: its worker may still be parked in a rendezvous at exit.
+    static Stream* default_stream = new Stream;
+    return default_stream;
+}
+
+Stream* CreateStream() { return new Stream; }
+
+void DestroyStream(Stream* s) {
+    if (!s || s == ResolveStream(nullptr)) return;
+    s->Synchronize();
+    delete s;
+}
+
+// ---------------------------------------------------------------------------
+// Events
+
+Event* CreateEvent() { return new Event; }
+
+void DestroyEvent(Event* e) {
+    if (!e) return;
+    SynchronizeEvent(e);
+    delete e;
+}
+
+void RecordEvent(Event* e, Stream* s) {
+    {
+        std::lock_guard<std::mutex> lock(e->mu);
+        ++e->pending;
+    }
+    s->Enqueue([e] {
+        std::lock_guard<std::mutex> lock(e->mu);
+        e->ns = NowNs();
+        --e->pending;
+        ++e->reached;
+        e->cv.notify_all();
+    });
+}
+
+void SynchronizeEvent(Event* e) {
+    std::unique_lock<std::mutex> lock(e->mu);
+    e->cv.wait(lock, [e] { return e->pending == 0; });
+}
+
+void WaitEvent(Stream* s, Event* e) {
+    uint64_t target;
+    {
+        std::lock_guard<std::mutex> lock(e->mu);
+        target = e->reached + e->pending;
+    }
+    s->Enqueue([e, target] {
+        std::unique_lock<std::mutex> lock(e->mu);
+        e->cv.wait(lock, [e, target] { return e->reached >= target; });
+    });
+}
+
+bool QueryEvent(Event* e) {
+    std::lock_guard<std::mutex> lock(e->mu);
+    return e->pending == 0;
+}
+
+bool ElapsedMs(Event* start, Event* end, float* ms) {
+    uint64_t t0, t1;
+    {
+        std::lock_guard<std::mutex> lock(start->mu);
+        if (start->pending) return false;
+        t0 = start->ns;
+    }
+    {
+        std::lock_guard<std::mutex> lock(end->mu);
+        if (end->pending) return false;
+        t1 = end->ns;
+    }
+    *ms = static_cast<float>((static_cast<double>(t1) - static_cast<double>(t0)) / 1e6);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Devices and memory
+
+namespace {
+thread_local int g_device = 0;
+}  // namespace
+
+void SetDevice(int device) { g_device = device; }
+int GetDevice() { return g_device; }
+
+void* DeviceAlloc(size_t bytes) {
+    constexpr size_t kAlign = 256;
+    size_t rounded = (std::max<size_t>(bytes, 1) + kAlign - 1) / kAlign * kAlign;
+    return std::aligned_alloc(kAlign, rounded);
+}
+
+void DeviceFree(void* ptr) { std::free(ptr); }
+
+// ---------------------------------------------------------------------------
+// Communicators
+
+// Segment layout: Segment | result area | nranks staging areas, each staging bytes.
+// All fields start at zero, so whichever rank creates the file needs no setup.
+struct Comm::Segment {
+    std::atomic<uint64_t> arrivals;
+    std::atomic<int32_t> attached;
+    std::atomic<int32_t> nranks;
+    std::atomic<uint64_t> staging;
+    char pad[64 - 24];
+};
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && std::atomic<uint64_t>::is_always_lock_free,
+              "process-shared counters need lock-free 64-bit atomics");
+
+CommId NewCommId() {
+    std::random_device rd;
+    uint64_t id = (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    id ^= SplitMix64(NowNs() ^ (static_cast<uint64_t>(getpid()) << 20));
+    return CommId{kCommIdMagic, id};
+}
+
+Comm* Comm::Init(const CommId& id, int nranks, int rank) {
+    if (id.magic != kCommIdMagic || nranks <= 0 || rank < 0 || rank >= nranks) return nullptr;
+    const SimConfig& cfg = SimConfig::Get();
+
+    char name[40];
+    std::snprintf(name, sizeof(name), "/ampccl_mock_%016llx", static_cast<unsigned long long>(id.id));
+    size_t size = sizeof(Segment) + (static_cast<size_t>(nranks) + 1) * cfg.staging_bytes +
+                  2 * static_cast<size_t>(nranks) * sizeof(uint64_t);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (static_cast<size_t>(st.st_size) < size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return nullptr;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return nullptr;
+
+    Segment* seg = static_cast<Segment*>(base);
+    int32_t expect_n = 0;
+    uint64_t expect_s = 0;
+    if ((!seg->nranks.compare_exchange_strong(expect_n, nranks) && expect_n != nranks) ||
+        (!seg->staging.compare_exchange_strong(expect_s, cfg.staging_bytes) &&
+         expect_s != cfg.staging_bytes)) {
+        std::fprintf(stderr, "[ampccl-mock] %s: ranks disagree on nranks or AMPCCL_MOCK_STAGING_KB\n", name);
+        munmap(base, size);
+        return nullptr;
+    }
+    seg->attached.fetch_add(1);
+
+    Comm* c = new Comm;
+    c->name_ = name;
+    c->seg_ = seg;
+    c->seg_size_ = size;
+    c->rank_ = rank;
+    c->nranks_ = nranks;
+    c->device_ = GetDevice();
+    c->id_ = id.id;
+    // Blocking like ncclCommInitRank: every rank has attached before anyone can detach.
+    c->Arrive();
+    return c;
+}
+
+Comm::~Comm() {
+    // Outstanding collectives would touch the segment; callers synchronize their
+    // streams before destroying the communicator, as with the real libraries.
+    if (seg_ && seg_->attached.fetch_sub(1) == 1) shm_unlink(name_.c_str());
+    if (seg_) munmap(seg_, seg_size_);
+}
+
+char* Comm::Result() const { return reinterpret_cast<char*>(seg_) + sizeof(Segment); }
+
+char* Comm::Staging(int rank) const {
+    return Result() + (static_cast<size_t>(rank) + 1) * SimConfig::Get().staging_bytes;
+}
+
+// Two sets of per-rank signatures after the staging areas, alternating per collective:
+// a rank can be at most one collective ahead of the slowest one still comparing.
+uint64_t* Comm::Signatures(uint64_t parity) const {
+    return reinterpret_cast<uint64_t*>(Staging(nranks_)) + (parity & 1) * nranks_;
+}
+
+void Comm::Arrive() {
+    uint64_t target = ++barriers_ * static_cast<uint64_t>(nranks_);
+    seg_->arrivals.fetch_add(1, std::memory_order_acq_rel);
+    SpinUntil([&] { return seg_->arrivals.load(std::memory_order_acquire) >= target; }, "a collective rendezvous");
+}
+
+void Comm::Enter(const char* kind, size_t count, DataType dt) {
+    uint64_t sig = SplitMix64(count) ^ static_cast<uint64_t>(dt);
+    for (const char* k = kind; *k; ++k) sig = SplitMix64(sig ^ static_cast<unsigned char>(*k));
+    uint64_t* sigs = Signatures(entered_++);
+    __atomic_store_n(&sigs[rank_], sig, __ATOMIC_RELAXED);
+    Arrive();
+    for (int r = 0; r < nranks_; ++r) {
+        if (__atomic_load_n(&sigs[r], __ATOMIC_RELAXED) == sig) continue;
+        std::fprintf(stderr,
+                     "[ampccl-mock] %s: rank %d entered %s(count=%zu) as collective #%llu but rank %d "
+                     "entered a different one\n",
+                     name_.c_str(), rank_, kind, count, static_cast<unsigned long long>(entered_), r);
+        std::abort();
+    }
+}
+
+void Comm::RunInOrder(uint64_t ticket, const std::function<void()>& body) {
+    SpinUntil([&] { return turn_.load(std::memory_order_acquire) == ticket; },
+              "an earlier collective on this communicator");
+    body();
+    turn_.store(ticket + 1, std::memory_order_release);
+}
+
+void Comm::Finish(uint64_t start_ns, double bus_bytes) {
+    const PathModel& m = SimConfig::Get().fast;
+    double t = m.Time(bus_bytes) * JitterFactor(id_ ^ (barriers_ << 1));
+    WaitUntil(start_ns + static_cast<uint64_t>(t * 1e9));
+    completed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ---------------------------------------------------------------------------
+// Host reductions
+
+namespace {
+
+float HalfToFloat(uint16_t h) {
+    uint32_t sign = (h & 0x8000u) << 16;
+    int exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ffu;
+    uint32_t bits;
+    if (exp == 0) {
+        if (mant == 0) {
+            bits = sign;
+        } else {  // subnormal: normalize
+            exp = 1;
+            while (!(mant & 0x400u)) { mant <<= 1; --exp; }
+            mant &= 0x3ffu;
+            bits = sign | static_cast<uint32_t>(exp + 112) << 23 | mant << 13;
+        }
+    } else if (exp == 31) {
+        bits = sign | 0x7f800000u | mant << 13;
+    } else {
+        bits = sign | static_cast<uint32_t>(exp + 112) << 23 | mant << 13;
+    }
+    float f;
+    std::memcpy(&f, &bits, 4);
+    return f;
+}
+
+uint16_t FloatToHalf(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, 4);
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+    int exp = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mant = bits & 0x7fffffu;
+    if (((bits >> 23) & 0xff) == 0xff) return sign | 0x7c00u | (mant ? 0x200u : 0);
+    if (exp >= 31) return sign | 0x7c00u;
+    if (exp <= 0) {
+        if (exp < -10) return sign;
+        mant |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exp);
+        uint32_t half = mant >> shift;
+        if ((mant >> (shift - 1)) & 1u) ++half;  // round half up
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint16_t h = sign | static_cast<uint16_t>(exp << 10) | static_cast<uint16_t>(mant >> 13);
+    if (mant & 0x1000u) ++h;  // round half up (carry into the exponent is correct)
+    return h;
+}
+
+float Bf16ToFloat(uint16_t b) {
+    uint32_t bits = static_cast<uint32_t>(b) << 16;
+    float f;
+    std::memcpy(&f, &bits, 4);
+    return f;
+}
+
+uint16_t FloatToBf16(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, 4);
+    bits += 0x7fffu + ((bits >> 16) & 1u);  // round to nearest even
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+template <typename T>
+T Apply(T a, T b, ReduceOp op) {
+    switch (op) {
+        case ReduceOp::Sum: return static_cast<T>(a + b);
+        case ReduceOp::Prod: return static_cast<T>(a * b);
+        case ReduceOp::Max: return a < b ? b : a;
+        case ReduceOp::Min: return b < a ? b : a;
+    }
+    return a;
+}
+
+template <typename T>
+void ReduceTyped(T* dst, const T* src, size_t n, ReduceOp op) {
+    for (size_t i = 0; i < n; ++i) dst[i] = Apply(dst[i], src[i], op);
+}
+
+template <float (*Load)(uint16_t), uint16_t (*Store)(float)>
+void Reduce16(uint16_t* dst, const uint16_t* src, size_t n, ReduceOp op) {
+    for (size_t i = 0; i < n; ++i) dst[i] = Store(Apply(Load(dst[i]), Load(src[i]), op));
+}
+
+}  // namespace
+
+void ReduceInto(void* dst, const void* src, size_t n, DataType dt, ReduceOp op) {
+    switch (dt) {
+        case DataType::Int8: ReduceTyped(static_cast<int8_t*>(dst), static_cast<const int8_t*>(src), n, op); break;
+        case DataType::Uint8: ReduceTyped(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), n, op); break;
+        case DataType::Int32: ReduceTyped(static_cast<int32_t*>(dst), static_cast<const int32_t*>(src), n, op); break;
+        case DataType::Uint32: ReduceTyped(static_cast<uint32_t*>(dst), static_cast<const uint32_t*>(src), n, op); break;
+        case DataType::Int64: ReduceTyped(static_cast<int64_t*>(dst), static_cast<const int64_t*>(src), n, op); break;
+        case DataType::Uint64: ReduceTyped(static_cast<uint64_t*>(dst), static_cast<const uint64_t*>(src), n, op); break;
+        case DataType::Float32: ReduceTyped(static_cast<float*>(dst), static_cast<const float*>(src), n, op); break;
+        case DataType::Float64: ReduceTyped(static_cast<double*>(dst), static_cast<const double*>(src), n, op); break;
+        case DataType::Float16:
+            Reduce16<HalfToFloat, FloatToHalf>(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), n, op);
+            break;
+        case DataType::BFloat16:
+            Reduce16<Bf16ToFloat, FloatToBf16>(static_cast<uint16_t*>(dst), static_cast<const uint16_t*>(src), n, op);
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Collectives. Data moves in chunks that fit the per-rank staging area; every chunk is
+// staged, rendezvoused, combined, and rendezvoused again before staging is reused.
+
+void Comm::RunAllReduce(const void* send, void* recv, size_t count, DataType dt, ReduceOp op) {
+    size_t es = DataTypeSize(dt);
+    double bytes = static_cast<double>(count * es);
+    Enter("AllReduce", count, dt);
+    uint64_t start = NowNs();
+    if (SimConfig::Get().move_data) {
+        size_t chunk = SimConfig::Get().staging_bytes / es;
+        for (size_t off = 0; off < count; off += chunk) {
+            size_t n = std::min(chunk, count - off);
+            std::memcpy(Staging(rank_), static_cast<const char*>(send) + off * es, n * es);
+            Arrive();
+            // Rank r reduces slice r of the chunk into the shared result area.
+            size_t lo = n * rank_ / nranks_, hi = n * (rank_ + 1) / nranks_;
+            if (hi > lo) {
+                char* out = Result() + lo * es;
+                std::memcpy(out, Staging(0) + lo * es, (hi - lo) * es);
+                for (int r = 1; r < nranks_; ++r) ReduceInto(out, Staging(r) + lo * es, hi - lo, dt, op);
+            }
+            Arrive();
+            std::memcpy(static_cast<char*>(recv) + off * es, Result(), n * es);
+            Arrive();
+        }
+    }
+    Finish(start, bytes * 2.0 * (nranks_ - 1) / nranks_);
+}
+
+void Comm::RunAllGather(const void* send, void* recv, size_t sendcount, DataType dt) {
+    size_t es = DataTypeSize(dt);
+    double total = static_cast<double>(sendcount * es) * nranks_;
+    Enter("AllGather", sendcount, dt);
+    uint64_t start = NowNs();
+    if (SimConfig::Get().move_data) {
+        size_t chunk = SimConfig::Get().staging_bytes / es;
+        for (size_t off = 0; off < sendcount; off += chunk) {
+            size_t n = std::min(chunk, sendcount - off);
+            std::memcpy(Staging(rank_), static_cast<const char*>(send) + off * es, n * es);
+            Arrive();
+            for (int r = 0; r < nranks_; ++r)
+                std::memcpy(static_cast<char*>(recv) + (r * sendcount + off) * es, Staging(r), n * es);
+            Arrive();
+        }
+    }
+    Finish(start, total * (nranks_ - 1) / nranks_);
+}
+
+void Comm::RunReduceScatter(const void* send, void* recv, size_t recvcount, DataType dt, ReduceOp op) {
+    size_t es = DataTypeSize(dt);
+    double total = static_cast<double>(recvcount * es) * nranks_;
+    Enter("ReduceScatter", recvcount, dt);
+    uint64_t start = NowNs();
+    if (SimConfig::Get().move_data) {
+        // Staging holds one sub-chunk per destination rank.
+        size_t chunk = std::max<size_t>(1, SimConfig::Get().staging_bytes / (es * nranks_));
+        for (size_t off = 0; off < recvcount; off += chunk) {
+            size_t n = std::min(chunk, recvcount - off);
+            for (int d = 0; d < nranks_; ++d)
+                std::memcpy(Staging(rank_) + d * n * es,
+                            static_cast<const char*>(send) + (d * recvcount + off) * es, n * es);
+            Arrive();
+            char* out = static_cast<char*>(recv) + off * es;
+            std::memmove(out, Staging(0) + rank_ * n * es, n * es);
+            for (int r = 1; r < nranks_; ++r) ReduceInto(out, Staging(r) + rank_ * n * es, n, dt, op);
+            Arrive();
+        }
+    }
+    Finish(start, total * (nranks_ - 1) / nranks_);
+}
+
+void Comm::RunBroadcast(const void* send, void* recv, size_t count, DataType dt, int root) {
+    size_t es = DataTypeSize(dt);
+    Enter("Broadcast", count, dt);
+    uint64_t start = NowNs();
+    if (SimConfig::Get().move_data) {
+        size_t chunk = SimConfig::Get().staging_bytes / es;
+        for (size_t off = 0; off < count; off += chunk) {
+            size_t n = std::min(chunk, count - off);
+            if (rank_ == root) std::memcpy(Staging(root), static_cast<const char*>(send) + off * es, n * es);
+            Arrive();
+            std::memmove(static_cast<char*>(recv) + off * es, Staging(root), n * es);
+            Arrive();
+        }
+    }
+    Finish(start, static_cast<double>(count * es));
+}
+
+bool Comm::AllReduce(const void* send, void* recv, size_t count, DataType dt, ReduceOp op, Stream* s) {
+    if (!s || (count && (!send || !recv))) return false;
+    uint64_t ticket = Launch();
+    s->Enqueue([=] { RunInOrder(ticket, [&] { RunAllReduce(send, recv, count, dt, op); }); });
+    return true;
+}
+
+bool Comm::AllGather(const void* send, void* recv, size_t sendcount, DataType dt, Stream* s) {
+    if (!s || (sendcount && (!send || !recv))) return false;
+    uint64_t ticket = Launch();
+    s->Enqueue([=] { RunInOrder(ticket, [&] { RunAllGather(send, recv, sendcount, dt); }); });
+    return true;
+}
+
+bool Comm::ReduceScatter(const void* send, void* recv, size_t recvcount, DataType dt, ReduceOp op, Stream* s) {
+    if (!s || (recvcount && (!send || !recv))) return false;
+    uint64_t ticket = Launch();
+    s->Enqueue([=] { RunInOrder(ticket, [&] { RunReduceScatter(send, recv, recvcount, dt, op); }); });
+    return true;
+}
+
+bool Comm::Broadcast(const void* send, void* recv, size_t count, DataType dt, int root, Stream* s) {
+    if (!s || root < 0 || root >= nranks_ || (count && (!recv || (rank_ == root && !send)))) return false;
+    uint64_t ticket = Launch();
+    s->Enqueue([=] { RunInOrder(ticket, [&] { RunBroadcast(send, recv, count, dt, root); }); });
+    return true;
+}
+
+bool Comm::Split(int color, int key, Comm** child) {
+    if (!child) return false;
+    *child = nullptr;
+    int child_rank = 0;
+    int child_n = 0;
+    RunInOrder(Launch(), [&] {
+        Enter("Split", 0, DataType::Int32);
+        int32_t* mine = reinterpret_cast<int32_t*>(Staging(rank_));
+        mine[0] = color;
+        mine[1] = key;
+        Arrive();
+        for (int r = 0; r < nranks_; ++r) {
+            const int32_t* other = reinterpret_cast<const int32_t*>(Staging(r));
+            if (color < 0 || other[0] != color) continue;
+            ++child_n;
+            if (other[1] < key || (other[1] == key && r < rank_)) ++child_rank;
+        }
+        // Staging is reused by the next collective once everyone has read it.
+        Arrive();
+    });
+    uint64_t seq = splits_++;
+    if (color < 0) return true;
+    CommId id{kCommIdMagic, SplitMix64(id_ ^ SplitMix64(seq ^ SplitMix64(static_cast<uint64_t>(color))))};
+    *child = Init(id, child_n, child_rank);
+    return *child != nullptr;
+}
+
+}  // namespace sim
+}  // namespace ampccl
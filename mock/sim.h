@@ -0,0 +1,256 @@
+#ifndef AMPCCL_MOCK_SIM_H_
+#define AMPCCL_MOCK_SIM_H_
+
+// Host simulator behind the mock device runtimes and collective libraries
+// (mock_cudart.cc, mock_nccl.cc, mock_ascendcl.cc, mock_hccl.cc): "device" memory is host
+// memory, a stream is a host worker thread running its queue in order, an event is a
+// timestamp taken when the stream reaches it. Collectives rendezvous with the other
+// ranks of their communicator through a POSIX shm segment (so ranks may be threads or
+// forked processes), move the data on the host, and complete no earlier than
+// latency + bytes / bandwidth after the last rank arrived.
+//
+// The mock libraries call these functions directly, never the exported C symbols, so
+// an LD_PRELOADed libampccl.so intercepts only the application's calls.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ampccl {
+namespace sim {
+
+// Library-independent element types and reductions; the shims map their enums.
+enum class DataType { Int8, Uint8, Int32, Uint32, Int64, Uint64, Float16, Float32, Float64, BFloat16 };
+enum class ReduceOp { Sum, Prod, Max, Min };
+
+size_t DataTypeSize(DataType dt);
+
+// dst[i] = dst[i] (op) src[i] for n elements; 16-bit floats reduce in float.
+void ReduceInto(void* dst, const void* src, size_t n, DataType dt, ReduceOp op);
+
+// Per-path cost: latency + bytes / bandwidth (before jitter).
+struct PathModel {
+    double lat_s = 10e-6;
+    double gbps = 40.0;  // GB/s (1e9 bytes per second)
+
+    double Time(double bytes) const { return lat_s + bytes / (gbps * 1e9); }
+};
+
+// Simulator parameters, read once from the environment:
+//   AMPCCL_MOCK_FAST_GBPS / AMPCCL_MOCK_FAST_LAT_US    fast library (bus bandwidth)
+//   AMPCCL_MOCK_PCIE_GBPS / AMPCCL_MOCK_PCIE_LAT_US    PCIe copy path (PCCL D2H / H2D)
+//   AMPCCL_MOCK_D2D_GBPS   device-local copy (PCCL D2D, default 200)
+//   AMPCCL_MOCK_HOST_GBPS  host reduction (PCCL H2H_REDUCE, default 20)
+//   AMPCCL_MOCK_JITTER     relative stddev of every modelled time (default 0.02)
+//   AMPCCL_MOCK_DATA       0: rendezvous and timing only, no data movement (default 1)
+//   AMPCCL_MOCK_STAGING_KB per-rank shm staging, the data chunk size (default 1024);
+//                          also the size of one PCCL host chunk slot
+//   AMPCCL_MOCK_DEVICES    devices reported per process (default 8)
+//   AMPCCL_MOCK_TIMEOUT_S  abort a rank that waits this long for its peers (default 60)
+struct SimConfig {
+    PathModel fast{10e-6, 40.0};
+    PathModel pcie{20e-6, 12.0};
+    PathModel d2d{2e-6, 200.0};
+    PathModel host{1e-6, 20.0};
+    double jitter = 0.02;
+    bool move_data = true;
+    size_t staging_bytes = 1 << 20;
+    int devices = 8;
+    double timeout_s = 60.0;
+
+    static const SimConfig& Get();
+};
+
+// Normal(1, SimConfig::jitter) factor, clamped to [0.5, 2], derived from seed so that
+// every rank of a collective draws the same value.
+double JitterFactor(uint64_t seed);
+
+uint64_t NowNs();
+
+// Sleep (then spin for the last few µs) until the steady clock reaches deadline_ns.
+void WaitUntil(uint64_t deadline_ns);
+
+// Rendezvous with other ranks: spin, then yield, then sleep until done() holds. Ranks
+// that disagree on what to run never meet, so after SimConfig::timeout_s this reports
+// what was awaited and aborts the process instead of hanging the job.
+[[noreturn]] void RendezvousTimeout(const char* what);
+
+template <typename Done>
+void SpinUntil(Done done, const char* what) {
+    uint64_t deadline = 0;
+    for (int spins = 0; !done(); ++spins) {
+        if (spins < 1000) continue;
+        if (spins < 2000) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (deadline == 0) deadline = NowNs() + static_cast<uint64_t>(SimConfig::Get().timeout_s * 1e9);
+        if ((spins & 1023) == 0 && NowNs() > deadline) RendezvousTimeout(what);
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Streams and events
+
+class Stream {
+public:
+    Stream();
+    ~Stream();
+
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    void Enqueue(std::function<void()> task);
+    void Synchronize();
+    bool Idle();
+
+    // Collectives an open NCCL group holds for this stream (mock_nccl). Synchronizing the
+    // stream meanwhile reads their output before they ran (real NCCL has not launched
+    // them yet), so Synchronize aborts instead of returning stale data.
+    void Hold();
+    void Release();
+
+private:
+    void Run();
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    std::deque<std::function<void()>> queue_;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::atomic<int> held_{0};
+    std::thread worker_;
+};
+
+// nullptr handle -> the process's default stream.
+Stream* ResolveStream(void* handle);
+Stream* CreateStream();
+void DestroyStream(Stream* s);
+
+struct Event {
+    std::mutex mu;
+    std::condition_variable cv;
+    uint64_t pending = 0;   // Records not yet reached by their stream
+    uint64_t reached = 0;   // Records reached so far
+    uint64_t ns = 0;        // Time the last completed record was reached
+};
+
+Event* CreateEvent();
+void DestroyEvent(Event* e);
+void RecordEvent(Event* e, Stream* s);
+void SynchronizeEvent(Event* e);
+// Hold s's later work until every record of e made so far is reached.
+void WaitEvent(Stream* s, Event* e);
+bool QueryEvent(Event* e);
+// Milliseconds between two completed events; false if either is still pending.
+bool ElapsedMs(Event* start, Event* end, float* ms);
+
+// ---------------------------------------------------------------------------
+// Device state (per calling thread) and memory
+
+void SetDevice(int device);
+int GetDevice();
+
+void* DeviceAlloc(size_t bytes);
+void DeviceFree(void* ptr);
+
+// ---------------------------------------------------------------------------
+// Communicators
+
+// Opaque identity a root creates and ships to the other ranks (ncclUniqueId /
+// hcclUniqueId payload): the shm segment name.
+struct CommId {
+    uint64_t magic;
+    uint64_t id;
+};
+constexpr uint64_t kCommIdMagic = 0x414d504d4f434b31u;  // "AMPMOCK1"
+
+CommId NewCommId();
+
+class Comm {
+public:
+    // Attach to (creating if needed) the segment of id; every rank passes the same
+    // nranks. nullptr on error.
+    static Comm* Init(const CommId& id, int nranks, int rank);
+    ~Comm();
+
+    Comm(const Comm&) = delete;
+    Comm& operator=(const Comm&) = delete;
+
+    int rank() const { return rank_; }
+    int nranks() const { return nranks_; }
+    int device() const { return device_; }
+
+    // Enqueue on s, timed with SimConfig::fast. Return false on invalid arguments.
+    bool AllReduce(const void* send, void* recv, size_t count, DataType dt, ReduceOp op, Stream* s);
+    bool AllGather(const void* send, void* recv, size_t sendcount, DataType dt, Stream* s);
+    bool ReduceScatter(const void* send, void* recv, size_t recvcount, DataType dt, ReduceOp op, Stream* s);
+    bool Broadcast(const void* send, void* recv, size_t count, DataType dt, int root, Stream* s);
+
+    // Collective over this communicator, like ncclCommSplit: ranks passing the same
+    // color >= 0 form a child, ranked by (key, rank here); a negative color gets no child
+    // (*child = nullptr). Runs on the calling thread, after the collectives issued here
+    // before it. false on error.
+    bool Split(int color, int key, Comm** child);
+
+    // Collectives completed by this rank.
+    uint64_t completed() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    struct Segment;
+
+    Comm() = default;
+
+    // Stream-side bodies.
+    void RunAllReduce(const void* send, void* recv, size_t count, DataType dt, ReduceOp op);
+    void RunAllGather(const void* send, void* recv, size_t sendcount, DataType dt);
+    void RunReduceScatter(const void* send, void* recv, size_t recvcount, DataType dt, ReduceOp op);
+    void RunBroadcast(const void* send, void* recv, size_t count, DataType dt, int root);
+
+    // Take the next launch ticket; RunInOrder runs body once every earlier ticket has.
+    uint64_t Launch() { return launched_.fetch_add(1, std::memory_order_relaxed); }
+    void RunInOrder(uint64_t ticket, const std::function<void()>& body);
+
+    // Rendezvous: returns when every rank has entered barrier number ++barriers_.
+    void Arrive();
+    // Opening rendezvous of a collective: Arrive, then abort if any rank called a
+    // different collective (kind, element count, type) at this point of the sequence.
+    void Enter(const char* kind, size_t count, DataType dt);
+    // Completion: hold the stream until start_ns + modelled time for bus_bytes.
+    void Finish(uint64_t start_ns, double bus_bytes);
+
+    char* Staging(int rank) const;
+    char* Result() const;
+    uint64_t* Signatures(uint64_t parity) const;
+
+    std::string name_;
+    Segment* seg_ = nullptr;
+    size_t seg_size_ = 0;
+    int rank_ = 0;
+    int nranks_ = 0;
+    int device_ = 0;
+    uint64_t id_ = 0;
+    uint64_t barriers_ = 0;  // Barriers this rank has entered (same sequence on every rank)
+    uint64_t entered_ = 0;   // Collectives this rank has entered
+    uint64_t splits_ = 0;    // Split calls so far; with the color, names each child segment
+    // Launch order: collectives of one comm run one at a time in the order they were
+    // issued, whatever stream (or, for Split, thread) they were issued on, as NCCL
+    // serializes a communicator's operations.
+    std::atomic<uint64_t> launched_{0};
+    std::atomic<uint64_t> turn_{0};
+    std::atomic<uint64_t> completed_{0};
+};
+
+}  // namespace sim
+}  // namespace ampccl
+
+#endif  // AMPCCL_MOCK_SIM_H_
@@ -0,0 +1,404 @@
+// ampccl-replay: offline controller evaluation on captured workloads.
+// Replays an AMPCCL_CAPTURE file through the real Planner, AdaptiveController and
+// ParamCache, with per-path times from a latency + bandwidth model instead of devices,
+// and compares controllers on the same collective sequence. No GPU/NPU needed.
+//
+//   ampccl-replay capture.rank0.bin
+//   ampccl-replay --algo tcp,model,tail --pcie-bw 8 capture.rank0.bin
+//
+// Model: by default fitted per (op, path) to the measured completions in the capture
+// (least squares time = latency + bytes / bandwidth); ops or paths without enough
+// samples use the --fast-* / --pcie-* values. --model fixed ignores the measurements.
+// Each collective's stat is fed back immediately (live runs update at the next stream
+// sync), and every domain gets its own controller and cache, as at runtime.
+
+#include "telemetry/capture.h"
+#include "controller/controller.h"
+#include "controller/algo_factory.h"
+#include "cache/param_cache.h"
+#include "core/planner.h"
+#include "common/op_key.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using ampccl::AdaptiveAlgorithm;
+using ampccl::CaptureRecord;
+using ampccl::CollectiveType;
+using ampccl::kNumCollectiveTypes;
+
+struct Options {
+    std::vector<AdaptiveAlgorithm> algos;
+    bool fit = true;
+    double fast_gbps = 40.0;
+    double fast_lat_us = 10.0;
+    double pcie_gbps = 12.0;
+    double pcie_lat_us = 20.0;
+    double jitter = 0.02;   // Relative stddev of modelled times
+    unsigned seed = 1;
+    int rank = -2;          // -2: lowest rank present
+    bool per_size = false;
+    std::vector<std::string> files;
+};
+
+void Usage() {
+    std::fprintf(stderr,
+        "usage: ampccl-replay [--algo tcp,dcqcn,static,model,bandit,tail] [--model fit|fixed]\n"
+        "                     [--fast-bw GBPS] [--fast-lat US] [--pcie-bw GBPS] [--pcie-lat US]\n"
+        "                     [--jitter F] [--seed N] [--rank R] [--per-size] CAPTURE_FILE...\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options* opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--help" || a == "-h") return false;
+        if (a == "--per-size") {
+            opt->per_size = true;
+            continue;
+        }
+        if (a.compare(0, 2, "--") != 0) {
+            opt->files.push_back(a);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        std::string v = argv[++i];
+        if (a == "--algo") {
+            size_t start = 0;
+            while (start <= v.size()) {
+                size_t end = v.find(',', start);
+                if (end == std::string::npos) end = v.size();
+                AdaptiveAlgorithm algo;
+                if (!ampccl::AlgoFactory::Parse(v.substr(start, end - start), &algo)) return false;
+                opt->algos.push_back(algo);
+                start = end + 1;
+            }
+        } else if (a == "--model") {
+            if (v != "fit" && v != "fixed") return false;
+            opt->fit = (v == "fit");
+        } else if (a == "--fast-bw") opt->fast_gbps = std::atof(v.c_str());
+        else if (a == "--fast-lat") opt->fast_lat_us = std::atof(v.c_str());
+        else if (a == "--pcie-bw") opt->pcie_gbps = std::atof(v.c_str());
+        else if (a == "--pcie-lat") opt->pcie_lat_us = std::atof(v.c_str());
+        else if (a == "--jitter") opt->jitter = std::atof(v.c_str());
+        else if (a == "--seed") opt->seed = static_cast<unsigned>(std::atoi(v.c_str()));
+        else if (a == "--rank") opt->rank = std::atoi(v.c_str());
+        else return false;
+    }
+    if (opt->algos.empty()) {
+        opt->algos.assign(std::begin(ampccl::AlgoFactory::kAll), std::end(ampccl::AlgoFactory::kAll));
+    }
+    return !opt->files.empty() && opt->fast_gbps > 0.0 && opt->pcie_gbps > 0.0;
+}
+
+// One collective of the replayed sequence.
+struct Collective {
+    uint64_t ns = 0;
+    uint64_t domain = 0;
+    uint64_t seq = 0;
+    ampccl::OpKey op_key;
+    bool has_measured = false;
+    double measured = 0.0;  // Captured collective time (max of both paths)
+};
+
+bool ReadCapture(const std::string& path, std::vector<CaptureRecord>* out) {
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (f == nullptr) {
+        std::fprintf(stderr, "ampccl-replay: cannot open %s\n", path.c_str());
+        return false;
+    }
+    ampccl::CaptureFileHeader hdr;
+    if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != ampccl::kCaptureMagic ||
+        hdr.record_size != sizeof(CaptureRecord)) {
+        std::fprintf(stderr, "ampccl-replay: %s is not an AmpCCL capture (v%u)\n", path.c_str(),
+                     ampccl::kCaptureVersion);
+        std::fclose(f);
+        return false;
+    }
+    CaptureRecord r;
+    while (std::fread(&r, sizeof(r), 1, f) == 1) out->push_back(r);
+    std::fclose(f);
+    return true;
+}
+
+// time = latency + bytes / bandwidth.
+struct PathModel {
+    double lat = 0.0;      // Seconds
+    double sec_per_byte = 0.0;
+    bool fitted = false;
+
+    double Time(size_t bytes) const { return lat + sec_per_byte * static_cast<double>(bytes); }
+};
+
+struct Samples {
+    std::vector<std::pair<double, double>> xy;  // (bytes, seconds)
+
+    // Ordinary least squares; needs two distinct sizes and a non-negative fit.
+    bool Fit(PathModel* m) const {
+        if (xy.size() < 8) return false;
+        double n = static_cast<double>(xy.size());
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (const auto& p : xy) {
+            sx += p.first;
+            sy += p.second;
+            sxx += p.first * p.first;
+            sxy += p.first * p.second;
+        }
+        double den = n * sxx - sx * sx;
+        if (den <= 0.0) return false;
+        double slope = (n * sxy - sx * sy) / den;
+        double lat = (sy - slope * sx) / n;
+        if (slope <= 0.0) return false;
+        m->sec_per_byte = slope;
+        m->lat = lat > 0.0 ? lat : 0.0;
+        m->fitted = true;
+        return true;
+    }
+};
+
+struct Model {
+    PathModel fast[kNumCollectiveTypes];
+    PathModel pcie[kNumCollectiveTypes];
+};
+
+Model BuildModel(const Options& opt, const std::vector<CaptureRecord>& completes) {
+    Model m;
+    PathModel fast_default{opt.fast_lat_us * 1e-6, 1.0 / (opt.fast_gbps * 1e9), false};
+    PathModel pcie_default{opt.pcie_lat_us * 1e-6, 1.0 / (opt.pcie_gbps * 1e9), false};
+    Samples fast[kNumCollectiveTypes];
+    Samples pcie[kNumCollectiveTypes];
+    for (const CaptureRecord& r : completes) {
+        if (r.op >= kNumCollectiveTypes) continue;
+        if (r.bytes > 0 && r.fast_time > 0.0f && (r.flags & ampccl::kCaptureFastOk)) {
+            fast[r.op].xy.emplace_back(static_cast<double>(r.bytes), r.fast_time);
+        }
+        if (r.pcie_bytes > 0 && r.pcie_time > 0.0f && (r.flags & ampccl::kCapturePCIeOk)) {
+            pcie[r.op].xy.emplace_back(static_cast<double>(r.pcie_bytes), r.pcie_time);
+        }
+    }
+    for (int op = 0; op < kNumCollectiveTypes; ++op) {
+        m.fast[op] = fast_default;
+        m.pcie[op] = pcie_default;
+        if (opt.fit) {
+            fast[op].Fit(&m.fast[op]);
+            pcie[op].Fit(&m.pcie[op]);
+        }
+    }
+    return m;
+}
+
+struct Result {
+    double total = 0.0;        // Sum of simulated collective times
+    uint64_t split = 0;        // Collectives that used PCIe
+    double alpha_sum = 0.0;    // Over split collectives
+    uint64_t trips = 0;
+    // Exploration cost summed over domains; only for controllers that report it.
+    bool has_regret = false;
+    ampccl::RegretStats regret;
+    // Final alpha per (op, size class) of the first domain, for --per-size.
+    std::map<std::pair<int, int>, double> final_alpha;
+};
+
+struct DomainState {
+    std::unique_ptr<ampccl::AdaptiveController> controller;
+    ampccl::ParamCache cache;
+};
+
+Result Replay(AdaptiveAlgorithm algo, const std::vector<Collective>& seq, const Model& model,
+              const Options& opt) {
+    Result res;
+    std::map<uint64_t, DomainState> domains;
+    std::mt19937 rng(opt.seed);
+    std::normal_distribution<double> noise(1.0, opt.jitter);
+    auto jitter = [&](double t) { return opt.jitter > 0.0 ? t * std::max(0.1, noise(rng)) : t; };
+
+    for (const Collective& c : seq) {
+        DomainState& d = domains[c.domain];
+        if (!d.controller) {
+            d.controller.reset(new ampccl::AdaptiveController(ampccl::AlgoFactory::Create(algo)));
+        }
+        bool use_pcie = d.controller->UsePCIe(c.op_key, d.cache);
+        double alpha = d.controller->SuggestAlpha(c.op_key, d.cache);
+        ampccl::Plan plan = ampccl::Planner::CreatePlan(c.op_key.bytes, alpha, use_pcie);
+
+        int op = static_cast<int>(c.op_key.op);
+        ampccl::ExecStat stat;
+        stat.fast_bytes = plan.fast_bytes;
+        stat.pcie_bytes = plan.pcie_bytes;
+        stat.fast_time = plan.fast_bytes > 0 ? jitter(model.fast[op].Time(plan.fast_bytes)) : 0.0;
+        stat.pcie_time = plan.pcie_bytes > 0 ? jitter(model.pcie[op].Time(plan.pcie_bytes)) : 0.0;
+        d.controller->Update(c.op_key, stat, d.cache);
+
+        res.total += stat.GetTotalTime();
+        if (plan.pcie_bytes > 0) {
+            ++res.split;
+            res.alpha_sum += plan.alpha;
+        }
+        if (c.domain == seq.front().domain) {
+            res.final_alpha[{op, ampccl::SizeClassOf(c.op_key.bytes)}] = plan.pcie_bytes > 0 ? plan.alpha : 1.0;
+        }
+    }
+    for (const auto& kv : domains) {
+        res.trips += kv.second.controller->breaker().trips();
+        const ampccl::RegretStats* r = kv.second.controller->GetRegretStats();
+        if (r != nullptr) {
+            res.has_regret = true;
+            res.regret.pulls += r->pulls;
+            res.regret.explore_pulls += r->explore_pulls;
+            res.regret.regret_time += r->regret_time;
+        }
+    }
+    return res;
+}
+
+std::string FormatBytes(double b) {
+    static const char* kUnits[] = {"B", "K", "M", "G", "T"};
+    int u = 0;
+    while (b >= 1024.0 && u < 4) {
+        b /= 1024.0;
+        ++u;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.0f%s", b, kUnits[u]);
+    return buf;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+    // Replay evaluates splitting, so the PCIe path is on unless explicitly disabled.
+    setenv("AMPCCL_ENABLE_PCIE", "1", 0);
+
+    std::vector<CaptureRecord> records;
+    for (const std::string& f : opt.files) {
+        if (!ReadCapture(f, &records)) return 1;
+    }
+    if (opt.rank == -2) {
+        int lowest = -1;
+        for (const CaptureRecord& r : records) {
+            if (r.kind == ampccl::kCaptureLaunch && (lowest < 0 || (r.rank >= 0 && r.rank < lowest))) {
+                lowest = r.rank;
+            }
+        }
+        opt.rank = lowest;
+    }
+
+    // Join Complete records to their Launch on (domain, seq); one rank's view only.
+    std::map<std::pair<uint64_t, uint64_t>, size_t> index;
+    std::vector<Collective> seq;
+    std::vector<CaptureRecord> completes;
+    for (const CaptureRecord& r : records) {
+        if (r.rank != opt.rank || r.kind != ampccl::kCaptureLaunch || r.op >= kNumCollectiveTypes) continue;
+        Collective c;
+        c.ns = r.ns;
+        c.domain = r.domain;
+        c.seq = r.seq;
+        c.op_key.op = static_cast<CollectiveType>(r.op);
+        c.op_key.bytes = r.bytes;
+        c.op_key.datatype = r.datatype;
+        index[{r.domain, r.seq}] = seq.size();
+        seq.push_back(c);
+    }
+    for (const CaptureRecord& r : records) {
+        if (r.rank != opt.rank || r.kind != ampccl::kCaptureComplete) continue;
+        completes.push_back(r);
+        auto it = index.find({r.domain, r.seq});
+        if (it != index.end()) {
+            seq[it->second].has_measured = true;
+            seq[it->second].measured = std::max(r.fast_time, r.pcie_time);
+        }
+    }
+    if (seq.empty()) {
+        std::fprintf(stderr, "ampccl-replay: no launch records for rank %d\n", opt.rank);
+        return 1;
+    }
+    std::stable_sort(seq.begin(), seq.end(), [](const Collective& a, const Collective& b) { return a.ns < b.ns; });
+
+    std::map<uint64_t, int> domain_count;
+    double measured = 0.0;
+    size_t with_measured = 0;
+    for (const Collective& c : seq) {
+        ++domain_count[c.domain];
+        if (c.has_measured) {
+            measured += c.measured;
+            ++with_measured;
+        }
+    }
+    double span = static_cast<double>(seq.back().ns - seq.front().ns) * 1e-9;
+    std::printf("ampccl-replay: %zu collectives from rank %d, %zu domain(s), %.3f s of capture "
+                "(mean gap %.1f us), %zu with measured times\n",
+                seq.size(), opt.rank, domain_count.size(), span,
+                seq.size() > 1 ? span * 1e6 / static_cast<double>(seq.size() - 1) : 0.0, with_measured);
+
+    Model model = BuildModel(opt, completes);
+    for (int op = 0; op < kNumCollectiveTypes; ++op) {
+        bool used = std::any_of(seq.begin(), seq.end(),
+                                [op](const Collective& c) { return static_cast<int>(c.op_key.op) == op; });
+        if (!used) continue;
+        std::printf("model %-14s fast %6.2f GB/s + %6.1f us (%s)   pcie %6.2f GB/s + %6.1f us (%s)\n",
+                    ampccl::CollectiveTypeName(static_cast<CollectiveType>(op)),
+                    1e-9 / model.fast[op].sec_per_byte, model.fast[op].lat * 1e6,
+                    model.fast[op].fitted ? "fitted" : "default",
+                    1e-9 / model.pcie[op].sec_per_byte, model.pcie[op].lat * 1e6,
+                    model.pcie[op].fitted ? "fitted" : "default");
+    }
+
+    double fast_only = 0.0;
+    for (const Collective& c : seq) {
+        fast_only += model.fast[static_cast<int>(c.op_key.op)].Time(c.op_key.bytes);
+    }
+
+    std::printf("\n%-10s %12s %10s %8s %10s %6s %8s %10s\n", "algo", "total_s", "speedup", "split%", "mean_alpha",
+                "trips", "explore", "regret_ms");
+    std::printf("%-10s %12.6f %9.3fx %8s %10s %6s %8s %10s\n", "fast-only", fast_only, 1.0, "-", "-", "-", "-", "-");
+    if (with_measured == seq.size()) {
+        std::printf("%-10s %12.6f %9.3fx %8s %10s %6s %8s %10s\n", "captured", measured,
+                    measured > 0.0 ? fast_only / measured : 0.0, "-", "-", "-", "-", "-");
+    }
+    std::vector<std::pair<AdaptiveAlgorithm, Result>> results;
+    for (AdaptiveAlgorithm algo : opt.algos) {
+        Result r = Replay(algo, seq, model, opt);
+        std::printf("%-10s %12.6f %9.3fx %7.1f%% %10.3f %6llu", ampccl::AlgoFactory::Name(algo), r.total,
+                    r.total > 0.0 ? fast_only / r.total : 0.0,
+                    100.0 * static_cast<double>(r.split) / static_cast<double>(seq.size()),
+                    r.split > 0 ? r.alpha_sum / static_cast<double>(r.split) : 1.0,
+                    static_cast<unsigned long long>(r.trips));
+        if (r.has_regret) {
+            std::printf(" %7.1f%% %10.3f\n", 100.0 * r.regret.ExploreFraction(), r.regret.regret_time * 1e3);
+        } else {
+            std::printf(" %8s %10s\n", "-", "-");
+        }
+        results.emplace_back(algo, std::move(r));
+    }
+
+    if (opt.per_size) {
+        std::printf("\nfinal alpha per size class (first domain):\n%-14s %7s", "op", "size");
+        for (const auto& r : results) std::printf(" %8s", ampccl::AlgoFactory::Name(r.first));
+        std::printf("\n");
+        for (const auto& kv : results.front().second.final_alpha) {
+            std::printf("%-14s %7s", ampccl::CollectiveTypeName(static_cast<CollectiveType>(kv.first.first)),
+                        FormatBytes(std::ldexp(1.0, kv.first.second)).c_str());
+            for (const auto& r : results) {
+                auto it = r.second.final_alpha.find(kv.first);
+                std::printf(" %8.3f", it != r.second.final_alpha.end() ? it->second : 1.0);
+            }
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
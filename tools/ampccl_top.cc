@@ -0,0 +1,313 @@
+// ampccl-top: live monitor for AmpCCL jobs on this node.
+// Discovers the shared-memory segments of running jobs and maps them read-only:
+//   /ampccl_u<uid>_...    per-domain param segments (scheme A): last stat of every
+//                         rank, param table (alpha / use_pcie per size), version
+//   /ampccl_stats_<pid>   per-process latency histograms, hook overhead and
+//                         controller exploration cost (AMPCCL_STATS_PAGE)
+// Nothing is written, so watching a job does not perturb it.
+//
+//   ampccl-top                 refresh every second
+//   ampccl-top --interval 0.2  faster refresh
+//   ampccl-top --once          print one snapshot and exit
+
+#include "core/shm_store.h"
+#include "telemetry/stats_page.h"
+#include "telemetry/histogram.h"
+#include "common/op_key.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using ampccl::ShmParamStore;
+
+struct Options {
+    double interval = 1.0;
+    bool once = false;
+    std::string filter;  // Only segments whose name contains this
+};
+
+void Usage() {
+    std::fprintf(stderr, "usage: ampccl-top [--interval SEC] [--once] [--filter SUBSTR]\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options* opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--once") {
+            opt->once = true;
+            continue;
+        }
+        if (a == "--help" || a == "-h" || i + 1 >= argc) return false;
+        const char* v = argv[++i];
+        if (a == "--interval") opt->interval = std::atof(v);
+        else if (a == "--filter") opt->filter = v;
+        else return false;
+    }
+    return opt->interval > 0.0;
+}
+
+std::string FormatBytes(double b) {
+    static const char* kUnits[] = {"B", "K", "M", "G", "T"};
+    int u = 0;
+    while (b >= 1024.0 && u < 4) {
+        b /= 1024.0;
+        ++u;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), b < 10.0 && u > 0 ? "%.1f%s" : "%.0f%s", b, kUnits[u]);
+    return buf;
+}
+
+// Segment names in /dev/shm (without the leading '/'), split by kind.
+void Discover(const Options& opt, std::vector<std::string>* domains, std::vector<std::string>* pages) {
+    DIR* d = opendir("/dev/shm");
+    if (d == nullptr) {
+        return;
+    }
+    const std::string stats_prefix = std::string(ampccl::StatsPage::kShmPrefix).substr(1);
+    const std::string domain_prefix = std::string(ShmParamStore::kShmPrefix).substr(1);
+    while (struct dirent* e = readdir(d)) {
+        std::string name = e->d_name;
+        if (!opt.filter.empty() && name.find(opt.filter) == std::string::npos) continue;
+        if (name.compare(0, stats_prefix.size(), stats_prefix) == 0) {
+            pages->push_back("/" + name);
+        } else if (name.compare(0, domain_prefix.size(), domain_prefix) == 0) {
+            domains->push_back("/" + name);
+        }
+    }
+    closedir(d);
+    std::sort(domains->begin(), domains->end());
+    std::sort(pages->begin(), pages->end());
+}
+
+void PrintDomain(const std::string& name, const ShmParamStore::SegmentView& v) {
+    std::printf("domain %s  nranks=%d  owner=%.12s  param_version=%llu  updates=%llu  closed_seq=%llu  pcie=%s\n",
+                name.c_str(), v.nranks, v.owner.Hex().c_str(), static_cast<unsigned long long>(v.param_version),
+                static_cast<unsigned long long>(v.updates), static_cast<unsigned long long>(v.closed_seq),
+                v.pcie_allowed ? "allowed" : "OPEN (breaker)");
+    // Stale: every attached process has exited; the next attach (or job start) reclaims it.
+    std::printf("  generation=%llu  creator_pid=%d  attached=%d  live=%d%s\n",
+                static_cast<unsigned long long>(v.generation), v.creator_pid, v.attached, v.live,
+                v.live == 0 ? "  STALE" : "");
+    if (v.pcie_enable != 0) {
+        std::printf("  pcie_enable_seq=%llu  (lazy PCCL setup published)\n",
+                    static_cast<unsigned long long>(v.pcie_enable - 1));
+    }
+    if (v.pcie_disable != 0) {
+        std::printf("  pcie_disable_seq=%llu  (a rank quarantined PCIe; fast-only from here)\n",
+                    static_cast<unsigned long long>(v.pcie_disable - 1));
+    }
+
+    if (!v.stats.empty()) {
+        std::printf("  %4s %-16s %7s %9s %9s %8s %8s %8s %8s  %s\n", "rank", "last op", "bytes",
+                    "fast_ms", "pcie_ms", "fast_B", "pcie_B", "fastGB/s", "pcieGB/s", "ok");
+        // Straggler: slowest rank on the collective's critical path (max of both paths).
+        std::vector<double> totals;
+        for (const auto& r : v.stats) totals.push_back(r.stat.GetTotalTime());
+        std::vector<double> sorted = totals;
+        std::sort(sorted.begin(), sorted.end());
+        double median = sorted[sorted.size() / 2];
+        size_t slowest = std::max_element(totals.begin(), totals.end()) - totals.begin();
+        for (size_t i = 0; i < v.stats.size(); ++i) {
+            const auto& r = v.stats[i];
+            std::printf("  %4d %-16s %7s %9.3f %9.3f %8s %8s %8.2f %8.2f  %s%s", r.rank,
+                        ampccl::CollectiveTypeName(r.op_key.op),
+                        FormatBytes(static_cast<double>(r.op_key.bytes)).c_str(),
+                        r.stat.fast_time * 1e3, r.stat.pcie_time * 1e3,
+                        FormatBytes(static_cast<double>(r.stat.fast_bytes)).c_str(),
+                        FormatBytes(static_cast<double>(r.stat.pcie_bytes)).c_str(),
+                        r.stat.GetFastBandwidth(), r.stat.GetPCIeBandwidth(),
+                        r.stat.fast_success ? "F" : "f!", r.stat.pcie_success ? "P" : "p!");
+            if (v.stats.size() > 1 && i == slowest && median > 0.0) {
+                std::printf("  <- straggler (+%.1f%% vs median)", (totals[i] / median - 1.0) * 100.0);
+            }
+            std::printf("\n");
+        }
+    }
+
+    if (!v.params.empty()) {
+        std::vector<std::pair<ampccl::OpKey, ampccl::ParamValue>> params = v.params;
+        std::sort(params.begin(), params.end(), [](const auto& a, const auto& b) {
+            if (a.first.op != b.first.op) return a.first.op < b.first.op;
+            if (a.first.datatype != b.first.datatype) return a.first.datatype < b.first.datatype;
+            return a.first.bytes < b.first.bytes;
+        });
+        std::printf("  %-16s %5s %7s %6s %8s %9s %9s\n", "op", "dtype", "bytes", "alpha", "use_pcie",
+                    "fastGB/s", "pcieGB/s");
+        for (const auto& p : params) {
+            std::printf("  %-16s %5d %7s %6.3f %8s %9.2f %9.2f\n", ampccl::CollectiveTypeName(p.first.op),
+                        p.first.datatype, FormatBytes(static_cast<double>(p.first.bytes)).c_str(),
+                        p.second.alpha, p.second.use_pcie ? "yes" : "no", p.second.fast_bw,
+                        p.second.pcie_bw);
+        }
+    }
+    for (const auto& c : v.crossovers) {
+        std::printf("  crossover %s dtype=%d: split from %s\n",
+                    ampccl::CollectiveTypeName(std::get<0>(c)), std::get<1>(c),
+                    FormatBytes(static_cast<double>(static_cast<size_t>(1) << std::get<2>(c))).c_str());
+    }
+    std::printf("\n");
+}
+
+// Interposition overhead summed over the process's per-thread blocks.
+void PrintOverhead(const char* base, const ampccl::StatsPageHeader* hdr) {
+    uint32_t nblocks = std::min(hdr->num_hook_blocks.load(std::memory_order_acquire), hdr->max_hook_blocks);
+    if (nblocks == 0) {
+        return;
+    }
+    const auto* blocks = reinterpret_cast<const ampccl::HookCounters*>(base + hdr->hook_offset);
+    std::printf("  hook overhead, mean ns per call (1/%u calls timed, %u threads)\n",
+                hdr->hook_sample_period, nblocks);
+    std::printf("  %-16s %10s", "op", "calls");
+    for (int ph = 0; ph < ampccl::kNumHookPhases; ++ph) {
+        std::printf(" %8s", ampccl::HookOverhead::PhaseName(ph));
+    }
+    std::printf(" %8s\n", "total");
+    for (int op = 0; op < ampccl::kNumHookOps; ++op) {
+        uint64_t calls = 0;
+        uint64_t sampled = 0;
+        uint64_t ns[ampccl::kNumHookPhases] = {};
+        for (uint32_t b = 0; b < nblocks; ++b) {
+            calls += blocks[b].calls[op].load(std::memory_order_relaxed);
+            sampled += blocks[b].sampled[op].load(std::memory_order_relaxed);
+            for (int ph = 0; ph < ampccl::kNumHookPhases; ++ph) {
+                ns[ph] += blocks[b].ns[op][ph].load(std::memory_order_relaxed);
+            }
+        }
+        if (calls == 0) continue;
+        std::printf("  %-16s %10llu", ampccl::HookOverhead::OpName(op), static_cast<unsigned long long>(calls));
+        double total = 0.0;
+        for (int ph = 0; ph < ampccl::kNumHookPhases; ++ph) {
+            double mean = sampled > 0 ? static_cast<double>(ns[ph]) / static_cast<double>(sampled) : 0.0;
+            total += mean;
+            std::printf(" %8.1f", mean);
+        }
+        std::printf(" %8.1f\n", total);
+    }
+}
+
+// Exploration cost of each domain's bandit controller (regret vs the best arm).
+void PrintRegret(const char* base, const ampccl::StatsPageHeader* hdr) {
+    uint32_t n = std::min(hdr->num_regret_slots.load(std::memory_order_acquire), hdr->max_regret_slots);
+    if (n == 0) {
+        return;
+    }
+    const auto* slots = reinterpret_cast<const ampccl::RegretSlot*>(base + hdr->regret_offset);
+    std::printf("  controller regret\n");
+    std::printf("  %-16s %4s %10s %8s %11s %12s\n", "domain", "rank", "pulls", "explore", "regret_ms",
+                "us_per_pull");
+    for (uint32_t i = 0; i < n; ++i) {
+        const ampccl::RegretSlot& s = slots[i];
+        uint64_t pulls = s.pulls.load(std::memory_order_acquire);
+        if (pulls == 0) continue;
+        uint64_t explore = s.explore_pulls.load(std::memory_order_relaxed);
+        double regret_ns = static_cast<double>(s.regret_ns.load(std::memory_order_relaxed));
+        std::printf("  %016llx %4d %10llu %7.1f%% %11.3f %12.2f\n", static_cast<unsigned long long>(s.domain),
+                    s.rank, static_cast<unsigned long long>(pulls),
+                    100.0 * static_cast<double>(explore) / static_cast<double>(pulls), regret_ns / 1e6,
+                    regret_ns / 1e3 / static_cast<double>(pulls));
+    }
+}
+
+void PrintStatsPage(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return;
+    }
+    size_t size = ampccl::StatsPage::PageSize();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ampccl::StatsPageHeader)) {
+        close(fd);
+        return;
+    }
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return;
+    }
+    const auto* hdr = static_cast<const ampccl::StatsPageHeader*>(p);
+    if (hdr->magic != ampccl::kStatsPageMagic || hdr->version != ampccl::kStatsPageVersion ||
+        hdr->slot_size != sizeof(ampccl::HistogramSlot) || static_cast<size_t>(st.st_size) != size) {
+        std::printf("stats %s: unsupported layout (version %u)\n\n", name.c_str(), hdr->version);
+        munmap(p, static_cast<size_t>(st.st_size));
+        return;
+    }
+    bool alive = kill(hdr->pid, 0) == 0;
+    uint32_t n = hdr->num_slots.load(std::memory_order_acquire);
+    std::printf("stats %s  pid=%d%s  samples=%llu\n", name.c_str(), hdr->pid, alive ? "" : " (exited)",
+                static_cast<unsigned long long>(hdr->updates.load(std::memory_order_relaxed)));
+    std::printf("  %-16s %4s %7s %5s %10s %9s %9s %9s %9s\n", "op", "rank", "size", "path", "count",
+                "p50_ms", "p99_ms", "max_ms", "mean_ms");
+    static const char* kPathNames[] = {"fast", "pcie", "total"};
+    const auto* slots = reinterpret_cast<const ampccl::HistogramSlot*>(
+        static_cast<const char*>(p) + hdr->header_size);
+    std::vector<uint64_t> counts(ampccl::kHistNumBuckets);
+    for (uint32_t i = 0; i < n && i < hdr->max_slots; ++i) {
+        const ampccl::HistogramSlot& s = slots[i];
+        uint64_t total = 0;
+        for (int b = 0; b < ampccl::kHistNumBuckets; ++b) {
+            counts[b] = s.buckets[b].load(std::memory_order_relaxed);
+            total += counts[b];
+        }
+        if (total == 0) continue;
+        std::printf("  %-16s %4d %7s %5s %10llu %9.3f %9.3f %9.3f %9.3f\n",
+                    ampccl::CollectiveTypeName(static_cast<ampccl::CollectiveType>(s.op)), s.rank,
+                    FormatBytes(static_cast<double>(static_cast<size_t>(1) << s.size_class)).c_str(),
+                    s.path < 3 ? kPathNames[s.path] : "?", static_cast<unsigned long long>(total),
+                    ampccl::HistogramQuantile(counts.data(), total, 0.5) / 1e6,
+                    ampccl::HistogramQuantile(counts.data(), total, 0.99) / 1e6,
+                    s.max_ns.load(std::memory_order_relaxed) / 1e6,
+                    s.sum_ns.load(std::memory_order_relaxed) / 1e6 / static_cast<double>(total));
+    }
+    PrintOverhead(static_cast<const char*>(p), hdr);
+    PrintRegret(static_cast<const char*>(p), hdr);
+    std::printf("\n");
+    munmap(p, size);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 1;
+    }
+    while (true) {
+        std::vector<std::string> domains;
+        std::vector<std::string> pages;
+        Discover(opt, &domains, &pages);
+        if (!opt.once) {
+            std::printf("\033[H\033[2J");  // Home + clear screen
+        }
+        std::printf("ampccl-top: %zu domain segment(s), %zu stats page(s)\n\n", domains.size(), pages.size());
+        for (const auto& name : domains) {
+            ShmParamStore::SegmentView v;
+            if (ShmParamStore::Inspect(name, &v)) {
+                PrintDomain(name, v);
+            }
+        }
+        for (const auto& name : pages) {
+            PrintStatsPage(name);
+        }
+        std::fflush(stdout);
+        if (opt.once) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(opt.interval));
+    }
+    return 0;
+}
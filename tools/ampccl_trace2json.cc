@@ -0,0 +1,117 @@
+// ampccl-trace2json: convert AMPCCL_TRACE binary files to Chrome trace JSON.
+// Load the output in chrome://tracing or ui.perfetto.dev, alone or merged with
+// framework traces (timestamps are wall clock).
+//
+//   ampccl-trace2json trace.rank0.bin trace.rank1.bin > ampccl.json
+//
+// One process per rank ("AmpCCL rank N"), with three tracks:
+//   host - time spent inside the collective call (plan + launches)
+//   fast - fast-path device time, PCIe - PCIe-path device time
+// Device spans start at the host launch time, so they are placed approximately.
+
+#include "telemetry/trace.h"
+#include "common/op_key.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <vector>
+
+namespace {
+
+using ampccl::TraceFileHeader;
+using ampccl::TraceRecord;
+
+enum Track { kHostTrack = 0, kFastTrack = 1, kPCIeTrack = 2 };
+
+bool first_event = true;
+
+void BeginEvent() {
+    std::printf(first_event ? "\n" : ",\n");
+    first_event = false;
+}
+
+void EmitSpan(const TraceRecord& r, int pid, Track track, double ts_us, double dur_us,
+              uint64_t track_bytes) {
+    BeginEvent();
+    std::printf("{\"name\":\"%s\",\"cat\":\"ampccl\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"seq\":%" PRIu64 ",\"bytes\":%" PRIu64
+                ",\"path_bytes\":%" PRIu64 ",\"alpha\":%.4f,\"datatype\":%d,\"use_pcie\":%d,"
+                "\"fast_ok\":%d,\"pcie_ok\":%d,\"domain\":\"%016" PRIx64 "\"}}",
+                ampccl::CollectiveTypeName(static_cast<ampccl::CollectiveType>(r.op)), pid,
+                static_cast<int>(track), ts_us, dur_us, r.seq, r.bytes, track_bytes, r.alpha,
+                r.datatype, (r.flags & ampccl::kTraceUsePCIe) ? 1 : 0,
+                (r.flags & ampccl::kTraceFastOk) ? 1 : 0, (r.flags & ampccl::kTracePCIeOk) ? 1 : 0,
+                r.domain);
+}
+
+void EmitMetadata(int pid, int rank) {
+    BeginEvent();
+    std::printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"AmpCCL rank %d\"}}",
+                pid, rank);
+    static const char* kTrackNames[] = {"host", "fast", "PCIe"};
+    for (int t = 0; t < 3; ++t) {
+        BeginEvent();
+        std::printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    pid, t, kTrackNames[t]);
+    }
+}
+
+// Returns the number of records converted, or -1 on a bad file.
+long ConvertFile(const char* path, std::set<int>* seen_pids) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (f == nullptr) {
+        std::fprintf(stderr, "ampccl-trace2json: cannot open %s\n", path);
+        return -1;
+    }
+    TraceFileHeader hdr;
+    if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != ampccl::kTraceMagic ||
+        hdr.record_size != sizeof(TraceRecord)) {
+        std::fprintf(stderr, "ampccl-trace2json: %s is not an AmpCCL trace (v%u)\n",
+                     path, ampccl::kTraceVersion);
+        std::fclose(f);
+        return -1;
+    }
+    long n = 0;
+    TraceRecord r;
+    while (std::fread(&r, sizeof(r), 1, f) == 1) {
+        // Rank when known, else the process id, so several files merge side by side.
+        int pid = r.rank >= 0 ? r.rank : hdr.pid;
+        if (seen_pids->insert(pid).second) {
+            EmitMetadata(pid, r.rank >= 0 ? r.rank : -1);
+        }
+        double ts = static_cast<double>(r.launch_ns) / 1000.0;
+        EmitSpan(r, pid, kHostTrack, ts, static_cast<double>(r.launch_cost_ns) / 1000.0, r.bytes);
+        if (r.fast_bytes > 0) {
+            EmitSpan(r, pid, kFastTrack, ts, r.fast_time * 1e6, r.fast_bytes);
+        }
+        if ((r.flags & ampccl::kTraceUsePCIe) && r.pcie_bytes > 0) {
+            EmitSpan(r, pid, kPCIeTrack, ts, r.pcie_time * 1e6, r.pcie_bytes);
+        }
+        ++n;
+    }
+    std::fclose(f);
+    return n;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2 || std::strcmp(argv[1], "--help") == 0) {
+        std::fprintf(stderr, "usage: ampccl-trace2json TRACE_FILE... > out.json\n");
+        return argc < 2 ? 1 : 0;
+    }
+    std::set<int> seen_pids;
+    std::printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    int rc = 0;
+    for (int i = 1; i < argc; ++i) {
+        long n = ConvertFile(argv[i], &seen_pids);
+        if (n < 0) {
+            rc = 1;
+            continue;
+        }
+        std::fprintf(stderr, "ampccl-trace2json: %s: %ld records\n", argv[i], n);
+    }
+    std::printf("\n]}\n");
+    return rc;
+}
@@ -0,0 +1,420 @@
+// ampccl-tune: offline autotuner.
+// Drives VirtualCollective directly (no framework) over a grid of ops, datatypes,
+// sizes and alphas, measures per-path times, and writes the best split per
+// (op, size class) into a profile file that the runtime preloads through
+// AMPCCL_PROFILE_PRELOAD (or uses as a warm-start AMPCCL_PROFILE).
+//
+// Single rank:  ampccl-tune --out /etc/ampccl/profile.bin
+// N ranks:      one process per rank, e.g.
+//   ampccl-tune --rank $R --nranks 8 --device $R --id-file /tmp/tune.id --out profile.bin
+// Rank 0 merges per-rank results (max over ranks) and writes the profile.
+
+#include "core/virtual_collective.h"
+#include "core/domain_manager.h"
+#include "core/comm_init.h"
+#include "core/stream_sync.h"
+#include "core/profile_store.h"
+#include "controller/algo_factory.h"
+#include "common/op_key.h"
+#include <dlfcn.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t kUniqueIdBytes = 128;
+struct UniqueId { char internal[kUniqueIdBytes]; };
+
+// Device runtime + CCL entry points, resolved with dlopen like the hooks do.
+struct Runtime {
+    // CCL
+    int (*get_unique_id)(UniqueId*) = nullptr;
+    int (*comm_init_rank)(void**, int, UniqueId, int) = nullptr;
+    int (*comm_destroy)(void*) = nullptr;
+    // Collectives, registered as the fast backend; enums and handles pass as int / void*.
+    int (*all_reduce)(const void*, void*, size_t, int, int, void*, void*) = nullptr;
+    int (*all_gather)(const void*, void*, size_t, int, void*, void*) = nullptr;
+    size_t (*datatype_size)(int) = nullptr;
+    // Device
+    int (*set_device)(int) = nullptr;
+    int (*malloc_fn)(void**, size_t) = nullptr;
+    int (*free_fn)(void*) = nullptr;
+    int (*create_stream)(void**) = nullptr;
+    int (*sync_stream)(void*) = nullptr;
+    // Device model name for the profile fingerprint: cudaGetDeviceProperties fills a
+    // cudaDeviceProp, led by name[256]; aclrtGetSocName returns the SoC name.
+    int (*device_props)(void*, int) = nullptr;
+    const char* (*soc_name)() = nullptr;
+    // ACL uses a policy argument for malloc
+    int (*acl_malloc)(void**, size_t, int) = nullptr;
+    int (*acl_init)(const char*) = nullptr;
+};
+
+// ncclInt8 .. ncclBfloat16 (nccl.h values).
+size_t NcclDataTypeSize(int datatype) {
+    static const size_t kSizes[] = {1, 1, 4, 4, 8, 8, 2, 4, 8, 2};
+    return (datatype >= 0 && datatype < 10) ? kSizes[datatype] : 0;
+}
+
+// HCCL_DATA_TYPE_INT8 .. HCCL_DATA_TYPE_BFP16 (hccl_types.h values).
+size_t HcclDataTypeSize(int datatype) {
+    static const size_t kSizes[] = {1, 2, 4, 2, 4, 8, 8, 1, 2, 4, 8, 2};
+    return (datatype >= 0 && datatype < 12) ? kSizes[datatype] : 0;
+}
+
+void* OpenFirst(const char* a, const char* b) {
+    void* h = dlopen(a, RTLD_LAZY | RTLD_GLOBAL);
+    if (!h && b) h = dlopen(b, RTLD_LAZY | RTLD_GLOBAL);
+    return h;
+}
+
+bool LoadRuntime(const std::string& backend, Runtime* rt) {
+    if (backend == "nccl") {
+        void* ccl = OpenFirst("libnccl.so", "libnccl.so.2");
+        void* dev = OpenFirst("libcudart.so", nullptr);
+        if (!ccl || !dev) return false;
+        rt->get_unique_id = (int (*)(UniqueId*))dlsym(ccl, "ncclGetUniqueId");
+        rt->comm_init_rank = (int (*)(void**, int, UniqueId, int))dlsym(ccl, "ncclCommInitRank");
+        rt->comm_destroy = (int (*)(void*))dlsym(ccl, "ncclCommDestroy");
+        rt->all_reduce = (int (*)(const void*, void*, size_t, int, int, void*, void*))dlsym(ccl, "ncclAllReduce");
+        rt->all_gather = (int (*)(const void*, void*, size_t, int, void*, void*))dlsym(ccl, "ncclAllGather");
+        rt->datatype_size = &NcclDataTypeSize;
+        rt->set_device = (int (*)(int))dlsym(dev, "cudaSetDevice");
+        rt->malloc_fn = (int (*)(void**, size_t))dlsym(dev, "cudaMalloc");
+        rt->free_fn = (int (*)(void*))dlsym(dev, "cudaFree");
+        rt->create_stream = (int (*)(void**))dlsym(dev, "cudaStreamCreate");
+        rt->sync_stream = (int (*)(void*))dlsym(dev, "cudaStreamSynchronize");
+        rt->device_props = (int (*)(void*, int))dlsym(dev, "cudaGetDeviceProperties");
+    } else if (backend == "hccl") {
+        void* ccl = OpenFirst("libhccl.so", "libhccl.so.1");
+        void* dev = OpenFirst("libascendcl.so", "libacl.so");
+        if (!ccl || !dev) return false;
+        rt->get_unique_id = (int (*)(UniqueId*))dlsym(ccl, "HcclGetUniqueId");
+        rt->comm_init_rank = (int (*)(void**, int, UniqueId, int))dlsym(ccl, "HcclCommInitRank");
+        rt->comm_destroy = (int (*)(void*))dlsym(ccl, "HcclCommDestroy");
+        rt->all_reduce = (int (*)(const void*, void*, size_t, int, int, void*, void*))dlsym(ccl, "HcclAllReduce");
+        rt->all_gather = (int (*)(const void*, void*, size_t, int, void*, void*))dlsym(ccl, "HcclAllGather");
+        rt->datatype_size = &HcclDataTypeSize;
+        rt->acl_init = (int (*)(const char*))dlsym(dev, "aclInit");
+        rt->set_device = (int (*)(int))dlsym(dev, "aclrtSetDevice");
+        rt->acl_malloc = (int (*)(void**, size_t, int))dlsym(dev, "aclrtMalloc");
+        rt->free_fn = (int (*)(void*))dlsym(dev, "aclrtFree");
+        rt->create_stream = (int (*)(void**))dlsym(dev, "aclrtCreateStream");
+        rt->sync_stream = (int (*)(void*))dlsym(dev, "aclrtSynchronizeStream");
+        rt->soc_name = (const char* (*)())dlsym(dev, "aclrtGetSocName");
+    } else {
+        return false;
+    }
+    return rt->get_unique_id && rt->comm_init_rank && rt->all_reduce && rt->all_gather && rt->set_device &&
+           (rt->malloc_fn || rt->acl_malloc) && rt->create_stream && rt->sync_stream;
+}
+
+void* DeviceAlloc(const Runtime& rt, size_t bytes) {
+    void* p = nullptr;
+    int ret = rt.malloc_fn ? rt.malloc_fn(&p, bytes) : rt.acl_malloc(&p, bytes, 0);
+    return ret == 0 ? p : nullptr;
+}
+
+// Same name the hooks hash into the runtime fingerprint, or empty.
+std::string DeviceName(const Runtime& rt, int device) {
+    if (rt.soc_name) {
+        const char* soc = rt.soc_name();
+        return soc ? std::string(soc) : std::string();
+    }
+    alignas(8) static char prop[8192];
+    if (!rt.device_props || rt.device_props(prop, device) != 0) {
+        return std::string();
+    }
+    return std::string(prop, strnlen(prop, 256));
+}
+
+struct Options {
+    std::string backend = "nccl";
+    std::string out;
+    std::string id_file;
+    int rank = 0;
+    int nranks = 1;
+    int device = 0;
+    std::vector<ampccl::CollectiveType> ops = {ampccl::CollectiveType::AllReduce,
+                                               ampccl::CollectiveType::AllGather};
+    std::vector<int> dtypes = {0};
+    size_t min_bytes = 64 << 10;
+    size_t max_bytes = 256 << 20;
+    double alpha_step = 0.1;
+    int warmup = 3;
+    int iters = 10;
+};
+
+void Usage() {
+    std::fprintf(stderr,
+        "usage: ampccl-tune --out PATH [--backend nccl|hccl] [--rank R --nranks N --id-file PATH]\n"
+        "                   [--device D] [--ops allreduce,allgather] [--dtypes 0,2]\n"
+        "                   [--min-bytes B] [--max-bytes B] [--alpha-step S] [--warmup W] [--iters I]\n");
+}
+
+std::vector<std::string> Split(const std::string& s) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        if (end > start) out.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    return out;
+}
+
+bool ParseArgs(int argc, char** argv, Options* opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        auto next = [&](void) -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        const char* v = nullptr;
+        if (a == "--help" || a == "-h") return false;
+        if ((v = next()) == nullptr) return false;
+        if (a == "--backend") opt->backend = v;
+        else if (a == "--out") opt->out = v;
+        else if (a == "--id-file") opt->id_file = v;
+        else if (a == "--rank") opt->rank = std::atoi(v);
+        else if (a == "--nranks") opt->nranks = std::atoi(v);
+        else if (a == "--device") opt->device = std::atoi(v);
+        else if (a == "--min-bytes") opt->min_bytes = std::stoull(v);
+        else if (a == "--max-bytes") opt->max_bytes = std::stoull(v);
+        else if (a == "--alpha-step") opt->alpha_step = std::atof(v);
+        else if (a == "--warmup") opt->warmup = std::atoi(v);
+        else if (a == "--iters") opt->iters = std::atoi(v);
+        else if (a == "--dtypes") {
+            opt->dtypes.clear();
+            for (const auto& t : Split(v)) opt->dtypes.push_back(std::atoi(t.c_str()));
+        } else if (a == "--ops") {
+            opt->ops.clear();
+            for (const auto& t : Split(v)) {
+                if (t == "allreduce") opt->ops.push_back(ampccl::CollectiveType::AllReduce);
+                else if (t == "allgather") opt->ops.push_back(ampccl::CollectiveType::AllGather);
+                else return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return !opt->out.empty() && opt->nranks >= 1 && opt->rank >= 0 && opt->rank < opt->nranks &&
+           (opt->nranks == 1 || !opt->id_file.empty()) && opt->alpha_step > 0.0 &&
+           opt->min_bytes > 0 && opt->min_bytes <= opt->max_bytes && opt->iters > 0;
+}
+
+// Rank 0 publishes the unique id; other ranks poll for it.
+bool ExchangeUniqueId(const Options& opt, const Runtime& rt, UniqueId* id) {
+    if (opt.rank == 0) {
+        if (rt.get_unique_id(id) != 0) return false;
+        if (opt.nranks == 1) return true;
+        std::string tmp = opt.id_file + ".tmp";
+        std::ofstream f(tmp, std::ios::binary);
+        f.write(id->internal, kUniqueIdBytes);
+        f.close();
+        return std::rename(tmp.c_str(), opt.id_file.c_str()) == 0;
+    }
+    for (int tries = 0; tries < 6000; ++tries) {
+        std::ifstream f(opt.id_file, std::ios::binary);
+        if (f && f.read(id->internal, kUniqueIdBytes)) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// Every rank writes its mean times; rank 0 waits for all and keeps the max per point.
+bool MergeAcrossRanks(const Options& opt, std::vector<double>* times) {
+    if (opt.nranks == 1) return true;
+    std::string mine = opt.out + ".rank" + std::to_string(opt.rank);
+    {
+        std::string tmp = mine + ".tmp";
+        std::ofstream f(tmp, std::ios::binary);
+        f.write(reinterpret_cast<const char*>(times->data()), times->size() * sizeof(double));
+        f.close();
+        if (std::rename(tmp.c_str(), mine.c_str()) != 0) return false;
+    }
+    if (opt.rank != 0) return true;
+    std::vector<double> other(times->size());
+    for (int r = 1; r < opt.nranks; ++r) {
+        std::string path = opt.out + ".rank" + std::to_string(r);
+        bool ok = false;
+        for (int tries = 0; tries < 60000 && !ok; ++tries) {
+            std::ifstream f(path, std::ios::binary);
+            ok = f && f.read(reinterpret_cast<char*>(other.data()), other.size() * sizeof(double));
+            if (!ok) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!ok) {
+            std::fprintf(stderr, "ampccl-tune: timed out waiting for %s\n", path.c_str());
+            return false;
+        }
+        for (size_t i = 0; i < times->size(); ++i) {
+            if (other[i] > (*times)[i]) (*times)[i] = other[i];
+        }
+        std::remove(path.c_str());
+    }
+    std::remove(mine.c_str());
+    return true;
+}
+
+const char* OpName(ampccl::CollectiveType op) {
+    return op == ampccl::CollectiveType::AllReduce ? "AllReduce" : "AllGather";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    using namespace ampccl;
+    Options opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+    Runtime rt;
+    if (!LoadRuntime(opt.backend, &rt)) {
+        std::fprintf(stderr, "ampccl-tune: cannot load %s runtime libraries\n", opt.backend.c_str());
+        return 1;
+    }
+    // Unregistered fast ops are no-ops; the grid would only time the PCIe share.
+    FastBackendOps ops;
+    ops.all_reduce = rt.all_reduce;
+    ops.all_gather = rt.all_gather;
+    ops.datatype_size = rt.datatype_size;
+    FastBackendImpl::SetOps(ops);
+
+    if (rt.acl_init) rt.acl_init(nullptr);
+    rt.set_device(opt.device);
+
+    UniqueId id;
+    if (!ExchangeUniqueId(opt, rt, &id)) {
+        std::fprintf(stderr, "ampccl-tune: unique id exchange failed\n");
+        return 1;
+    }
+    void* comm = nullptr;
+    if (rt.comm_init_rank(&comm, opt.nranks, id, opt.rank) != 0 || comm == nullptr) {
+        std::fprintf(stderr, "ampccl-tune: CommInitRank failed\n");
+        return 1;
+    }
+    void* stream = nullptr;
+    rt.create_stream(&stream);
+
+    CommDomainKey key = BuildKeyFromNcclInit(opt.nranks, id.internal, kUniqueIdBytes, opt.rank);
+    CommDomain* domain = DomainManager::GetInstance().GetOrCreateDomainByKey(key);
+    domain->set_comm_rank(opt.rank);
+    // As the CommInit hook without a rank info exchange: grouped by the launcher's
+    // ranks per node, which the fingerprint and the PCCL group both follow.
+    domain->set_topology(BuildNodeTopology(opt.rank, opt.nranks, Config::GetLocalSize()));
+    InitPCIeForDomain(domain, opt.rank, opt.nranks);
+
+    // AllGather output is nranks times the input.
+    size_t buf_bytes = opt.max_bytes * static_cast<size_t>(opt.nranks);
+    void* sendbuf = DeviceAlloc(rt, buf_bytes);
+    void* recvbuf = DeviceAlloc(rt, buf_bytes);
+    if (!sendbuf || !recvbuf) {
+        std::fprintf(stderr, "ampccl-tune: device allocation of %zu bytes failed\n", buf_bytes);
+        return 1;
+    }
+
+    std::vector<size_t> sizes;
+    for (size_t b = opt.min_bytes; b <= opt.max_bytes; b *= 2) sizes.push_back(b);
+    std::vector<double> alphas;
+    for (double a = 0.0; a < 1.0 + 1e-9; a += opt.alpha_step) alphas.push_back(a > 1.0 ? 1.0 : a);
+
+    // times[op][dtype][size][alpha] = mean total time; fast/pcie bandwidth kept alongside.
+    size_t npoints = opt.ops.size() * opt.dtypes.size() * sizes.size() * alphas.size();
+    std::vector<double> times(npoints, 0.0);
+    std::vector<double> fast_bw(npoints, 0.0);
+    std::vector<double> pcie_bw(npoints, 0.0);
+
+    size_t idx = 0;
+    for (CollectiveType op : opt.ops) {
+        for (int dtype : opt.dtypes) {
+            size_t elem = VirtualCollective::GetDataTypeSize(dtype);
+            for (size_t bytes : sizes) {
+                size_t count = bytes / elem;
+                for (double alpha : alphas) {
+                    domain->controller = std::make_unique<AdaptiveController>(
+                        std::make_unique<StaticAlgo>(alpha));
+                    double sum = 0.0, fbw = 0.0, pbw = 0.0;
+                    for (int it = 0; it < opt.warmup + opt.iters; ++it) {
+                        if (op == CollectiveType::AllReduce) {
+                            VirtualCollective::AllReduce(domain, sendbuf, recvbuf, count, dtype,
+                                                         0 /* sum */, comm, stream);
+                        } else {
+                            VirtualCollective::AllGather(domain, sendbuf, recvbuf, count, dtype,
+                                                         comm, stream);
+                        }
+                        rt.sync_stream(stream);
+                        PendingCollective pending;
+                        ExecStat stat;
+                        if (!CollectPendingStat(stream, &pending, &stat) || it < opt.warmup) {
+                            continue;
+                        }
+                        sum += stat.GetTotalTime();
+                        fbw += stat.GetFastBandwidth();
+                        pbw += stat.GetPCIeBandwidth();
+                    }
+                    times[idx] = sum / opt.iters;
+                    fast_bw[idx] = fbw / opt.iters;
+                    pcie_bw[idx] = pbw / opt.iters;
+                    ++idx;
+                }
+            }
+        }
+    }
+
+    if (!MergeAcrossRanks(opt, &times)) {
+        return 1;
+    }
+    if (opt.rank != 0) {
+        return 0;
+    }
+
+    ProfileStore profile;
+    if (!profile.Open(opt.out)) {
+        std::fprintf(stderr, "ampccl-tune: cannot open profile %s\n", opt.out.c_str());
+        return 1;
+    }
+    uint64_t fingerprint =
+        ProfileStore::Fingerprint(key, domain->topology(), opt.backend.c_str(), DeviceName(rt, opt.device));
+    std::printf("%-10s %12s %8s %12s %12s\n", "op", "bytes", "alpha", "time_us", "fast_only_us");
+
+    // Best alpha per (op, size): lowest time summed over datatypes.
+    size_t per_size = alphas.size();
+    size_t per_dtype = sizes.size() * per_size;
+    size_t per_op = opt.dtypes.size() * per_dtype;
+    for (size_t o = 0; o < opt.ops.size(); ++o) {
+        for (size_t s = 0; s < sizes.size(); ++s) {
+            size_t best = 0;
+            double best_time = 0.0;
+            for (size_t a = 0; a < alphas.size(); ++a) {
+                double t = 0.0;
+                for (size_t d = 0; d < opt.dtypes.size(); ++d) {
+                    t += times[o * per_op + d * per_dtype + s * per_size + a];
+                }
+                if (a == 0 || t < best_time) {
+                    best = a;
+                    best_time = t;
+                }
+            }
+            size_t i0 = o * per_op + s * per_size;
+            double fast_only = 0.0;
+            for (size_t d = 0; d < opt.dtypes.size(); ++d) {
+                fast_only += times[o * per_op + d * per_dtype + s * per_size + alphas.size() - 1];
+            }
+            double alpha = alphas[best];
+            ParamValue value(alpha, alpha < 1.0, fast_bw[i0 + best], pcie_bw[i0 + best]);
+            profile.Put(fingerprint, opt.ops[o], SizeClassOf(sizes[s]), value);
+            std::printf("%-10s %12zu %8.2f %12.1f %12.1f\n", OpName(opt.ops[o]), sizes[s], alpha,
+                        best_time / opt.dtypes.size() * 1e6, fast_only / opt.dtypes.size() * 1e6);
+        }
+    }
+    std::printf("wrote %s (world_size=%d)\n", opt.out.c_str(), opt.nranks);
+
+    if (rt.comm_destroy) rt.comm_destroy(comm);
+    return 0;
+}